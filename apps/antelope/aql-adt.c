@@ -86,6 +86,7 @@ aql_clear(aql_adt_t *adt)
   adt->relation_count = 0;
   adt->attribute_count = 0;
   adt->value_count = 0;
+  adt->row_count = 0;
   adt->flags = 0;
   memset(adt->aggregators, 0, sizeof(adt->aggregators));
 }
@@ -125,7 +126,7 @@ aql_add_value(aql_adt_t *adt, domain_t domain, void *value_ptr)
 {
   attribute_value_t *value;
 
-  if(adt->value_count == AQL_ATTRIBUTE_LIMIT) {
+  if(adt->value_count == sizeof(adt->values) / sizeof(adt->values[0])) {
     return DB_LIMIT_ERROR;
   }
 
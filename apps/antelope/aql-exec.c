@@ -154,7 +154,14 @@ aql_execute(db_handle_t *handle, aql_adt_t *adt)
     result = relation_select(handle, rel, adt);
     break;
   case AQL_TYPE_INSERT:
-    result = relation_insert(rel, adt->values);
+    if(adt->row_count > 1) {
+      if(adt->value_count != adt->row_count * rel->attribute_count) {
+        break;
+      }
+      result = relation_insert_batch(rel, adt->values, adt->row_count);
+    } else {
+      result = relation_insert(rel, adt->values);
+    }
     break;
 #if DB_FEATURE_JOIN
   case AQL_TYPE_JOIN:
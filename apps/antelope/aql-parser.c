@@ -514,17 +514,40 @@ PARSER(select)
 
 PARSER(insert)
 {
+  uint8_t values_per_row;
+
   AQL_SET_TYPE(adt, AQL_TYPE_INSERT);
 
-  CONSUME(LEFT_PAREN);
+  values_per_row = 0;
+
+  /* Several rows may be given, separated by commas. */
+  do {
+    if(adt->row_count == AQL_INSERT_ROW_LIMIT) {
+      RETURN(SYNTAX_ERROR);
+    }
+
+    CONSUME(LEFT_PAREN);
+
+    if(!PARSE(values)) {
+      RETURN(SYNTAX_ERROR);
+    }
+
+    CONSUME(RIGHT_PAREN);
+    adt->row_count++;
+
+    /* All rows must have as many values as the first one. */
+    if(adt->row_count == 1) {
+      values_per_row = adt->value_count;
+    } else if(adt->value_count != adt->row_count * values_per_row) {
+      RETURN(SYNTAX_ERROR);
+    }
+    NEXT;
+  } while(TOKEN == COMMA);
 
-  if(!PARSE(values)) {
+  if(TOKEN != INTO) {
     RETURN(SYNTAX_ERROR);
   }
 
-  CONSUME(RIGHT_PAREN);
-  CONSUME(INTO);
-
   if(!PARSE(relations)) {
     RETURN(SYNTAX_ERROR);
   }
@@ -149,11 +149,12 @@ struct aql_adt {
   char relations[AQL_RELATION_LIMIT][RELATION_NAME_LENGTH + 1];
   aql_attribute_t attributes[AQL_ATTRIBUTE_LIMIT];
   aql_aggregator_t aggregators[AQL_ATTRIBUTE_LIMIT];
-  attribute_value_t values[AQL_ATTRIBUTE_LIMIT];
+  attribute_value_t values[AQL_ATTRIBUTE_LIMIT * AQL_INSERT_ROW_LIMIT];
   index_type_t index_type;
   uint8_t relation_count;
   uint8_t attribute_count;
   uint8_t value_count;
+  uint8_t row_count;
   uint8_t optype;
   uint8_t flags;
   void *lvm_instance;
@@ -104,6 +104,14 @@
 #endif /* DB_MAX_ELEMENT_SIZE */
 
 
+/* The size of the buffer in which rows of a batch insertion are
+   collected before being written to storage, e.g., 256. Preferably a
+   multiple of the flash page size. The default of 0 stores one row at
+   a time and saves the RAM. */
+#ifndef DB_INSERT_BUFFER_SIZE
+#define DB_INSERT_BUFFER_SIZE		0
+#endif /* DB_INSERT_BUFFER_SIZE */
+
 /* The maximum size of the LVM bytecode compiled from a
    single database query. */
 #ifndef DB_VM_BYTECODE_SIZE
@@ -133,6 +141,13 @@
 #define AQL_ATTRIBUTE_LIMIT    		5
 #endif /* AQL_ATTRIBUTE_LIMIT */
 
+/* The maximum number of rows in a single INSERT query. Each row
+   beyond the first adds AQL_ATTRIBUTE_LIMIT values to the query
+   structure. */
+#ifndef AQL_INSERT_ROW_LIMIT
+#define AQL_INSERT_ROW_LIMIT		1
+#endif /* AQL_INSERT_ROW_LIMIT */
+
 /*----------------------------------------------------------------------------*/
 
 /*
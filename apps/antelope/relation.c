@@ -68,6 +68,11 @@ struct source_dest_map {
 
 static struct source_dest_map attr_map[AQL_ATTRIBUTE_LIMIT];
 
+#if DB_INSERT_BUFFER_SIZE > 0
+/* Rows of a batch insertion are collected here before being stored. */
+static unsigned char insert_buffer[DB_INSERT_BUFFER_SIZE];
+#endif /* DB_INSERT_BUFFER_SIZE > 0 */
+
 #if DB_FEATURE_JOIN
 /*
  * The source_map structure is used for mapping attributes to
@@ -472,11 +477,11 @@ relation_remove(char *name, int remove_tuples)
   return result;
 }
 
-db_result_t
-relation_insert(relation_t *rel, attribute_value_t *values)
+/* Convert a set of values to the physical representation of a row. */
+static db_result_t
+encode_row(relation_t *rel, attribute_value_t *values, unsigned char *record)
 {
   attribute_t *attr;
-  unsigned char record[rel->row_length];
   unsigned char *ptr;
   attribute_value_t *value;
   db_result_t result;
@@ -533,20 +538,148 @@ relation_insert(relation_t *rel, attribute_value_t *values)
 #endif /* DEBUG */
 
     ptr += attr->element_size;
-    if(attr->index != NULL) {
+  }
+
+  PRINTF(")\n");
+
+  return DB_OK;
+}
+
+db_result_t
+relation_insert(relation_t *rel, attribute_value_t *values)
+{
+  attribute_t *attr;
+  unsigned char record[rel->row_length];
+  attribute_value_t *value;
+  db_result_t result;
+
+  result = encode_row(rel, values, record);
+  if(DB_ERROR(result)) {
+    return result;
+  }
+
+  for(attr = list_head(rel->attributes), value = values;
+      attr != NULL;
+      attr = attr->next, value++) {
+    if(attr->index != NULL && !(attr->flags & ATTRIBUTE_FLAG_INVALID)) {
       if(DB_ERROR(index_insert(attr->index, value, rel->next_row))) {
         return DB_INDEX_ERROR;
       }
     }
   }
 
-  PRINTF(")\n");
-
   rel->cardinality++;
   rel->next_row++;
   return storage_put_row(rel, record);
 }
 
+#if DB_INSERT_BUFFER_SIZE > 0
+static db_result_t
+insert_buffered(relation_t *rel, attribute_value_t *values, unsigned count)
+{
+  attribute_t *attr;
+  attribute_value_t *value;
+  unsigned char *ptr;
+  unsigned rows_per_buffer;
+  unsigned rows;
+  unsigned i;
+  unsigned j;
+  tuple_id_t first_row;
+  db_result_t result;
+
+  rows_per_buffer = sizeof(insert_buffer) / rel->row_length;
+
+  for(i = 0; i < count; i += rows) {
+    rows = count - i;
+    if(rows > rows_per_buffer) {
+      rows = rows_per_buffer;
+    }
+
+    ptr = insert_buffer;
+    for(j = 0; j < rows; j++) {
+      encode_row(rel, values + (i + j) * rel->attribute_count, ptr);
+      ptr += rel->row_length;
+    }
+
+    result = storage_put_rows(rel, insert_buffer, rows);
+    if(DB_ERROR(result)) {
+      return result;
+    }
+
+    first_row = rel->next_row;
+    rel->cardinality += rows;
+    rel->next_row += rows;
+
+    value = values + i * rel->attribute_count;
+    for(attr = list_head(rel->attributes);
+        attr != NULL;
+        attr = attr->next, value++) {
+      if(attr->index == NULL || (attr->flags & ATTRIBUTE_FLAG_INVALID)) {
+        continue;
+      }
+      for(j = 0; j < rows; j++) {
+        if(DB_ERROR(index_insert(attr->index,
+                                 value + j * rel->attribute_count,
+                                 first_row + j))) {
+          return DB_INDEX_ERROR;
+        }
+      }
+    }
+  }
+
+  return DB_OK;
+}
+#endif /* DB_INSERT_BUFFER_SIZE > 0 */
+
+/*
+ * Insert a batch of rows, given as count consecutive sets of values
+ * with one value per attribute of the relation.
+ *
+ * All rows are verified before anything is stored. The rows are then
+ * collected in insert_buffer and stored one full buffer at a time.
+ * The index entries for the rows in a buffer are inserted after the
+ * buffer has been stored, one index at a time. Hence, an index never
+ * refers to a row that has not been stored. If the insertion fails
+ * or is interrupted, the relation contains the rows of the buffers
+ * stored so far, and the index entries of the rows in the last
+ * stored buffer may be missing.
+ *
+ * Without an insert buffer (DB_INSERT_BUFFER_SIZE is 0), or for rows
+ * that do not fit in it, the rows are inserted one at a time with
+ * relation_insert(), and a failure leaves the rows before the one
+ * that failed.
+ */
+db_result_t
+relation_insert_batch(relation_t *rel, attribute_value_t *values,
+                      unsigned count)
+{
+  unsigned char record[rel->row_length];
+  unsigned i;
+  db_result_t result;
+
+  /* Verify all rows before storing any of them. */
+  for(i = 0; i < count; i++) {
+    result = encode_row(rel, values + i * rel->attribute_count, record);
+    if(DB_ERROR(result)) {
+      return result;
+    }
+  }
+
+#if DB_INSERT_BUFFER_SIZE > 0
+  if(rel->row_length > 0 && rel->row_length <= sizeof(insert_buffer)) {
+    return insert_buffered(rel, values, count);
+  }
+#endif /* DB_INSERT_BUFFER_SIZE > 0 */
+
+  for(i = 0; i < count; i++) {
+    result = relation_insert(rel, values + i * rel->attribute_count);
+    if(DB_ERROR(result)) {
+      return result;
+    }
+  }
+  return DB_OK;
+}
+
 static void
 aggregate(attribute_t *attr, attribute_value_t *value)
 {
@@ -438,12 +438,14 @@ storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
 }
 
 db_result_t
-storage_put_row(relation_t *rel, storage_row_t row)
+storage_put_rows(relation_t *rel, storage_row_t rows, unsigned count)
 {
   cfs_offset_t end;
   unsigned remaining;
+  unsigned i;
   int r;
-  unsigned char *last_byte;
+  unsigned char *ptr;
+  db_result_t result;
 #if DB_FEATURE_INTEGRITY
   int missing_bytes;
   char buf[rel->row_length];
@@ -465,28 +467,43 @@ storage_put_row(relation_t *rel, storage_row_t row)
   }
 #endif
 
-  /* Ensure that last written byte is separated from 0, to make file
-     lengths correct in Coffee. */
-  last_byte = row + rel->row_length - 1;
-  *last_byte ^= ROW_XOR;
+  /* Ensure that last written byte of each row is separated from 0,
+     to make file lengths correct in Coffee. */
+  for(i = 1; i <= count; i++) {
+    rows[i * rel->row_length - 1] ^= ROW_XOR;
+  }
 
-  remaining = rel->row_length;
+  /* The rows are contiguous, so they are stored with as few writes as
+     the file system allows. */
+  result = DB_OK;
+  ptr = rows;
+  remaining = count * rel->row_length;
   do {
-    r = cfs_write(rel->tuple_storage, row, remaining);
+    r = cfs_write(rel->tuple_storage, ptr, remaining);
     if(r < 0) {
       PRINTF("DB: Failed to store %u bytes\n", remaining);
-      *last_byte ^= ROW_XOR;
-      return DB_STORAGE_ERROR;
+      result = DB_STORAGE_ERROR;
+      break;
     }
-    row += r;
+    ptr += r;
     remaining -= r;
   } while(remaining > 0);
 
-  PRINTF("DB: Stored a of %d bytes\n", rel->row_length);
+  if(!DB_ERROR(result)) {
+    PRINTF("DB: Stored %u rows of %d bytes\n", count, rel->row_length);
+  }
 
-  *last_byte ^= ROW_XOR;
+  for(i = 1; i <= count; i++) {
+    rows[i * rel->row_length - 1] ^= ROW_XOR;
+  }
 
-  return DB_OK;
+  return result;
+}
+
+db_result_t
+storage_put_row(relation_t *rel, storage_row_t row)
+{
+  return storage_put_rows(rel, row, 1);
 }
 
 db_result_t
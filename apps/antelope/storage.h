@@ -66,6 +66,7 @@ db_result_t storage_put_index(index_t *);
 
 db_result_t storage_get_row(relation_t *, tuple_id_t *, storage_row_t);
 db_result_t storage_put_row(relation_t *, storage_row_t);
+db_result_t storage_put_rows(relation_t *, storage_row_t, unsigned);
 db_result_t storage_get_row_amount(relation_t *, tuple_id_t *);
 
 db_storage_id_t storage_open(const char *);
@@ -157,6 +157,7 @@ init_page(struct deluge_object *obj, int pagenum, int have)
   page->flags = 0;
   page->last_request = 0;
   page->last_data = 0;
+  page->tx_set = 0;
 
   if(have) {
     page->version = obj->version;
@@ -204,7 +205,7 @@ init_object(struct deluge_object *obj, char *filename, unsigned version)
   obj->version = obj->update_version = version;
   obj->current_rx_page = 0;
   obj->nrequests = 0;
-  obj->tx_set = 0;
+  obj->nservers = 0;
 
   obj->pages = malloc(OBJECT_PAGE_COUNT(*obj) * sizeof(*obj->pages));
   if(obj->pages == NULL) {
@@ -217,7 +218,7 @@ init_object(struct deluge_object *obj, char *filename, unsigned version)
     init_page(&current_object, i, 1);
   }
 
-  memset(obj->current_page, 0, sizeof(obj->current_page));
+  memset(obj->rx_pages, 0, sizeof(obj->rx_pages));
 
   return 0;
 }
@@ -236,32 +237,170 @@ highest_available_page(struct deluge_object *obj)
   return i;
 }
 
+static unsigned
+get_request_bits(const uint8_t *request_set, unsigned index)
+{
+  unsigned bit, i, bits;
+
+  bits = 0;
+  for(i = 0; i < N_PKT; i++) {
+    bit = index * N_PKT + i;
+    if(request_set[bit / 8] & (1 << (bit % 8))) {
+      bits |= 1 << i;
+    }
+  }
+  return bits;
+}
+
+static void
+set_request_bits(uint8_t *request_set, unsigned index, unsigned bits)
+{
+  unsigned bit, i;
+
+  for(i = 0; i < N_PKT; i++) {
+    bit = index * N_PKT + i;
+    if(bits & (1 << i)) {
+      request_set[bit / 8] |= 1 << (bit % 8);
+    }
+  }
+}
+
+static void
+update_server(struct deluge_object *obj, const rimeaddr_t *addr,
+              unsigned highest_available)
+{
+  struct deluge_server *server, *lowest;
+  int i;
+
+  lowest = NULL;
+  for(i = 0; i < obj->nservers; i++) {
+    server = &obj->servers[i];
+    if(rimeaddr_cmp(&server->addr, addr)) {
+      if(highest_available == 0) {
+        /* The neighbor has nothing more to offer. */
+        *server = obj->servers[--obj->nservers];
+      } else {
+        server->highest_available = highest_available;
+      }
+      return;
+    }
+    if(lowest == NULL ||
+       server->highest_available < lowest->highest_available) {
+      lowest = server;
+    }
+  }
+
+  if(highest_available == 0) {
+    return;
+  }
+
+  if(obj->nservers < DELUGE_MAX_SERVERS) {
+    server = &obj->servers[obj->nservers++];
+  } else if(lowest->highest_available < highest_available) {
+    server = lowest;
+  } else {
+    return;
+  }
+  rimeaddr_copy(&server->addr, addr);
+  server->highest_available = highest_available;
+}
+
+static void send_request(void *arg);
+
+static void
+schedule_request(struct deluge_object *obj, clock_time_t delay)
+{
+  ctimer_set(&rx_timer, delay + ((unsigned)random_rand() % T_R),
+	send_request, obj);
+}
+
 static void
 send_request(void *arg)
 {
   struct deluge_object *obj;
   struct deluge_msg_request request;
+  struct deluge_page *page;
+  uint8_t server_of[DELUGE_PIPELINE];
+  clock_time_t now;
+  unsigned i, j, n, pagenum, pending;
 
   obj = (struct deluge_object *)arg;
 
+  if(obj->nservers == 0) {
+    if(deluge_state == DELUGE_STATE_RX) {
+      transition(DELUGE_STATE_MAINTAIN);
+    }
+    return;
+  }
+
+  /* Assign each missing page of the window to one of the servers
+     that have it, so that different neighbors stream different pages
+     at the same time. Pages that were requested less than a request
+     round ago are still in flight. */
+  memset(server_of, DELUGE_MAX_SERVERS, sizeof(server_of));
+  now = clock_time();
+  for(i = 0; i < DELUGE_PIPELINE; i++) {
+    pagenum = obj->current_rx_page + i;
+    if(pagenum >= OBJECT_PAGE_COUNT(*obj)) {
+      break;
+    }
+    page = &obj->pages[pagenum];
+    if((page->flags & PAGE_COMPLETE) ||
+       now - page->last_request < CONST_OMEGA * ESTIMATED_TX_TIME) {
+      continue;
+    }
+
+    for(n = 0, j = 0; j < obj->nservers; j++) {
+      if(obj->servers[j].highest_available > pagenum) {
+        n++;
+      }
+    }
+    if(n == 0) {
+      continue;
+    }
+    n = pagenum % n;
+    for(j = 0; obj->servers[j].highest_available <= pagenum || n-- > 0; j++);
+
+    server_of[i] = j;
+    page->last_request = now;
+  }
+
   request.cmd = DELUGE_CMD_REQUEST;
   request.pagenum = obj->current_rx_page;
+  request.npages = DELUGE_PIPELINE;
   request.version = obj->pages[request.pagenum].version;
-  request.request_set = ~obj->pages[obj->current_rx_page].packet_set;
   request.object_id = obj->object_id;
 
-  PRINTF("Sending request for page %d, version %u, request_set %u\n", 
-	request.pagenum, request.version, request.request_set);
-  packetbuf_copyfrom(&request, sizeof(request));
-  unicast_send(&deluge_uc, &obj->summary_from);
+  for(j = 0; j < obj->nservers; j++) {
+    memset(request.request_set, 0, sizeof(request.request_set));
+    pending = 0;
+    for(i = 0; i < DELUGE_PIPELINE; i++) {
+      if(server_of[i] == j) {
+        /* NACK the packets that are still missing. */
+        set_request_bits(request.request_set, i,
+                         ~obj->pages[request.pagenum + i].packet_set & ALL_PACKETS);
+        pending = 1;
+      }
+    }
+    if(pending) {
+      PRINTF("Sending request for pages %d-%d, version %u, to %u.%u\n",
+	     request.pagenum, request.pagenum + DELUGE_PIPELINE - 1,
+	     request.version, obj->servers[j].addr.u8[0],
+	     obj->servers[j].addr.u8[1]);
+      packetbuf_copyfrom(&request, sizeof(request));
+      unicast_send(&deluge_uc, &obj->servers[j].addr);
+    }
+  }
 
   /* Deluge R.2 */
   if(++obj->nrequests == CONST_LAMBDA) {
     /* XXX check rate here too. */
     obj->nrequests = 0;
-    transition(DELUGE_STATE_MAINTAIN);
+    if(deluge_state == DELUGE_STATE_RX) {
+      transition(DELUGE_STATE_MAINTAIN);
+    }
   } else {
-    ctimer_reset(&rx_timer);
+    schedule_request(obj, CONST_OMEGA * ESTIMATED_TX_TIME);
   }
 }
 
@@ -316,6 +455,8 @@ handle_summary(struct deluge_msg_summary *msg, const rimeaddr_t *sender)
       return;
     }
 
+    update_server(&current_object, sender, msg->highest_available);
+
     oldest_request = oldest_data = now = clock_time();
     for(i = 0; i < msg->highest_available; i++) {
       page = &current_object.pages[i];
@@ -332,14 +473,13 @@ handle_summary(struct deluge_msg_summary *msg, const rimeaddr_t *sender)
       return;
     }
 
-    rimeaddr_copy(&current_object.summary_from, sender);
     transition(DELUGE_STATE_RX);
 
     if(ctimer_expired(&rx_timer)) {
-      ctimer_set(&rx_timer,
-	CONST_OMEGA * ESTIMATED_TX_TIME + ((unsigned)random_rand() % T_R),
-	send_request, &current_object);
+      schedule_request(&current_object, CONST_OMEGA * ESTIMATED_TX_TIME);
     }
+  } else {
+    update_server(&current_object, sender, 0);
   }
 }
 
@@ -361,7 +501,7 @@ send_page(struct deluge_object *obj, unsigned pagenum)
 
   /* Divide the page into packets and send them one at a time. */
   for(cp = buf; cp + S_PKT <= (unsigned char *)&buf[S_PAGE]; cp += S_PKT) {
-    if(obj->tx_set & (1 << pkt.packetnum)) {
+    if(obj->pages[pagenum].tx_set & (1 << pkt.packetnum)) {
       pkt.crc = crc16_data(cp, S_PKT, 0);
       memcpy(pkt.payload, cp, S_PKT);
       packetbuf_copyfrom(&pkt, sizeof(pkt));
@@ -369,26 +509,40 @@ send_page(struct deluge_object *obj, unsigned pagenum)
     }
     pkt.packetnum++;
   }
-  obj->tx_set = 0;
+  obj->pages[pagenum].tx_set = 0;
+}
+
+static int
+next_tx_page(struct deluge_object *obj)
+{
+  int i;
+
+  for(i = 0; i < OBJECT_PAGE_COUNT(*obj); i++) {
+    if(obj->pages[i].tx_set) {
+      return i;
+    }
+  }
+  return -1;
 }
 
 static void
 tx_callback(void *arg)
 {
   struct deluge_object *obj;
+  int pagenum;
 
   obj = (struct deluge_object *)arg;
-  if(obj->current_tx_page >= 0 && obj->tx_set) {
-    send_page(obj, obj->current_tx_page);
+  pagenum = next_tx_page(obj);
+  if(pagenum >= 0) {
+    send_page(obj, pagenum);
     /* Deluge T.2. */
-    if(obj->tx_set) {
+    if(next_tx_page(obj) >= 0) {
       packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
 			 PACKETBUF_ATTR_PACKET_TYPE_STREAM);
       ctimer_reset(&tx_timer);
     } else {
       packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
 			 PACKETBUF_ATTR_PACKET_TYPE_STREAM_END);
-      obj->current_tx_page = -1;
       transition(DELUGE_STATE_MAINTAIN);
     }
   }
@@ -397,33 +551,39 @@ tx_callback(void *arg)
 static void
 handle_request(struct deluge_msg_request *msg)
 {
-  int highest_available;
-
-  if(msg->pagenum >= OBJECT_PAGE_COUNT(current_object)) {
-    return;
-  }
+  struct deluge_page *page;
+  unsigned i, pagenum, request_set;
+  int queued;
 
   if(msg->version != current_object.version) {
     neighbor_inconsistency = 1;
+    return;
   }
 
-  highest_available = highest_available_page(&current_object);
-
-  /* Deluge M.6 */
-  if(msg->version == current_object.version &&
-      msg->pagenum <= highest_available) {
-    current_object.pages[msg->pagenum].last_request = clock_time();
-
-    /* Deluge T.1 */
-    if(msg->pagenum == current_object.current_tx_page) {
-      current_object.tx_set |= msg->request_set;
-    } else {
-      current_object.current_tx_page = msg->pagenum;
-      current_object.tx_set = msg->request_set;
+  queued = 0;
+  for(i = 0; i < msg->npages && i < DELUGE_PIPELINE; i++) {
+    pagenum = msg->pagenum + i;
+    if(pagenum >= OBJECT_PAGE_COUNT(current_object)) {
+      break;
+    }
+    request_set = get_request_bits(msg->request_set, i);
+    page = &current_object.pages[pagenum];
+
+    /* Deluge M.6. Any complete page can be served, not only those
+       below the highest available page. */
+    if(request_set != 0 && (page->flags & PAGE_COMPLETE)) {
+      page->last_request = clock_time();
+      /* Deluge T.1 */
+      page->tx_set |= request_set;
+      queued = 1;
     }
+  }
 
+  if(queued) {
     transition(DELUGE_STATE_TX);
-    ctimer_set(&tx_timer, CLOCK_SECOND, tx_callback, &current_object);
+    if(ctimer_expired(&tx_timer)) {
+      ctimer_set(&tx_timer, CLOCK_SECOND, tx_callback, &current_object);
+    }
   }
 }
 
@@ -433,6 +593,7 @@ handle_packet(struct deluge_msg_packet *msg)
   struct deluge_page *page;
   uint16_t crc;
   struct deluge_msg_packet packet;
+  uint8_t *buf;
 
   memcpy(&packet, msg, sizeof(packet));
 
@@ -440,7 +601,10 @@ handle_packet(struct deluge_msg_packet *msg)
 	(unsigned)packet.object_id, (unsigned)packet.version,
 	(unsigned)packet.pagenum, (unsigned)packet.packetnum);
 
-  if(packet.pagenum != current_object.current_rx_page) {
+  if(packet.pagenum < current_object.current_rx_page ||
+     packet.pagenum >= current_object.current_rx_page + DELUGE_PIPELINE ||
+     packet.pagenum >= OBJECT_PAGE_COUNT(current_object) ||
+     packet.packetnum >= N_PKT) {
     return;
   }
 
@@ -450,15 +614,15 @@ handle_packet(struct deluge_msg_packet *msg)
 
   page = &current_object.pages[packet.pagenum];
   if(packet.version == page->version && !(page->flags & PAGE_COMPLETE)) {
-    memcpy(&current_object.current_page[S_PKT * packet.packetnum],
-	packet.payload, S_PKT);
-
     crc = crc16_data(packet.payload, S_PKT, 0);
     if(packet.crc != crc) {
       PRINTF("packet crc: %hu, calculated crc: %hu\n", packet.crc, crc);
       return;
     }
 
+    buf = current_object.rx_pages[packet.pagenum % DELUGE_PIPELINE];
+    memcpy(&buf[S_PKT * packet.packetnum], packet.payload, S_PKT);
+
     page->last_data = clock_time();
     page->packet_set |= (1 << packet.packetnum);
 
@@ -467,27 +631,36 @@ handle_packet(struct deluge_msg_packet *msg)
       packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
 			 PACKETBUF_ATTR_PACKET_TYPE_STREAM_END);
 
-      write_page(&current_object, packet.pagenum, current_object.current_page);
+      write_page(&current_object, packet.pagenum, buf);
       page->version = packet.version;
       page->flags = PAGE_COMPLETE;
       PRINTF("Page %u completed\n", packet.pagenum);
 
-      current_object.current_rx_page++;
+      /* Slide the receive window past all complete pages. */
+      current_object.nrequests = 0;
+      while(current_object.current_rx_page < OBJECT_PAGE_COUNT(current_object) &&
+	    (current_object.pages[current_object.current_rx_page].flags & PAGE_COMPLETE)) {
+	current_object.current_rx_page++;
+      }
 
-      if(packet.pagenum == OBJECT_PAGE_COUNT(current_object) - 1) {
+      if(current_object.current_rx_page == OBJECT_PAGE_COUNT(current_object)) {
 	current_object.version = current_object.update_version;
 	leds_on(LEDS_RED);
-	PRINTF("Update completed for object %u, version %u\n", 
+	PRINTF("Update completed for object %u, version %u\n",
 	       (unsigned)current_object.object_id, packet.version);
-      } else if(current_object.current_rx_page < OBJECT_PAGE_COUNT(current_object)) {
-        if(ctimer_expired(&rx_timer)) {
-	  ctimer_set(&rx_timer,
-		CONST_OMEGA * ESTIMATED_TX_TIME + (random_rand() % T_R),
-		send_request, &current_object);
+	/* Deluge R.3 */
+	transition(DELUGE_STATE_MAINTAIN);
+      } else if(current_object.nservers > 0) {
+	/* Keep the pipeline full by requesting the pages that entered
+	   the window without waiting for the next summary. */
+	if(deluge_state != DELUGE_STATE_TX) {
+	  transition(DELUGE_STATE_RX);
 	}
+	schedule_request(&current_object, 0);
+      } else {
+	/* Deluge R.3 */
+	transition(DELUGE_STATE_MAINTAIN);
       }
-      /* Deluge R.3 */
-      transition(DELUGE_STATE_MAINTAIN);
     } else {
       /* More packets to come. Put lower layers in streaming mode. */
       packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
@@ -521,7 +694,7 @@ send_profile(struct deluge_object *obj)
 }
 
 static void
-handle_profile(struct deluge_msg_profile *msg)
+handle_profile(struct deluge_msg_profile *msg, const rimeaddr_t *sender)
 {
   int i;
   int npages;
@@ -537,7 +710,6 @@ handle_profile(struct deluge_msg_profile *msg)
 	msg->version, msg->npages);
 
   leds_off(LEDS_RED);
-  current_object.tx_set = 0;
 
   npages = OBJECT_PAGE_COUNT(*obj);
   obj->size = msg->npages * S_PAGE;
@@ -548,15 +720,21 @@ handle_profile(struct deluge_msg_profile *msg)
     return;
   }
 
+  if(msg->npages < npages) {
+    npages = msg->npages;
+  }
+
   memcpy(p, obj->pages, npages * sizeof(*obj->pages));
   free(obj->pages);
   obj->pages = (struct deluge_page *)p;
 
-  if(msg->npages < npages) {
-    npages = msg->npages;
-  }
+  /* Servers of the old version are of no use for the new one, but
+     the sender of the profile has all pages of the new version. */
+  obj->nservers = 0;
+  update_server(obj, sender, msg->npages);
 
   for(i = 0; i < npages; i++) {
+    obj->pages[i].tx_set = 0;
     if(msg->version_vector[i] > obj->pages[i].version) {
       obj->pages[i].packet_set = 0;
       obj->pages[i].flags &= ~PAGE_COMPLETE;
@@ -566,6 +744,7 @@ handle_profile(struct deluge_msg_profile *msg)
 
   for(; i < msg->npages; i++) {
     init_page(obj, i, 0);
+    obj->pages[i].version = msg->version_vector[i];
   }
 
   obj->current_rx_page = highest_available_page(obj);
@@ -573,9 +752,7 @@ handle_profile(struct deluge_msg_profile *msg)
 
   transition(DELUGE_STATE_RX);
 
-  ctimer_set(&rx_timer,
-	CONST_OMEGA * ESTIMATED_TX_TIME + ((unsigned)random_rand() % T_R),
-	send_request, obj);
+  schedule_request(obj, CONST_OMEGA * ESTIMATED_TX_TIME);
 }
 
 static void
@@ -607,7 +784,7 @@ command_dispatcher(const rimeaddr_t *sender)
     profile = (struct deluge_msg_profile *)msg;
     if(len >= sizeof(*profile) &&
        len >= sizeof(*profile) + profile->npages * profile->version_vector[0])
-      handle_profile((struct deluge_msg_profile *)msg);
+      handle_profile((struct deluge_msg_profile *)msg, sender);
     break;
   default:
     PRINTF("Incoming packet with unknown command: %d\n", msg[0]);
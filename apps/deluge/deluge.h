@@ -79,6 +79,25 @@ PROCESS_NAME(deluge_process);
 
 #define ALL_PACKETS		((1 << N_PKT) - 1)
 
+/* The number of consecutive pages that can be received at the same
+   time. Each page in the window needs an S_PAGE buffer. */
+#ifdef DELUGE_CONF_PIPELINE
+#define DELUGE_PIPELINE		DELUGE_CONF_PIPELINE
+#else
+#define DELUGE_PIPELINE		2
+#endif
+
+/* The number of neighbors that are remembered as page sources. Pages
+   in the receive window are spread over these neighbors. */
+#ifdef DELUGE_CONF_MAX_SERVERS
+#define DELUGE_MAX_SERVERS	DELUGE_CONF_MAX_SERVERS
+#else
+#define DELUGE_MAX_SERVERS	3
+#endif
+
+/* Bytes needed for a bitmap of N_PKT bits per page in the window. */
+#define REQUEST_SET_SIZE	((DELUGE_PIPELINE * N_PKT + 7) / 8)
+
 #define DELUGE_CMD_SUMMARY	1
 #define DELUGE_CMD_REQUEST	2
 #define DELUGE_CMD_PACKET	3
@@ -103,12 +122,15 @@ struct deluge_msg_summary {
   deluge_object_id_t object_id;
 };
 
+/* A request covers npages pages starting at pagenum. Bit
+   (i * N_PKT + n) of request_set asks for packet n of page pagenum + i. */
 struct deluge_msg_request {
   uint8_t cmd;
   uint8_t version;
   uint8_t pagenum;
-  uint8_t request_set;
+  uint8_t npages;
   deluge_object_id_t object_id;
+  uint8_t request_set[REQUEST_SET_SIZE];
 };
 
 struct deluge_msg_packet {
@@ -129,6 +151,11 @@ struct deluge_msg_profile {
   uint8_t version_vector[];
 };
 
+struct deluge_server {
+  rimeaddr_t addr;
+  uint8_t highest_available;
+};
+
 struct deluge_object {
   char *filename;
   uint16_t object_id;
@@ -137,16 +164,17 @@ struct deluge_object {
   uint8_t update_version;
   struct deluge_page *pages;
   uint8_t current_rx_page;
-  int8_t current_tx_page;
   uint8_t nrequests;
-  uint8_t current_page[S_PAGE];
-  uint8_t tx_set;
+  /* Page p of the receive window is buffered in rx_pages[p % DELUGE_PIPELINE]. */
+  uint8_t rx_pages[DELUGE_PIPELINE][S_PAGE];
   int cfs_fd;
-  rimeaddr_t summary_from;
+  struct deluge_server servers[DELUGE_MAX_SERVERS];
+  uint8_t nservers;
 };
 
 struct deluge_page {
   uint32_t packet_set;
+  uint8_t tx_set;
   uint16_t crc;
   clock_time_t last_request;
   clock_time_t last_data;
@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2011, Institute for Pervasive Computing, ETH Zurich
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      CoAP module for caching blockwise (Block2) representations
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "er-coap-07-block-cache.h"
+#include "lib/crc16.h"
+
+#define DEBUG 0
+#if DEBUG
+#define PRINTF(...) printf(__VA_ARGS__)
+#define PRINT6ADDR(addr) PRINTF("[%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x]", ((uint8_t *)addr)[0], ((uint8_t *)addr)[1], ((uint8_t *)addr)[2], ((uint8_t *)addr)[3], ((uint8_t *)addr)[4], ((uint8_t *)addr)[5], ((uint8_t *)addr)[6], ((uint8_t *)addr)[7], ((uint8_t *)addr)[8], ((uint8_t *)addr)[9], ((uint8_t *)addr)[10], ((uint8_t *)addr)[11], ((uint8_t *)addr)[12], ((uint8_t *)addr)[13], ((uint8_t *)addr)[14], ((uint8_t *)addr)[15])
+#define PRINTLLADDR(lladdr) PRINTF("[%02x:%02x:%02x:%02x:%02x:%02x]",(lladdr)->addr[0], (lladdr)->addr[1], (lladdr)->addr[2], (lladdr)->addr[3],(lladdr)->addr[4], (lladdr)->addr[5])
+#else
+#define PRINTF(...)
+#define PRINT6ADDR(addr)
+#define PRINTLLADDR(addr)
+#endif
+
+#if COAP_BLOCK_CACHE_SIZE
+
+MEMB(cached_blocks_memb, coap_cached_blocks_t, COAP_MAX_CACHED_TRANSFERS);
+LIST(cached_blocks_list); /* least recently used first */
+
+/* Representations are stored back to back, +1 for the terminating '\0' of snprintf() in the resource handlers. */
+static uint8_t pool[COAP_BLOCK_CACHE_SIZE+1];
+static uint16_t pool_used = 0;
+
+/*----------------------------------------------------------------------------*/
+static uint16_t
+hash(const char *str, size_t len)
+{
+  return crc16_data((const unsigned char *) str, len, 0);
+}
+/*----------------------------------------------------------------------------*/
+static void
+remove_cached_blocks(coap_cached_blocks_t *c)
+{
+  coap_cached_blocks_t *other = NULL;
+
+  PRINTF("Evicting %u bytes at %u\n", c->len, c->offset);
+
+  /* Compact the pool. */
+  memmove(pool + c->offset, pool + c->offset + c->len, pool_used - c->offset - c->len);
+  pool_used -= c->len;
+
+  for (other = (coap_cached_blocks_t*)list_head(cached_blocks_list); other; other = other->next)
+  {
+    if (other->offset > c->offset)
+    {
+      other->offset -= c->len;
+    }
+  }
+
+  list_remove(cached_blocks_list, c);
+  memb_free(&cached_blocks_memb, c);
+}
+/*----------------------------------------------------------------------------*/
+static void
+remove_expired(void)
+{
+  coap_cached_blocks_t *c = NULL;
+  coap_cached_blocks_t *next = NULL;
+
+  for (c = (coap_cached_blocks_t*)list_head(cached_blocks_list); c; c = next)
+  {
+    next = c->next;
+    if (stimer_expired(&c->lifetime))
+    {
+      remove_cached_blocks(c);
+    }
+  }
+}
+/*----------------------------------------------------------------------------*/
+static coap_cached_blocks_t *
+render(coap_packet_t *request, service_callback_t service)
+{
+  static coap_packet_t rendered[1];
+  coap_cached_blocks_t *c = NULL;
+  int32_t offset = 0;
+  int32_t new_offset = 0;
+  uint16_t size, len;
+  int ok;
+
+  if ((c = memb_alloc(&cached_blocks_memb))==NULL)
+  {
+    /* Replace the least recently used transfer. */
+    remove_cached_blocks((coap_cached_blocks_t*)list_head(cached_blocks_list));
+    c = memb_alloc(&cached_blocks_memb);
+  }
+
+  /* Also make room when the pool is full but transfer slots are free. */
+  while (COAP_BLOCK_CACHE_SIZE - pool_used < REST_MAX_CHUNK_SIZE && list_head(cached_blocks_list))
+  {
+    remove_cached_blocks((coap_cached_blocks_t*)list_head(cached_blocks_list));
+  }
+
+  c->offset = pool_used;
+  c->len = 0;
+  c->complete = 0;
+
+  /*
+   * Let the resource render as much as fits in one go, and continue from its offset until done or the pool is full.
+   * Handlers may write up to REST_MAX_CHUNK_SIZE+1 bytes whatever the preferred size, so only call them with that much room left.
+   */
+  while ((size = COAP_BLOCK_CACHE_SIZE - pool_used - c->len) >= REST_MAX_CHUNK_SIZE)
+  {
+    new_offset = offset;
+    coap_init_message(rendered, COAP_TYPE_ACK, CONTENT_2_05, request->mid);
+    coap_max_payload_len = size;
+    ok = service(request, rendered, pool + pool_used + c->len, size, &new_offset);
+    coap_max_payload_len = REST_MAX_CHUNK_SIZE;
+    if (!ok || coap_error_code!=NO_ERROR || rendered->code!=CONTENT_2_05)
+    {
+      /* Keep what was rendered so far, the resource will report the error for the later blocks. */
+      if (c->len > 0)
+      {
+        coap_error_code = NO_ERROR;
+      }
+      break;
+    }
+
+    if (c->len==0)
+    {
+      c->options = rendered->options;
+      c->content_type = rendered->content_type;
+      c->max_age = rendered->max_age;
+      c->etag_len = rendered->etag_len;
+      memcpy(c->etag, rendered->etag, rendered->etag_len);
+    }
+
+    /* Resources unaware of blockwise transfers may not use the buffer. */
+    len = MIN(rendered->payload_len, size);
+    if (rendered->payload!=pool + pool_used + c->len)
+    {
+      memmove(pool + pool_used + c->len, rendered->payload, len);
+    }
+    c->len += len;
+
+    /* An unchanged offset means the resource does not support blockwise transfers and returned everything. */
+    if (new_offset==-1 || new_offset==offset || len==0)
+    {
+      c->complete = 1;
+      break;
+    }
+    offset = new_offset;
+  }
+
+  if (c->len==0 && !c->complete)
+  {
+    memb_free(&cached_blocks_memb, c);
+    return NULL;
+  }
+
+  pool_used += c->len;
+
+  PRINTF("Rendered /%.*s: %u bytes%s\n", request->uri_path_len, request->uri_path, c->len, c->complete ? "" : " (incomplete)");
+
+  return c;
+}
+/*----------------------------------------------------------------------------*/
+coap_cached_blocks_t *
+coap_get_cached_blocks(coap_packet_t *request, uip_ipaddr_t *addr, uint16_t port, uint16_t block_size, service_callback_t service)
+{
+  coap_cached_blocks_t *c = NULL;
+  uint16_t path_hash, query_hash;
+  uint32_t block_end;
+
+  if (request->code!=COAP_GET)
+  {
+    return NULL;
+  }
+
+  remove_expired();
+
+  path_hash = hash(request->uri_path, request->uri_path_len);
+  query_hash = hash(request->uri_query, request->uri_query_len);
+
+  for (c = (coap_cached_blocks_t*)list_head(cached_blocks_list); c; c = c->next)
+  {
+    if (c->path_hash==path_hash && c->query_hash==query_hash && c->port==port && uip_ipaddr_cmp(&c->addr, addr)
+        && c->token_len==request->token_len && memcmp(c->token, request->token, c->token_len)==0)
+    {
+      break;
+    }
+  }
+
+  if (c)
+  {
+    /* The first block or a different ETag starts a new transfer. */
+    if (request->block2_num==0
+        || (IS_OPTION(request, COAP_OPTION_ETAG) && (request->etag_len!=c->etag_len || memcmp(request->etag, c->etag, c->etag_len)!=0)))
+    {
+      remove_cached_blocks(c);
+      c = NULL;
+    }
+    else
+    {
+      list_remove(cached_blocks_list, c);
+      list_add(cached_blocks_list, c);
+    }
+  }
+
+  if (c==NULL)
+  {
+    if ((c = render(request, service))==NULL)
+    {
+      return NULL;
+    }
+
+    uip_ipaddr_copy(&c->addr, addr);
+    c->port = port;
+    c->token_len = request->token_len;
+    memcpy(c->token, request->token, request->token_len);
+    c->path_hash = path_hash;
+    c->query_hash = query_hash;
+
+    list_add(cached_blocks_list, c);
+  }
+
+  stimer_set(&c->lifetime, COAP_BLOCK_CACHE_LIFETIME);
+
+  /* Blocks beyond an incomplete representation are left to the resource. */
+  block_end = (request->block2_num + 1) * block_size;
+  return (c->complete || block_end <= c->len) ? c : NULL;
+}
+/*----------------------------------------------------------------------------*/
+void
+coap_set_cached_block(coap_cached_blocks_t *c, coap_packet_t *response, uint32_t block_num, uint16_t block_size)
+{
+  uint32_t block_offset = block_num * block_size;
+
+  if (c->options & 1L<<COAP_OPTION_CONTENT_TYPE)
+  {
+    coap_set_header_content_type(response, c->content_type);
+  }
+  if (c->options & 1L<<COAP_OPTION_MAX_AGE)
+  {
+    coap_set_header_max_age(response, c->max_age);
+  }
+  if (c->options & 1L<<COAP_OPTION_ETAG)
+  {
+    coap_set_header_etag(response, c->etag, c->etag_len);
+  }
+
+  if (block_offset > 0 && block_offset >= c->len)
+  {
+    response->code = BAD_OPTION_4_02;
+    coap_set_payload(response, "BlockOutOfScope", 15);
+  }
+  else
+  {
+    coap_set_header_block2(response, block_num, !c->complete || c->len - block_offset > block_size, block_size);
+    coap_set_payload(response, pool + c->offset + block_offset, MIN(c->len - block_offset, block_size));
+  }
+
+  if (c->complete && block_offset + block_size >= c->len)
+  {
+    /* Last block: evict with the next request, the payload is still needed for serialization. */
+    stimer_set(&c->lifetime, 0);
+  }
+}
+/*----------------------------------------------------------------------------*/
+void
+coap_evict_cached_blocks(const char *url, size_t url_len)
+{
+  coap_cached_blocks_t *c = NULL;
+  coap_cached_blocks_t *next = NULL;
+  uint16_t path_hash = url ? hash(url, url_len) : 0;
+
+  for (c = (coap_cached_blocks_t*)list_head(cached_blocks_list); c; c = next)
+  {
+    next = c->next;
+    if (url==NULL || c->path_hash==path_hash)
+    {
+      remove_cached_blocks(c);
+    }
+  }
+}
+/*----------------------------------------------------------------------------*/
+#endif /* COAP_BLOCK_CACHE_SIZE */
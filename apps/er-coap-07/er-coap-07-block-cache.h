@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2011, Institute for Pervasive Computing, ETH Zurich
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      CoAP module for caching blockwise (Block2) representations
+ */
+
+#ifndef COAP_BLOCK_CACHE_H_
+#define COAP_BLOCK_CACHE_H_
+
+#include "er-coap-07.h"
+#include "er-coap-07-duplicates.h"
+
+/*
+ * Bytes of the pool into which representations of GET requests with a Block2 option are rendered.
+ * The following blocks of a transfer are served from the pool instead of invoking the resource again.
+ * The resource is only invoked with REST_MAX_CHUNK_SIZE+1 bytes free, so smaller pools cache nothing.
+ * 0 disables the cache.
+ */
+#ifndef COAP_BLOCK_CACHE_SIZE
+#define COAP_BLOCK_CACHE_SIZE         0
+#endif /* COAP_BLOCK_CACHE_SIZE */
+
+/* The number of blockwise transfers that can be cached at the same time. */
+#ifndef COAP_MAX_CACHED_TRANSFERS
+#define COAP_MAX_CACHED_TRANSFERS     2
+#endif /* COAP_MAX_CACHED_TRANSFERS */
+
+/* Time in seconds after which a transfer without new block requests is evicted. */
+#ifndef COAP_BLOCK_CACHE_LIFETIME
+#define COAP_BLOCK_CACHE_LIFETIME     COAP_MAX_TRANSMIT_SPAN
+#endif /* COAP_BLOCK_CACHE_LIFETIME */
+
+typedef struct coap_cached_blocks {
+  struct coap_cached_blocks *next; /* for LIST */
+
+  /* A transfer is identified by client endpoint, token, and request URI. */
+  uip_ipaddr_t addr;
+  uint16_t port;
+  uint8_t token_len;
+  uint8_t token[COAP_TOKEN_LEN];
+  uint16_t path_hash;
+  uint16_t query_hash;
+
+  /* Options of the rendered response that are repeated in every block. */
+  uint32_t options;
+  coap_content_type_t content_type;
+  uint32_t max_age;
+  uint8_t etag_len;
+  uint8_t etag[COAP_ETAG_LEN];
+
+  struct stimer lifetime;
+
+  uint16_t offset; /* position in the pool */
+  uint16_t len;
+  uint8_t complete; /* 0 if only the first len bytes of a larger representation fitted */
+} coap_cached_blocks_t;
+
+#if COAP_BLOCK_CACHE_SIZE
+
+coap_cached_blocks_t *coap_get_cached_blocks(coap_packet_t *request, uip_ipaddr_t *addr, uint16_t port, uint16_t block_size, service_callback_t service);
+void coap_set_cached_block(coap_cached_blocks_t *c, coap_packet_t *response, uint32_t block_num, uint16_t block_size);
+
+/* Evict the transfers of a resource whose representation has changed, or of all resources if url is NULL. */
+void coap_evict_cached_blocks(const char *url, size_t url_len);
+
+#endif /* COAP_BLOCK_CACHE_SIZE */
+
+#endif /* COAP_BLOCK_CACHE_H_ */
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2011, Institute for Pervasive Computing, ETH Zurich
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      CoAP module for streaming blockwise uploads (Block1)
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "er-coap-07-block1.h"
+#include "lib/crc16.h"
+
+#define DEBUG 0
+#if DEBUG
+#define PRINTF(...) printf(__VA_ARGS__)
+#define PRINT6ADDR(addr) PRINTF("[%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x]", ((uint8_t *)addr)[0], ((uint8_t *)addr)[1], ((uint8_t *)addr)[2], ((uint8_t *)addr)[3], ((uint8_t *)addr)[4], ((uint8_t *)addr)[5], ((uint8_t *)addr)[6], ((uint8_t *)addr)[7], ((uint8_t *)addr)[8], ((uint8_t *)addr)[9], ((uint8_t *)addr)[10], ((uint8_t *)addr)[11], ((uint8_t *)addr)[12], ((uint8_t *)addr)[13], ((uint8_t *)addr)[14], ((uint8_t *)addr)[15])
+#define PRINTLLADDR(lladdr) PRINTF("[%02x:%02x:%02x:%02x:%02x:%02x]",(lladdr)->addr[0], (lladdr)->addr[1], (lladdr)->addr[2], (lladdr)->addr[3],(lladdr)->addr[4], (lladdr)->addr[5])
+#else
+#define PRINTF(...)
+#define PRINT6ADDR(addr)
+#define PRINTLLADDR(addr)
+#endif
+
+MEMB(uploads_memb, coap_upload_t, COAP_MAX_OPEN_UPLOADS);
+LIST(uploads_list);
+
+/*----------------------------------------------------------------------------*/
+static void
+remove_upload(coap_upload_t *u)
+{
+  list_remove(uploads_list, u);
+  memb_free(&uploads_memb, u);
+}
+/*----------------------------------------------------------------------------*/
+static coap_upload_t *
+get_upload(uip_ipaddr_t *addr, uint16_t port, coap_packet_t *request, uint16_t path_hash)
+{
+  coap_upload_t *u = NULL;
+  coap_upload_t *next = NULL;
+
+  for (u = (coap_upload_t*)list_head(uploads_list); u; u = next)
+  {
+    next = u->next;
+    if (stimer_expired(&u->lifetime))
+    {
+      PRINTF("Block1: upload of %lu bytes timed out\n", u->received);
+      remove_upload(u);
+    }
+  }
+
+  for (u = (coap_upload_t*)list_head(uploads_list); u; u = u->next)
+  {
+    if (u->path_hash==path_hash && u->port==port && uip_ipaddr_cmp(&u->addr, addr)
+        && u->token_len==request->token_len && memcmp(u->token, request->token, u->token_len)==0)
+    {
+      return u;
+    }
+  }
+  return NULL;
+}
+/*----------------------------------------------------------------------------*/
+static void
+reject(coap_packet_t *response, coap_status_t code, const char *message)
+{
+  coap_set_status_code(response, code);
+  coap_set_payload(response, message, strlen(message));
+}
+/*----------------------------------------------------------------------------*/
+int
+coap_block1_stream(uip_ipaddr_t *addr, uint16_t port, void *request, void *response, coap_block1_handler_t block_handler)
+{
+  coap_packet_t *const coap_req = (coap_packet_t *) request;
+  coap_upload_t *u = NULL;
+  uint16_t path_hash = 0;
+  uint32_t block_num = 0;
+  uint8_t more = 0;
+  uint16_t block_size = REST_MAX_CHUNK_SIZE;
+  uint32_t offset = 0;
+  uint32_t size = 0;
+  uint8_t *data = NULL;
+  uint16_t len = coap_get_payload(request, &data);
+  coap_status_t status;
+
+  if (!coap_get_header_block1(request, &block_num, &more, &block_size, &offset))
+  {
+    /* A single block. */
+    coap_get_header_size(request, &size);
+    status = block_handler(request, response, 0, data, len, size ? size : len, 0);
+    if (status!=NO_ERROR)
+    {
+      coap_set_status_code(response, status);
+    }
+    return status==NO_ERROR;
+  }
+
+  if (block_size > REST_MAX_CHUNK_SIZE)
+  {
+    /* The payload was truncated to REST_MAX_CHUNK_SIZE; ask for smaller blocks. */
+    for (block_size = 2048; block_size > REST_MAX_CHUNK_SIZE; block_size >>= 1);
+    reject(response, REQUEST_ENTITY_TOO_LARGE_4_13, "BlockTooLarge");
+    coap_set_header_block1(response, block_num, 0, block_size);
+    return 0;
+  }
+
+  path_hash = crc16_data((const unsigned char *) coap_req->uri_path, coap_req->uri_path_len, 0);
+  u = get_upload(addr, port, coap_req, path_hash);
+
+  if (block_num==0)
+  {
+    /* A new upload, possibly restarting an old one. */
+    if (u)
+    {
+      remove_upload(u);
+    }
+    if (more)
+    {
+      if ((u = memb_alloc(&uploads_memb))==NULL)
+      {
+        reject(response, SERVICE_UNAVAILABLE_5_03, "TooManyUploads");
+        return 0;
+      }
+      uip_ipaddr_copy(&u->addr, addr);
+      u->port = port;
+      u->token_len = coap_req->token_len;
+      memcpy(u->token, coap_req->token, coap_req->token_len);
+      u->path_hash = path_hash;
+      u->received = 0;
+      u->size = 0;
+      coap_get_header_size(request, &u->size);
+      list_add(uploads_list, u);
+    }
+    else if (!coap_get_header_size(request, &size))
+    {
+      size = len;
+    }
+  }
+  else if (u==NULL)
+  {
+    reject(response, REQUEST_ENTITY_INCOMPLETE_4_08, "NoUpload");
+    return 0;
+  }
+  else if (offset + len <= u->received)
+  {
+    /* Retransmission of a block with a new MID; acknowledge it again. */
+    PRINTF("Block1: block %lu again\n", block_num);
+    coap_set_status_code(response, CHANGED_2_04);
+    coap_set_header_block1(response, block_num, 1, block_size);
+    return 0;
+  }
+  else if (offset!=u->received)
+  {
+    PRINTF("Block1: block %lu at %lu, expected %lu\n", block_num, offset, u->received);
+    remove_upload(u);
+    reject(response, REQUEST_ENTITY_INCOMPLETE_4_08, "MissingBlock");
+    return 0;
+  }
+
+  if (u)
+  {
+    size = u->size;
+  }
+
+  if ((status = block_handler(request, response, offset, data, len, size, more))!=NO_ERROR)
+  {
+    PRINTF("Block1: block %lu rejected with %u\n", block_num, status);
+    if (u)
+    {
+      remove_upload(u);
+    }
+    coap_set_status_code(response, status);
+    return 0;
+  }
+
+  coap_set_header_block1(response, block_num, more, block_size);
+
+  if (more)
+  {
+    u->received += len;
+    stimer_set(&u->lifetime, COAP_UPLOAD_LIFETIME);
+    coap_set_status_code(response, CHANGED_2_04);
+    return 0;
+  }
+
+  if (u)
+  {
+    remove_upload(u);
+  }
+  return 1;
+}
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2011, Institute for Pervasive Computing, ETH Zurich
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      CoAP module for streaming blockwise uploads (Block1)
+ */
+
+#ifndef COAP_BLOCK1_H_
+#define COAP_BLOCK1_H_
+
+#include "er-coap-07.h"
+#include "er-coap-07-duplicates.h"
+
+/*
+ * The number of Block1 uploads that can be in progress at the same time.
+ */
+#ifndef COAP_MAX_OPEN_UPLOADS
+#define COAP_MAX_OPEN_UPLOADS       2
+#endif /* COAP_MAX_OPEN_UPLOADS */
+
+/* Time in seconds after which an upload without new blocks is abandoned. */
+#ifndef COAP_UPLOAD_LIFETIME
+#define COAP_UPLOAD_LIFETIME        COAP_MAX_TRANSMIT_SPAN
+#endif /* COAP_UPLOAD_LIFETIME */
+
+/*
+ * Called with each new block of an upload, in order and without gaps.
+ * offset is the position of data in the whole body, size the total length announced with the Size option (0 if unknown),
+ * and more is 0 for the last block. Return NO_ERROR to continue, or a response code to reject the upload.
+ * The size is known with the first block, so that an upload can be refused before anything was transferred.
+ */
+typedef coap_status_t (*coap_block1_handler_t)(void *request, void *response, uint32_t offset, const uint8_t *data, uint16_t len, uint32_t size, uint8_t more);
+
+typedef struct coap_upload {
+  struct coap_upload *next; /* for LIST */
+
+  uip_ipaddr_t addr;
+  uint16_t port;
+  uint8_t token_len;
+  uint8_t token[COAP_TOKEN_LEN];
+  uint16_t path_hash;
+
+  uint32_t received; /* bytes delivered to the handler */
+  uint32_t size;
+  struct stimer lifetime;
+} coap_upload_t;
+
+/*
+ * To be called from the handler of a PUT or POST resource with the client endpoint of the request, which identifies the
+ * upload together with the token and Uri-Path. Passes the payload of the request to block_handler and sets
+ * the Block1 option of the response. Returns 1 when the last block was accepted and the resource must set the final
+ * response code; returns 0 if more blocks are expected or the upload was rejected, with the response already set.
+ * Requests without Block1 option are delivered as a single last block.
+ */
+int coap_block1_stream(uip_ipaddr_t *addr, uint16_t port, void *request, void *response, coap_block1_handler_t block_handler);
+
+#endif /* COAP_BLOCK1_H_ */
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2011, Institute for Pervasive Computing, ETH Zurich
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      CoAP module for duplicate detection
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "er-coap-07-duplicates.h"
+
+#define DEBUG 0
+#if DEBUG
+#define PRINTF(...) printf(__VA_ARGS__)
+#define PRINT6ADDR(addr) PRINTF("[%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x]", ((uint8_t *)addr)[0], ((uint8_t *)addr)[1], ((uint8_t *)addr)[2], ((uint8_t *)addr)[3], ((uint8_t *)addr)[4], ((uint8_t *)addr)[5], ((uint8_t *)addr)[6], ((uint8_t *)addr)[7], ((uint8_t *)addr)[8], ((uint8_t *)addr)[9], ((uint8_t *)addr)[10], ((uint8_t *)addr)[11], ((uint8_t *)addr)[12], ((uint8_t *)addr)[13], ((uint8_t *)addr)[14], ((uint8_t *)addr)[15])
+#define PRINTLLADDR(lladdr) PRINTF("[%02x:%02x:%02x:%02x:%02x:%02x]",(lladdr)->addr[0], (lladdr)->addr[1], (lladdr)->addr[2], (lladdr)->addr[3],(lladdr)->addr[4], (lladdr)->addr[5])
+#else
+#define PRINTF(...)
+#define PRINT6ADDR(addr)
+#define PRINTLLADDR(addr)
+#endif
+
+coap_duplicate_stats_t coap_duplicate_stats;
+
+#if COAP_MAX_DUPLICATES
+
+MEMB(duplicates_memb, coap_duplicate_t, COAP_MAX_DUPLICATES);
+LIST(duplicates_list); /* oldest first */
+
+/*----------------------------------------------------------------------------*/
+coap_duplicate_t *
+coap_get_duplicate(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
+{
+  coap_duplicate_t *d = NULL;
+  coap_duplicate_t *next = NULL;
+
+  for (d = (coap_duplicate_t*)list_head(duplicates_list); d; d = next)
+  {
+    next = d->next;
+
+    if (stimer_expired(&d->lifetime))
+    {
+      PRINTF("Expiring MID %u\n", d->mid);
+      list_remove(duplicates_list, d);
+      memb_free(&duplicates_memb, d);
+    }
+    else if (d->mid==mid && d->port==port && uip_ipaddr_cmp(&d->addr, addr))
+    {
+      PRINTF("Duplicate of MID %u from ", mid);
+      PRINT6ADDR(addr);
+      PRINTF(":%u\n", uip_ntohs(port));
+      ++coap_duplicate_stats.hits;
+      return d;
+    }
+  }
+
+  ++coap_duplicate_stats.misses;
+  return NULL;
+}
+/*----------------------------------------------------------------------------*/
+void
+coap_store_duplicate(uint16_t mid, uip_ipaddr_t *addr, uint16_t port, uint8_t *packet, uint16_t packet_len)
+{
+  coap_duplicate_t *d = memb_alloc(&duplicates_memb);
+
+  if (d==NULL)
+  {
+    /* Replace the oldest exchange. */
+    d = list_pop(duplicates_list);
+  }
+
+  if (d)
+  {
+    d->mid = mid;
+    uip_ipaddr_copy(&d->addr, addr);
+    d->port = port;
+    stimer_set(&d->lifetime, COAP_EXCHANGE_LIFETIME);
+
+    d->packet_len = MIN(packet_len, COAP_MAX_PACKET_SIZE);
+    memcpy(d->packet, packet, d->packet_len);
+
+    PRINTF("Storing response to MID %u (%u bytes)\n", mid, d->packet_len);
+    list_add(duplicates_list, d);
+  }
+}
+/*----------------------------------------------------------------------------*/
+
+#endif /* COAP_MAX_DUPLICATES */
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2011, Institute for Pervasive Computing, ETH Zurich
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      CoAP module for duplicate detection
+ */
+
+#ifndef COAP_DUPLICATES_H_
+#define COAP_DUPLICATES_H_
+
+#include "er-coap-07.h"
+
+/*
+ * The number of recent requests whose responses are kept to answer retransmissions.
+ * Each one holds a COAP_MAX_PACKET_SIZE copy of the response. Set to 0 to save the RAM;
+ * retransmitted requests are then handled again like new ones.
+ */
+#ifndef COAP_MAX_DUPLICATES
+#define COAP_MAX_DUPLICATES     2
+#endif /* COAP_MAX_DUPLICATES */
+
+/* Time in seconds from the first transmission of a confirmable request to the last retransmission. */
+#define COAP_MAX_TRANSMIT_SPAN  (COAP_RESPONSE_TIMEOUT * ((1 << COAP_MAX_RETRANSMIT) - 1) * COAP_RESPONSE_RANDOM_FACTOR)
+
+/* Maximum time in seconds a datagram takes through the network, and the time the peer takes to acknowledge. */
+#ifndef COAP_MAX_LATENCY
+#define COAP_MAX_LATENCY        100
+#endif /* COAP_MAX_LATENCY */
+#define COAP_PROCESSING_DELAY   COAP_RESPONSE_TIMEOUT
+
+/* Time in seconds during which a retransmission of a request can still arrive (247 s with the defaults). */
+#ifndef COAP_EXCHANGE_LIFETIME
+#define COAP_EXCHANGE_LIFETIME  (COAP_MAX_TRANSMIT_SPAN + 2 * COAP_MAX_LATENCY + COAP_PROCESSING_DELAY)
+#endif /* COAP_EXCHANGE_LIFETIME */
+
+typedef struct coap_duplicate {
+  struct coap_duplicate *next; /* for LIST */
+
+  uip_ipaddr_t addr;
+  uint16_t port;
+  uint16_t mid;
+  struct stimer lifetime;
+
+  uint16_t packet_len; /* 0 if the request was not answered */
+  uint8_t packet[COAP_MAX_PACKET_SIZE];
+} coap_duplicate_t;
+
+typedef struct coap_duplicate_stats {
+  uint32_t hits;
+  uint32_t misses;
+} coap_duplicate_stats_t;
+
+extern coap_duplicate_stats_t coap_duplicate_stats;
+
+#if COAP_MAX_DUPLICATES
+coap_duplicate_t *coap_get_duplicate(uint16_t mid, uip_ipaddr_t *addr, uint16_t port);
+void coap_store_duplicate(uint16_t mid, uip_ipaddr_t *addr, uint16_t port, uint8_t *packet, uint16_t packet_len);
+#else
+#define coap_get_duplicate(mid, addr, port)                            ((coap_duplicate_t *) NULL)
+#define coap_store_duplicate(mid, addr, port, packet, packet_len)
+#endif /* COAP_MAX_DUPLICATES */
+
+#endif /* COAP_DUPLICATES_H_ */
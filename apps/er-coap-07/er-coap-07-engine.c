@@ -86,6 +86,10 @@ coap_receive(void)
   static coap_packet_t message[1]; /* This way the packet can be treated as pointer as usual. */
   static coap_packet_t response[1];
   static coap_transaction_t *transaction = NULL;
+  coap_duplicate_t *duplicate = NULL;
+#if COAP_BLOCK_CACHE_SIZE
+  coap_cached_blocks_t *cached_blocks = NULL;
+#endif
 
   if (uip_newdata()) {
 
@@ -100,8 +104,6 @@ coap_receive(void)
     if (coap_error_code==NO_ERROR)
     {
 
-      /*TODO duplicates suppression, if required by application */
-
       PRINTF("  Parsed: v %u, t %u, oc %u, c %u, mid %u\n", message->version, message->type, message->option_count, message->code, message->mid);
       PRINTF("  URL: %.*s\n", message->uri_path_len, message->uri_path);
       PRINTF("  Payload: %.*s\n", message->payload_len, message->payload);
@@ -109,8 +111,17 @@ coap_receive(void)
       /* Handle requests. */
       if (message->code >= COAP_GET && message->code <= COAP_DELETE)
       {
+        /* Answer retransmitted requests with the stored response instead of invoking the resource again. */
+        if ( (duplicate = coap_get_duplicate(message->mid, &UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport)) )
+        {
+          if (duplicate->packet_len)
+          {
+            coap_send_message(&UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport, duplicate->packet, duplicate->packet_len);
+          }
+          transaction = NULL;
+        }
         /* Use transaction buffer for response to confirmable request. */
-        if ( (transaction = coap_new_transaction(message->mid, &UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport)) )
+        else if ( (transaction = coap_new_transaction(message->mid, &UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport)) )
         {
           uint32_t block_num = 0;
           uint16_t block_size = REST_MAX_CHUNK_SIZE;
@@ -147,8 +158,24 @@ coap_receive(void)
           /* Invoke resource handler. */
           if (service_cbk)
           {
+#if COAP_BLOCK_CACHE_SIZE
+            if (message->code!=COAP_GET)
+            {
+              /* The representation is likely to change. */
+              coap_evict_cached_blocks(message->uri_path, message->uri_path_len);
+            }
+
+            /* Serve the following blocks of a transfer from the representation rendered for the first one. */
+            if ( IS_OPTION(message, COAP_OPTION_BLOCK2)
+                 && (cached_blocks = coap_get_cached_blocks(message, &UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport, block_size, service_cbk)) )
+            {
+              PRINTF("Blockwise: cached block %lu\n", block_num);
+              coap_set_cached_block(cached_blocks, response, block_num, block_size);
+            }
+            else
+#endif
             /* Call REST framework and check if found and allowed. */
-            if (service_cbk(message, response, transaction->packet+COAP_MAX_HEADER_SIZE, block_size, &new_offset))
+            if (coap_error_code==NO_ERROR && service_cbk(message, response, transaction->packet+COAP_MAX_HEADER_SIZE, block_size, &new_offset))
             {
               if (coap_error_code==NO_ERROR)
               {
@@ -253,11 +280,19 @@ coap_receive(void)
 
     if (coap_error_code==NO_ERROR)
     {
-      if (transaction) coap_send_transaction(transaction);
+      if (transaction)
+      {
+        coap_store_duplicate(message->mid, &transaction->addr, transaction->port, transaction->packet, transaction->packet_len);
+        coap_send_transaction(transaction);
+      }
     }
     else if (coap_error_code==MANUAL_RESPONSE)
     {
       PRINTF("Clearing transaction for manual response");
+      /* Remember the empty ACK sent by coap_separate_accept(), NONs are just ignored when repeated. */
+      coap_init_message(response, COAP_TYPE_ACK, 0, message->mid);
+      coap_store_duplicate(message->mid, &transaction->addr, transaction->port, transaction->packet,
+                           message->type==COAP_TYPE_CON ? coap_serialize_message(response, transaction->packet) : 0);
       coap_clear_transaction(transaction);
     }
     else
@@ -302,18 +337,18 @@ coap_get_rest_method(void *packet)
 /*----------------------------------------------------------------------------*/
 
 /* The discover resource is automatically included for CoAP. */
-RESOURCE(well_known_core, METHOD_GET, ".well-known/core", "ct=40");
-void
-well_known_core_handler(void* request, void* response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+/*
+ * Renders the link-format description of all resources, or of those matching the rt filter,
+ * into the buffer, starting at offset. Returns the resource at which the buffer ran full, or NULL when done.
+ */
+static resource_t *
+well_known_core_render(const char *filter, int len, uint8_t *buffer, uint16_t preferred_size, int32_t *offset,
+                       size_t *bufpos_out, size_t *strpos_out)
 {
     size_t strpos = 0; /* position in overall string (which is larger than the buffer) */
     size_t bufpos = 0; /* position within buffer (bytes written) */
     size_t tmplen = 0;
     resource_t* resource = NULL;
-
-    /* For filtering. */
-    const char *filter = NULL;
-    int len = coap_get_query_variable(request, "rt", &filter);
     char *rt = NULL;
 
     for (resource = (resource_t*)list_head(rest_get_resources()); resource; resource = resource->next)
@@ -395,6 +430,79 @@ well_known_core_handler(void* request, void* response, uint8_t *buffer, uint16_t
       }
     }
 
+    *bufpos_out = bufpos;
+    *strpos_out = strpos;
+    return resource;
+}
+
+#if COAP_LINK_FORMAT_SIZE
+/* The unfiltered description, rebuilt when the number of resources has changed. */
+static char link_format[COAP_LINK_FORMAT_SIZE+1];
+static size_t link_format_len = 0;
+static int link_format_resources = -1;
+
+static int
+well_known_core_cached(void)
+{
+  int32_t offset = 0;
+  size_t strpos = 0;
+  int resources = list_length(rest_get_resources());
+
+  if (resources!=link_format_resources)
+  {
+    link_format_resources = resources;
+    if (well_known_core_render(NULL, 0, (uint8_t *) link_format, COAP_LINK_FORMAT_SIZE, &offset, &link_format_len, &strpos)!=NULL
+        || link_format_len!=strpos)
+    {
+      PRINTF("well_known_core: %u bytes do not fit COAP_LINK_FORMAT_SIZE\n", strpos);
+      link_format_len = 0;
+    }
+  }
+  return link_format_len > 0;
+}
+#endif /* COAP_LINK_FORMAT_SIZE */
+
+RESOURCE(well_known_core, METHOD_GET, ".well-known/core", "ct=40");
+void
+well_known_core_handler(void* request, void* response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+    size_t strpos = 0;
+    size_t bufpos = 0;
+    resource_t* resource = NULL;
+
+    /* For filtering. */
+    const char *filter = NULL;
+    int len = coap_get_query_variable(request, "rt", &filter);
+
+#if COAP_LINK_FORMAT_SIZE
+    if (!len && well_known_core_cached())
+    {
+      if (*offset < link_format_len)
+      {
+        bufpos = MIN(preferred_size, link_format_len - *offset);
+        coap_set_payload(response, link_format + *offset, bufpos);
+        coap_set_header_content_type(response, APPLICATION_LINK_FORMAT);
+      }
+      else
+      {
+        coap_set_status_code(response, BAD_OPTION_4_02);
+        coap_set_payload(response, "BlockOutOfScope", 15);
+      }
+
+      if (*offset + preferred_size >= link_format_len)
+      {
+        *offset = -1;
+      }
+      else
+      {
+        *offset += preferred_size;
+      }
+      return;
+    }
+#endif /* COAP_LINK_FORMAT_SIZE */
+
+    resource = well_known_core_render(len ? filter : NULL, len, buffer, preferred_size, offset, &bufpos, &strpos);
+
     if (bufpos>0) {
       PRINTF("BUF %d: %.*s\n", bufpos, bufpos, (char *) buffer);
 
@@ -521,6 +629,287 @@ PT_THREAD(coap_blocking_request(struct request_state_t *state, process_event_t e
   PT_END(&state->pt);
 }
 /*----------------------------------------------------------------------------*/
+#if COAP_NSTART > 1
+/* The interval between two requests of a full window: the round-trip time spread over the window. */
+#ifndef PIPELINE_SPACING
+#define PIPELINE_SPACING(rtt) ((rtt) / COAP_NSTART)
+#endif
+/* The number of blocks requested one at a time to measure the round-trip time. */
+#ifndef PIPELINE_CHECK_BLOCKS
+#define PIPELINE_CHECK_BLOCKS (4 * COAP_NSTART)
+#endif
+/* The number of blocks then pipelined before checking that this is faster. Kept short, as there is nothing to gain
+ * over one or two hops. */
+#ifndef PIPELINE_TRIAL_BLOCKS
+#define PIPELINE_TRIAL_BLOCKS (2 * COAP_NSTART)
+#endif
+
+enum {
+  PIPELINE_FREE,
+  PIPELINE_SENT,
+  PIPELINE_RECEIVED,
+  PIPELINE_INVALID,
+  PIPELINE_TIMEOUT,
+  PIPELINE_BUFFERED
+};
+
+void coap_pipelined_request_callback(void *callback_data, void *response) {
+  struct pipelined_request_slot_t *slot = (struct pipelined_request_slot_t *) callback_data;
+  coap_packet_t *const res = (coap_packet_t *) response;
+
+  slot->transaction = NULL;
+
+  if (res==NULL)
+  {
+    slot->status = PIPELINE_TIMEOUT;
+  }
+  else
+  {
+    /* The incoming buffer is reused before the requesting process runs, so keep a copy. */
+    slot->packet_len = res->payload - res->buffer + res->payload_len;
+    if (slot->packet_len > COAP_MAX_PACKET_SIZE)
+    {
+      slot->status = PIPELINE_INVALID;
+    }
+    else
+    {
+      memcpy(slot->packet, res->buffer, slot->packet_len);
+      slot->code = res->code;
+      if (!coap_get_header_block2(res, &slot->res_block, &slot->more, &slot->size, NULL))
+      {
+        slot->res_block = 0;
+        slot->more = 0;
+        slot->size = 0;
+      }
+      slot->status = PIPELINE_RECEIVED;
+    }
+  }
+  process_poll(slot->state->process);
+}
+/*----------------------------------------------------------------------------*/
+static int
+pipelined_request_send(struct pipelined_request_slot_t *slot, uint32_t block_num,
+                       uip_ipaddr_t *remote_ipaddr, uint16_t remote_port, coap_packet_t *request)
+{
+  request->mid = coap_get_mid();
+  if (!(slot->transaction = coap_new_transaction(request->mid, remote_ipaddr, remote_port)))
+  {
+    PRINTF("Could not allocate transaction buffer\n");
+    slot->status = PIPELINE_FREE;
+    return 0;
+  }
+  slot->transaction->callback = coap_pipelined_request_callback;
+  slot->transaction->callback_data = slot;
+
+  if (block_num>0 || IS_OPTION(request, COAP_OPTION_BLOCK2))
+  {
+    coap_set_header_block2(request, block_num, 0, slot->state->block_size);
+  }
+
+  slot->transaction->packet_len = coap_serialize_message(request, slot->transaction->packet);
+  slot->block_num = block_num;
+  slot->status = PIPELINE_SENT;
+
+  coap_send_transaction(slot->transaction);
+  PRINTF("Requested #%lu (MID %u)\n", block_num, request->mid);
+  return 1;
+}
+/*----------------------------------------------------------------------------*/
+static void
+pipelined_request_cancel(struct pipelined_request_state_t *state, uint32_t after_block)
+{
+  struct pipelined_request_slot_t *slot = NULL;
+
+  for (slot = state->slots; slot < state->slots + COAP_NSTART; ++slot)
+  {
+    if (slot->status!=PIPELINE_FREE && slot->block_num > after_block)
+    {
+      if (slot->status==PIPELINE_SENT && slot->transaction)
+      {
+        coap_clear_transaction(slot->transaction);
+        slot->transaction = NULL;
+      }
+      slot->status = PIPELINE_FREE;
+    }
+  }
+}
+/*----------------------------------------------------------------------------*/
+PT_THREAD(coap_pipelined_request(struct pipelined_request_state_t *state, process_event_t ev,
+                                 uip_ipaddr_t *remote_ipaddr, uint16_t remote_port,
+                                 coap_packet_t *request,
+                                 blocking_response_handler request_callback)) {
+  struct pipelined_request_slot_t *slot = NULL;
+  uint8_t in_flight = 0;
+  uint8_t delivered = 0;
+
+  PT_BEGIN(&state->pt);
+
+  state->process = PROCESS_CURRENT();
+  etimer_stop(&state->pace);
+  state->spacing = 0;
+  state->paced = 0;
+  state->window = 1; /* measure the round-trip time first */
+  state->checked = 0;
+  state->block_error = 0;
+  state->block_size = REST_MAX_CHUNK_SIZE;
+  state->next_request = 0;
+  state->next_block = 0;
+  state->last_block = 0xFFFFFFFF;
+
+  for (slot = state->slots; slot < state->slots + COAP_NSTART; ++slot)
+  {
+    slot->state = state;
+    slot->status = PIPELINE_FREE;
+  }
+
+  while (state->next_block <= state->last_block)
+  {
+    /* Fill the window. */
+    in_flight = 0;
+    for (slot = state->slots; slot < state->slots + COAP_NSTART; ++slot)
+    {
+      if (slot->status==PIPELINE_SENT) ++in_flight;
+    }
+    for (slot = state->slots; slot < state->slots + COAP_NSTART && in_flight < state->window && state->next_request <= state->last_block && (!state->spacing || state->paced); ++slot)
+    {
+      if (slot->status==PIPELINE_FREE)
+      {
+        if (!pipelined_request_send(slot, state->next_request, remote_ipaddr, remote_port, request))
+        {
+          break;
+        }
+        if (state->next_request==0)
+        {
+          state->started = clock_time();
+        }
+        ++in_flight;
+        ++(state->next_request);
+        if (state->spacing)
+        {
+          /* One request per interval, instead of the whole window as a burst. */
+          state->paced = 0;
+          etimer_set(&state->pace, state->spacing);
+        }
+      }
+    }
+    if (state->spacing && !state->paced && etimer_expired(&state->pace)
+        && in_flight < state->window && state->next_request <= state->last_block)
+    {
+      /* A response made room. Sending at once would meet the next response at the relays, so wait a random part of the interval. */
+      etimer_set(&state->pace, 1 + random_rand() % state->spacing);
+    }
+    if (in_flight==0 && etimer_expired(&state->pace))
+    {
+      /* Nothing in flight and nothing could be sent. */
+      pipelined_request_cancel(state, 0);
+      etimer_stop(&state->pace);
+      PT_EXIT(&state->pt);
+    }
+
+    PT_YIELD_UNTIL(&state->pt, ev == PROCESS_EVENT_POLL || (ev == PROCESS_EVENT_TIMER && etimer_expired(&state->pace)));
+    state->paced = ev == PROCESS_EVENT_TIMER;
+
+    for (slot = state->slots; slot < state->slots + COAP_NSTART; ++slot)
+    {
+      if (slot->status==PIPELINE_TIMEOUT)
+      {
+        PRINTF("Server not responding\n");
+        slot->status = PIPELINE_FREE;
+        pipelined_request_cancel(state, 0);
+        etimer_stop(&state->pace);
+        PT_EXIT(&state->pt);
+      }
+      if (slot->status!=PIPELINE_RECEIVED && slot->status!=PIPELINE_INVALID)
+      {
+        continue;
+      }
+
+      PRINTF("Received #%lu%s for #%lu\n", slot->res_block, slot->more ? "+" : "", slot->block_num);
+
+      if (slot->status==PIPELINE_RECEIVED && slot->code==BAD_OPTION_4_02 && slot->block_num>0)
+      {
+        /* Requested beyond the end of the representation. */
+        state->last_block = MIN(state->last_block, slot->block_num-1);
+        slot->status = PIPELINE_FREE;
+      }
+      else if (slot->status==PIPELINE_INVALID || slot->res_block!=slot->block_num)
+      {
+        PRINTF("WRONG BLOCK %lu/%lu\n", slot->res_block, slot->block_num);
+        if (++(state->block_error)>=COAP_MAX_ATTEMPTS
+            || !pipelined_request_send(slot, slot->block_num, remote_ipaddr, remote_port, request))
+        {
+          pipelined_request_cancel(state, 0);
+          etimer_stop(&state->pace);
+          PT_EXIT(&state->pt);
+        }
+      }
+      else
+      {
+        if (slot->block_num==0)
+        {
+          /* The server answers: use its block size. */
+          if (slot->size && slot->size<state->block_size)
+          {
+            state->block_size = slot->size;
+          }
+        }
+        if (!slot->more)
+        {
+          state->last_block = MIN(state->last_block, slot->block_num);
+        }
+        /* COAP_MAX_ATTEMPTS limits the retries of one block, not of the whole transfer. */
+        state->block_error = 0;
+        slot->status = PIPELINE_BUFFERED;
+      }
+    }
+
+    /* Stop requests beyond the end, if it is known by now. */
+    pipelined_request_cancel(state, state->last_block);
+
+    /* Deliver the blocks that are in order. */
+    do {
+      delivered = 0;
+      for (slot = state->slots; slot < state->slots + COAP_NSTART; ++slot)
+      {
+        if (slot->status==PIPELINE_BUFFERED && slot->block_num==state->next_block)
+        {
+          coap_parse_message(state->response, slot->packet, slot->packet_len);
+          slot->status = PIPELINE_FREE;
+          request_callback(state->response);
+          ++(state->next_block);
+          delivered = 1;
+        }
+      }
+    } while (delivered);
+
+    if (state->window==1 && !state->checked && state->next_block>=PIPELINE_CHECK_BLOCKS)
+    {
+      /* Open the window, and spread it over the round-trip time instead of sending it as a burst. */
+      state->rtt = (clock_time() - state->started) / state->next_block;
+      state->spacing = PIPELINE_SPACING(state->rtt);
+      state->window = COAP_NSTART;
+      state->opened = clock_time();
+      state->opened_block = state->next_block;
+    }
+    else if (state->window>1 && !state->checked && state->next_block>=state->opened_block+PIPELINE_TRIAL_BLOCKS)
+    {
+      state->checked = 1;
+      if (clock_time() - state->opened > state->rtt * (state->next_block-state->opened_block))
+      {
+        /* Slower than one block per round trip, e.g., when client and server share one channel and there is
+         * nothing to overlap: fall back to stop-and-wait. */
+        PRINTF("Pipelining slower than stop-and-wait\n");
+        state->window = 1;
+        state->spacing = 0;
+      }
+    }
+  }
+
+  etimer_stop(&state->pace);
+  PT_END(&state->pt);
+}
+#endif /* COAP_NSTART > 1 */
+/*----------------------------------------------------------------------------*/
 /*- Engine Interface ---------------------------------------------------------*/
 /*----------------------------------------------------------------------------*/
 const struct rest_implementation coap_rest_implementation = {
@@ -47,6 +47,9 @@
 #include "er-coap-07-transactions.h"
 #include "er-coap-07-observing.h"
 #include "er-coap-07-separate.h"
+#include "er-coap-07-duplicates.h"
+#include "er-coap-07-block-cache.h"
+#include "er-coap-07-block1.h"
 
 #include "pt.h"
 
@@ -55,6 +58,14 @@ PROCESS_NAME(coap_receiver);
 
 #define SERVER_LISTEN_PORT      UIP_HTONS(COAP_SERVER_PORT)
 
+/*
+ * Size of the buffer that keeps the unfiltered /.well-known/core description, so that it is not rendered for every block.
+ * Descriptions that do not fit, and filtered requests, are rendered on the fly. Set to 0 to save the RAM.
+ */
+#ifndef COAP_LINK_FORMAT_SIZE
+#define COAP_LINK_FORMAT_SIZE   256
+#endif
+
 typedef coap_packet_t rest_request_t;
 typedef coap_packet_t rest_response_t;
 
@@ -91,4 +102,72 @@ PT_THREAD(coap_blocking_request(struct request_state_t *state, process_event_t e
 }
 /*-----------------------------------------------------------------------------------*/
 
+/*
+ * The number of requests a client may have outstanding with one server (NSTART).
+ * COAP_PIPELINED_REQUEST keeps up to this many Block2 requests in flight. With the CoAP default of 1 it is
+ * COAP_BLOCKING_REQUEST; higher values should only be used where the path is known to cope with the load.
+ */
+#ifndef COAP_NSTART
+#define COAP_NSTART             1
+#endif /* COAP_NSTART */
+
+#if COAP_NSTART > 1
+
+struct pipelined_request_state_t;
+
+/* One block request in flight, with a copy of its response until it can be delivered in order. */
+struct pipelined_request_slot_t {
+    struct pipelined_request_state_t *state;
+    coap_transaction_t *transaction;
+    uint32_t block_num;
+    uint8_t status;
+    uint8_t code;
+    uint8_t more;
+    uint16_t size;
+    uint32_t res_block;
+    uint16_t packet_len;
+    uint8_t packet[COAP_MAX_PACKET_SIZE+1];
+};
+
+struct pipelined_request_state_t {
+    struct pt pt;
+    struct process *process;
+    coap_packet_t response[1];
+    struct pipelined_request_slot_t slots[COAP_NSTART];
+    struct etimer pace;
+    clock_time_t spacing;
+    clock_time_t started;
+    clock_time_t rtt;
+    clock_time_t opened;
+    uint32_t opened_block;
+    uint8_t paced;
+    uint8_t checked;
+    uint8_t window;
+    uint8_t block_error;
+    uint16_t block_size;
+    uint32_t next_request; /* next block to request */
+    uint32_t next_block; /* next block to deliver */
+    uint32_t last_block;
+};
+
+PT_THREAD(coap_pipelined_request(struct pipelined_request_state_t *state, process_event_t ev,
+                                 uip_ipaddr_t *remote_ipaddr, uint16_t remote_port,
+                                 coap_packet_t *request,
+                                 blocking_response_handler request_callback));
+
+#define COAP_PIPELINED_REQUEST(server_addr, server_port, request, chunk_handler) \
+{ \
+  static struct pipelined_request_state_t request_state; \
+  PT_SPAWN(process_pt, &request_state.pt, \
+           coap_pipelined_request(&request_state, ev, \
+                                  server_addr, server_port, \
+                                  request, chunk_handler) \
+  ); \
+}
+#else /* COAP_NSTART > 1 */
+#define COAP_PIPELINED_REQUEST(server_addr, server_port, request, chunk_handler) \
+  COAP_BLOCKING_REQUEST(server_addr, server_port, request, chunk_handler)
+#endif /* COAP_NSTART > 1 */
+/*-----------------------------------------------------------------------------------*/
+
 #endif /* COAP_SERVER_H_ */
@@ -40,6 +40,7 @@
 #include <string.h>
 
 #include "er-coap-07-observing.h"
+#include "er-coap-07-block-cache.h"
 
 #define DEBUG 0
 #if DEBUG
@@ -175,6 +176,11 @@ coap_notify_observers(resource_t *resource, uint16_t obs_counter, void *notifica
 
   PRINTF("Observing: Notification from %s\n", resource->url);
 
+#if COAP_BLOCK_CACHE_SIZE
+  /* Cached blocks of the old representation must not be mixed with the new one. */
+  coap_evict_cached_blocks(resource->url, strlen(resource->url));
+#endif
+
   /* Iterate over observers. */
   for (obs = (coap_observer_t*)list_head(observers_list); obs; obs = obs->next)
   {
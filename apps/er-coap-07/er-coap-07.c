@@ -65,6 +65,7 @@ static uint16_t current_mid = 0;
 
 coap_status_t coap_error_code = NO_ERROR;
 char *coap_error_message = "";
+uint16_t coap_max_payload_len = REST_MAX_CHUNK_SIZE;
 /*-----------------------------------------------------------------------------------*/
 /*- LOCAL HELP FUNCTIONS ------------------------------------------------------------*/
 /*-----------------------------------------------------------------------------------*/
@@ -465,6 +466,14 @@ coap_serialize_message(void *packet, uint8_t *buffer)
     coap_pkt->option_count += 1 + (COAP_OPTION_BLOCK2-current_number)/COAP_OPTION_FENCE_POST;
     current_number = COAP_OPTION_BLOCK2;
   }
+  if (IS_OPTION(coap_pkt, COAP_OPTION_SIZE)) {
+    PRINTF("Size [%lu]\n", coap_pkt->size);
+
+    option += coap_serialize_int_option(COAP_OPTION_SIZE, current_number, option, coap_pkt->size);
+
+    coap_pkt->option_count += 1 + (COAP_OPTION_SIZE-current_number)/COAP_OPTION_FENCE_POST;
+    current_number = COAP_OPTION_SIZE;
+  }
   if (IS_OPTION(coap_pkt, COAP_OPTION_BLOCK1))
   {
     PRINTF("Block1 [%lu%s (%u B/blk)]\n", coap_pkt->block1_num, coap_pkt->block1_more ? "+" : "", coap_pkt->block1_size);
@@ -696,6 +705,10 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
           coap_pkt->block2_num >>= 4;
           PRINTF("Block2 [%lu%s (%u B/blk)]\n", coap_pkt->block2_num, coap_pkt->block2_more ? "+" : "", coap_pkt->block2_size);
           break;
+        case COAP_OPTION_SIZE:
+          coap_pkt->size = coap_parse_int_option(current_option, option_len);
+          PRINTF("Size [%lu]\n", coap_pkt->size);
+          break;
         case COAP_OPTION_BLOCK1:
           coap_pkt->block1_num = coap_parse_int_option(current_option, option_len);
           coap_pkt->block1_more = (coap_pkt->block1_num & 0x08)>>3;
@@ -1174,6 +1187,27 @@ coap_set_header_block1(void *packet, uint32_t num, uint8_t more, uint16_t size)
   return 1;
 }
 /*-----------------------------------------------------------------------------------*/
+int
+coap_get_header_size(void *packet, uint32_t *size)
+{
+  coap_packet_t *const coap_pkt = (coap_packet_t *) packet;
+
+  if (!IS_OPTION(coap_pkt, COAP_OPTION_SIZE)) return 0;
+
+  *size = coap_pkt->size;
+  return 1;
+}
+
+int
+coap_set_header_size(void *packet, uint32_t size)
+{
+  coap_packet_t *const coap_pkt = (coap_packet_t *) packet;
+
+  coap_pkt->size = size;
+  SET_OPTION(coap_pkt, COAP_OPTION_SIZE);
+  return 1;
+}
+/*-----------------------------------------------------------------------------------*/
 /*- PAYLOAD -------------------------------------------------------------------------*/
 /*-----------------------------------------------------------------------------------*/
 int
@@ -1195,10 +1229,10 @@ coap_set_payload(void *packet, const void *payload, size_t length)
 {
   coap_packet_t *const coap_pkt = (coap_packet_t *) packet;
 
-  PRINTF("setting payload (%u/%u)\n", length, REST_MAX_CHUNK_SIZE);
+  PRINTF("setting payload (%u/%u)\n", length, coap_max_payload_len);
 
   coap_pkt->payload = (uint8_t *) payload;
-  coap_pkt->payload_len = MIN(REST_MAX_CHUNK_SIZE, length);
+  coap_pkt->payload_len = MIN(coap_max_payload_len, length);
 
   return coap_pkt->payload_len;
 }
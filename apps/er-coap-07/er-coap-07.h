@@ -129,6 +129,7 @@ typedef enum {
   FORBIDDEN_4_03 = 131,                 /* FORBIDDEN */
   NOT_FOUND_4_04 = 132,                 /* NOT_FOUND */
   METHOD_NOT_ALLOWED_4_05 = 133,        /* METHOD_NOT_ALLOWED */
+  REQUEST_ENTITY_INCOMPLETE_4_08 = 136, /* REQUEST_ENTITY_INCOMPLETE */
   PRECONDITION_FAILED_4_12 = 140,       /* BAD_REQUEST */
   REQUEST_ENTITY_TOO_LARGE_4_13 = 141,  /* REQUEST_ENTITY_TOO_LARGE */
   UNSUPPORTED_MADIA_TYPE_4_15 = 143,    /* UNSUPPORTED_MADIA_TYPE */
@@ -167,6 +168,7 @@ typedef enum {
   COAP_OPTION_FENCE_POST = 14,    /* 0 B */
   COAP_OPTION_URI_QUERY = 15,     /* 1-270 B */
     COAP_OPTION_BLOCK2 = 17,        /* 1-3 B */
+    COAP_OPTION_SIZE = 18,          /* 0-4 B */
     COAP_OPTION_BLOCK1 = 19,        /* 1-3 B */
   COAP_OPTION_IF_NONE_MATCH = 21  /* 0 B */
 } coap_option_t;
@@ -238,6 +240,7 @@ typedef struct {
   uint8_t block1_more;
   uint16_t block1_size;
   uint32_t block1_offset;
+  uint32_t size;
   size_t uri_query_len;
   const char *uri_query;
   uint8_t if_none_match;
@@ -252,6 +255,9 @@ typedef struct {
 extern coap_status_t coap_error_code;
 extern char *coap_error_message;
 
+/* Limit of coap_set_payload(), raised while a whole representation is rendered into a larger buffer */
+extern uint16_t coap_max_payload_len;
+
 void coap_init_connection(uint16_t port);
 uint16_t coap_get_mid(void);
 
@@ -315,6 +321,9 @@ int coap_set_header_block2(void *packet, uint32_t num, uint8_t more, uint16_t si
 int coap_get_header_block1(void *packet, uint32_t *num, uint8_t *more, uint16_t *size, uint32_t *offset);
 int coap_set_header_block1(void *packet, uint32_t num, uint8_t more, uint16_t size);
 
+int coap_get_header_size(void *packet, uint32_t *size);
+int coap_set_header_size(void *packet, uint32_t size);
+
 int coap_get_payload(void *packet, uint8_t **payload);
 int coap_set_payload(void *packet, const void *payload, size_t length);
 
@@ -53,11 +53,97 @@
 #define PRINTLLADDR(addr)
 #endif
 
+/*
+ * Number of hash buckets used to dispatch requests to resources with an exact URL (must be a power of two).
+ * Resources that handle sub-resources are kept in a separate chain, sorted by URL length, for prefix matching.
+ */
+#ifndef REST_DISPATCH_BUCKETS
+#define REST_DISPATCH_BUCKETS   16
+#endif
+
 PROCESS_NAME(rest_manager_process);
 
 LIST(restful_services);
 LIST(restful_periodic_services);
 
+static resource_t *dispatch_table[REST_DISPATCH_BUCKETS];
+static resource_t *dispatch_prefixes;
+
+/* Changes whenever a resource is activated or deactivated. */
+static uint16_t resources_generation;
+
+/*-----------------------------------------------------------------------------------*/
+static uint16_t
+dispatch_hash(const char *url, uint16_t len)
+{
+  uint16_t hash = len;
+
+  while (len--)
+  {
+    hash = (hash << 5) + hash + (uint8_t) *url++;
+  }
+  return hash & (REST_DISPATCH_BUCKETS-1);
+}
+
+static void
+dispatch_add(resource_t* resource)
+{
+  resource_t **chain = NULL;
+
+  resource->url_len = strlen(resource->url);
+
+  if (resource->flags & HAS_SUB_RESOURCES)
+  {
+    /* Longest URL first, so that the first prefix match is the most specific one. */
+    for (chain = &dispatch_prefixes; *chain && (*chain)->url_len >= resource->url_len; chain = &(*chain)->dispatch_next);
+  }
+  else
+  {
+    chain = &dispatch_table[dispatch_hash(resource->url, resource->url_len)];
+  }
+  resource->dispatch_next = *chain;
+  *chain = resource;
+}
+
+static int
+dispatch_remove(resource_t* resource)
+{
+  resource_t **chain = NULL;
+
+  chain = (resource->flags & HAS_SUB_RESOURCES) ? &dispatch_prefixes : &dispatch_table[dispatch_hash(resource->url, resource->url_len)];
+  for (; *chain; chain = &(*chain)->dispatch_next)
+  {
+    if (*chain==resource)
+    {
+      *chain = resource->dispatch_next;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static resource_t *
+dispatch_lookup(const char *url, uint16_t len)
+{
+  resource_t* resource = NULL;
+
+  for (resource = dispatch_table[dispatch_hash(url, len)]; resource; resource = resource->dispatch_next)
+  {
+    if (resource->url_len==len && memcmp(resource->url, url, len)==0)
+    {
+      return resource;
+    }
+  }
+  for (resource = dispatch_prefixes; resource; resource = resource->dispatch_next)
+  {
+    if (resource->url_len<=len && memcmp(resource->url, url, resource->url_len)==0)
+    {
+      return resource;
+    }
+  }
+  return NULL;
+}
+/*-----------------------------------------------------------------------------------*/
 
 void
 rest_init_engine(void)
@@ -87,7 +173,32 @@ rest_activate_resource(resource_t* resource)
     rest_set_post_handler(resource, REST.default_post_handler);
   }
 
+  /* Like list_add(), do not index a resource twice when it is activated again. */
   list_add(restful_services, resource);
+  dispatch_remove(resource);
+  dispatch_add(resource);
+  ++resources_generation;
+}
+
+void
+rest_deactivate_resource(resource_t* resource)
+{
+  periodic_resource_t* periodic_resource = NULL;
+
+  PRINTF("Deactivating: %s", resource->url);
+
+  for (periodic_resource = (periodic_resource_t*)list_head(restful_periodic_services); periodic_resource; periodic_resource = periodic_resource->next)
+  {
+    if (periodic_resource->resource==resource)
+    {
+      etimer_stop(&periodic_resource->periodic_timer);
+      list_remove(restful_periodic_services, periodic_resource);
+      break;
+    }
+  }
+  list_remove(restful_services, resource);
+  dispatch_remove(resource);
+  ++resources_generation;
 }
 
 void
@@ -112,6 +223,12 @@ rest_get_resources(void)
   return restful_services;
 }
 
+uint16_t
+rest_get_resources_generation(void)
+{
+  return resources_generation;
+}
+
 
 void*
 rest_get_user_data(resource_t* resource)
@@ -140,59 +257,61 @@ rest_set_post_handler(resource_t* resource, restful_post_handler post_handler)
 void
 rest_set_special_flags(resource_t* resource, rest_resource_flags_t flags)
 {
-  resource->flags |= flags;
+  if (dispatch_remove(resource))
+  {
+    /* Already active: re-index in case HAS_SUB_RESOURCES changed. */
+    resource->flags |= flags;
+    dispatch_add(resource);
+  }
+  else
+  {
+    resource->flags |= flags;
+  }
 }
 
 int
 rest_invoke_restful_service(void* request, void* response, uint8_t *buffer, uint16_t buffer_size, int32_t *offset)
 {
-  uint8_t found = 0;
   uint8_t allowed = 0;
 
-  PRINTF("rest_invoke_restful_service url /%.*s -->\n", url_len, url);
-
   resource_t* resource = NULL;
   const char *url = NULL;
+  uint16_t url_len = REST.get_url(request, &url);
+
+  PRINTF("rest_invoke_restful_service url /%.*s -->\n", url_len, url);
 
-  for (resource = (resource_t*)list_head(restful_services); resource; resource = resource->next)
+  if ((resource = dispatch_lookup(url, url_len)))
   {
-    /*if the web service handles that kind of requests and urls matches*/
-    if ((REST.get_url(request, &url)==strlen(resource->url) || (REST.get_url(request, &url)>strlen(resource->url) && (resource->flags & HAS_SUB_RESOURCES)))
-        && strncmp(resource->url, url, strlen(resource->url)) == 0)
-    {
-      found = 1;
-      rest_resource_flags_t method = REST.get_method_type(request);
+    rest_resource_flags_t method = REST.get_method_type(request);
 
-      PRINTF("method %u, resource->flags %u\n", (uint16_t)method, resource->flags);
+    PRINTF("method %u, resource->flags %u\n", (uint16_t)method, resource->flags);
 
-      if (resource->flags & method)
+    if (resource->flags & method)
+    {
+      allowed = 1;
+
+      /*call pre handler if it exists*/
+      if (!resource->pre_handler || resource->pre_handler(resource, request, response))
       {
-        allowed = 1;
+        /* call handler function*/
+        resource->handler(request, response, buffer, buffer_size, offset);
 
-        /*call pre handler if it exists*/
-        if (!resource->pre_handler || resource->pre_handler(resource, request, response))
+        /*call post handler if it exists*/
+        if (resource->post_handler)
         {
-          /* call handler function*/
-          resource->handler(request, response, buffer, buffer_size, offset);
-
-          /*call post handler if it exists*/
-          if (resource->post_handler)
-          {
-            resource->post_handler(resource, request, response);
-          }
+          resource->post_handler(resource, request, response);
         }
-      } else {
-        REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
       }
-      break;
+    } else {
+      REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
     }
   }
-
-  if (!found) {
+  else
+  {
     REST.set_response_status(response, REST.status.NOT_FOUND);
   }
 
-  return found & allowed;
+  return allowed;
 }
 /*-----------------------------------------------------------------------------------*/
 
@@ -147,6 +147,8 @@ struct resource_s {
   restful_post_handler post_handler; /* to be called after handler, may perform finalizations (cleanup, etc) */
   void* user_data; /* pointer to user specific data */
   unsigned int benchmark; /* to benchmark resource handler, used for separate response */
+  struct resource_s *dispatch_next; /* next resource in the same dispatch bucket, set when activated */
+  uint16_t url_len; /* length of the URL, set when activated */
 };
 typedef struct resource_s resource_t;
 
@@ -297,6 +299,11 @@ void rest_activate_resource(resource_t* resource);
 void rest_activate_periodic_resource(periodic_resource_t* periodic_resource);
 void rest_activate_event_resource(resource_t* resource);
 
+/*
+ * Removes an active resource, so that it is neither served nor listed anymore.
+ */
+void rest_deactivate_resource(resource_t* resource);
+
 
 /*
  * To be called by HTTP/COAP server as a callback function when a new service request appears.
@@ -309,6 +316,11 @@ int rest_invoke_restful_service(void* request, void* response, uint8_t *buffer,
  */
 list_t rest_get_resources(void);
 
+/*
+ * Returns a number that changes whenever a resource is activated or deactivated.
+ */
+uint16_t rest_get_resources_generation(void);
+
 /*
  * Getter and setter methods for user specific data.
  */
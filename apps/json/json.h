@@ -62,7 +62,8 @@ enum {
   JSON_ERROR_UNEXPECTED_ARRAY,
   JSON_ERROR_UNEXPECTED_END_OF_ARRAY,
   JSON_ERROR_UNEXPECTED_OBJECT,
-  JSON_ERROR_UNEXPECTED_STRING
+  JSON_ERROR_UNEXPECTED_STRING,
+  JSON_ERROR_INCOMPLETE
 };
 
 #define JSON_CONTENT_TYPE "application/json"
@@ -97,17 +97,108 @@ skip_ws(struct jsonparse_state *state)
   }
 }
 /*--------------------------------------------------------------------*/
+/* when streaming: is the next element entirely in the input window? */
+/*--------------------------------------------------------------------*/
+static int
+is_complete(struct jsonparse_state *state)
+{
+  int pos;
+  char c;
+
+  if(state->size == 0) {
+    return 1;
+  }
+  if(state->pos >= state->len) {
+    return 0;
+  }
+  c = state->json[state->pos];
+  if(c == '"') {
+    for(pos = state->pos + 1; pos < state->len; pos++) {
+      if(state->json[pos] == '\\') {
+        pos++;
+      } else if(state->json[pos] == '"') {
+        return 1;
+      }
+    }
+    return 0;
+  }
+  if(c >= '0' && c <= '9') {
+    for(pos = state->pos + 1; pos < state->len; pos++) {
+      c = state->json[pos];
+      if((c < '0' || c > '9') && c != '.') {
+        return 1;
+      }
+    }
+    return 0;
+  }
+  return 1;
+}
+/*--------------------------------------------------------------------*/
 void
 jsonparse_setup(struct jsonparse_state *state, const char *json, int len)
 {
   state->json = json;
   state->len = len;
+  state->size = 0;
   state->pos = 0;
   state->depth = 0;
   state->error = 0;
   state->stack[0] = 0;
 }
 /*--------------------------------------------------------------------*/
+void
+jsonparse_setup_stream(struct jsonparse_state *state, char *buf, int size)
+{
+  jsonparse_setup(state, buf, 0);
+  state->size = size;
+  buf[0] = '\0';
+}
+/*--------------------------------------------------------------------*/
+int
+jsonparse_feed(struct jsonparse_state *state, const char *data, int len)
+{
+  /* the window was passed as a writable buffer to jsonparse_setup_stream() */
+  char *buf = (char *)state->json;
+
+  if(state->size == 0) {
+    return 0;
+  }
+  if(data == NULL) {
+    /* end of input: parse the rest of the window as a whole document */
+    state->size = 0;
+    if(state->error == JSON_ERROR_INCOMPLETE) {
+      state->error = 0;
+    }
+    return 0;
+  }
+
+  /* drop what has been parsed */
+  if(state->pos > 0) {
+    memmove(buf, &buf[state->pos], state->len - state->pos);
+    state->len -= state->pos;
+    if(state->vstart >= state->pos) {
+      state->vstart -= state->pos;
+    } else {
+      /* the last value has been dropped */
+      state->vstart = 0;
+      state->vlen = 0;
+    }
+    state->pos = 0;
+  }
+
+  if(len > state->size - 1 - state->len) {
+    len = state->size - 1 - state->len;
+  }
+  memcpy(&buf[state->len], data, len);
+  state->len += len;
+  buf[state->len] = '\0';
+
+  if(state->error == JSON_ERROR_INCOMPLETE) {
+    state->error = 0;
+  }
+  return len;
+}
+/*--------------------------------------------------------------------*/
 int
 jsonparse_next(struct jsonparse_state *state)
 {
@@ -115,6 +206,15 @@ jsonparse_next(struct jsonparse_state *state)
   char s;
 
   skip_ws(state);
+  if(!is_complete(state)) {
+    if(state->len - state->pos >= state->size - 1) {
+      /* the element does not fit in the window */
+      state->error = JSON_ERROR_SYNTAX;
+    } else {
+      state->error = JSON_ERROR_INCOMPLETE;
+    }
+    return 0;
+  }
   c = state->json[state->pos];
   s = jsonparse_get_type(state);
   state->pos++;
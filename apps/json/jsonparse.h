@@ -45,6 +45,8 @@ struct jsonparse_state {
   const char *json;
   int pos;
   int len;
+  /* size of the input window when streaming, 0 for a whole document */
+  int size;
   int depth;
   /* for handling atomic values */
   int vstart;
@@ -66,6 +68,35 @@ struct jsonparse_state {
 void jsonparse_setup(struct jsonparse_state *state, const char *json,
                      int len);
 
+/**
+ * \brief      Initialize a JSON parser state for streaming input.
+ * \param state A pointer to a JSON parser state
+ * \param buf  A buffer for the input window
+ * \param size The size of the buffer
+ *
+ *             The input is passed with jsonparse_feed() as it
+ *             arrives. The buffer only has to hold the longest
+ *             string or number of the document, plus one byte.
+ */
+void jsonparse_setup_stream(struct jsonparse_state *state, char *buf,
+                            int size);
+
+/**
+ * \brief      Pass the next fragment of streaming input.
+ * \param state A pointer to a JSON parser state
+ * \param data The input, or NULL at the end of the input
+ * \param len  The length of the input
+ * \return     The number of bytes accepted
+ *
+ *             Input that has been parsed is dropped from the window
+ *             to make room for the new input, so the current value
+ *             must be used before more input is fed. When the input
+ *             in the window ends within a value, jsonparse_next()
+ *             returns 0 with the error JSON_ERROR_INCOMPLETE, and
+ *             can be called again once more input has been fed.
+ */
+int jsonparse_feed(struct jsonparse_state *state, const char *data, int len);
+
 /* move to next JSON element */
 int jsonparse_next(struct jsonparse_state *state);
 
@@ -50,54 +50,101 @@
 #define PRINTF(...)
 #endif
 
+/*---------------------------------------------------------------------------*/
+void
+jsontree_write(const struct jsontree_context *js_ctx, const char *data, int len)
+{
+  struct jsontree_buffer *out;
+  int n;
+
+  if(js_ctx->putchar != NULL) {
+    while(len-- > 0) {
+      js_ctx->putchar(*data++);
+    }
+    return;
+  }
+
+  out = js_ctx->out;
+  if(out->skip == 0 && len <= out->size - out->pos) {
+    memcpy(&out->buf[out->pos], data, len);
+    out->pos += len;
+    return;
+  }
+  if(out->skip > 0) {
+    n = out->skip < len ? out->skip : len;
+    out->skip -= n;
+    data += n;
+    len -= n;
+  }
+  while(len > 0 && !out->overflow) {
+    n = out->size - out->pos;
+    if(n > len) {
+      n = len;
+    }
+    memcpy(&out->buf[out->pos], data, n);
+    out->pos += n;
+    data += n;
+    len -= n;
+    if(len > 0) {
+      if(out->flush != NULL && out->flush(out)) {
+        out->pos = 0;
+      } else {
+        out->overflow = 1;
+      }
+    }
+  }
+}
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_atom(const struct jsontree_context *js_ctx, const char *text)
 {
   if(text == NULL) {
-    js_ctx->putchar('0');
+    jsontree_write(js_ctx, "0", 1);
   } else {
-    while(*text != '\0') {
-      js_ctx->putchar(*text++);
-    }
+    jsontree_write(js_ctx, text, strlen(text));
   }
 }
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_string(const struct jsontree_context *js_ctx, const char *text)
 {
-  js_ctx->putchar('"');
+  const char *end;
+
+  jsontree_write(js_ctx, "\"", 1);
   if(text != NULL) {
-    while(*text != '\0') {
-      if(*text == '"') {
-        js_ctx->putchar('\\');
+    /* Write the text in spans up to the next quote that needs escaping */
+    do {
+      for(end = text; *end != '\0' && *end != '"'; end++);
+      jsontree_write(js_ctx, text, end - text);
+      if(*end == '"') {
+        jsontree_write(js_ctx, "\\\"", 2);
+        end++;
       }
-      js_ctx->putchar(*text++);
-    }
+      text = end;
+    } while(*text != '\0');
   }
-  js_ctx->putchar('"');
+  jsontree_write(js_ctx, "\"", 1);
 }
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_int(const struct jsontree_context *js_ctx, int value)
 {
-  char buf[10];
+  char buf[11];
   int l;
+  unsigned int u;
 
-  if(value < 0) {
-    js_ctx->putchar('-');
-    value = -value;
-  }
+  u = value < 0 ? -(unsigned int)value : (unsigned int)value;
 
-  l = sizeof(buf) - 1;
+  l = sizeof(buf);
   do {
-    buf[l--] = '0' + (value % 10);
-    value /= 10;
-  } while(value > 0 && l >= 0);
+    buf[--l] = '0' + (u % 10);
+    u /= 10;
+  } while(u > 0 && l > 1);
 
-  while(++l < sizeof(buf)) {
-    js_ctx->putchar(buf[l]);
+  if(value < 0) {
+    buf[--l] = '-';
   }
+  jsontree_write(js_ctx, &buf[l], sizeof(buf) - l);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -106,11 +153,68 @@ jsontree_setup(struct jsontree_context *js_ctx, struct jsontree_value *root,
 {
   js_ctx->values[0] = root;
   js_ctx->putchar = putchar;
+  js_ctx->out = NULL;
   js_ctx->path = 0;
   jsontree_reset(js_ctx);
 }
 /*---------------------------------------------------------------------------*/
 void
+jsontree_setup_buffer(struct jsontree_context *js_ctx,
+                      struct jsontree_value *root, struct jsontree_buffer *out)
+{
+  jsontree_setup(js_ctx, root, NULL);
+  js_ctx->out = out;
+  out->pos = 0;
+  out->skip = 0;
+  out->overflow = 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+jsontree_flush(const struct jsontree_context *js_ctx)
+{
+  struct jsontree_buffer *out = js_ctx->out;
+
+  if(out == NULL || out->pos == 0) {
+    return 1;
+  }
+  if(out->flush != NULL && out->flush(out)) {
+    out->pos = 0;
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+jsontree_print_chunk(struct jsontree_context *js_ctx, char *buf,
+                     uint16_t size, int32_t *offset)
+{
+  struct jsontree_buffer out, *saved_out;
+  int (* saved_putchar)(int);
+
+  out.buf = buf;
+  out.size = size;
+  out.pos = 0;
+  out.skip = *offset;
+  out.overflow = 0;
+  out.flush = NULL;
+
+  saved_putchar = js_ctx->putchar;
+  saved_out = js_ctx->out;
+  js_ctx->putchar = NULL;
+  js_ctx->out = &out;
+
+  /* Stop at the first byte that does not fit: there is more to come. */
+  while(!out.overflow && jsontree_print_next(js_ctx) &&
+        js_ctx->path <= js_ctx->depth);
+
+  js_ctx->putchar = saved_putchar;
+  js_ctx->out = saved_out;
+
+  *offset = out.overflow ? *offset + out.pos : -1;
+  return out.pos;
+}
+/*---------------------------------------------------------------------------*/
+void
 jsontree_reset(struct jsontree_context *js_ctx)
 {
   js_ctx->depth = 0;
@@ -144,24 +248,21 @@ jsontree_print_next(struct jsontree_context *js_ctx)
 
     index = js_ctx->index[js_ctx->depth];
     if(index == 0) {
-      js_ctx->putchar(v->type);
-      js_ctx->putchar('\n');
+      jsontree_write(js_ctx, v->type == JSON_TYPE_OBJECT ? "{\n" : "[\n", 2);
     }
     if(index >= o->count) {
-      js_ctx->putchar('\n');
-      js_ctx->putchar(v->type + 2);
+      jsontree_write(js_ctx, v->type == JSON_TYPE_OBJECT ? "\n}" : "\n]", 2);
       /* Default operation: back up one level! */
       break;
     }
 
     if(index > 0) {
-      js_ctx->putchar(',');
-      js_ctx->putchar('\n');
+      jsontree_write(js_ctx, ",\n", 2);
     }
     if(v->type == JSON_TYPE_OBJECT) {
       jsontree_write_string(js_ctx,
                             ((struct jsontree_object *)o)->pairs[index].name);
-      js_ctx->putchar(':');
+      jsontree_write(js_ctx, ":", 1);
       ov = ((struct jsontree_object *)o)->pairs[index].value;
     } else {
       ov = o->values[index];
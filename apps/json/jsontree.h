@@ -49,6 +49,23 @@
 #define JSONTREE_MAX_DEPTH 10
 #endif /* JSONTREE_CONF_MAX_DEPTH */
 
+/*
+ * Buffered output. Spans of output are copied into buf. When it is
+ * full, flush is called and should consume the first pos bytes and
+ * return non-zero; without a flush function (or when it returns 0),
+ * the rest of the output is dropped and overflow is set. The first
+ * skip bytes of output are discarded, which allows to resume the
+ * output at an offset.
+ */
+struct jsontree_buffer {
+  char *buf;
+  uint16_t size;
+  uint16_t pos;
+  int32_t skip;
+  uint8_t overflow;
+  int (* flush)(struct jsontree_buffer *out);
+};
+
 struct jsontree_context {
   struct jsontree_value *values[JSONTREE_MAX_DEPTH];
   uint16_t index[JSONTREE_MAX_DEPTH];
@@ -56,6 +73,8 @@ struct jsontree_context {
   uint8_t depth;
   uint8_t path;
   int callback_state;
+  /* used instead of putchar when putchar is NULL */
+  struct jsontree_buffer *out;
 };
 
 struct jsontree_value {
@@ -120,6 +139,41 @@ void jsontree_setup(struct jsontree_context *js_ctx,
                     struct jsontree_value *root, int (* putchar)(int));
 void jsontree_reset(struct jsontree_context *js_ctx);
 
+/**
+ * \brief      Initialize a JSON tree context with buffered output.
+ * \param js_ctx A pointer to a JSON tree context
+ * \param root The root of the JSON tree
+ * \param out  The output buffer, with buf, size and flush set
+ *
+ *             The output is written to the buffer in spans rather
+ *             than one character at a time. Call jsontree_flush()
+ *             when done to flush the rest of the output.
+ */
+void jsontree_setup_buffer(struct jsontree_context *js_ctx,
+                           struct jsontree_value *root,
+                           struct jsontree_buffer *out);
+int jsontree_flush(const struct jsontree_context *js_ctx);
+
+/**
+ * \brief      Print a chunk of the JSON tree into a buffer.
+ * \param js_ctx A pointer to a JSON tree context, at the start of the tree
+ * \param buf  The buffer
+ * \param size The size of the buffer
+ * \param offset The offset of the chunk in the output
+ * \return     The number of bytes in the buffer
+ *
+ *             The tree is printed from the start and the output
+ *             before offset is skipped, so this can be used by a
+ *             REST resource handler to produce its payload blockwise.
+ *             The offset is advanced past the chunk, or set to -1 if
+ *             the chunk is the last one.
+ */
+int jsontree_print_chunk(struct jsontree_context *js_ctx, char *buf,
+                         uint16_t size, int32_t *offset);
+
+void jsontree_write(const struct jsontree_context *js_ctx,
+                    const char *data, int len);
+
 const char *jsontree_path_name(const struct jsontree_context *js_ctx,
                                int depth);
 
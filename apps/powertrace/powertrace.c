@@ -42,12 +42,20 @@
 #include "sys/compower.h"
 #include "powertrace.h"
 #include "net/rime.h"
+#if UIP_CONF_IPV6
+#include "net/uip.h"
+#include "net/uip-icmp6.h"
+
+#define UIP_IP_BUF  ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF ((struct uip_udp_hdr *)&uip_buf[UIP_LLIPH_LEN])
+#endif /* UIP_CONF_IPV6 */
 
 #include <stdio.h>
 #include <string.h>
 
 struct powertrace_sniff_stats {
   struct powertrace_sniff_stats *next;
+  uint8_t class;
   uint32_t num_input, num_output;
   uint32_t input_txtime, input_rxtime;
   uint32_t output_txtime, output_rxtime;
@@ -67,6 +75,9 @@ struct powertrace_sniff_stats {
 MEMB(stats_memb, struct powertrace_sniff_stats, MAX_NUM_STATS);
 LIST(stats_list);
 
+static uint32_t seqno;
+static powertrace_output_t output;
+
 PROCESS(powertrace_process, "Periodic power output");
 /*---------------------------------------------------------------------------*/
 void
@@ -80,8 +91,6 @@ powertrace_print(char *str)
   uint32_t idle_transmit, idle_listen;
   uint32_t all_idle_transmit, all_idle_listen;
 
-  static uint32_t seqno;
-
   uint32_t time, all_time, radio, all_radio;
   
   struct powertrace_sniff_stats *s;
@@ -188,6 +197,140 @@ powertrace_print(char *str)
     s->last_output_rxtime = s->output_rxtime;
     
   }
+
+#if ENERGEST_CONF_ON && ENERGEST_PROCESSES
+  {
+    struct energest_process *e;
+    int i;
+
+    for(i = 0; i < ENERGEST_PROCESSES; i++) {
+      e = energest_process_entry(i);
+      if(i == 0 || e->p != NULL) {
+        printf("%s %lu PR %d.%d %lu %s %lu %lu %lu %lu\n",
+               str, clock_time(), rimeaddr_node_addr.u8[0],
+               rimeaddr_node_addr.u8[1], (unsigned long)seqno,
+               e->p == NULL ? "-" : PROCESS_NAME_STRING(e->p),
+               e->calls, e->cpu, e->transmit, e->listen);
+      }
+    }
+  }
+#endif /* ENERGEST_CONF_ON && ENERGEST_PROCESSES */
+
+  {
+    uint32_t num, txtime, rxtime;
+    uint8_t class;
+
+    for(class = 0; class < POWERTRACE_CLASS_MAX; class++) {
+      num = txtime = rxtime = 0;
+      for(s = list_head(stats_list); s != NULL; s = list_item_next(s)) {
+        if(s->class == class) {
+          num += s->num_input + s->num_output;
+          txtime += s->input_txtime + s->output_txtime;
+          rxtime += s->input_rxtime + s->output_rxtime;
+        }
+      }
+      if(num > 0) {
+        printf("%s %lu PC %d.%d %lu %u %lu %lu %lu\n",
+               str, clock_time(), rimeaddr_node_addr.u8[0],
+               rimeaddr_node_addr.u8[1], (unsigned long)seqno, class,
+               (unsigned long)num, (unsigned long)txtime,
+               (unsigned long)rxtime);
+      }
+    }
+  }
+  seqno++;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t *
+put16(uint8_t *p, uint16_t v)
+{
+  p[0] = v >> 8;
+  p[1] = v;
+  return p + 2;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t *
+put32(uint8_t *p, uint32_t v)
+{
+  p = put16(p, v >> 16);
+  return put16(p, v);
+}
+/*---------------------------------------------------------------------------*/
+static void
+emit(powertrace_output_t out, uint8_t *record, uint8_t *end)
+{
+  record[1] = end - record - 2;
+  out(record, end - record);
+}
+/*---------------------------------------------------------------------------*/
+void
+powertrace_print_binary(powertrace_output_t out)
+{
+  uint8_t record[POWERTRACE_RECORD_MAX];
+  uint8_t *p;
+  struct powertrace_sniff_stats *s;
+
+  energest_flush();
+
+  record[0] = POWERTRACE_RECORD_NODE;
+  p = &record[2];
+  *p++ = POWERTRACE_BINARY_VERSION;
+  *p++ = rimeaddr_node_addr.u8[0];
+  *p++ = rimeaddr_node_addr.u8[1];
+  p = put16(p, seqno);
+  p = put32(p, clock_time());
+  p = put32(p, energest_type_time(ENERGEST_TYPE_CPU));
+  p = put32(p, energest_type_time(ENERGEST_TYPE_LPM));
+  p = put32(p, energest_type_time(ENERGEST_TYPE_TRANSMIT));
+  p = put32(p, energest_type_time(ENERGEST_TYPE_LISTEN));
+  p = put32(p, compower_idle_activity.transmit);
+  p = put32(p, compower_idle_activity.listen);
+  emit(out, record, p);
+
+#if ENERGEST_CONF_ON && ENERGEST_PROCESSES
+  {
+    struct energest_process *e;
+    const char *name;
+    int i, len;
+
+    for(i = 0; i < ENERGEST_PROCESSES; i++) {
+      e = energest_process_entry(i);
+      if(i != 0 && e->p == NULL) {
+        continue;
+      }
+      record[0] = POWERTRACE_RECORD_PROCESS;
+      p = &record[2];
+      p = put32(p, e->calls);
+      p = put32(p, e->cpu);
+      p = put32(p, e->transmit);
+      p = put32(p, e->listen);
+      name = e->p == NULL ? "" : PROCESS_NAME_STRING(e->p);
+      for(len = 0; name[len] != '\0' && len < POWERTRACE_NAME_LEN; len++) {
+        *p++ = name[len];
+      }
+      emit(out, record, p);
+    }
+  }
+#endif /* ENERGEST_CONF_ON && ENERGEST_PROCESSES */
+
+  for(s = list_head(stats_list); s != NULL; s = list_item_next(s)) {
+    record[0] = POWERTRACE_RECORD_CHANNEL;
+    p = &record[2];
+    *p++ = s->class;
+#if UIP_CONF_IPV6
+    *p++ = s->proto;
+#else
+    *p++ = 0;
+#endif
+    p = put16(p, s->channel);
+    p = put32(p, s->num_input);
+    p = put32(p, s->input_txtime);
+    p = put32(p, s->input_rxtime);
+    p = put32(p, s->num_output);
+    p = put32(p, s->output_txtime);
+    p = put32(p, s->output_rxtime);
+    emit(out, record, p);
+  }
   seqno++;
 }
 /*---------------------------------------------------------------------------*/
@@ -207,7 +350,11 @@ PROCESS_THREAD(powertrace_process, ev, data)
   while(1) {
     PROCESS_WAIT_UNTIL(etimer_expired(&periodic));
     etimer_reset(&periodic);
-    powertrace_print("");
+    if(output != NULL) {
+      powertrace_print_binary(output);
+    } else {
+      powertrace_print("");
+    }
   }
 
   PROCESS_END();
@@ -225,6 +372,46 @@ powertrace_stop(void)
   process_exit(&powertrace_process);
 }
 /*---------------------------------------------------------------------------*/
+void
+powertrace_set_output(powertrace_output_t out)
+{
+  output = out;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+classify(void)
+{
+#if UIP_CONF_IPV6
+  switch(packetbuf_attr(PACKETBUF_ATTR_NETWORK_ID)) {
+  case UIP_PROTO_ICMP6:
+    if((packetbuf_attr(PACKETBUF_ATTR_CHANNEL) >> 8) == ICMP6_RPL) {
+      return POWERTRACE_CLASS_RPL;
+    }
+    return POWERTRACE_CLASS_ICMP6;
+  case UIP_PROTO_UDP:
+    if(packetbuf_attr(PACKETBUF_ATTR_CHANNEL) ==
+       UIP_HTONS(POWERTRACE_COAP_PORT)) {
+      return POWERTRACE_CLASS_COAP;
+    }
+    /* The channel is the smaller of the two ports, which is the other
+       end's when it is below the CoAP port. Look for the CoAP port as
+       source or destination in uip_buf, if it still holds this
+       packet. */
+    if(UIP_IP_BUF->proto == UIP_PROTO_UDP &&
+       (UIP_UDP_BUF->srcport == UIP_HTONS(POWERTRACE_COAP_PORT) ||
+        UIP_UDP_BUF->destport == UIP_HTONS(POWERTRACE_COAP_PORT)) &&
+       (UIP_UDP_BUF->srcport == packetbuf_attr(PACKETBUF_ATTR_CHANNEL) ||
+        UIP_UDP_BUF->destport == packetbuf_attr(PACKETBUF_ATTR_CHANNEL))) {
+      return POWERTRACE_CLASS_COAP;
+    }
+    break;
+  }
+  return POWERTRACE_CLASS_DATA;
+#else /* UIP_CONF_IPV6 */
+  return POWERTRACE_CLASS_RIME;
+#endif /* UIP_CONF_IPV6 */
+}
+/*---------------------------------------------------------------------------*/
 static void
 add_stats(struct powertrace_sniff_stats *s, int input_or_output)
 {
@@ -261,6 +448,7 @@ add_packet_stats(int input_or_output)
     s = memb_alloc(&stats_memb);
     if(s != NULL) {
       memset(s, 0, sizeof(struct powertrace_sniff_stats));
+      s->class = classify();
       s->channel = packetbuf_attr(PACKETBUF_ATTR_CHANNEL);
 #if UIP_CONF_IPV6
       s->proto = packetbuf_attr(PACKETBUF_ATTR_NETWORK_ID);
@@ -41,6 +41,7 @@
 #define POWERTRACE_H
 
 #include "sys/clock.h"
+#include "sys/energest.h"
 
 void powertrace_start(clock_time_t perioc);
 void powertrace_stop(void);
@@ -54,4 +55,55 @@ void powertrace_sniff(powertrace_onoff_t onoff);
 
 void powertrace_print(char *str);
 
+/*
+ * Traffic classes. Packets seen by the sniffer are classified when
+ * their channel is first seen. For IPv6, CoAP is recognized by its
+ * UDP port; the remaining UDP and TCP traffic is counted as data.
+ */
+#define POWERTRACE_CLASS_RIME  0
+#define POWERTRACE_CLASS_DATA  1
+#define POWERTRACE_CLASS_ICMP6 2
+#define POWERTRACE_CLASS_RPL   3
+#define POWERTRACE_CLASS_COAP  4
+#define POWERTRACE_CLASS_MAX   5
+
+#ifdef POWERTRACE_CONF_COAP_PORT
+#define POWERTRACE_COAP_PORT POWERTRACE_CONF_COAP_PORT
+#else
+#define POWERTRACE_COAP_PORT 5683
+#endif
+
+/*
+ * Binary output. A report is a sequence of records, each passed to
+ * the output function on its own. A record starts with a type byte
+ * and a length byte that counts the bytes after it. All values are
+ * totals since boot, big endian, with times in rtimer ticks:
+ *
+ * NODE:    version(1) addr(2) seqno(2) clock(4) cpu(4) lpm(4)
+ *          transmit(4) listen(4) idle_transmit(4) idle_listen(4)
+ * PROCESS: calls(4) cpu(4) transmit(4) listen(4) name(0..8)
+ *          The first PROCESS record, with an empty name, holds the
+ *          time spent outside of any process.
+ * CHANNEL: class(1) proto(1) channel(2)
+ *          input_packets(4) input_transmit(4) input_listen(4)
+ *          output_packets(4) output_transmit(4) output_listen(4)
+ *
+ * PROCESS records are only sent when ENERGEST_CONF_PROCESSES is set.
+ */
+#define POWERTRACE_BINARY_VERSION 1
+
+#define POWERTRACE_RECORD_NODE    'N'
+#define POWERTRACE_RECORD_PROCESS 'R'
+#define POWERTRACE_RECORD_CHANNEL 'C'
+
+#define POWERTRACE_NAME_LEN 8
+#define POWERTRACE_RECORD_MAX 36
+
+typedef void (*powertrace_output_t)(const uint8_t *record, int len);
+
+/** Make the periodic report binary, or text again if out is NULL. */
+void powertrace_set_output(powertrace_output_t out);
+
+void powertrace_print_binary(powertrace_output_t out);
+
 #endif /* POWERTRACE_H */
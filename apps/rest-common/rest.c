@@ -226,7 +226,8 @@ rest_invoke_restful_service(REQUEST* request, RESPONSE* response)
 
   for (resource = (resource_t*)list_head(restful_services); resource; resource = resource->next) {
     /*if the web service handles that kind of requests and urls matches*/
-    if (url && strlen(resource->url) == url_len && strncmp(resource->url, url, url_len) == 0){
+    /*compare without strlen: the resource URL must end where the request URL does*/
+    if (url && strncmp(resource->url, url, url_len) == 0 && resource->url[url_len] == '\0'){
       found = 1;
       method_t method = rest_get_method_type(request);
 
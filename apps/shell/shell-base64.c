@@ -54,11 +54,14 @@ SHELL_COMMAND(dec64_command,
 	      "dec64",
 	      "dec64: decode base64 input",
 	      &shell_dec64_process);
+
+static struct shell_pipe dec64_pipe;
 /*---------------------------------------------------------------------------*/
 #define BASE64_MAX_LINELEN 76
+#define BASE64_MAX_DATALEN (3 * BASE64_MAX_LINELEN / 4)
 
 struct base64_decoder_state {
-  uint8_t data[3 * BASE64_MAX_LINELEN / 4];
+  uint8_t *data;
   int dataptr;
   unsigned long tmpdata;
   int sextets;
@@ -90,7 +93,7 @@ base64_add_char(struct base64_decoder_state *s, char c)
     return 0;
   }
 
-  if(s->dataptr >= sizeof(s->data)) {
+  if(s->dataptr >= BASE64_MAX_DATALEN) {
     return 0;
   }
   if(c == '=') {
@@ -105,7 +108,7 @@ base64_add_char(struct base64_decoder_state *s, char c)
     s->data[s->dataptr + 1] = (uint8_t)(s->tmpdata >> 8);
     s->data[s->dataptr + 2] = (uint8_t)(s->tmpdata);
     s->dataptr += 3;
-    if(s->dataptr == sizeof(s->data)) {
+    if(s->dataptr == BASE64_MAX_DATALEN) {
       return 0;
     } else {
       return 1;
@@ -116,29 +119,40 @@ base64_add_char(struct base64_decoder_state *s, char c)
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(shell_dec64_process, ev, data)
 {
-  struct shell_input *input;
+  struct shell_input input;
   struct base64_decoder_state s;
+  uint8_t buf[BASE64_MAX_DATALEN];
   int i;
 
   PROCESS_BEGIN();
 
-  while(1) {
-    PROCESS_WAIT_EVENT_UNTIL(ev == shell_event_input);
-    input = data;
+  shell_pipe_open(&dec64_pipe, &dec64_command);
 
-    if(input->len1 + input->len2 == 0) {
-      PROCESS_EXIT();
-    }
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
 
-    s.sextets = s.dataptr = s.padding = 0;
+    while(shell_pipe_read(&dec64_pipe, &input) &&
+	  shell_output_ready(&dec64_command, BASE64_MAX_DATALEN)) {
+      /* Decode straight into the pipe of the next command, if it has
+	 one. */
+      s.data = (uint8_t *)shell_output_reserve(&dec64_command, (char *)buf,
+					       BASE64_MAX_DATALEN);
+      s.sextets = s.dataptr = s.padding = 0;
 
-    for(i = 0; i < input->len1; ++i) {
-      base64_add_char(&s, input->data1[i]);
+      for(i = 0; i < input.len1; ++i) {
+	base64_add_char(&s, input.data1[i]);
+      }
+      for(i = 0; i < input.len2; ++i) {
+	base64_add_char(&s, input.data2[i]);
+      }
+      shell_output_commit(&dec64_command, (char *)s.data,
+			  s.dataptr - s.padding);
+      shell_pipe_next(&dec64_pipe);
     }
-    for(i = 0; i < input->len2; ++i) {
-      base64_add_char(&s, input->data2[i]);
+
+    if(shell_pipe_eof(&dec64_pipe)) {
+      PROCESS_EXIT();
     }
-    shell_output(&dec64_command, s.data, s.dataptr - s.padding, "", 0);
   }
   PROCESS_END();
 }
@@ -75,6 +75,8 @@ SHELL_COMMAND(crcvalidate_command,
 	      "crc-v",
 	      "crc-v: verify crc and output if valid",
 	      &shell_crcvalidate_process);
+
+static struct shell_pipe bin2hex_pipe, hex2bin_pipe, crc_pipe, crcvalidate_pipe;
 /*---------------------------------------------------------------------------*/
 static unsigned char
 fromhexchar(unsigned char c)
@@ -99,36 +101,56 @@ fromhex(unsigned char c1, unsigned char c2)
   return (fromhexchar(c1)<<4) + fromhexchar(c2);
 }
 /*---------------------------------------------------------------------------*/
-PROCESS_THREAD(shell_bin2hex_process, ev, data)
+static char *
+tohex(char *ptr, const char *data, int len)
 {
-  struct shell_input *input;
+  static const char hexchars[] = "0123456789abcdef";
   int i;
+
+  for(i = 0; i < len; i++) {
+    *ptr++ = hexchars[(data[i] >> 4) & 0xf];
+    *ptr++ = hexchars[data[i] & 0xf];
+  }
+  return ptr;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_bin2hex_process, ev, data)
+{
+  struct shell_input input;
   char *bufptr;
   char *buf;
+  int len;
 
   PROCESS_BEGIN();
 
-  while(1) {
-    PROCESS_WAIT_EVENT_UNTIL(ev == shell_event_input);
-    input = data;
+  shell_pipe_open(&bin2hex_pipe, &bin2hex_command);
 
-    if(input->len1 + input->len2 == 0) {
-      PROCESS_EXIT();
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    while(shell_pipe_read(&bin2hex_pipe, &input) &&
+	  shell_output_ready(&bin2hex_command,
+			     (input.len1 + input.len2)*2)) {
+      len = (input.len1 + input.len2)*2;
+
+      /* Only input that does not go through a pipe buffer needs a
+	 buffer on the stack, and there is only one such input per
+	 event. */
+      buf = shell_output_reserve(&bin2hex_command, NULL, len);
+      if(buf == NULL) {
+	buf = alloca(len);
+      }
+
+      bufptr = tohex(buf, input.data1, input.len1);
+      tohex(bufptr, input.data2, input.len2);
+
+      shell_output_commit(&bin2hex_command, buf, len);
+      shell_pipe_next(&bin2hex_pipe);
     }
 
-    buf = alloca((input->len1 + input->len2)*2);
-
-    bufptr = buf;
-    for(i = 0; i < input->len1; i++) {
-      bufptr += sprintf(bufptr, "%02x", 0xff&((char*)input->data1)[i]);
-    }
-    for(i = 0; i < input->len2; i++) {
-      bufptr += sprintf(bufptr, "%02x", 0xff&((char*)input->data2)[i]);
+    if(shell_pipe_eof(&bin2hex_pipe)) {
+      PROCESS_EXIT();
     }
-
-    shell_output(
-        &bin2hex_command,
-        buf, ((input->len1 + input->len2)*2), "", 0);
   }
 
   PROCESS_END();
@@ -136,46 +158,58 @@ PROCESS_THREAD(shell_bin2hex_process, ev, data)
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(shell_hex2bin_process, ev, data)
 {
-  struct shell_input *input;
-  int i, cnt;
+  struct shell_input input;
+  int i, cnt, len;
   char* buf;
 
   PROCESS_BEGIN();
 
   /* Reads data in hexadecimal format and prints in binary */
 
-  while(1) {
-    PROCESS_WAIT_EVENT_UNTIL(ev == shell_event_input);
-    input = data;
+  shell_pipe_open(&hex2bin_pipe, &hex2bin_command);
 
-    if(input->len1 + input->len2 == 0) {
-      PROCESS_EXIT();
-    }
-
-    if(input->len1 % 2 != 0) {
-      PRINTF("Bad input length 1: %d\n", input->len1);
-      continue;
-    }
-    if(input->len2 % 2 != 0) {
-      PRINTF("Bad input length 2: %d\n", input->len2);
-      continue;
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    while(shell_pipe_read(&hex2bin_pipe, &input) &&
+	  shell_output_ready(&hex2bin_command,
+			     (input.len1 + input.len2)/2)) {
+      if(input.len1 % 2 != 0) {
+	PRINTF("Bad input length 1: %d\n", input.len1);
+	shell_pipe_next(&hex2bin_pipe);
+	continue;
+      }
+      if(input.len2 % 2 != 0) {
+	PRINTF("Bad input length 2: %d\n", input.len2);
+	shell_pipe_next(&hex2bin_pipe);
+	continue;
+      }
+
+      len = (input.len1 + input.len2)/2;
+      buf = shell_output_reserve(&hex2bin_command, NULL, len);
+      if(buf == NULL) {
+	buf = alloca(len+1);
+      }
+
+      cnt = 0;
+      for(i = 0; i < input.len1; i += 2) {
+	buf[cnt++] = fromhex(
+	    ((char*)input.data1)[i],
+	    ((char*)input.data1)[i+1]);
+      }
+      for(i = 0; i < input.len2; i += 2) {
+	buf[cnt++] = fromhex(
+	    ((char*)input.data2)[i],
+	    ((char*)input.data2)[i+1]);
+      }
+
+      shell_output_commit(&hex2bin_command, buf, cnt);
+      shell_pipe_next(&hex2bin_pipe);
     }
 
-    buf = alloca((input->len1 + input->len2)/2+1);
-
-    cnt = 0;
-    for(i = 0; i < input->len1; i += 2) {
-      buf[cnt++] = fromhex(
-          ((char*)input->data1)[i],
-          ((char*)input->data1)[i+1]);
-    }
-    for(i = 0; i < input->len2; i += 2) {
-      buf[cnt++] = fromhex(
-          ((char*)input->data2)[i],
-          ((char*)input->data2)[i+1]);
+    if(shell_pipe_eof(&hex2bin_pipe)) {
+      PROCESS_EXIT();
     }
-
-    shell_output(&hex2bin_command, buf, cnt, "", 0);
   }
 
   PROCESS_END();
@@ -183,8 +217,8 @@ PROCESS_THREAD(shell_hex2bin_process, ev, data)
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(shell_crc_process, ev, data)
 {
-  struct shell_input *input;
-  int i;
+  struct shell_input input;
+  int i, len;
   uint16_t crc;
   char *buf;
 
@@ -192,31 +226,47 @@ PROCESS_THREAD(shell_crc_process, ev, data)
 
   /* Append per-block 16-bit CRC */
 
-  while(1) {
-    PROCESS_WAIT_EVENT_UNTIL(ev == shell_event_input);
-    input = data;
+  shell_pipe_open(&crc_pipe, &crc_command);
 
-    if(input->len1 + input->len2 == 0) {
-      PROCESS_EXIT();
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    while(shell_pipe_read(&crc_pipe, &input) &&
+	  shell_output_ready(&crc_command, input.len1 + input.len2 + 2)) {
+      /* calculate crc */
+      crc = 0;
+      for(i = 0; i < input.len1; i++) {
+	crc = crc16_add(((char*)(input.data1))[i], crc);
+      }
+      for(i = 0; i < input.len2; i++) {
+	crc = crc16_add(((char*)(input.data2))[i], crc);
+      }
+
+      len = input.len1 + input.len2;
+      buf = shell_output_reserve(&crc_command, NULL, len+2);
+      if(buf != NULL) {
+	/* input + 16-bit CRC, in the pipe of the next command */
+	memcpy(buf, input.data1, input.len1);
+	memcpy(buf+input.len1, input.data2, input.len2);
+	buf[len] = crc&0xff;
+	buf[len+1] = (crc>>8)&0xff;
+	shell_output_commit(&crc_command, buf, len+2);
+      } else {
+	/* input + 16-bit CRC */
+	buf = alloca(input.len2+2);
+
+	memcpy(buf, input.data2, input.len2);
+	buf[input.len2] = crc&0xff;
+	buf[input.len2+1] = (crc>>8)&0xff;
+
+	shell_output(&crc_command, input.data1, input.len1, buf, input.len2+2);
+      }
+      shell_pipe_next(&crc_pipe);
     }
 
-    /* calculate crc */
-    crc = 0;
-    for(i = 0; i < input->len1; i++) {
-      crc = crc16_add(((char*)(input->data1))[i], crc);
-    }
-    for(i = 0; i < input->len2; i++) {
-      crc = crc16_add(((char*)(input->data2))[i], crc);
+    if(shell_pipe_eof(&crc_pipe)) {
+      PROCESS_EXIT();
     }
-
-    /* input + 16-bit CRC */
-    buf = alloca(input->len2+2);
-
-    memcpy(buf, input->data2, input->len2);
-    buf[input->len2] = crc&0xff;
-    buf[input->len2+1] = (crc>>8)&0xff;
-
-    shell_output(&crc_command, input->data1, input->len1, buf, input->len2+2);
   }
 
   PROCESS_END();
@@ -224,7 +274,7 @@ PROCESS_THREAD(shell_crc_process, ev, data)
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(shell_crcvalidate_process, ev, data)
 {
-  struct shell_input *input;
+  struct shell_input input;
   int i;
   char crc1, crc2;
   uint16_t crc, crc_footer;
@@ -234,52 +284,59 @@ PROCESS_THREAD(shell_crcvalidate_process, ev, data)
   /* Per-block 16-bit CRC verification:
    * outputs data without CRCs matches, otherwise nothing */
 
-  while(1) {
-    PROCESS_WAIT_EVENT_UNTIL(ev == shell_event_input);
-    input = data;
+  shell_pipe_open(&crcvalidate_pipe, &crcvalidate_command);
 
-    if(input->len1 + input->len2 == 0) {
-      PROCESS_EXIT();
-    }
-
-    if(input->len1 + input->len2 < 2) {
-      /* too short - no output */
-      PRINTF("Too short input: %d+%d\n", input->len1, input->len2);
-      continue;
-    }
-
-    if(input->len2 == 1) {
-      crc1 = ((char*)input->data1)[input->len1-1];
-      crc2 = ((char*)input->data2)[input->len2-1];
-      input->len1 -= 1;
-      input->len2 -= 1;
-    } else if(input->len2 >= 2) {
-      crc1 = ((char*)input->data2)[input->len2-2];
-      crc2 = ((char*)input->data2)[input->len2-1];
-      input->len2 -= 2;
-    } else {
-      crc1 = ((char*)input->data1)[input->len1-2];
-      crc2 = ((char*)input->data1)[input->len1-1];
-      input->len1 -= 2;
-    }
-
-    /* recalculate crc */
-    crc = 0;
-    for(i = 0; i < input->len1; i++) {
-      crc = crc16_add(((char*)(input->data1))[i], crc);
-    }
-    for(i = 0; i < input->len2; i++) {
-      crc = crc16_add(((char*)(input->data2))[i], crc);
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    while(shell_pipe_read(&crcvalidate_pipe, &input) &&
+	  shell_output_ready(&crcvalidate_command,
+			     input.len1 + input.len2)) {
+      if(input.len1 + input.len2 < 2) {
+	/* too short - no output */
+	PRINTF("Too short input: %d+%d\n", input.len1, input.len2);
+	shell_pipe_next(&crcvalidate_pipe);
+	continue;
+      }
+
+      if(input.len2 == 1) {
+	crc1 = ((char*)input.data1)[input.len1-1];
+	crc2 = ((char*)input.data2)[input.len2-1];
+	input.len1 -= 1;
+	input.len2 -= 1;
+      } else if(input.len2 >= 2) {
+	crc1 = ((char*)input.data2)[input.len2-2];
+	crc2 = ((char*)input.data2)[input.len2-1];
+	input.len2 -= 2;
+      } else {
+	crc1 = ((char*)input.data1)[input.len1-2];
+	crc2 = ((char*)input.data1)[input.len1-1];
+	input.len1 -= 2;
+      }
+
+      /* recalculate crc */
+      crc = 0;
+      for(i = 0; i < input.len1; i++) {
+	crc = crc16_add(((char*)(input.data1))[i], crc);
+      }
+      for(i = 0; i < input.len2; i++) {
+	crc = crc16_add(((char*)(input.data2))[i], crc);
+      }
+
+      /* compare with input crc */
+      crc_footer = ((0xff&crc2)<<8) | (0xff&crc1);
+
+      /* output if matching crcs */
+      if(crc_footer == crc) {
+	shell_output(
+	    &crcvalidate_command,
+	    input.data1, input.len1, input.data2, input.len2);
+      }
+      shell_pipe_next(&crcvalidate_pipe);
     }
 
-    /* compare with input crc */
-    crc_footer = ((0xff&crc2)<<8) | (0xff&crc1);
-
-    /* output if matching crcs */
-    if(crc_footer == crc) {
-      shell_output(
-          &crcvalidate_command,
-          input->data1, input->len1, input->data2, input->len2);
+    if(shell_pipe_eof(&crcvalidate_pipe)) {
+      PROCESS_EXIT();
     }
   }
 
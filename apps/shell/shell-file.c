@@ -73,6 +73,8 @@ SHELL_COMMAND(rm_command,
               "rm",
               "rm <filename>: remove the file named filename",
               &shell_rm_process);
+
+static struct shell_pipe append_pipe, write_pipe;
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(shell_ls_process, ev, data)
 {
@@ -102,7 +104,7 @@ PROCESS_THREAD(shell_ls_process, ev, data)
 PROCESS_THREAD(shell_append_process, ev, data)
 {
   static int fd = 0;
-  struct shell_input *input;
+  struct shell_input input;
 
   PROCESS_EXITHANDLER(cfs_close(fd));
   
@@ -114,21 +116,24 @@ PROCESS_THREAD(shell_append_process, ev, data)
     shell_output_str(&append_command,
 		     "append: could not open file for writing: ", data);
   } else {
+    shell_pipe_open(&append_pipe, &append_command);
     while(1) {
-      PROCESS_WAIT_EVENT_UNTIL(ev == shell_event_input);
-      input = data;
-      /*    printf("cat input %d %d\n", input->len1, input->len2);*/
-      if(input->len1 + input->len2 == 0) {
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+      while(shell_pipe_read(&append_pipe, &input) &&
+	    shell_output_ready(&append_command, input.len1 + input.len2)) {
+	/*    printf("cat input %d %d\n", input.len1, input.len2);*/
+	cfs_write(fd, input.data1, input.len1);
+	cfs_write(fd, input.data2, input.len2);
+
+	shell_output(&append_command,
+		     input.data1, input.len1,
+		     input.data2, input.len2);
+	shell_pipe_next(&append_pipe);
+      }
+      if(shell_pipe_eof(&append_pipe)) {
 	cfs_close(fd);
 	PROCESS_EXIT();
       }
-      
-      cfs_write(fd, input->data1, input->len1);
-      cfs_write(fd, input->data2, input->len2);
-      
-      shell_output(&append_command,
-		   input->data1, input->len1,
-		   input->data2, input->len2);
     }
   }
   
@@ -138,7 +143,7 @@ PROCESS_THREAD(shell_append_process, ev, data)
 PROCESS_THREAD(shell_write_process, ev, data)
 {
   static int fd = 0;
-  struct shell_input *input;
+  struct shell_input input;
   int r;
 
   PROCESS_EXITHANDLER(cfs_close(fd));
@@ -151,31 +156,34 @@ PROCESS_THREAD(shell_write_process, ev, data)
     shell_output_str(&write_command,
 		     "write: could not open file for writing: ", data);
   } else {
+    shell_pipe_open(&write_pipe, &write_command);
     while(1) {
-      PROCESS_WAIT_EVENT_UNTIL(ev == shell_event_input);
-      input = data;
-      /*    printf("cat input %d %d\n", input->len1, input->len2);*/
-      if(input->len1 + input->len2 == 0) {
-	cfs_close(fd);
-	PROCESS_EXIT();
-      }
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+      while(shell_pipe_read(&write_pipe, &input) &&
+	    shell_output_ready(&write_command, input.len1 + input.len2)) {
+	/*    printf("cat input %d %d\n", input.len1, input.len2);*/
+	r = 0;
+	if(input.len1 > 0) {
+	  r = cfs_write(fd, input.data1, input.len1);
+	}
 
-      r = 0;      
-      if(input->len1 > 0) {
-	r = cfs_write(fd, input->data1, input->len1);
-      }
+	if(r >= 0 && input.len2 > 0) {
+	  r = cfs_write(fd, input.data2, input.len2);
+	}
 
-      if(r >= 0 && input->len2 > 0) {
-	r = cfs_write(fd, input->data2, input->len2);
+	if(r < 0) {
+	  shell_output_str(&write_command, "write: could not write to the file",
+			   "");
+	} else {
+	  shell_output(&write_command,
+		       input.data1, input.len1,
+		       input.data2, input.len2);
+	}
+	shell_pipe_next(&write_pipe);
       }
-
-      if(r < 0) {
-	shell_output_str(&write_command, "write: could not write to the file",
-			 NULL);
-      } else {
-	shell_output(&write_command,
-		     input->data1, input->len1,
-		     input->data2, input->len2);
+      if(shell_pipe_eof(&write_pipe)) {
+	cfs_close(fd);
+	PROCESS_EXIT();
       }
     }
   }
@@ -187,7 +195,7 @@ PROCESS_THREAD(shell_read_process, ev, data)
 {
   static int fd = 0;
   static int block_size = MAX_BLOCKSIZE;
-  char *next;
+  char *next, *ptr;
   char filename[MAX_FILENAME_LEN];
   int len;
   int offset = 0;
@@ -238,16 +246,24 @@ PROCESS_THREAD(shell_read_process, ev, data)
     } else {
       
       while(1) {
-	len = cfs_read(fd, buf, block_size);
-	if(len <= 0) {
-	  cfs_close(fd);
-	  PROCESS_EXIT();
+	/* If the next command reads from a pipe, we read the file
+	   straight into the pipe until it is full. Otherwise, we let
+	   other processes run after each block. */
+	while(shell_output_ready(&read_command, block_size)) {
+	  ptr = shell_output_reserve(&read_command, buf, block_size);
+	  len = cfs_read(fd, ptr, block_size);
+	  if(len <= 0) {
+	    cfs_close(fd);
+	    PROCESS_EXIT();
+	  }
+	  shell_output_commit(&read_command, ptr, len);
+	  if(ptr == buf) {
+	    process_post(&shell_read_process, PROCESS_EVENT_CONTINUE, NULL);
+	    break;
+	  }
 	}
-	shell_output(&read_command,
-		     buf, len, "", 0);
-	
-	process_post(&shell_read_process, PROCESS_EVENT_CONTINUE, NULL);
 	PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_CONTINUE ||
+				 ev == PROCESS_EVENT_POLL ||
 				 ev == shell_event_input);
 	
 	if(ev == shell_event_input) {
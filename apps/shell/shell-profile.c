@@ -32,7 +32,7 @@
 
 /**
  * \file
- *         A brief description of what this file is.
+ *         The Contiki shell profiling command
  * \author
  *         Adam Dunkels <adam@sics.se>
  */
@@ -41,7 +41,7 @@
 #include "contiki-conf.h"
 #include "shell-profile.h"
 
-#include "loader/symbols.h"
+#include "sys/profile.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -50,38 +50,71 @@
 PROCESS(shell_profile_process, "Shell 'profile' command");
 SHELL_COMMAND(profile_command,
 	      "profile",
-	      "profile: show aggregate profiling information",
+	      "profile [-m|-r]: show profiling information, -m machine readable, -r reset",
 	      &shell_profile_process);
 /*---------------------------------------------------------------------------*/
+static void
+output_stats(struct profile_stats *s)
+{
+  char buf[60];
+  char hist[8 * PROFILE_HISTOGRAM_SIZE];
+  int i, len;
+
+  snprintf(buf, sizeof(buf), "P %s %lu %lu %u %u %lu", s->name,
+           (unsigned long)s->count, (unsigned long)s->total,
+           (unsigned)s->min, (unsigned)s->max,
+           (unsigned long)(s->total / s->count));
+  len = 0;
+  for(i = 0; i < PROFILE_HISTOGRAM_SIZE; i++) {
+    len += sprintf(&hist[len], " %u", s->histogram[i]);
+  }
+  shell_output_str(&profile_command, buf, hist);
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(shell_profile_process, ev, data)
 {
-  int i;
-  char buf[100];
+  struct profile_stats *s;
+  const char *args;
+  char buf[60];
+  char unit[20];
+  int machine;
+
   PROCESS_BEGIN();
 
-#if DETAILED_AGGREGATES
-  for(i = 0; i < aggregates_list_ptr; ++i) {
-    sprintf(buf, "-- %s: %lu / %u = %lu", aggregates[i].ptr,
-	   aggregates[i].cycles,
-	   aggregates[i].episodes,
-	   aggregates[i].cycles / aggregates[i].episodes);
-    shell_output(buf, "");
+  args = data;
+  machine = 0;
+  if(args != NULL && args[0] == '-') {
+    if(args[1] == 'r') {
+      profile_reset();
+      shell_output_str(&profile_command, "profile: statistics cleared", "");
+      PROCESS_EXIT();
+    } else if(args[1] == 'm') {
+      machine = 1;
+    }
   }
-#else
-  for(i = 0; i < aggregates_list_ptr; ++i) {
-    sprintf(buf, "-- %c%c: %lu / %u = %lu",
-	   aggregates[i].ptr[0], aggregates[i].ptr[1],
-	   aggregates[i].cycles,
-	   aggregates[i].episodes,
-	   aggregates[i].cycles / aggregates[i].episodes);
-    shell_output(buf, "");
+
+  for(s = profile_stats_head(); s != NULL; s = profile_stats_next(s)) {
+    if(machine) {
+      output_stats(s);
+    } else {
+      snprintf(buf, sizeof(buf), "-- %s: %lu calls, min %u mean %lu max %u",
+               s->name, (unsigned long)s->count, (unsigned)s->min,
+               (unsigned long)(s->total / s->count), (unsigned)s->max);
+      shell_output_str(&profile_command, buf, " ticks");
+    }
   }
-#endif
 
-  sprintf(buf, "Memory for aggregates: %d * %d = %d\n",
-	  (int)sizeof(struct aggregate), aggregates_list_ptr,
-	  (int)sizeof(struct aggregate) * aggregates_list_ptr);
-  shell_output(buf, "");
+  if(machine) {
+    snprintf(buf, sizeof(buf), "P dropped %u", profile_dropped());
+    shell_output_str(&profile_command, buf, "");
+  } else {
+    snprintf(unit, sizeof(unit), "%lu", (unsigned long)RTIMER_ARCH_SECOND);
+    shell_output_str(&profile_command, "Ticks per second: ", unit);
+    if(profile_dropped() > 0) {
+      snprintf(unit, sizeof(unit), "%u", profile_dropped());
+      shell_output_str(&profile_command, "Dropped, probe table full: ", unit);
+    }
+  }
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         The Contiki shell command resolv, which shows the counters
+ *         of the DNS cache.
+ */
+
+#include <stdio.h>
+
+#include "contiki.h"
+#include "shell.h"
+#include "contiki-net.h"
+
+#define BUFLEN 100
+
+/*---------------------------------------------------------------------------*/
+PROCESS(shell_resolv_process, "resolv");
+SHELL_COMMAND(resolv_command,
+	      "resolv",
+	      "resolv: show DNS cache statistics",
+	      &shell_resolv_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_resolv_process, ev, data)
+{
+  char buf[BUFLEN];
+  unsigned long lookups;
+  PROCESS_BEGIN();
+
+  lookups = (unsigned long)resolv_stats.hits + resolv_stats.negative_hits +
+    resolv_stats.misses;
+  snprintf(buf, BUFLEN,
+	   "%u hits, %u negative hits, %u misses, %lu%% hit rate",
+	   resolv_stats.hits, resolv_stats.negative_hits,
+	   resolv_stats.misses,
+	   lookups == 0 ? 0 :
+	   100 * ((unsigned long)resolv_stats.hits +
+		  resolv_stats.negative_hits) / lookups);
+  shell_output_str(&resolv_command, buf, "");
+  snprintf(buf, BUFLEN,
+	   "%u queries, %u expired, %u evicted",
+	   resolv_stats.queries, resolv_stats.expired,
+	   resolv_stats.evictions);
+  shell_output_str(&resolv_command, buf, "");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_resolv_init(void)
+{
+  shell_register_command(&resolv_command);
+}
+/*---------------------------------------------------------------------------*/
@@ -69,6 +69,23 @@ LIST(commands);
 
 int shell_event_input;
 
+#define DEBUG 0
+#if DEBUG
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/* Input pipes of the commands that are running, and the pool of ring
+   buffers for them. */
+LIST(pipes);
+#if SHELL_PIPES > 0
+struct pipe_buf {
+  char data[SHELL_PIPE_SIZE];
+};
+MEMB(pipe_bufs, struct pipe_buf, SHELL_PIPES);
+#endif /* SHELL_PIPES > 0 */
+
 static struct process *front_process;
 
 static unsigned long time_offset;
@@ -341,12 +358,192 @@ shell_start_command(char *commandline, int commandline_len,
 }
 /*---------------------------------------------------------------------------*/
 static void
+pipe_close(struct shell_pipe *p)
+{
+  list_remove(pipes, p);
+#if SHELL_PIPES > 0
+  if(p->buf != NULL) {
+    memb_free(&pipe_bufs, p->buf);
+    p->buf = NULL;
+  }
+#endif /* SHELL_PIPES > 0 */
+  if(p->blocked != NULL) {
+    process_poll(p->blocked);
+    p->blocked = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+close_pipes(void)
+{
+  struct shell_pipe *p, *next;
+
+  for(p = list_head(pipes); p != NULL; p = next) {
+    next = p->next;
+    if(!process_is_running(p->command->process)) {
+      PRINTF("shell: closing pipe of '%s'\n", p->command->command);
+      pipe_close(p);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct shell_pipe *
+input_pipe(struct shell_command *c)
+{
+  struct shell_pipe *p;
+
+  for(p = list_head(pipes); p != NULL && p->command != c; p = p->next);
+  if(p != NULL && !process_is_running(c->process)) {
+    pipe_close(p);
+    return NULL;
+  }
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+static struct shell_pipe *
+output_pipe(struct shell_command *c)
+{
+  if(c == NULL || c->child == NULL) {
+    return NULL;
+  }
+  return input_pipe(c->child);
+}
+/*---------------------------------------------------------------------------*/
+/* Every piece of input is stored in the ring buffer with a two-byte
+   length in front of it. Pieces are never split: a piece that does
+   not fit at the end of the buffer is put at the start, and wrap
+   tells where the data before it ends. */
+static int
+pipe_alloc(struct shell_pipe *p, int len)
+{
+  len += 2;
+  if(p->head >= p->tail) {
+    if(p->head + len <= SHELL_PIPE_SIZE) {
+      return p->head;
+    }
+    if(len < p->tail) {
+      return 0;
+    }
+  } else if(p->head + len < p->tail) {
+    return p->head;
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+pipe_put(struct shell_pipe *p, int pos, int len)
+{
+  p->buf[pos] = len & 0xff;
+  p->buf[pos + 1] = len >> 8;
+  if(pos == 0 && p->head != 0) {
+    p->wrap = p->head;
+  }
+  p->head = pos + 2 + len;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+pipe_len(struct shell_pipe *p)
+{
+  return (uint8_t)p->buf[p->tail] | ((uint8_t)p->buf[p->tail + 1] << 8);
+}
+/*---------------------------------------------------------------------------*/
+/* Let a command and the piped commands after it read from their
+   pipes, the last one first, so that a command that waits for room
+   further down the pipeline can go on. */
+static void
+poll_pipeline(struct shell_command *c)
+{
+  if(c->child != NULL && input_pipe(c->child) != NULL) {
+    poll_pipeline(c->child);
+  }
+  process_post_synch(c->process, PROCESS_EVENT_POLL, NULL);
+}
+/*---------------------------------------------------------------------------*/
+/* Make room for len bytes in a pipe whose writer did not wait for
+   room, for as long as the commands down the pipeline make progress. */
+static int
+pipe_drain(struct shell_pipe *p, int len)
+{
+  uint16_t tail;
+  int pos;
+
+  do {
+    tail = p->tail;
+    poll_pipeline(p->command);
+    if(p->buf == NULL) {
+      return -1;
+    }
+    pos = pipe_alloc(p, len);
+  } while(pos < 0 && p->tail != tail);
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static void
+pipe_input(struct shell_pipe *p,
+	   char *data1, int len1,
+	   const char *data2, int len2)
+{
+  struct shell_input input;
+  int pos;
+
+  if(len1 + len2 == 0) {
+    p->eof = 1;
+    if(p->buf != NULL) {
+      process_poll(p->command->process);
+    } else {
+      process_post_synch(p->command->process, PROCESS_EVENT_POLL, NULL);
+    }
+    return;
+  }
+
+  if(p->buf != NULL) {
+    pos = pipe_alloc(p, len1 + len2);
+    if(pos < 0 && p->head != p->tail) {
+      /* The previous command did not wait for room in the pipe. */
+      pos = pipe_drain(p, len1 + len2);
+      if(p->buf == NULL) {
+	/* The command has exited. */
+	return;
+      }
+    }
+    if(pos >= 0) {
+      memcpy(&p->buf[pos + 2], data1, len1);
+      memcpy(&p->buf[pos + 2 + len1], data2, len2);
+      pipe_put(p, pos, len1 + len2);
+      process_poll(p->command->process);
+      return;
+    }
+    if(p->head != p->tail) {
+      shell_output_str(NULL, "shell: input lost, pipe full: ",
+		       p->command->command);
+      return;
+    }
+  }
+
+  /* Without a buffer, or if the input is larger than the buffer, the
+     input is handed over directly. */
+  input.data1 = data1;
+  input.len1 = len1;
+  input.data2 = data2;
+  input.len2 = len2;
+  p->direct = &input;
+  process_post_synch(p->command->process, PROCESS_EVENT_POLL, NULL);
+  p->direct = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
 input_to_child_command(struct shell_command *c,
 		       char *data1, int len1,
 		       const char *data2, int len2)
 {
   struct shell_input input;
+  struct shell_pipe *p;
   if(process_is_running(c->process)) {
+    p = input_pipe(c);
+    if(p != NULL) {
+      pipe_input(p, data1, len1, data2, len2);
+      return;
+    }
     input.data1 = data1;
     input.len1 = len1;
     input.data2 = data2;
@@ -355,10 +552,27 @@ input_to_child_command(struct shell_command *c,
   }
 }
 /*---------------------------------------------------------------------------*/
+static int
+pipeline_running(struct process *head)
+{
+  struct shell_command *c;
+
+  for(c = list_head(commands);
+      c != NULL && c->process != head;
+      c = c->next);
+  for(; c != NULL; c = c->child) {
+    if(process_is_running(c->process) && input_pipe(c) != NULL) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 void
 shell_input(char *commandline, int commandline_len)
 {
   struct shell_input input;
+  struct shell_command *c;
 
   /*  printf("shell_input front_process '%s'\n", front_process->name);*/
 
@@ -369,7 +583,12 @@ shell_input(char *commandline, int commandline_len)
       process_exit(front_process);
     }
   } else {
-    if(process_is_running(front_process)) {
+    for(c = list_head(commands);
+	c != NULL && c->process != front_process;
+	c = c->next);
+    if(c != NULL) {
+      input_to_child_command(c, commandline, commandline_len, "", 0);
+    } else if(process_is_running(front_process)) {
       input.data1 = commandline;
       input.len1 = commandline_len;
       input.data2 = "";
@@ -404,6 +623,127 @@ shell_output(struct shell_command *c,
 }
 /*---------------------------------------------------------------------------*/
 void
+shell_pipe_open(struct shell_pipe *p, struct shell_command *c)
+{
+  pipe_close(p);
+  p->command = c;
+  p->direct = NULL;
+  p->head = p->tail = 0;
+  p->eof = 0;
+  p->blocked = NULL;
+#if SHELL_PIPES > 0
+  p->buf = memb_alloc(&pipe_bufs);
+#else /* SHELL_PIPES > 0 */
+  p->buf = NULL;
+#endif /* SHELL_PIPES > 0 */
+  PRINTF("shell: pipe of '%s' opened, buffer %p\n", c->command, p->buf);
+  list_add(pipes, p);
+}
+/*---------------------------------------------------------------------------*/
+int
+shell_pipe_read(struct shell_pipe *p, struct shell_input *input)
+{
+  if(p->direct != NULL) {
+    *input = *p->direct;
+    return 1;
+  }
+  if(p->buf == NULL || p->head == p->tail) {
+    return 0;
+  }
+  input->data1 = &p->buf[p->tail + 2];
+  input->len1 = pipe_len(p);
+  input->data2 = "";
+  input->len2 = 0;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_pipe_next(struct shell_pipe *p)
+{
+  if(p->direct != NULL) {
+    p->direct = NULL;
+    return;
+  }
+  if(p->buf == NULL || p->head == p->tail) {
+    return;
+  }
+  p->tail += 2 + pipe_len(p);
+  if(p->tail == p->head) {
+    p->head = p->tail = 0;
+  } else if(p->head < p->tail && p->tail == p->wrap) {
+    p->tail = 0;
+  }
+  if(p->blocked != NULL) {
+    process_poll(p->blocked);
+    p->blocked = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+shell_pipe_eof(struct shell_pipe *p)
+{
+  return p->eof && p->direct == NULL &&
+    (p->buf == NULL || p->head == p->tail);
+}
+/*---------------------------------------------------------------------------*/
+int
+shell_output_ready(struct shell_command *c, int len)
+{
+  struct shell_pipe *p, *in;
+
+  p = output_pipe(c);
+  if(p == NULL || p->buf == NULL || len + 2 > SHELL_PIPE_SIZE ||
+     pipe_alloc(p, len) >= 0) {
+    return 1;
+  }
+
+  /* Input that was handed over directly cannot be kept until there
+     is room, so we let the next command read from its pipe right
+     away. */
+  in = input_pipe(c);
+  if(in != NULL && in->direct != NULL) {
+    process_post_synch(p->command->process, PROCESS_EVENT_POLL, NULL);
+    p = output_pipe(c);
+    if(p == NULL || p->buf == NULL || pipe_alloc(p, len) >= 0) {
+      return 1;
+    }
+  }
+  p->blocked = PROCESS_CURRENT();
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+char *
+shell_output_reserve(struct shell_command *c, char *buf, int len)
+{
+  struct shell_pipe *p;
+  int pos;
+
+  p = output_pipe(c);
+  if(p != NULL && p->buf != NULL && (pos = pipe_alloc(p, len)) >= 0) {
+    p->reserved = pos;
+    return &p->buf[pos + 2];
+  }
+  return buf;
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_output_commit(struct shell_command *c, char *ptr, int len)
+{
+  struct shell_pipe *p;
+
+  if(len <= 0) {
+    return;
+  }
+  p = output_pipe(c);
+  if(p != NULL && p->buf != NULL && ptr == &p->buf[p->reserved + 2]) {
+    pipe_put(p, p->reserved, len);
+    process_poll(p->command->process);
+  } else {
+    shell_output(c, ptr, len, "", 0);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
 shell_unregister_command(struct shell_command *c)
 {
   list_remove(commands, c);
@@ -450,11 +790,17 @@ PROCESS_THREAD(shell_process, ev, data)
 				&started_process);
 
       if(started_process != NULL &&
-	 ret == SHELL_FOREGROUND &&
-	 process_is_running(started_process)) {
-	front_process = started_process;
-	PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_EXITED &&
-				 data == started_process);
+	 ret == SHELL_FOREGROUND) {
+	if(process_is_running(started_process)) {
+	  front_process = started_process;
+	  PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_EXITED &&
+				   data == started_process);
+	}
+	/* Commands that read from pipes may still have input to
+	   process. */
+	while(pipeline_running(started_process)) {
+	  PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_EXITED);
+	}
       }
       front_process = &shell_process;
     }
@@ -477,6 +823,7 @@ PROCESS_THREAD(shell_server_process, ev, data)
       p = data;
       /*      printf("process exited '%s' (front '%s')\n", p->name,
 	      front_process->name);*/
+      close_pipes();
       for(c = list_head(commands);
 	  c != NULL && c->process != p;
 	  c = c->next);
@@ -485,6 +832,13 @@ PROCESS_THREAD(shell_server_process, ev, data)
 	  /*	  printf("Killing '%s'\n", c->process->name);*/
 	  input_to_child_command(c->child, "", 0, "", 0);
 	  /*	  process_exit(c->process);*/
+
+	  /* A command that reads from a pipe exits when it has read
+	     all its input. The rest of the pipeline is told when it
+	     has. */
+	  if(input_pipe(c->child) != NULL) {
+	    break;
+	  }
 	}
 	c = c->child;
       }
@@ -501,6 +855,10 @@ void
 shell_init(void)
 {
   list_init(commands);
+  list_init(pipes);
+#if SHELL_PIPES > 0
+  memb_init(&pipe_bufs);
+#endif /* SHELL_PIPES > 0 */
   shell_register_command(&help_command);
   shell_register_command(&question_command);
   shell_register_command(&killall_command);
@@ -368,6 +368,148 @@ struct shell_input {
   int len1, len2;
 };
 
+/**
+ * @}
+ */
+
+/**
+ * \name       Shell pipes
+ *
+ *             A shell command that reads input can open a pipe to
+ *             receive its input through a ring buffer instead of
+ *             getting one shell_event_input event for every piece of
+ *             output of the previous command in the pipeline. Output
+ *             to the command is queued in the ring buffer and the
+ *             command is polled (with PROCESS_EVENT_POLL) so that it
+ *             can process everything that has been queued in one go.
+ *
+ *             A command that writes to a piped command can use
+ *             shell_output_ready() to wait until the pipe has room,
+ *             and shell_output_reserve() and shell_output_commit() to
+ *             produce its output directly into the ring buffer.
+ *
+ *             The ring buffers are taken from a small pool when the
+ *             pipe is opened. If the pool is empty, the pipe works
+ *             without a buffer: input is then handed to the command
+ *             synchronously, one piece at a time, as without a pipe.
+ * @{
+ */
+
+#ifdef SHELL_CONF_PIPES
+#define SHELL_PIPES SHELL_CONF_PIPES
+#else /* SHELL_CONF_PIPES */
+#define SHELL_PIPES 2
+#endif /* SHELL_CONF_PIPES */
+
+#ifdef SHELL_CONF_PIPE_SIZE
+#define SHELL_PIPE_SIZE SHELL_CONF_PIPE_SIZE
+#else /* SHELL_CONF_PIPE_SIZE */
+#define SHELL_PIPE_SIZE 256
+#endif /* SHELL_CONF_PIPE_SIZE */
+
+/**
+ * \brief      Structure for the input pipe of a shell command
+ *
+ *             The structure is owned by the command that reads from
+ *             the pipe, but all fields are managed by the shell.
+ *
+ */
+struct shell_pipe {
+  struct shell_pipe *next;
+  struct shell_command *command;
+  struct shell_input *direct;
+  char *buf;
+  uint16_t head, tail, wrap, reserved;
+  uint8_t eof;
+  struct process *blocked;
+};
+
+/**
+ * \brief      Open the input pipe of a shell command
+ * \param p    A pointer to the pipe structure
+ * \param c    The command that reads from the pipe
+ *
+ *             This function is called by a shell command when it
+ *             starts, before it waits for any input. From then on,
+ *             all input to the command goes through the pipe and the
+ *             command waits for PROCESS_EVENT_POLL instead of
+ *             shell_event_input. The pipe is closed by the shell when
+ *             the command exits.
+ *
+ */
+void shell_pipe_open(struct shell_pipe *p, struct shell_command *c);
+
+/**
+ * \brief      Get the next piece of input from a pipe
+ * \param p    A pointer to the pipe structure
+ * \param input A pointer to a structure that is filled in with the input
+ * \retval 0   The pipe is empty
+ * \retval 1   The input structure was filled in
+ *
+ *             This function does not remove the input from the pipe,
+ *             so that a command that cannot pass the input on yet can
+ *             try again later. The data stays valid until
+ *             shell_pipe_next() is called or the command waits for an
+ *             event.
+ *
+ */
+int shell_pipe_read(struct shell_pipe *p, struct shell_input *input);
+
+/**
+ * \brief      Remove the input returned by shell_pipe_read()
+ * \param p    A pointer to the pipe structure
+ *
+ */
+void shell_pipe_next(struct shell_pipe *p);
+
+/**
+ * \brief      Check if a pipe has reached the end of its input
+ * \param p    A pointer to the pipe structure
+ * \retval     Non-zero if the previous command has exited and all its output has been read
+ *
+ */
+int shell_pipe_eof(struct shell_pipe *p);
+
+/**
+ * \brief      Check if a command can output data without blocking
+ * \param c    The command that outputs data
+ * \param len  The number of bytes the command wants to output
+ * \retval     Non-zero if the output can be made now
+ *
+ *             If the next command in the pipeline has a full pipe,
+ *             this function returns zero and the calling process is
+ *             polled when the pipe has been read from. Output to
+ *             commands without a pipe buffer is always possible.
+ *
+ */
+int shell_output_ready(struct shell_command *c, int len);
+
+/**
+ * \brief      Get a buffer for output from a shell command
+ * \param c    The command that outputs data
+ * \param buf  A buffer of at least len bytes owned by the caller
+ * \param len  The maximum number of bytes that will be output
+ * \retval     A pointer to where the output should be put
+ *
+ *             If the next command in the pipeline has room in its
+ *             pipe buffer, this function returns a pointer into the
+ *             pipe buffer, so that the output does not have to be
+ *             copied. Otherwise, it returns buf. The output must be
+ *             passed on with shell_output_commit() before the command
+ *             outputs anything else or waits for an event.
+ *
+ */
+char *shell_output_reserve(struct shell_command *c, char *buf, int len);
+
+/**
+ * \brief      Pass on output prepared with shell_output_reserve()
+ * \param c    The command that outputs data
+ * \param ptr  The pointer returned by shell_output_reserve()
+ * \param len  The number of bytes of output, at most the number reserved
+ *
+ */
+void shell_output_commit(struct shell_command *c, char *ptr, int len);
+
 /**
  * @}
  */
@@ -391,6 +533,7 @@ struct shell_input {
 #include "shell-powertrace.h"
 #include "shell-ps.h"
 #include "shell-reboot.h"
+#include "shell-resolv.h"
 #include "shell-rime-debug.h"
 #include "shell-rime-debug-runicast.h"
 #include "shell-rime-neighbors.h"
@@ -0,0 +1,20 @@
+/* Generated by makeperfecthash from html-keywords, do not edit. */
+
+#include "html-keywords.h"
+
+const unsigned char html_keywords_asso[32] = {
+  10, 52, 213, 86, 144, 0, 192, 253,
+  111, 180, 89, 146, 33, 16, 243, 39,
+  165, 55, 141, 240, 159, 53, 1, 146,
+  238, 87, 231, 152, 100, 230, 177, 58,
+};
+const unsigned char html_keywords_index[64] = {
+  0x1b, 0xff, 0xff, 0xff, 0x11, 0xff, 0x0c, 0xff,
+  0x0b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x1d,
+  0x10, 0x01, 0xff, 0x04, 0xff, 0xff, 0x1e, 0x13,
+  0x03, 0xff, 0xff, 0x20, 0x0a, 0x00, 0xff, 0x1f,
+  0xff, 0x0f, 0x19, 0x02, 0x09, 0xff, 0x14, 0x08,
+  0x0d, 0xff, 0xff, 0x17, 0xff, 0xff, 0x18, 0xff,
+  0x12, 0xff, 0xff, 0xff, 0xff, 0x07, 0x16, 0x1a,
+  0x15, 0xff, 0xff, 0x1c, 0x06, 0x05, 0x0e, 0xff,
+};
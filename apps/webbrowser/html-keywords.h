@@ -0,0 +1,23 @@
+/* Generated by makeperfecthash from html-keywords, do not edit. */
+#ifndef __HTML_KEYWORDS_H__
+#define __HTML_KEYWORDS_H__
+
+/*
+ * The keyword of a string s of length len > 0 is found with
+ *
+ *   hash = len + asso[s[0] & 0x1f] + asso[s[1] & 0x1f] +
+ *                asso[s[2] & 0x1f] + asso[s[len - 1] & 0x1f]
+ *
+ * in unsigned char arithmetic, where s[1] is only used if len > 1,
+ * s[2] if len > 2 and s[len - 1] if len > 3. index[hash % size]
+ * is the line of the keyword in html-keywords, counting from 0, or NONE.
+ * s must then be compared with that keyword.
+ */
+
+#define HTML_KEYWORDS_SIZE 64
+#define HTML_KEYWORDS_NONE 0xff
+
+extern const unsigned char html_keywords_asso[32];
+extern const unsigned char html_keywords_index[64];
+
+#endif /* __HTML_KEYWORDS_H__ */
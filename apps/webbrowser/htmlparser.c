@@ -44,7 +44,10 @@ G * (<br>, <p>, <h>), the <li> tag (but does not even try to
  * means that it will shave off one character from the HTML page,
  * process that character, and return to the next. Another way of
  * doing it would be to buffer a number of characters and process them
- * together.
+ * together. Runs of plain text are an exception: they are copied to
+ * the current word in one go, up to the next whitespace, '<' or '&'.
+ * Tag and attribute names are looked up with a perfect hash that is
+ * generated from the html-keywords file.
  *
  * The main function in this file is the htmlparser_parse() function
  * which takes a htmlparser_state structur and a part of an HTML file
@@ -64,6 +67,7 @@ G * (<br>, <p>, <h>), the <li> tag (but does not even try to
 
 #include "contiki.h"
 #include "html-strings.h"
+#include "html-keywords.h"
 #include "www.h"
 
 #include "htmlparser.h"
@@ -171,9 +175,10 @@ struct htmlparser_state {
 static struct htmlparser_state s;
 
 /*-----------------------------------------------------------------------------------*/
-static char last[1] = {(char)0xff};
-
-static const char *tags[] = {
+/* The tags and attributes that are recognized, in the order of the
+   html-keywords file. After editing that file, regenerate the hash
+   with "tools/makeperfecthash html-keywords". */
+static const char *keywords[] = {
 #define TAG_FIRST       0
 #define TAG_SLASHA      0
   html_slasha,
@@ -226,7 +231,23 @@ static const char *tags[] = {
 #define TAG_TR         24   
   html_tr,
 #define TAG_LAST       25
-  last,
+#define ATTR_ACTION    25
+  html_action,
+#define ATTR_ALT       26
+  html_alt,
+#define ATTR_HREF      27
+  html_href,
+#define ATTR_NAME      28
+  html_name,
+#define ATTR_SIZE      29
+  html_size,
+#define ATTR_SRC       30
+  html_src,
+#define ATTR_TYPE      31
+  html_type,
+#define ATTR_VALUE     32
+  html_value,
+#define ATTR_LAST      33
 };
 
 /*-----------------------------------------------------------------------------------*/
@@ -287,6 +308,31 @@ add_char(unsigned char c)
   }
 }
 /*-----------------------------------------------------------------------------------*/
+static uint8_t
+add_text(char *data, uint8_t len)
+{
+  /* Add the plain characters at the start of data to the word, as
+     add_char() would one by one. Returns how many there were. */
+  char *word, *end;
+  uint8_t i;
+  unsigned char c;
+
+  word = &s.word[s.wordlen];
+  end = &s.word[WWW_CONF_WEBPAGE_WIDTH - 1];
+  for(i = 0; i < len; ++i) {
+    c = data[i];
+    if(c <= ISO_space || c >= 0x80 ||
+       c == ISO_lt || c == ISO_ampersand) {
+      break;
+    }
+    if(word < end) {
+      *word++ = c;
+    }
+  }
+  s.wordlen = word - s.word;
+  return i;
+}
+/*-----------------------------------------------------------------------------------*/
 static void
 do_word(void)
 {
@@ -313,45 +359,38 @@ newline(void)
 }
 /*-----------------------------------------------------------------------------------*/
 static unsigned char CC_FASTCALL
-find_tag(char *tag)
+find_keyword(char *str)
 {
-  static unsigned char first, last, i, tabi;
-  static char tagc;
-  
-  first = TAG_FIRST;
-  last = TAG_LAST;
-  i = 0;
-  
-  do {
-    tagc = tag[i];
-
-    if(tagc == 0 &&
-       tags[first][i] == 0) {
-      return first;
-    }
+  unsigned char len, hash, id;
 
-    tabi = first;
-    
-    /* First, find first matching tag from table. */
-    while(tagc > (tags[tabi])[i] &&
-	  tabi < last) {
-      ++tabi;
-    }
-    first = tabi;
-    
-    /* Second, find last matching tag from table. */
-    while(tagc == (tags[tabi])[i] &&
-	  tabi < last) {
-      ++tabi;
+  len = strlen(str);
+  if(len == 0) {
+    return HTML_KEYWORDS_NONE;
+  }
+  hash = len + html_keywords_asso[str[0] & 0x1f];
+  if(len > 1) {
+    hash += html_keywords_asso[str[1] & 0x1f];
+    if(len > 2) {
+      hash += html_keywords_asso[str[2] & 0x1f];
+      if(len > 3) {
+	hash += html_keywords_asso[str[len - 1] & 0x1f];
+      }
     }
-    last = tabi;
-    
-    /* If first and last matching tags are equal, we have a non-match
-       and return. Else we continue with the next character. */
-    ++i;
+  }
+  id = html_keywords_index[hash % HTML_KEYWORDS_SIZE];
+  if(id != HTML_KEYWORDS_NONE && strcmp(str, keywords[id]) == 0) {
+    return id;
+  }
+  return HTML_KEYWORDS_NONE;
+}
+/*-----------------------------------------------------------------------------------*/
+static unsigned char CC_FASTCALL
+find_tag(char *tag)
+{
+  unsigned char id;
 
-  } while(last != first);
-  return TAG_LAST;
+  id = find_keyword(tag);
+  return id < TAG_LAST? id: TAG_LAST;
 }
 /*-----------------------------------------------------------------------------------*/
 static void
@@ -361,6 +400,7 @@ parse_tag(void)
   static unsigned char size;
 
   static char dummy;
+  static unsigned char attr;
   
   PRINTF(("Parsing tag '%s' '%s' '%s'\n",
 	  s.tag, s.tagattr, s.tagattrparam));
@@ -401,7 +441,7 @@ parse_tag(void)
     s.majorstate = s.lastmajorstate = MAJORSTATE_BODY;
     break;
   case TAG_FRAME:
-    if(strncmp(s.tagattr, html_src, sizeof(html_src)) == 0 &&
+    if(find_keyword(s.tagattr) == ATTR_SRC &&
        s.tagattrparam[0] != 0) {
       switch_majorstate(MAJORSTATE_BODY);
       newline();
@@ -414,7 +454,7 @@ parse_tag(void)
     }
     break;
   case TAG_IMG:
-    if(strncmp(s.tagattr, html_alt, sizeof(html_alt)) == 0 &&
+    if(find_keyword(s.tagattr) == ATTR_ALT &&
        s.tagattrparam[0] != 0) {
       /*      parse_char(ISO_lt);*/
       add_char(ISO_lt);
@@ -431,7 +471,7 @@ parse_tag(void)
     break;
   case TAG_A:
     PRINTF(("A %s %s\n", s.tagattr, s.tagattrparam));
-    if(strncmp(s.tagattr, html_href, sizeof(html_href)) == 0 &&
+    if(find_keyword(s.tagattr) == ATTR_HREF &&
        s.tagattrparam[0] != 0) {
       strcpy(s.linkurl, s.tagattrparam);
       do_word();
@@ -450,10 +490,11 @@ parse_tag(void)
   case TAG_FORM:
     PRINTF(("Form tag\n"));
     switch_majorstate(MAJORSTATE_FORM);
-    if(strncmp(s.tagattr, html_action, sizeof(html_action)) == 0) {
+    attr = find_keyword(s.tagattr);
+    if(attr == ATTR_ACTION) {
       PRINTF(("Form action '%s'\n", s.tagattrparam));
       strncpy(s.formaction, s.tagattrparam, WWW_CONF_MAX_FORMACTIONLEN - 1);
-    } else if(strncmp(s.tagattr, html_name, sizeof(html_name)) == 0) {
+    } else if(attr == ATTR_NAME) {
       PRINTF(("Form name '%s'\n", s.tagattrparam));
       strncpy(s.formname, s.tagattrparam, WWW_CONF_MAX_FORMNAMELEN - 1);
     }
@@ -486,7 +527,8 @@ parse_tag(void)
 	s.inputtype = HTMLPARSER_INPUTTYPE_NONE;
       } else {
 	PRINTF(("Input '%s' '%s'\n", s.tagattr, s.tagattrparam));
-	if(strncmp(s.tagattr, html_type, sizeof(html_type)) == 0) {
+	attr = find_keyword(s.tagattr);
+	if(attr == ATTR_TYPE) {
 	  if(strncmp(s.tagattrparam, html_submit,
 		     sizeof(html_submit)) == 0) {
 	    s.inputtype = HTMLPARSER_INPUTTYPE_SUBMIT;
@@ -499,21 +541,17 @@ parse_tag(void)
 	  } else {
 	    s.inputtype = HTMLPARSER_INPUTTYPE_OTHER;
 	  }
-	} else if(strncmp(s.tagattr, html_name,
-			  sizeof(html_name)) == 0) {
+	} else if(attr == ATTR_NAME) {
 	  strncpy(s.inputname, s.tagattrparam,
 		  WWW_CONF_MAX_INPUTNAMELEN);
-	} else if(strncmp(s.tagattr, html_alt,
-			  sizeof(html_alt)) == 0 &&
+	} else if(attr == ATTR_ALT &&
 		  s.inputtype == HTMLPARSER_INPUTTYPE_IMAGE) {	  
 	  strncpy(s.inputvalue, s.tagattrparam,
 		  WWW_CONF_MAX_INPUTVALUELEN);	  
-	} else if(strncmp(s.tagattr, html_value,
-			  sizeof(html_value)) == 0) {
+	} else if(attr == ATTR_VALUE) {
 	  strncpy(s.inputvalue, s.tagattrparam,
 		  WWW_CONF_MAX_INPUTVALUELEN);
-	} else if(strncmp(s.tagattr, html_size,
-			  sizeof(html_size)) == 0) {
+	} else if(attr == ATTR_SIZE) {
 	  size = 0;
 	  if(s.tagattrparam[0] >= '0' &&
 	     s.tagattrparam[0] <= '9') {
@@ -557,16 +595,29 @@ parse_word(char *data, uint8_t dlen)
 {
   static uint8_t i;
   static uint8_t len;
+  uint8_t run;
   unsigned char c;
+  char *end;
 
   len = dlen;
 
   switch(s.minorstate) {
   case MINORSTATE_TEXT:
     for(i = 0; i < len; ++i) {
+      /* Copy a run of plain text to the word in one go. */
+      i += add_text(&data[i], len - i);
+      if(i == len) {
+	break;
+      }
       c = data[i];
       if(iswhitespace(c)) {
 	do_word();
+	/* Further whitespace ends no word, except within a link
+	   where do_word() adds a space. */
+	if(s.majorstate != MAJORSTATE_LINK) {
+	  for(run = i + 1; run < len && iswhitespace(data[run]); ++run);
+	  i = run - 1;
+	}
       } else if(c == ISO_lt) {
 	s.minorstate = MINORSTATE_TAG;
 	s.tagptr = 0;
@@ -803,14 +854,15 @@ parse_word(char *data, uint8_t dlen)
     break;
   case MINORSTATE_TAGEND:
     /* Discard characters until a '>' is seen. */
-    for(i = 0; i < len; ++i) {
-      if(data[i] == ISO_gt) {
-	s.minorstate = MINORSTATE_TEXT;
-	s.tagattrptr = 0;
-	endtagfound();
-	parse_tag();
-	break;
-      }
+    end = memchr(data, ISO_gt, len);
+    if(end != NULL) {
+      i = end - data;
+      s.minorstate = MINORSTATE_TEXT;
+      s.tagattrptr = 0;
+      endtagfound();
+      parse_tag();
+    } else {
+      i = len;
     }
     break;
   default:
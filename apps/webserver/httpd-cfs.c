@@ -72,6 +72,41 @@ MEMB(conns, struct httpd_state, CONNS);
 #define ISO_slash   0x2f
 
 /*---------------------------------------------------------------------------*/
+#if HTTPD_CFS_DIRECT
+static unsigned short
+generate(void *state)
+{
+  struct httpd_state *s = (struct httpd_state *)state;
+
+  /* The generator is called again for retransmissions, so always read
+     from the start of the segment that is not yet acknowledged. */
+  if(cfs_seek(s->fd, s->pos, CFS_SEEK_SET) != s->pos) {
+    s->len = 0;
+  } else {
+    s->len = cfs_read(s->fd, uip_appdata, uip_mss());
+    if(s->len < 0) {
+      s->len = 0;
+    }
+  }
+  return s->len;
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(send_file(struct httpd_state *s))
+{
+  PSOCK_BEGIN(&s->sout);
+
+  s->size = cfs_seek(s->fd, 0, CFS_SEEK_END);
+  for(s->pos = 0; s->pos < s->size; s->pos += s->len) {
+    PSOCK_GENERATOR_SEND(&s->sout, generate, s);
+    if(s->len == 0) {
+      break;
+    }
+  }
+
+  PSOCK_END(&s->sout);
+}
+#else /* HTTPD_CFS_DIRECT */
 static
 PT_THREAD(send_file(struct httpd_state *s))
 {
@@ -91,6 +126,7 @@ PT_THREAD(send_file(struct httpd_state *s))
       
   PSOCK_END(&s->sout);
 }
+#endif /* HTTPD_CFS_DIRECT */
 /*---------------------------------------------------------------------------*/
 static
 PT_THREAD(send_string(struct httpd_state *s, const char *str))
@@ -35,6 +35,7 @@
 #define __HTTPD_CFS_H__
 
 #include "contiki-net.h"
+#include "cfs/cfs.h"
 
 #ifndef WEBSERVER_CONF_CFS_PATHLEN
 #define HTTPD_PATHLEN 80
@@ -42,12 +43,25 @@
 #define HTTPD_PATHLEN WEBSERVER_CONF_CFS_PATHLEN
 #endif /* WEBSERVER_CONF_CFS_CONNS */
 
+/* Read file data straight into the uIP buffer instead of going through
+   outputbuf. Retransmissions seek back in the file, so the file system
+   must support cfs_seek(), including CFS_SEEK_END. */
+#ifndef WEBSERVER_CONF_CFS_DIRECT
+#define HTTPD_CFS_DIRECT 0
+#else /* WEBSERVER_CONF_CFS_DIRECT */
+#define HTTPD_CFS_DIRECT WEBSERVER_CONF_CFS_DIRECT
+#endif /* WEBSERVER_CONF_CFS_DIRECT */
+
 struct httpd_state {
   struct timer timer;
   struct psock sin, sout;
   struct pt outputpt;
   char inputbuf[HTTPD_PATHLEN + 30];
+#if HTTPD_CFS_DIRECT
+  cfs_offset_t pos, size;
+#else /* HTTPD_CFS_DIRECT */
   char outputbuf[UIP_TCP_MSS];
+#endif /* HTTPD_CFS_DIRECT */
   char filename[HTTPD_PATHLEN];
   char state;
   int fd;
@@ -80,6 +80,10 @@ httpd_fs_open(const char *name, struct httpd_fs_file *file)
     if(httpd_fs_strcmp(name, f->name) == 0) {
       file->data = f->data;
       file->len = f->len;
+#if HTTPD_STATIC_HEADERS
+      file->hdrlen = f->hdrlen;
+      file->etag = f->etag;
+#endif /* HTTPD_STATIC_HEADERS */
 #if HTTPD_FS_STATISTICS
       ++count[i];
 #endif /* HTTPD_FS_STATISTICS */
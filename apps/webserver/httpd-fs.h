@@ -38,9 +38,30 @@
 
 #define HTTPD_FS_STATISTICS 1
 
+/*
+ * In static header mode, httpd-fsdata.c is generated with
+ * "makefsdata -H", which stores the complete 200 response header of
+ * every static file right in front of the file data. The header ends
+ * with the ETag line, which is also used to answer conditional GETs.
+ */
+#ifdef WEBSERVER_CONF_STATIC_HEADERS
+#define HTTPD_STATIC_HEADERS WEBSERVER_CONF_STATIC_HEADERS
+#else
+#define HTTPD_STATIC_HEADERS 0
+#endif
+
+/* Length of the quoted entity tag, e.g. "\"0123abcd\"". */
+#define HTTPD_FS_ETAG_LEN 10
+
 struct httpd_fs_file {
   char *data;
   int len;
+#if HTTPD_STATIC_HEADERS
+  /* Length of the header that precedes data, 0 if there is none. */
+  int hdrlen;
+  /* The "ETag: " line at the end of the header. */
+  const char *etag;
+#endif /* HTTPD_STATIC_HEADERS */
 };
 
 /* file must be allocated by caller and will be filled in
@@ -41,6 +41,10 @@ struct httpd_fsdata_file {
   const char *name;
   const char *data;
   const int len;
+#if HTTPD_STATIC_HEADERS
+  const int hdrlen;
+  const char *etag;
+#endif /* HTTPD_STATIC_HEADERS */
 #ifdef HTTPD_FS_STATISTICS
 #if HTTPD_FS_STATISTICS == 1
   uint16_t count;
@@ -53,6 +57,10 @@ struct httpd_fsdata_file_noconst {
   char *name;
   char *data;
   int len;
+#if HTTPD_STATIC_HEADERS
+  int hdrlen;
+  char *etag;
+#endif /* HTTPD_STATIC_HEADERS */
 #ifdef HTTPD_FS_STATISTICS
 #if HTTPD_FS_STATISTICS == 1
   uint16_t count;
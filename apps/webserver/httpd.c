@@ -53,11 +53,13 @@
 
 #define STATE_WAITING 0
 #define STATE_OUTPUT  1
+#define STATE_CLOSED  2
 
 #define SEND_STRING(s, str) PSOCK_SEND(s, (uint8_t *)str, (unsigned int)strlen(str))
 MEMB(conns, struct httpd_state, CONNS);
 
 #define ISO_nl      0x0a
+#define ISO_cr      0x0d
 #define ISO_space   0x20
 #define ISO_bang    0x21
 #define ISO_percent 0x25
@@ -65,6 +67,21 @@ MEMB(conns, struct httpd_state, CONNS);
 #define ISO_slash   0x2f
 #define ISO_colon   0x3a
 
+/* Offset of the entity tag in the "ETag: " header line. */
+#define ETAG_VALUE_OFFSET 6
+
+#if HTTPD_KEEPALIVE
+/* Kinds of response header, see header_part(). */
+#define HDR_FILE         0
+#define HDR_SCRIPT       1
+#define HDR_STATIC       2
+#define HDR_NOT_MODIFIED 3
+
+/* Room for the Content-Length line, with the digits of an int and the
+   line end in place of the terminating zero of the string. */
+#define CONTENT_LENGTH_SIZE (sizeof(http_content_length) + 11 + 2)
+#endif /* HTTPD_KEEPALIVE */
+
 /*---------------------------------------------------------------------------*/
 static unsigned short
 generate(void *state)
@@ -104,6 +121,48 @@ PT_THREAD(send_part_of_file(struct httpd_state *s))
   
   PSOCK_END(&s->sout);
 }
+#if HTTPD_STATIC_HEADERS
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(send_static(struct httpd_state *s))
+{
+  PSOCK_BEGIN(&s->sout);
+
+  /* The precomputed header sits right in front of the file data, so
+     the whole response is sent straight from the file system. */
+  PSOCK_SEND(&s->sout, (uint8_t *)s->file.data - s->file.hdrlen,
+	     s->file.hdrlen + s->file.len);
+
+  PSOCK_END(&s->sout);
+}
+#if !HTTPD_KEEPALIVE
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(send_not_modified(struct httpd_state *s))
+{
+  PSOCK_BEGIN(&s->sout);
+
+  /* The ETag line is the last line of the precomputed header, so the
+     end of the header is reused as the end of the 304 response. */
+  SEND_STRING(&s->sout, http_header_304);
+  PSOCK_SEND(&s->sout, (uint8_t *)s->file.etag,
+	     (unsigned int)(s->file.data - s->file.etag));
+
+  PSOCK_END(&s->sout);
+}
+#endif /* !HTTPD_KEEPALIVE */
+#endif /* HTTPD_STATIC_HEADERS */
+/*---------------------------------------------------------------------------*/
+/* True if the line just read is the empty line that ends the request
+   headers: a lone "\r\n", or a bare "\n" from lenient clients. */
+static int
+end_of_headers(struct httpd_state *s)
+{
+  unsigned short len = PSOCK_DATALEN(&s->sin);
+
+  return (len == 1 && s->inputbuf[0] == ISO_nl) ||
+    (len == 2 && s->inputbuf[0] == ISO_cr && s->inputbuf[1] == ISO_nl);
+}
 /*---------------------------------------------------------------------------*/
 static void
 next_scriptstate(struct httpd_state *s)
@@ -181,19 +240,12 @@ PT_THREAD(handle_script(struct httpd_state *s))
   PT_END(&s->scriptpt);
 }
 /*---------------------------------------------------------------------------*/
-static
-PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
+static const char *
+get_content_type(const char *filename)
 {
-/* gcc warning if not initialized. 
- * If initialized, minimal-net platform segmentation fault if not static...
- */
-  static const char *ptr = NULL;
-
-  PSOCK_BEGIN(&s->sout);
+  const char *ptr;
 
-  SEND_STRING(&s->sout, statushdr);
-
-  ptr = strrchr(s->filename, ISO_period);
+  ptr = strrchr(filename, ISO_period);
   if(ptr == NULL) {
     ptr = http_content_type_binary;
   } else if(strncmp(http_html, ptr, 5) == 0 ||
@@ -210,9 +262,202 @@ PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
   } else {
     ptr = http_content_type_plain;
   }
-  SEND_STRING(&s->sout, ptr);
+  return ptr;
+}
+#if HTTPD_KEEPALIVE
+/*---------------------------------------------------------------------------*/
+/*
+ * The response header is made of up to four parts that are copied
+ * straight into the outgoing segments by generate_header(), so that
+ * no buffer is needed for it and the header is sent in as few
+ * segments as possible. Returns NULL after the last part.
+ */
+static const char *
+header_part(struct httpd_state *s, uint8_t i, char *buf, int *len)
+{
+  const char *ptr;
+
+  ptr = "";
+  switch(i) {
+  case 0:
+#if HTTPD_STATIC_HEADERS
+    if(s->hdrkind == HDR_STATIC) {
+      /* All of the precomputed header but the empty line. */
+      *len = s->file.hdrlen - 2;
+      return s->file.data - s->file.hdrlen;
+    }
+#endif /* HTTPD_STATIC_HEADERS */
+    ptr = s->statushdr;
+    break;
+  case 1:
+    if(!s->keepalive) {
+      ptr = http_connection_close;
+    } else if(s->http10) {
+      ptr = http_connection_keepalive;
+    }
+    break;
+  case 2:
+    if(s->hdrkind == HDR_FILE) {
+      snprintf(buf, CONTENT_LENGTH_SIZE, "%s%d\r\n",
+	       http_content_length, s->file.len);
+      ptr = buf;
+    }
+#if HTTPD_STATIC_HEADERS
+    else if(s->hdrkind == HDR_STATIC) {
+      ptr = http_crnl;
+    } else if(s->hdrkind == HDR_NOT_MODIFIED) {
+      /* The ETag line and the empty line that end the precomputed
+	 header. */
+      *len = (int)(s->file.data - s->file.etag);
+      return s->file.etag;
+    }
+#endif /* HTTPD_STATIC_HEADERS */
+    break;
+  case 3:
+    if(s->hdrkind == HDR_FILE || s->hdrkind == HDR_SCRIPT) {
+      ptr = get_content_type(s->filename);
+    }
+    break;
+  default:
+    return NULL;
+  }
+  *len = strlen(ptr);
+  return ptr;
+}
+/*---------------------------------------------------------------------------*/
+static int
+header_length(struct httpd_state *s)
+{
+  char buf[CONTENT_LENGTH_SIZE];
+  int len, total;
+  uint8_t i;
+
+  total = 0;
+  for(i = 0; header_part(s, i, buf, &len) != NULL; i++) {
+    total += len;
+  }
+  return total;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+generate_header(void *state)
+{
+  struct httpd_state *s = (struct httpd_state *)state;
+  char buf[CONTENT_LENGTH_SIZE];
+  const char *ptr;
+  int len, off;
+  uint8_t i;
+
+  off = s->hdroff;
+  s->len = 0;
+  for(i = 0; s->len < uip_mss() &&
+	(ptr = header_part(s, i, buf, &len)) != NULL; i++) {
+    if(off >= len) {
+      off -= len;
+    } else {
+      len -= off;
+      if(len > uip_mss() - s->len) {
+	len = uip_mss() - s->len;
+      }
+      memcpy((char *)uip_appdata + s->len, ptr + off, len);
+      s->len += len;
+      off = 0;
+    }
+  }
+  return s->len;
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(send_header(struct httpd_state *s))
+{
+  PSOCK_BEGIN(&s->sout);
+
+  for(s->hdroff = 0; s->hdroff < header_length(s); s->hdroff += s->len) {
+    PSOCK_GENERATOR_SEND(&s->sout, generate_header, s);
+  }
+
   PSOCK_END(&s->sout);
 }
+#else /* HTTPD_KEEPALIVE */
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
+{
+  PSOCK_BEGIN(&s->sout);
+
+  SEND_STRING(&s->sout, statushdr);
+  SEND_STRING(&s->sout, get_content_type(s->filename));
+
+  PSOCK_END(&s->sout);
+}
+#endif /* HTTPD_KEEPALIVE */
+#if HTTPD_KEEPALIVE
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(handle_output(struct httpd_state *s))
+{
+  char *ptr;
+
+  PT_BEGIN(&s->outputpt);
+
+  s->hdrkind = HDR_FILE;
+  s->statushdr = http_header11_200;
+  if(!httpd_fs_open(s->filename, &s->file)) {
+    strcpy(s->filename, http_404_html);
+    httpd_fs_open(s->filename, &s->file);
+    s->statushdr = http_header11_404;
+#if HTTPD_STATIC_HEADERS
+    /* The precomputed header has the wrong status. */
+    s->file.hdrlen = 0;
+#endif /* HTTPD_STATIC_HEADERS */
+  } else {
+    ptr = strrchr(s->filename, ISO_period);
+    if(ptr != NULL && strncmp(ptr, http_shtml, 6) == 0) {
+      s->hdrkind = HDR_SCRIPT;
+    }
+  }
+#if HTTPD_STATIC_HEADERS
+  if(s->file.hdrlen > 0) {
+    if(strncmp(s->etag, s->file.etag + ETAG_VALUE_OFFSET,
+	       HTTPD_FS_ETAG_LEN) == 0) {
+      s->hdrkind = HDR_NOT_MODIFIED;
+      s->statushdr = http_header11_304;
+    } else {
+      s->hdrkind = HDR_STATIC;
+    }
+  }
+#endif /* HTTPD_STATIC_HEADERS */
+
+  /* The client can only find the end of script output by the
+     connection being closed. */
+  if(++s->requests >= HTTPD_KEEPALIVE_MAX || s->hdrkind == HDR_SCRIPT) {
+    s->keepalive = 0;
+  }
+
+  /* The precomputed header has no Connection line. */
+  if(s->hdrkind == HDR_STATIC && s->keepalive && !s->http10) {
+#if HTTPD_STATIC_HEADERS
+    PT_WAIT_THREAD(&s->outputpt, send_static(s));
+#endif /* HTTPD_STATIC_HEADERS */
+  } else {
+    PT_WAIT_THREAD(&s->outputpt, send_header(s));
+    if(s->hdrkind == HDR_SCRIPT) {
+      PT_INIT(&s->scriptpt);
+      PT_WAIT_THREAD(&s->outputpt, handle_script(s));
+    } else if(s->hdrkind != HDR_NOT_MODIFIED) {
+      PT_WAIT_THREAD(&s->outputpt, send_file(s));
+    }
+  }
+
+  if(s->keepalive) {
+    s->state = STATE_WAITING;
+  } else {
+    s->state = STATE_CLOSED;
+    PSOCK_CLOSE(&s->sout);
+  }
+  PT_END(&s->outputpt);
+}
+#else /* HTTPD_KEEPALIVE */
 /*---------------------------------------------------------------------------*/
 static
 PT_THREAD(handle_output(struct httpd_state *s))
@@ -230,6 +475,18 @@ PT_THREAD(handle_output(struct httpd_state *s))
     PT_WAIT_THREAD(&s->outputpt,
 		   send_file(s));
   } else {
+#if HTTPD_STATIC_HEADERS
+    if(s->file.hdrlen > 0) {
+      if(strncmp(s->etag, s->file.etag + ETAG_VALUE_OFFSET,
+		 HTTPD_FS_ETAG_LEN) == 0) {
+	PT_WAIT_THREAD(&s->outputpt, send_not_modified(s));
+      } else {
+	PT_WAIT_THREAD(&s->outputpt, send_static(s));
+      }
+      PSOCK_CLOSE(&s->sout);
+      PT_EXIT(&s->outputpt);
+    }
+#endif /* HTTPD_STATIC_HEADERS */
     PT_WAIT_THREAD(&s->outputpt,
 		   send_headers(s,
 		   http_header_200));
@@ -245,6 +502,144 @@ PT_THREAD(handle_output(struct httpd_state *s))
   PSOCK_CLOSE(&s->sout);
   PT_END(&s->outputpt);
 }
+#endif /* HTTPD_KEEPALIVE */
+#if HTTPD_KEEPALIVE
+/*---------------------------------------------------------------------------*/
+static void
+next_request(struct httpd_state *s)
+{
+  memcpy(s->filename, s->pending[0].filename, sizeof(s->filename));
+#if HTTPD_STATIC_HEADERS
+  memcpy(s->etag, s->pending[0].etag, sizeof(s->etag));
+#endif /* HTTPD_STATIC_HEADERS */
+  s->keepalive = s->pending[0].keepalive;
+  s->http10 = s->pending[0].http10;
+  --s->npending;
+  if(uip_stopped(uip_conn)) {
+    uip_restart();
+  }
+  memmove(&s->pending[0], &s->pending[1],
+	  s->npending * sizeof(struct httpd_request));
+
+  PT_INIT(&s->outputpt);
+  s->state = STATE_OUTPUT;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Requests are parsed as they arrive, also while an earlier one is
+ * being answered, and queued in s->pending. The psock only reads from
+ * the current segment, so the input thread must not block on anything
+ * but new data. When the queue is full, the connection is stopped
+ * until handle_connection() has taken a request off the queue.
+ */
+#define REQ(s) (&(s)->pending[(s)->npending])
+static
+PT_THREAD(handle_input(struct httpd_state *s))
+{
+  char c;
+
+  PSOCK_BEGIN(&s->sin);
+
+  while(1) {
+    PSOCK_READTO(&s->sin, ISO_space);
+
+    if(strncmp(s->inputbuf, http_get, 4) != 0) {
+      PSOCK_CLOSE_EXIT(&s->sin);
+    }
+
+    if(s->npending == HTTPD_PIPELINE) {
+      /* The rest of the segment held one request too many. It is
+	 dropped, and the connection is closed after the queued ones so
+	 that the client sends it again on a new connection. */
+      s->pending[HTTPD_PIPELINE - 1].keepalive = 0;
+      while(1) {
+	PSOCK_READTO(&s->sin, ISO_nl);
+      }
+    }
+
+    PSOCK_READTO(&s->sin, ISO_space);
+
+    if(s->inputbuf[0] != ISO_slash) {
+      PSOCK_CLOSE_EXIT(&s->sin);
+    }
+
+    if(s->inputbuf[1] == ISO_space) {
+      strncpy(REQ(s)->filename, http_index_html, sizeof(REQ(s)->filename));
+    } else {
+      s->inputbuf[PSOCK_DATALEN(&s->sin) - 1] = 0;
+      strncpy(REQ(s)->filename, s->inputbuf, sizeof(REQ(s)->filename));
+    }
+
+    petsciiconv_topetscii(REQ(s)->filename, sizeof(REQ(s)->filename));
+    webserver_log_file(&uip_conn->ripaddr, REQ(s)->filename);
+    petsciiconv_toascii(REQ(s)->filename, sizeof(REQ(s)->filename));
+
+    /* HTTP/1.1 connections are persistent unless the client asks
+       otherwise, HTTP/1.0 connections only if the client asks for it. */
+    PSOCK_READTO(&s->sin, ISO_nl);
+    REQ(s)->keepalive = strncmp(s->inputbuf, http_11, 8) == 0;
+    REQ(s)->http10 = !REQ(s)->keepalive;
+#if HTTPD_STATIC_HEADERS
+    REQ(s)->etag[0] = 0;
+#endif /* HTTPD_STATIC_HEADERS */
+
+    while(1) {
+      PSOCK_READTO(&s->sin, ISO_nl);
+
+      if(end_of_headers(s)) {
+	break;
+      }
+
+      if(strncmp(s->inputbuf, http_connection,
+		 sizeof(http_connection) - 1) == 0) {
+	c = s->inputbuf[sizeof(http_connection) - 1] | 0x20;
+	if(c == 'c') {
+	  REQ(s)->keepalive = 0;
+	} else if(c == 'k') {
+	  REQ(s)->keepalive = 1;
+	}
+      }
+#if HTTPD_STATIC_HEADERS
+      if(strncmp(s->inputbuf, http_if_none_match,
+		 sizeof(http_if_none_match) - 1) == 0) {
+	strncpy(REQ(s)->etag, s->inputbuf + sizeof(http_if_none_match) - 1,
+		sizeof(REQ(s)->etag));
+      }
+#endif /* HTTPD_STATIC_HEADERS */
+
+      if(strncmp(s->inputbuf, http_referer, 8) == 0) {
+	s->inputbuf[PSOCK_DATALEN(&s->sin) - 2] = 0;
+	petsciiconv_topetscii(s->inputbuf, PSOCK_DATALEN(&s->sin) - 2);
+	webserver_log(s->inputbuf);
+      }
+    }
+
+    ++s->npending;
+    if(s->state == STATE_WAITING) {
+      next_request(s);
+    } else if(s->npending == HTTPD_PIPELINE) {
+      uip_stop();
+    }
+  }
+
+  PSOCK_END(&s->sin);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_connection(struct httpd_state *s)
+{
+  handle_input(s);
+  do {
+    if(s->state == STATE_WAITING && s->npending > 0) {
+      next_request(s);
+    }
+    if(s->state != STATE_OUTPUT) {
+      break;
+    }
+    handle_output(s);
+  } while(s->state == STATE_WAITING);
+}
+#else /* HTTPD_KEEPALIVE */
 /*---------------------------------------------------------------------------*/
 static
 PT_THREAD(handle_input(struct httpd_state *s))
@@ -272,11 +667,25 @@ PT_THREAD(handle_input(struct httpd_state *s))
   petsciiconv_topetscii(s->filename, sizeof(s->filename));
   webserver_log_file(&uip_conn->ripaddr, s->filename);
   petsciiconv_toascii(s->filename, sizeof(s->filename));
+#if !HTTPD_STATIC_HEADERS
   s->state = STATE_OUTPUT;
+#endif /* HTTPD_STATIC_HEADERS */
 
   while(1) {
     PSOCK_READTO(&s->sin, ISO_nl);
 
+#if HTTPD_STATIC_HEADERS
+    /* The reply depends on If-None-Match, so wait for the empty line
+       that ends the request headers. */
+    if(end_of_headers(s)) {
+      s->state = STATE_OUTPUT;
+    } else if(strncmp(s->inputbuf, http_if_none_match,
+		      sizeof(http_if_none_match) - 1) == 0) {
+      strncpy(s->etag, s->inputbuf + sizeof(http_if_none_match) - 1,
+	      sizeof(s->etag));
+    }
+#endif /* HTTPD_STATIC_HEADERS */
+
     if(strncmp(s->inputbuf, http_referer, 8) == 0) {
       s->inputbuf[PSOCK_DATALEN(&s->sin) - 2] = 0;
       petsciiconv_topetscii(s->inputbuf, PSOCK_DATALEN(&s->sin) - 2);
@@ -295,6 +704,7 @@ handle_connection(struct httpd_state *s)
     handle_output(s);
   }
 }
+#endif /* HTTPD_KEEPALIVE */
 /*---------------------------------------------------------------------------*/
 void
 httpd_appcall(void *state)
@@ -316,12 +726,29 @@ httpd_appcall(void *state)
     PSOCK_INIT(&s->sout, (uint8_t *)s->inputbuf, sizeof(s->inputbuf) - 1);
     PT_INIT(&s->outputpt);
     s->state = STATE_WAITING;
+#if HTTPD_STATIC_HEADERS
+    s->etag[0] = 0;
+#endif /* HTTPD_STATIC_HEADERS */
+#if HTTPD_KEEPALIVE
+    s->requests = 0;
+    s->npending = 0;
+#endif /* HTTPD_KEEPALIVE */
     /*    timer_set(&s->timer, CLOCK_SECOND * 100);*/
     s->timer = 0;
     handle_connection(s);
   } else if(s != NULL) {
     if(uip_poll()) {
       ++s->timer;
+#if HTTPD_KEEPALIVE
+      /* Connections are polled twice a second. */
+      if(s->state == STATE_WAITING && s->requests > 0 &&
+	 s->npending == 0) {
+	if(s->timer >= HTTPD_KEEPALIVE_TIMEOUT * 2) {
+	  uip_close();
+	}
+	return;
+      }
+#endif /* HTTPD_KEEPALIVE */
       if(s->timer >= 20) {
 	uip_abort();
 	memb_free(&conns, s);
@@ -38,14 +38,73 @@
 #include "contiki-net.h"
 #include "httpd-fs.h"
 
+/*
+ * With keep-alive, several requests are answered on one connection,
+ * and requests that arrive before the previous reply is done are
+ * queued. Output of scripts has no Content-Length, so the connection
+ * is closed after it.
+ */
+#ifdef WEBSERVER_CONF_KEEPALIVE
+#define HTTPD_KEEPALIVE WEBSERVER_CONF_KEEPALIVE
+#else
+#define HTTPD_KEEPALIVE 0
+#endif
+
+/* Seconds an idle persistent connection is kept open. */
+#ifdef WEBSERVER_CONF_KEEPALIVE_TIMEOUT
+#define HTTPD_KEEPALIVE_TIMEOUT WEBSERVER_CONF_KEEPALIVE_TIMEOUT
+#else
+#define HTTPD_KEEPALIVE_TIMEOUT 10
+#endif
+
+/* Number of requests answered before the connection is closed. */
+#ifdef WEBSERVER_CONF_KEEPALIVE_MAX
+#define HTTPD_KEEPALIVE_MAX WEBSERVER_CONF_KEEPALIVE_MAX
+#else
+#define HTTPD_KEEPALIVE_MAX 10
+#endif
+
+/* Number of pipelined requests queued behind the one being answered. */
+#ifdef WEBSERVER_CONF_PIPELINE
+#define HTTPD_PIPELINE WEBSERVER_CONF_PIPELINE
+#else
+#define HTTPD_PIPELINE 2
+#endif
+
+#if HTTPD_KEEPALIVE
+struct httpd_request {
+  char filename[20];
+#if HTTPD_STATIC_HEADERS
+  char etag[HTTPD_FS_ETAG_LEN];
+#endif /* HTTPD_STATIC_HEADERS */
+  char keepalive;
+  /* HTTP/1.0 clients only keep the connection if the reply says so. */
+  char http10;
+};
+#endif /* HTTPD_KEEPALIVE */
+
 struct httpd_state {
-  unsigned char timer;
+  /* Half seconds, wide enough for HTTPD_KEEPALIVE_TIMEOUT. */
+  unsigned short timer;
   struct psock sin, sout;
   struct pt outputpt, scriptpt;
   char inputbuf[50];
   char filename[20];
   char state;
   struct httpd_fs_file file;  
+#if HTTPD_STATIC_HEADERS
+  char etag[HTTPD_FS_ETAG_LEN];
+#endif /* HTTPD_STATIC_HEADERS */
+#if HTTPD_KEEPALIVE
+  char keepalive;
+  char http10;
+  uint8_t requests;
+  uint8_t npending;
+  struct httpd_request pending[HTTPD_PIPELINE];
+  uint8_t hdrkind;
+  const char *statushdr;
+  int hdroff;
+#endif /* HTTPD_KEEPALIVE */
   int len;
   char *scriptptr;
   int scriptlen;
@@ -58,6 +58,7 @@
 #include "cfs/cfs.h"
 #include "cfs-coffee-arch.h"
 #include "cfs/cfs-coffee.h"
+#include "sys/profile.h"
 
 /* Micro logs enable modifications on storage types that do not support
    in-place updates. This applies primarily to flash memories. */
@@ -1146,6 +1147,7 @@ cfs_read(int fd, void *buf, unsigned size)
   return size;
 }
 /*---------------------------------------------------------------------------*/
+PROFILE_PROBE(cfs_write);
 int
 cfs_write(int fd, const void *buf, unsigned size)
 {
@@ -1162,6 +1164,8 @@ cfs_write(int fd, const void *buf, unsigned size)
     return -1;
   }
 
+  PROFILE_PROBE_BEGIN(cfs_write);
+
   fdp = &coffee_fd_set[fd];
   file = fdp->file;
 
@@ -1172,6 +1176,7 @@ cfs_write(int fd, const void *buf, unsigned size)
   while(size + fdp->offset + sizeof(struct file_header) >
      (file->max_pages * COFFEE_PAGE_SIZE)) {
     if(merge_log(file->page, 1) < 0) {
+      PROFILE_PROBE_END(cfs_write);
       return -1;
     }
     file = fdp->file;
@@ -1196,6 +1201,7 @@ cfs_write(int fd, const void *buf, unsigned size)
       if(i < 0) {
 	/* Return -1 if we wrote nothing because the log write failed. */
 	if(size == bytes_left) {
+	  PROFILE_PROBE_END(cfs_write);
 	  return -1;
 	}
 	break;
@@ -1224,6 +1230,7 @@ cfs_write(int fd, const void *buf, unsigned size)
 #endif /* COFFEE_MICRO_LOGS */
 #if COFFEE_APPEND_ONLY
     if(fdp->offset < file->end) {
+      PROFILE_PROBE_END(cfs_write);
       return -1;
     }
 #endif /* COFFEE_APPEND_ONLY */
@@ -1238,6 +1245,7 @@ cfs_write(int fd, const void *buf, unsigned size)
     file->end = fdp->offset;
   }
 
+  PROFILE_PROBE_END(cfs_write);
   return size;
 }
 /*---------------------------------------------------------------------------*/
@@ -38,9 +38,9 @@
 
 #ifdef __AVR__
 #include <avr/pgmspace.h>
-const unsigned char vncfont[] PROGMEM = {
+const unsigned char ctk_vncfont[] PROGMEM = {
 #else
-const unsigned char vncfont[] = {
+const unsigned char ctk_vncfont[] = {
 #endif
 /* char 0 */
 X,o,_,_,_,_,
@@ -38,7 +38,7 @@
 #define CTK_VNCFONT_HEIGHT 8
 
 
-extern unsigned char ctk_vncfont[CTK_VNCFONT_WIDTH *
+extern const unsigned char ctk_vncfont[CTK_VNCFONT_WIDTH *
 				 CTK_VNCFONT_HEIGHT *
 				 128];
 
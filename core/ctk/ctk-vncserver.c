@@ -114,6 +114,10 @@ PROCESS(ctk_vncserver_process, "CTK VNC server");
 
 static struct vnc_server_state conns[CTK_VNCSERVER_CONF_NUMCONNS];
 
+/* Set when CTK has drawn something since the connections were last
+   told about the changed characters. */
+static uint8_t areas_updated;
+
 #define PRINTF(x) 
 
 #define revers(x)
@@ -123,115 +127,6 @@ unsigned char ctk_draw_windowborder_width = 1;
 unsigned char ctk_draw_windowtitle_height = 1;
 
 
-/*-----------------------------------------------------------------------------------*/
-/**
- * Add an update request from a client to the list of pending updates
- * for the connection.
- *
- * This function is called from the vnc-out module.
- *
- * \param vs The VNC connection state.
- * \param a The area that is requested to be updated.
- */
-/*-----------------------------------------------------------------------------------*/
-void
-vnc_server_update_add(struct vnc_server_state *vs,
-		      struct vnc_server_update *a)
-{
-  /* XXX: test both head and tail placement!*/
-  a->next = vs->updates_pending;
-  vs->updates_pending = a;
-}
-/*-----------------------------------------------------------------------------------*/
-/**
- * Allocate an update request from the VNC connection state.
- *
- * This function is called from the vnc-out module.
- *
- * \param vs The VNC connection state.
- *
- * \return Memory for an update structure, or NULL if no update could
- * be allocated.
- */
-/*-----------------------------------------------------------------------------------*/
-struct vnc_server_update *
-vnc_server_update_alloc(struct vnc_server_state *vs)
-{
-  struct vnc_server_update *a;
-
-  a = vs->updates_free;
-  if(a == NULL) {
-    return NULL;
-  }
-  vs->updates_free = a->next;
-  a->next = NULL;
-  return a;
-}
-/*-----------------------------------------------------------------------------------*/
-/**
- * Deallocate an update request from the VNC connection state.
- *
- * This function is called from the vnc-out module.
- *
- * \param vs The VNC connection state.
- *
- * \param a The update structure to be deallocated.
- */
-/*-----------------------------------------------------------------------------------*/
-void
-vnc_server_update_free(struct vnc_server_state *vs,
-		       struct vnc_server_update *a)
-{
-  a->next = vs->updates_free;
-  vs->updates_free = a;
-}
-/*-----------------------------------------------------------------------------------*/
-/**
- * Dequeue the first update on the queue of updates.
- *
- * This function is called from the vnc-out module.
- *
- * \param vs The VNC connection state.
- *
- * \return The first update on the queue, or NULL if the queue is empty.
- */
-/*-----------------------------------------------------------------------------------*/
-struct vnc_server_update *
-vnc_server_update_dequeue(struct vnc_server_state *vs)
-{
-  struct vnc_server_update *a;
-
-  a = vs->updates_pending;
-  if(a == NULL) {
-    return a;
-  }
-  vs->updates_pending = a->next;
-  a->next = NULL;
-  return a;
-}
-/*-----------------------------------------------------------------------------------*/
-/**
- * Remove a specific update on the queue of updates.
- *
- * \param vs The VNC connection state.
- * \param a The update to be removed.
- */
-/*-----------------------------------------------------------------------------------*/
-void
-vnc_server_update_remove(struct vnc_server_state *vs,
-			 struct vnc_server_update *a)
-{
-  struct vnc_server_update *b, *c;
-
-  if(a == vs->updates_pending) {
-    vs->updates_pending = a->next;
-  } else {
-    b = vs->updates_pending;
-    for(c = vs->updates_pending; c != a; b = c, c = c->next);
-
-    b->next = a->next;
-  }
-}
 /*-----------------------------------------------------------------------------------*/
 /** \internal
  * Flag an area to be updated for all open VNC server connections.
@@ -241,19 +136,14 @@ vnc_server_update_remove(struct vnc_server_state *vs,
 static void
 update_area(uint8_t x, uint8_t y, uint8_t w, uint8_t h)
 {
-  uint8_t i;
-  
   if(h == 0 || w == 0) {
     return;
   }
   
-  /* Update for all active VNC connections. */
-  for(i = 0; i < CTK_VNCSERVER_CONF_NUMCONNS; ++i) {
-    if(conns[i].state != VNC_DEALLOCATED) {
-      vnc_out_update_area(&conns[i],
-			  x, y, w, h);
-    }
-  }
+  /* The characters that have changed are passed on to the active
+     VNC connections the next time the server runs, when CTK has
+     finished drawing. */
+  areas_updated = 1;
 
 }
 /*-----------------------------------------------------------------------------------*/
@@ -1049,9 +939,20 @@ void
 ctk_vncserver_appcall(void *state)
 {
   static struct vnc_server_state *vs;
+  uint8_t i;
 
   vs = (struct vnc_server_state *)(state);
 
+  if(areas_updated) {
+    areas_updated = 0;
+    for(i = 0; i < CTK_VNCSERVER_CONF_NUMCONNS; ++i) {
+      if(conns[i].state != VNC_DEALLOCATED) {
+	vnc_out_update_changed(&conns[i]);
+      }
+    }
+    vnc_out_clear_changed();
+  }
+
   if(uip_connected()) {
 
     /* Since we've just been connected, the state pointer should be
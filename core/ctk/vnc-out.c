@@ -40,6 +40,8 @@
 
 #include "lib/libconio.h"
 
+#include <string.h>
+
 #ifdef WITH_AVR
 #include <avr/pgmspace.h>
 #else
@@ -233,6 +235,24 @@ vnc_out_add_icon(struct ctk_icon *icon)
   return empty;
 }
 
+/* Cells that are different from what the clients were last told
+   about. With a shadow copy of the screen as it was then, a cell that
+   is cleared and then redrawn with the same character, as CTK does
+   when it redraws the desktop, does not count as changed. The shadow
+   copy takes two bytes per character, so it is off by default. */
+#ifdef CTK_VNCSERVER_CONF_SHADOW_SCREEN
+#define SHADOW_SCREEN CTK_VNCSERVER_CONF_SHADOW_SCREEN
+#else
+#define SHADOW_SCREEN 0
+#endif
+
+static uint8_t changed[VNC_SERVER_DIRTY_SIZE];
+
+#if SHADOW_SCREEN
+static uint8_t shadowscreen[CHARS_WIDTH * CHARS_HEIGHT];
+static uint8_t shadowcolorscreen[CHARS_WIDTH * CHARS_HEIGHT];
+#endif /* SHADOW_SCREEN */
+
 /*-----------------------------------------------------------------------------------*/
 void
 vnc_out_init(void)
@@ -241,189 +261,171 @@ vnc_out_init(void)
   for(i = 0; i < CHARS_WIDTH * CHARS_HEIGHT; ++i) {
     screen[i] = 0x20;
   }
+#if SHADOW_SCREEN
+  memcpy(shadowscreen, screen, sizeof(shadowscreen));
+#endif /* SHADOW_SCREEN */
 }
 
 void
 vnc_out_update_screen(uint8_t xpos, uint8_t ypos, uint8_t c, uint8_t color)
 {
-  screen[xpos + ypos * CHARS_WIDTH] = c;
-  colorscreen[xpos + ypos * CHARS_WIDTH] = color;
+  uint16_t i;
+
+  i = xpos + ypos * CHARS_WIDTH;
+#if SHADOW_SCREEN
+  screen[i] = c;
+  colorscreen[i] = color;
+  if(shadowscreen[i] != c || shadowcolorscreen[i] != color) {
+    changed[i >> 3] |= 1 << (i & 7);
+  } else {
+    changed[i >> 3] &= ~(1 << (i & 7));
+  }
+#else /* SHADOW_SCREEN */
+  if(screen[i] != c || colorscreen[i] != color) {
+    screen[i] = c;
+    colorscreen[i] = color;
+    changed[i >> 3] |= 1 << (i & 7);
+  }
+#endif /* SHADOW_SCREEN */
 }
 /*-----------------------------------------------------------------------------------*/
+#define DIRTY(vs, i) ((vs)->dirty[(i) >> 3] & (1 << ((i) & 7)))
+
+/* The area is recorded as a set of dirty character cells. When the
+   update is sent, the dirty cells are coalesced into rectangles
+   again, so overlapping or adjacent areas never cause any cell to be
+   sent twice. */
 void
 vnc_out_update_area(struct vnc_server_state *vs,
 		    uint8_t x, uint8_t y, uint8_t w, uint8_t h)
 {
-  uint8_t x2, y2, ax2, ay2;
-  register struct vnc_server_update *a, *b;
+  uint16_t i, x2, y2;
 
   PRINTF(("update_area_connection: should update (%d:%d) (%d:%d)\n",
 	 x, y, w, h));
-  
-  /* First check if we already have a full update queued. If so, there
-     is no need to put this update on the list. If there is a full
-     update, it is always the first one on the list, so there is no
-     need to go step the list in search for it. */
-
-  if(vs->updates_pending != NULL &&
-     vs->updates_pending->type == VNC_SERVER_UPDATE_FULL) {
-    PRINTF(("Update_area_connecion: full update already queued...\n"));
+
+  if(x >= CHARS_WIDTH || y >= CHARS_HEIGHT) {
     return;
   }
+  x2 = x + w > CHARS_WIDTH? CHARS_WIDTH: x + w;
+  y2 = y + h > CHARS_HEIGHT? CHARS_HEIGHT: y + h;
 
- again:
-  
-  /* Check that we don't update the same area twice by going through
-     the list and search for an update with the same coordinates. */
-  for(a = vs->updates_pending; a != NULL; a = a->next) {
-    if(a->x == x && a->y == y &&
-       a->w == w && a->h == h) {
-      PRINTF(("Update_area_connecion: found equal area\n"));
-      return;
-    }    
-  }
-
-  /* Next we check if this update covers an existing update. If so, we
-     remove the old update, expand this update so that it covers both
-     areas to be updated and run through the process again. */
-  b = NULL;
-  for(a = vs->updates_pending; a != NULL; a = a->next) {      
-    x2 = x + w;
-    y2 = y + h;
-    
-    ax2 = a->x + a->w;
-    ay2 = a->y + a->h;
-
-    /* Test the corners of both updates to see if they are inside the
-       other area. */
-#define INSIDE(x,y,x1,y1,x2,y2) ((x1) <= (x) && \
-                                 (x2) >= (x) && \
-                                 (y1) <= (y) && \
-                                 (y2) >= (y))
-    if(INSIDE(x, y, a->x, a->y, ax2, ay2) ||
-       INSIDE(x, y2, a->x, a->y, ax2, ay2) ||
-       INSIDE(x2, y2, a->x, a->y, ax2, ay2) ||
-       INSIDE(x2, y, a->x, a->y, ax2, ay2) ||
-       INSIDE(a->x, a->y, x, y, x2, y2) ||
-       INSIDE(a->x, ay2, x, y, x2, y2) ||
-       INSIDE(ax2, ay2, x, y, x2, y2) ||
-       INSIDE(ax2, a->y, x, y, x2, y2)) {
-
-      /* Remove the old update from the list. */
-      vnc_server_update_remove(vs, a);
-
-      /* Put it on the free list. */
-      vnc_server_update_free(vs, a);
-
-      PRINTF(("update_area_connection: inside (%d:%d, %d:%d)\n",
-	     a->x, a->y, ax2, ay2));
-      
-      /* Find the area that covers both updates. */
-#define MIN(a,b) ((a) < (b)? (a): (b))
-#define MAX(a,b) ((a) > (b)? (a): (b))
-      x = MIN(a->x, x);
-      y = MIN(a->y, y);
-      ax2 = MAX(ax2, x2);
-      ay2 = MAX(ay2, y2);
-      w = ax2 - x;
-      h = ay2 - y;
-
-      /* This should really be done by a recursive call to this
-	 function: update_area_connection(vs, x, y, w, h); but because
-	 some compilers might not be able to optimize away the
-	 recursive call, we do it using a goto instead. */
-      PRINTF(("Update_area_connecion: trying larger area (%d:%d) (%d:%d)\n", x, y, w, h));
-      goto again;
+  for(; y < y2; ++y) {
+    for(i = x + y * CHARS_WIDTH; i < x2 + y * CHARS_WIDTH; ++i) {
+      vs->dirty[i >> 3] |= 1 << (i & 7);
     }
-    if(b != NULL) {
-      b = b->next;
+  }
+}
+/*-----------------------------------------------------------------------------------*/
+/* Mark the characters that have changed as dirty. This is done when
+   CTK has finished drawing, since CTK redraws whole windows and
+   widgets even when only a few of their characters are different. */
+void
+vnc_out_update_changed(struct vnc_server_state *vs)
+{
+  uint16_t i;
+
+  for(i = 0; i < VNC_SERVER_DIRTY_SIZE; ++i) {
+    vs->dirty[i] |= changed[i];
+  }
+}
+/*-----------------------------------------------------------------------------------*/
+/* Called when the changed characters have been passed on to all
+   connections. */
+void
+vnc_out_clear_changed(void)
+{
+#if SHADOW_SCREEN
+  memcpy(shadowscreen, screen, sizeof(shadowscreen));
+  memcpy(shadowcolorscreen, colorscreen, sizeof(shadowcolorscreen));
+#endif /* SHADOW_SCREEN */
+  memset(changed, 0, sizeof(changed));
+}
+/*-----------------------------------------------------------------------------------*/
+/* Take the next rectangle of dirty cells out of the dirty set. The
+   rectangle starts at the first dirty cell, is grown to the right as
+   long as the cells are dirty, and then downwards as long as the
+   whole row below it is dirty. */
+static uint8_t
+take_update(CC_REGISTER_ARG struct vnc_server_state *vs,
+	    struct vnc_server_update *a)
+{
+  uint16_t i, j;
+  uint8_t w, h;
+
+  for(i = 0; i < VNC_SERVER_DIRTY_SIZE && vs->dirty[i] == 0; ++i);
+  if(i == VNC_SERVER_DIRTY_SIZE) {
+    return 0;
+  }
+  for(i <<= 3; !DIRTY(vs, i); ++i);
+
+  a->x = i % CHARS_WIDTH;
+  a->y = i / CHARS_WIDTH;
+
+  for(w = 1; a->x + w < CHARS_WIDTH && DIRTY(vs, i + w); ++w);
+  for(h = 1; a->y + h < CHARS_HEIGHT; ++h) {
+    for(j = 0; j < w && DIRTY(vs, i + h * CHARS_WIDTH + j); ++j);
+    if(j < w) {
+      break;
     }
   }
-  
-  /* Allocate an update object by pulling it off the free list. If
-     there are no free objects, we go for a full update instead. */
-
-  /*  a = vs->updates_free;*/
-  a = vnc_server_update_alloc(vs);
-  if(a == NULL) {
-    PRINTF(("Update_area_connecion: no free updates, doing full\n"));
-    /* Put all pending updates, except for one, on the free list. Use
-       the remaining update as a full update. */
-    while(vs->updates_pending != NULL) {
-      a = vs->updates_pending;
-      vnc_server_update_remove(vs, a);
-      vnc_server_update_free(vs, a);
+  a->w = w;
+  a->h = h;
+
+  for(; h > 0; --h, i += CHARS_WIDTH) {
+    for(j = i; j < i + w; ++j) {
+      vs->dirty[j >> 3] &= ~(1 << (j & 7));
     }
+  }
 
-    a = vnc_server_update_alloc(vs);
-    a->type = VNC_SERVER_UPDATE_FULL;
-    vnc_server_update_add(vs, a);
-					
+  PRINTF(("take_update: (%d:%d) (%d:%d)\n", a->x, a->y, a->w, a->h));
+  return 1;
+}
+/*-----------------------------------------------------------------------------------*/
+#define UPDATE(vs, n) (&(vs)->updates[((vs)->updates_first + (n)) % \
+				      VNC_SERVER_MAX_UPDATES])
 
-  } else {
-    
-    PRINTF(("Update_area_connecion: allocated update for (%d:%d) (%d:%d)\n", x, y, w, h));
-  /* Else, we put the update object at the end of the pending
-     list. */
-    a->type = VNC_SERVER_UPDATE_PARTS;
-    a->x = x;
-    a->y = y;
-    a->w = w;
-    a->h = h;
-    vnc_server_update_add(vs, a);
+static void
+fill_updates(CC_REGISTER_ARG struct vnc_server_state *vs)
+{
+  while(vs->updates_num < VNC_SERVER_MAX_UPDATES &&
+	take_update(vs, UPDATE(vs, vs->updates_num))) {
+    ++vs->updates_num;
   }
 }
 /*-----------------------------------------------------------------------------------*/
 static void
 init_send_screen(CC_REGISTER_ARG struct vnc_server_state *vs)
 {
-  vs->sendmsg = SEND_SCREEN;
-  vs->x = vs->y = 0;
-  vs->x1 = vs->y1 = 0;
-  vs->x2 = vs->y2 = 0;
-  vs->w = CHARS_WIDTH;
-  vs->h = CHARS_HEIGHT;
+  vs->sendmsg = SEND_NONE;
+  vs->update_requested = 1;
+  vnc_out_update_area(vs, 0, 0, CHARS_WIDTH, CHARS_HEIGHT);
 }
 /*-----------------------------------------------------------------------------------*/
 static void
 check_updates(CC_REGISTER_ARG struct vnc_server_state *vs)
 {
-  
+
   if(vs->state == VNC_RUNNING &&
      vs->sendmsg == SEND_NONE &&
-     vs->updates_current == NULL) {
-    if(vs->updates_pending != NULL &&
-       vs->update_requested != 0) {
+     vs->update_requested != 0) {
+    /* The queue is only refilled when no segment is in flight, so
+       that a retransmission produces the same data again. */
+    fill_updates(vs);
+    if(vs->updates_num > 0) {
       vs->update_requested = 0;
-      /*      vs->updates_current = vs->updates_pending;
-      vs->updates_pending = vs->updates_pending->next;
-      vs->updates_current->next = NULL;*/
-
-      vs->updates_current = vnc_server_update_dequeue(vs);
-      
-      if(vs->updates_current->type == VNC_SERVER_UPDATE_PARTS) {
-	vs->x = vs->x1 = vs->x2 = vs->updates_current->x;
-	vs->y = vs->y1 = vs->y2 = vs->updates_current->y;
-	vs->w = vs->updates_current->w;
-	vs->h = vs->updates_current->h;
-	vs->sendmsg = SEND_UPDATE;
-	
-	PRINTF(("New update from (%d:%d) (%d:%d) to (%d:%d)\n",
-	       vs->x, vs->y, vs->x1, vs->y1, vs->x + vs->w,
-	       vs->y + vs->h));
-      } else if(vs->updates_current->type == VNC_SERVER_UPDATE_FULL) {
-	init_send_screen(vs);
-	PRINTF(("New full update\n"));
-      }
+      vs->x1 = vs->y1 = 0;
+      vs->sendmsg = SEND_UPDATE;
+      PRINTF(("New update, %d rectangles\n", vs->updates_num));
     }
   }
 }
 /*-----------------------------------------------------------------------------------*/
-static uint8_t tmp[CTK_VNCFONT_WIDTH * CTK_VNCFONT_HEIGHT];
+static uint8_t tmp[CTK_VNCFONT_WIDTH];
 static void
-makechar(CC_REGISTER_ARG char *ptr, uint8_t x, uint8_t y)
+makecharrow(CC_REGISTER_ARG uint8_t *ptr, uint8_t x, uint8_t y, uint8_t i)
 {
-  uint8_t i, *tmpptr;
+  uint8_t j, *tmpptr;
   register uint8_t *colorscheme;
   unsigned char *bitmap;
   uint8_t b, b2;
@@ -434,7 +436,7 @@ makechar(CC_REGISTER_ARG char *ptr, uint8_t x, uint8_t y)
   c = screen[x + y * CHARS_WIDTH];
 
   colorscheme = (uint8_t *)colortheme[color];
-      
+
   /* First check if the character is a special icon character. These
      are to be interpreted in a special manner: the first character of
      the icon (the top left corner) has the highest bit set, but not
@@ -446,7 +448,7 @@ makechar(CC_REGISTER_ARG char *ptr, uint8_t x, uint8_t y)
   if((c & 0x80) != 0) {
     xmove = c & 0x0f;
     ymove = (c & 0x30) >> 4;
-    
+
     c = colorscreen[x + y * CHARS_WIDTH];
 
     if(icons[c % MAX_ICONS] == NULL) {
@@ -459,85 +461,81 @@ makechar(CC_REGISTER_ARG char *ptr, uint8_t x, uint8_t y)
       colorscheme = (uint8_t *)colortheme[VNC_OUT_ICONCOLOR + (c >> 6)];
       switch(xmove) {
       case 0:
-	for(i = 0; i < CTK_VNCFONT_HEIGHT; ++i) {
-	  b = bitmap[i];
-	  *ptr++ = colorscheme[((b >> 7) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b >> 6) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b >> 5) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b >> 4) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b >> 3) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b >> 2) & 0x01) << 2];		
-	}
+	b = bitmap[i];
+	*ptr++ = colorscheme[((b >> 7) & 0x01) << 2];
+	*ptr++ = colorscheme[((b >> 6) & 0x01) << 2];
+	*ptr++ = colorscheme[((b >> 5) & 0x01) << 2];
+	*ptr++ = colorscheme[((b >> 4) & 0x01) << 2];
+	*ptr++ = colorscheme[((b >> 3) & 0x01) << 2];
+	*ptr++ = colorscheme[((b >> 2) & 0x01) << 2];
 	break;
       case 1:
-	for(i = 0; i < CTK_VNCFONT_HEIGHT; ++i) {
-	  b = bitmap[i];
-	  b2 = bitmap[i + 8];
-	  *ptr++ = colorscheme[((b >> 1) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b >> 0) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b2 >> 7) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b2 >> 6) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b2 >> 5) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b2 >> 4) & 0x01) << 2];		
-	}
+	b = bitmap[i];
+	b2 = bitmap[i + 8];
+	*ptr++ = colorscheme[((b >> 1) & 0x01) << 2];
+	*ptr++ = colorscheme[((b >> 0) & 0x01) << 2];
+	*ptr++ = colorscheme[((b2 >> 7) & 0x01) << 2];
+	*ptr++ = colorscheme[((b2 >> 6) & 0x01) << 2];
+	*ptr++ = colorscheme[((b2 >> 5) & 0x01) << 2];
+	*ptr++ = colorscheme[((b2 >> 4) & 0x01) << 2];
 	break;
       case 2:
-	for(i = 0; i < CTK_VNCFONT_HEIGHT; ++i) {
-	  b = bitmap[i + 8];
-	  b2 = bitmap[i + 16];
-	  *ptr++ = colorscheme[((b >> 3) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b >> 2) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b >> 1) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b >> 0) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b2 >> 7) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b2 >> 6) & 0x01) << 2];		
-	}
+	b = bitmap[i + 8];
+	b2 = bitmap[i + 16];
+	*ptr++ = colorscheme[((b >> 3) & 0x01) << 2];
+	*ptr++ = colorscheme[((b >> 2) & 0x01) << 2];
+	*ptr++ = colorscheme[((b >> 1) & 0x01) << 2];
+	*ptr++ = colorscheme[((b >> 0) & 0x01) << 2];
+	*ptr++ = colorscheme[((b2 >> 7) & 0x01) << 2];
+	*ptr++ = colorscheme[((b2 >> 6) & 0x01) << 2];
 	break;
       case 3:
-	for(i = 0; i < CTK_VNCFONT_HEIGHT; ++i) {
-	  b = bitmap[i + 16];
-	  *ptr++ = colorscheme[((b >> 5) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b >> 4) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b >> 3) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b >> 2) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b >> 1) & 0x01) << 2];
-	  *ptr++ = colorscheme[((b >> 0) & 0x01) << 2];		
-	}
+	b = bitmap[i + 16];
+	*ptr++ = colorscheme[((b >> 5) & 0x01) << 2];
+	*ptr++ = colorscheme[((b >> 4) & 0x01) << 2];
+	*ptr++ = colorscheme[((b >> 3) & 0x01) << 2];
+	*ptr++ = colorscheme[((b >> 2) & 0x01) << 2];
+	*ptr++ = colorscheme[((b >> 1) & 0x01) << 2];
+	*ptr++ = colorscheme[((b >> 0) & 0x01) << 2];
 	break;
       }
     }
   } else {
-    memcpy_P(tmp, &ctk_vncfont[c * (CTK_VNCFONT_WIDTH * CTK_VNCFONT_HEIGHT)],
-	     CTK_VNCFONT_WIDTH * CTK_VNCFONT_HEIGHT);
-    
+    memcpy_P(tmp, &ctk_vncfont[c * (CTK_VNCFONT_WIDTH * CTK_VNCFONT_HEIGHT) +
+			       i * CTK_VNCFONT_WIDTH],
+	     CTK_VNCFONT_WIDTH);
+
     tmpptr = tmp;
 
-    
-    for(i = 0; i < CTK_VNCFONT_HEIGHT * CTK_VNCFONT_WIDTH; ++i) {
+    for(j = 0; j < CTK_VNCFONT_WIDTH; ++j) {
       *ptr++ = colorscheme[*tmpptr++];
     }
   }
 }
 /*-----------------------------------------------------------------------------------*/
+static void
+makechar(CC_REGISTER_ARG uint8_t *ptr, uint8_t x, uint8_t y)
+{
+  uint8_t i;
+
+  for(i = 0; i < CTK_VNCFONT_HEIGHT; ++i) {
+    makecharrow(ptr, x, y, i);
+    ptr += CTK_VNCFONT_WIDTH;
+  }
+}
+/*-----------------------------------------------------------------------------------*/
 void
 vnc_out_new(CC_REGISTER_ARG struct vnc_server_state *vs)
 {
-  uint8_t i;
-  
   vs->width = SCREEN_WIDTH;
   vs->height = SCREEN_HEIGHT;
-  vs->x = vs->y = vs->x1 = vs->y1 = vs->x2 = vs->y2 = 0;
+  vs->x1 = vs->y1 = vs->x2 = vs->y2 = 0;
+  vs->done = 0;
   vs->w = CHARS_WIDTH;
   vs->h = CHARS_HEIGHT;
 
-  /* Initialize the linked list of updates. */
-  for(i = 0; i < VNC_SERVER_MAX_UPDATES - 1; ++i) {
-    vs->updates_pool[i].next = &vs->updates_pool[i + 1];    
-  }
-  vs->updates_pool[VNC_SERVER_MAX_UPDATES].next = NULL;
-
-  vs->updates_free = &vs->updates_pool[0];
-  vs->updates_pending = vs->updates_current = NULL;
+  vs->updates_first = vs->updates_num = 0;
+  memset(vs->dirty, 0, sizeof(vs->dirty));
 }
 /*-----------------------------------------------------------------------------------*/
 void
@@ -547,24 +545,21 @@ vnc_out_send_blank(CC_REGISTER_ARG struct vnc_server_state *vs)
   uint8_t *ptr;
   uint16_t len;
   uint8_t msglen;
-      
-  vs->x = vs->y = 0;
-  vs->x2 = vs->y2 = 0;
-	  
+
   umsg = (struct rfb_fb_update *)uip_appdata;
-  
+
   umsg->type = RFB_FB_UPDATE;
   umsg->rects = UIP_HTONS(2);
 
   ptr = (uint8_t *)umsg + sizeof(struct rfb_fb_update);
   len = sizeof(struct rfb_fb_update);
-  
+
   msglen = vnc_server_draw_rect(ptr, 0, 0,
 				UIP_HTONS(SCREEN_WIDTH),
 				UIP_HTONS(SCREEN_HEIGHT),
 				BORDER_COLOR);
 
-  
+
   ptr += msglen;
   len += msglen;
 
@@ -585,188 +580,423 @@ vnc_out_send_screen(struct vnc_server_state *vs)
   vnc_out_send_update(vs);
 }
 /*-----------------------------------------------------------------------------------*/
+/* The segment that is being put together. */
+static uint8_t *outptr, *outend;
+static uint16_t outrects;
+
 static short tmpbuf[30];
-void
-vnc_out_send_update(CC_REGISTER_ARG struct vnc_server_state *vs)
+
+static void
+put_rect_hdr(uint8_t *ptr, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+	     uint8_t encoding)
 {
-  uint8_t x, y, x0;
-  uint8_t msglen;
-  uint16_t len, n;
-  uint8_t *ptr;
-  struct rfb_fb_update *umsg;
   register struct rfb_fb_update_rect_hdr *recthdr;
+
+  /* The header is built in an aligned buffer, since ptr may point
+     anywhere in the segment. */
+  recthdr = (struct rfb_fb_update_rect_hdr *)tmpbuf;
+  recthdr->rect.x = uip_htons(x);
+  recthdr->rect.y = uip_htons(y);
+  recthdr->rect.w = uip_htons(w);
+  recthdr->rect.h = uip_htons(h);
+  recthdr->encoding[0] =
+    recthdr->encoding[1] =
+    recthdr->encoding[2] = 0;
+  recthdr->encoding[3] = encoding;
+  memcpy(ptr, tmpbuf, sizeof(struct rfb_fb_update_rect_hdr));
+}
+/*-----------------------------------------------------------------------------------*/
+/* Send an update character by character, for clients that do not
+   support hextile. Runs of blanks are sent as single color RRE
+   rectangles, other characters as raw bitmaps. Returns zero if the
+   segment is full, with vs->x2, vs->y2 set to where the next segment
+   should continue. */
+static uint8_t
+send_chars(CC_REGISTER_ARG struct vnc_server_state *vs,
+	   struct vnc_server_update *a)
+{
+  uint8_t x, y, x0, xend;
+  uint8_t msglen;
   struct rfb_rre_hdr *rrehdr;
-  uint8_t c, color, lastcolor;
+  uint8_t color;
   uint8_t numblanks;
 
-  /* First, check if we need to feed the update function with a new
-     pending update. */
-  check_updates(vs);
+  xend = a->x + a->w;
+  x0 = a->x + vs->x2;
 
-  /*  PRINTF(("Sending Update from (%d:%d) (%d:%d) to (%d:%d)\n",
-	 vs->x, vs->y, vs->x1, vs->y1, vs->x + vs->w,
-	 vs->y + vs->h));*/
-  
-  umsg = (struct rfb_fb_update *)uip_appdata;
-
-  umsg->type = RFB_FB_UPDATE;
-
-  x0 = vs->x1;
-  n = 0;
-  msglen = 0;
-  ptr = (uint8_t *)umsg + sizeof(struct rfb_fb_update);
-  len = sizeof(struct rfb_fb_update);
-  
   /* Loop over all characters that are covered by this update. */
-  for(y = vs->y1; y < vs->y + vs->h; ++y) {
-    for(x = x0; x < vs->x + vs->w; ++x) {
-
+  for(y = a->y + vs->y2; y < a->y + a->h; ++y) {
+    for(x = x0; x < xend; ++x) {
 
       /* First check if there are any blank space characters, and if
 	 so, find out how many of them there are in a row. Instead of
 	 sending the individual space characters as raw bitmaps, we
 	 can send the entire string of blanks as a single color
-	 rectangle instead. */
-      
-      c = screen[x + y * CHARS_WIDTH];
+	 rectangle instead. We must keep within the update rectangle,
+	 so we make sure that the "x" variable does not increase
+	 beyond the edge. */
+      color = colorscreen[x + y * CHARS_WIDTH];
       numblanks = 0;
-      lastcolor = color = colorscreen[x + y * CHARS_WIDTH];
-
-      /* If the character is a blank, we continue reading characters
-	 until we find one that has a different color, or one that is
-	 not a blank. We must keep within the update rectangle, so we
-	 make sure that the "x" variable does not increase beyond the
-	 edge. The "numblanks" variable is used to keep track of how
-	 many blank characters we have found. */
-      while(lastcolor == color &&
-	    c == 0x20 &&
-	    x < vs->x + vs->w) {
+      while(x < xend &&
+	    screen[x + y * CHARS_WIDTH] == 0x20 &&
+	    colorscreen[x + y * CHARS_WIDTH] == color) {
 	++numblanks;
-
-	
 	++x;
-	lastcolor = color;
-	color = colorscreen[x + y * CHARS_WIDTH];
-	c = screen[x + y * CHARS_WIDTH];
       }
 
       if(numblanks > 0) {
-	
-	/*	PRINTF(("Found %d blanks (%d:%d -> %d:%d)\n",
-		numblanks, x - numblanks, y, x, y));*/
-	
+
 	/* There were one or more blank characters, so we send out a
 	   single color rectangle with the right width. But first we
 	   make sure that there is enough space in the current TCP
 	   segment to put the rectangle. If there isn't we have to
 	   backtrack the "x" variable to where we found the first
 	   blank character so that the next TCP segment will be able
-	   to update this area instead. */	
+	   to update this area instead. */
 
 	msglen = sizeof(struct rfb_fb_update_rect_hdr) +
 	  /*sizeof(struct rfb_rre_hdr)*/5;
 
-	if(msglen >= uip_mss() - len) {
-	  /*	  PRINTF(("Not enouch space for blanks (%d, left %d)\n",
-		  msglen, uip_mss() - len));*/
+	if(msglen >= outend - outptr) {
 	  /* There is not enough space in the segment, so we remember
-	     where we were ... */
-	  vs->x2 = x - numblanks;
-	  vs->y2 = y;
-
-	  /* ... and we break out of the loop. */
-	  goto loopend;	  
+	     where we were and break out of the loop. */
+	  vs->x2 = x - numblanks - a->x;
+	  vs->y2 = y - a->y;
+	  return 0;
 	}
 
 	/* We construct a rectangle with the right width and color. */
-	/*	recthdr = (struct rfb_fb_update_rect_hdr *)ptr;*/
-	recthdr = (struct rfb_fb_update_rect_hdr *)tmpbuf;
-	rrehdr = (struct rfb_rre_hdr *)((char *)recthdr +
-		 sizeof(struct rfb_fb_update_rect_hdr));
-
-	/*	PRINTF(("Blankign (%d:%d) to (%d:%d)\n",
-	       (x - numblanks) * CTK_VNCFONT_WIDTH,
-	       y * CTK_VNCFONT_HEIGHT,
-	       CTK_VNCFONT_WIDTH * numblanks,
-	       CTK_VNCFONT_HEIGHT));*/
-	recthdr->rect.x = uip_htons(SCREEN_X + (x - numblanks) *
-				CTK_VNCFONT_WIDTH);
-	recthdr->rect.y = uip_htons(SCREEN_Y + y * CTK_VNCFONT_HEIGHT);
-	recthdr->rect.w = uip_htons(CTK_VNCFONT_WIDTH * numblanks);
-	recthdr->rect.h = UIP_HTONS(CTK_VNCFONT_HEIGHT);
-	recthdr->encoding[0] =
-	  recthdr->encoding[1] =
-	  recthdr->encoding[2] = 0;
-	recthdr->encoding[3] = RFB_ENC_RRE;
-	
+	put_rect_hdr(outptr,
+		     SCREEN_X + (x - numblanks) * CTK_VNCFONT_WIDTH,
+		     SCREEN_Y + y * CTK_VNCFONT_HEIGHT,
+		     CTK_VNCFONT_WIDTH * numblanks, CTK_VNCFONT_HEIGHT,
+		     RFB_ENC_RRE);
+	rrehdr = (struct rfb_rre_hdr *)tmpbuf;
 	rrehdr->subrects[0] =
 	  rrehdr->subrects[1] = 0;
-	rrehdr->bgpixel = colortheme[lastcolor][0];
+	rrehdr->bgpixel = colortheme[color][0];
+	memcpy(outptr + sizeof(struct rfb_fb_update_rect_hdr), tmpbuf, 5);
 
 	--x;
       } else {
 
-	/* So there were no blank characters. */
-
-	/*	PRINTF(("An char at (%d:%d)\n", x, y));*/
-	/* First we must make sure that there is enough space in the
-	   outgoing TCP segment. */
-
+	/* So there were no blank characters. First we must make sure
+	   that there is enough space in the outgoing TCP segment. */
 	msglen = sizeof(struct rfb_fb_update_rect_hdr) +
 	  CTK_VNCFONT_HEIGHT * CTK_VNCFONT_WIDTH;
-	if(msglen >= uip_mss() - len) {
-	  /*	  PRINTF(("Not enouch space for char (%d, left %d)\n",
-		  msglen, uip_mss() - len));*/
-	  
-	  /* There is not enough space in the segment, so we remember
-	     where we were ... */
-	  vs->x2 = x;
-	  vs->y2 = y;
-
-	  /* ... and we break out of the loop. */
-	  goto loopend;	  
+	if(msglen >= outend - outptr) {
+	  vs->x2 = x - a->x;
+	  vs->y2 = y - a->y;
+	  return 0;
 	}
 
-	/*	PRINTF(("ptr %p\n",ptr);*/
-	/*	recthdr = (struct rfb_fb_update_rect_hdr *)ptr;*/
-	recthdr = (struct rfb_fb_update_rect_hdr *)tmpbuf;
-
-	recthdr->rect.x = uip_htons(SCREEN_X + x * CTK_VNCFONT_WIDTH);
-	recthdr->rect.y = uip_htons(SCREEN_Y + y * CTK_VNCFONT_HEIGHT);
-	recthdr->rect.w = UIP_HTONS(CTK_VNCFONT_WIDTH);
-	recthdr->rect.h = UIP_HTONS(CTK_VNCFONT_HEIGHT);
-	recthdr->encoding[0] =
-	  recthdr->encoding[1] =
-	  recthdr->encoding[2] = 0;
-	recthdr->encoding[3] = RFB_ENC_RAW;
-
-	makechar((uint8_t *)recthdr +
-		 sizeof(struct rfb_fb_update_rect_hdr),
-		 x, y);
+	put_rect_hdr(outptr,
+		     SCREEN_X + x * CTK_VNCFONT_WIDTH,
+		     SCREEN_Y + y * CTK_VNCFONT_HEIGHT,
+		     CTK_VNCFONT_WIDTH, CTK_VNCFONT_HEIGHT,
+		     RFB_ENC_RAW);
+	makechar(outptr + sizeof(struct rfb_fb_update_rect_hdr), x, y);
       }
-      memcpy(ptr, tmpbuf, msglen);
       PRINTF(("Msglen %d (%d:%d)\n", msglen, x, y));
-      len += msglen;
-      ptr += msglen;
-      ++n;
+      outptr += msglen;
+      ++outrects;
     }
-    x0 = vs->x;
+    x0 = a->x;
   }
-  
- loopend:
+  return 1;
+}
+/*-----------------------------------------------------------------------------------*/
+/* Hextile splits a rectangle into tiles of 16x16 pixels, that are
+   sent one after the other. A tile with a single color takes one or
+   two bytes, and a tile with characters is sent as a background
+   color with subrectangles of the foreground colors on top. The
+   background and foreground colors are kept from one tile to the
+   next within a rectangle. */
+#define TILE_SIZE 16
+#define TILE_MAX_COLORS 8
+
+#define TILE_BG_VALID 1
+#define TILE_FG_VALID 2
+
+static uint8_t tile[TILE_SIZE * TILE_SIZE];
+static uint16_t covered[TILE_SIZE];
+static uint8_t tile_bg, tile_fg, tile_valid;
 
-  umsg->rects = uip_htons(n);
-	
-  if(y == vs->y + vs->h && x == vs->x + vs->w) {
-    vs->x2 = vs->y2 = 0;
+static void
+make_tile(struct vnc_server_update *a, uint16_t px, uint16_t py,
+	  uint8_t tw, uint8_t th)
+{
+  uint8_t r, n, x, y, row;
+  uint16_t i;
+  uint8_t *ptr;
+  uint8_t line[CTK_VNCFONT_WIDTH];
+
+  ptr = tile;
+  for(r = 0; r < th; ++r) {
+    y = a->y + (py + r) / CTK_VNCFONT_HEIGHT;
+    row = (py + r) % CTK_VNCFONT_HEIGHT;
+    /* Tiles are not aligned with the characters, so the first and
+       the last character of the row may only partly be in the
+       tile. */
+    for(i = px; i < px + tw; i += n) {
+      x = a->x + i / CTK_VNCFONT_WIDTH;
+      makecharrow(line, x, y, row);
+      n = CTK_VNCFONT_WIDTH - i % CTK_VNCFONT_WIDTH;
+      if(n > px + tw - i) {
+	n = px + tw - i;
+      }
+      memcpy(ptr, &line[i % CTK_VNCFONT_WIDTH], n);
+      ptr += n;
+    }
   }
+}
+/*-----------------------------------------------------------------------------------*/
+static uint8_t
+encode_tile(uint8_t tw, uint8_t th)
+{
+  uint8_t colors[TILE_MAX_COLORS];
+  uint16_t counts[TILE_MAX_COLORS];
+  uint8_t ncolors, b, c, x, y, w, h, subenc;
+  uint16_t i, npixels, mask;
+  uint8_t *ptr, *limit, *nsubrects;
+
+  npixels = (uint16_t)tw * th;
+
+  /* Find the colors of the tile. The most common one becomes the
+     background color. */
+  ncolors = 0;
+  b = 0;
+  for(i = 0; i < npixels; ++i) {
+    for(c = 0; c < ncolors && colors[c] != tile[i]; ++c);
+    if(c == ncolors) {
+      if(ncolors == TILE_MAX_COLORS) {
+	goto raw;
+      }
+      colors[ncolors] = tile[i];
+      counts[ncolors] = 0;
+      ++ncolors;
+    }
+    if(++counts[c] > counts[b]) {
+      b = c;
+    }
+  }
+
+  /* The tile is sent raw if that is not larger. */
+  limit = outptr + 1 + npixels;
+  if(limit > outend) {
+    limit = outend;
+  }
+
+  ptr = outptr + 1;
+  subenc = 0;
+  if(!(tile_valid & TILE_BG_VALID) || tile_bg != colors[b]) {
+    subenc |= RFB_HEXTILE_BG_SPECIFIED;
+    tile_bg = colors[b];
+    *ptr++ = tile_bg;
+  }
+
+  if(ncolors == 1) {
+    if(ptr > limit) {
+      return 0;
+    }
+    *outptr = subenc;
+    outptr = ptr;
+    tile_valid |= TILE_BG_VALID;
+    return 1;
+  }
+
+  subenc |= RFB_HEXTILE_ANY_SUBRECTS;
+  if(ncolors == 2) {
+    /* A character with a single foreground color: the subrectangles
+       only need their position and size. */
+    c = colors[1 - b];
+    if(!(tile_valid & TILE_FG_VALID) || tile_fg != c) {
+      subenc |= RFB_HEXTILE_FG_SPECIFIED;
+      tile_fg = c;
+      *ptr++ = tile_fg;
+    }
+  } else {
+    subenc |= RFB_HEXTILE_SUBRECTS_COLORED;
+  }
+  nsubrects = ptr++;
+  *nsubrects = 0;
+
+  memset(covered, 0, sizeof(covered));
+  for(y = 0; y < th; ++y) {
+    for(x = 0; x < tw; ++x) {
+      c = tile[y * tw + x];
+      if(c == tile_bg || (covered[y] & (1U << x)) != 0) {
+	continue;
+      }
+      /* Grow the subrectangle to the right and then downwards, as
+	 long as it covers pixels of the same color. */
+      for(w = 1; x + w < tw && tile[y * tw + x + w] == c &&
+	    (covered[y] & (1U << (x + w))) == 0; ++w);
+      for(h = 1; y + h < th; ++h) {
+	for(i = 0; i < w && tile[(y + h) * tw + x + i] == c &&
+	      (covered[y + h] & (1U << (x + i))) == 0; ++i);
+	if(i < w) {
+	  break;
+	}
+      }
+      mask = (0xffffU >> (TILE_SIZE - w)) << x;
+      for(i = y; i < y + h; ++i) {
+	covered[i] |= mask;
+      }
 
-  if(n > 0) {
-    /*    printf("Sending %d rects, %d bytes (%p, %p, %p)\n", n, len,
-	  uip_appdata, umsg, ptr);*/
-    uip_send(uip_appdata, len);
+      if(ptr + 3 > limit || *nsubrects == 255) {
+	goto raw;
+      }
+      if(subenc & RFB_HEXTILE_SUBRECTS_COLORED) {
+	*ptr++ = c;
+      }
+      *ptr++ = (x << 4) | y;
+      *ptr++ = ((w - 1) << 4) | (h - 1);
+      ++*nsubrects;
+    }
   }
 
+  if(ptr > limit) {
+    goto raw;
+  }
+  *outptr = subenc;
+  outptr = ptr;
+  tile_valid |= TILE_BG_VALID;
+  if(subenc & RFB_HEXTILE_SUBRECTS_COLORED) {
+    tile_valid &= ~TILE_FG_VALID;
+  } else {
+    tile_valid |= TILE_FG_VALID;
+  }
+  return 1;
+
+ raw:
+  if(outptr + 1 + npixels > outend) {
+    return 0;
+  }
+  *outptr++ = RFB_HEXTILE_RAW;
+  memcpy(outptr, tile, npixels);
+  outptr += npixels;
+  /* Neither color carries over a raw tile. */
+  tile_valid = 0;
+  return 1;
+}
+/*-----------------------------------------------------------------------------------*/
+/* Send an update with the hextile encoding. Each row of tiles that
+   goes into the segment is sent as a rectangle of its own, so that
+   vs->x2 and vs->y2 count tiles instead of characters. */
+static uint8_t
+send_hextile(CC_REGISTER_ARG struct vnc_server_state *vs,
+	     struct vnc_server_update *a)
+{
+  uint16_t width, height, px, py;
+  uint8_t tx, ty, tw, th, tiles_x, tiles_y;
+  uint8_t *hdr;
+
+  width = a->w * CTK_VNCFONT_WIDTH;
+  height = a->h * CTK_VNCFONT_HEIGHT;
+  tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+  tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+  for(ty = vs->y2; ty < tiles_y; ++ty) {
+    if(sizeof(struct rfb_fb_update_rect_hdr) + 2 > outend - outptr) {
+      vs->y2 = ty;
+      return 0;
+    }
+    hdr = outptr;
+    outptr += sizeof(struct rfb_fb_update_rect_hdr);
+    tile_valid = 0;
+
+    py = ty * TILE_SIZE;
+    th = height - py > TILE_SIZE? TILE_SIZE: height - py;
+    for(tx = vs->x2; tx < tiles_x; ++tx) {
+      px = tx * TILE_SIZE;
+      tw = width - px > TILE_SIZE? TILE_SIZE: width - px;
+      make_tile(a, px, py, tw, th);
+      if(!encode_tile(tw, th)) {
+	break;
+      }
+    }
+
+    if(tx == vs->x2) {
+      /* Not even a single tile did fit. */
+      outptr = hdr;
+      vs->y2 = ty;
+      return 0;
+    }
+
+    px = tx * TILE_SIZE > width? width: tx * TILE_SIZE;
+    put_rect_hdr(hdr,
+		 SCREEN_X + a->x * CTK_VNCFONT_WIDTH + vs->x2 * TILE_SIZE,
+		 SCREEN_Y + a->y * CTK_VNCFONT_HEIGHT + py,
+		 px - vs->x2 * TILE_SIZE, th,
+		 RFB_ENC_HEXTILE);
+    ++outrects;
+
+    if(tx < tiles_x) {
+      vs->x2 = tx;
+      vs->y2 = ty;
+      return 0;
+    }
+    vs->x2 = 0;
+  }
+  return 1;
+}
+/*-----------------------------------------------------------------------------------*/
+void
+vnc_out_send_update(CC_REGISTER_ARG struct vnc_server_state *vs)
+{
+  struct rfb_fb_update *umsg;
+  uint8_t x, y, done, hextile;
+
+  /* First, check if we need to feed the update function with a new
+     pending update. */
+  check_updates(vs);
+
+  if(vs->sendmsg != SEND_UPDATE) {
+    return;
+  }
+
+  umsg = (struct rfb_fb_update *)uip_appdata;
+
+  umsg->type = RFB_FB_UPDATE;
+
+  outptr = (uint8_t *)umsg + sizeof(struct rfb_fb_update);
+  outend = (uint8_t *)uip_appdata + uip_mss();
+  outrects = 0;
+
+  /* Put as many of the queued updates into the segment as will
+     fit. The first one continues where the previous segment
+     ended. */
+  x = vs->x1;
+  y = vs->y1;
+
+  /* Hextile can only make progress if a raw tile fits into an empty
+     segment. With a smaller MSS the update is sent character by
+     character instead. */
+  hextile = (vs->encodings & VNC_SERVER_ENC_HEXTILE) &&
+    uip_mss() >= sizeof(struct rfb_fb_update) +
+    sizeof(struct rfb_fb_update_rect_hdr) + 1 + TILE_SIZE * TILE_SIZE;
+
+  for(done = 0; done < vs->updates_num; ++done) {
+    vs->x2 = x;
+    vs->y2 = y;
+    if(hextile?
+       !send_hextile(vs, UPDATE(vs, done)):
+       !send_chars(vs, UPDATE(vs, done))) {
+      break;
+    }
+    x = y = 0;
+  }
+  vs->done = done;
+  if(done == vs->updates_num) {
+    vs->x2 = vs->y2 = 0;
+  }
+
+  umsg->rects = uip_htons(outrects);
+
+  if(outrects > 0) {
+    uip_send(uip_appdata, outptr - (uint8_t *)uip_appdata);
+  }
 }
 /*-----------------------------------------------------------------------------------*/
 #define NUMKEYS 20
@@ -804,11 +1034,6 @@ vnc_out_key_event(struct vnc_server_state *vs)
   ev = (struct rfb_key_event *)uip_appdata;
 
   if(ev->down != 0) {
-    if(vs->sendmsg == SEND_NONE) {
-      vs->sendmsg = SEND_UPDATE;
-    }
-
-
     if(ev->key[2] == 0 ||
        (ev->key[2] == 0xff &&	
 	(ev->key[3] == CH_HOME ||
@@ -863,64 +1088,26 @@ vnc_out_acked(CC_REGISTER_ARG struct vnc_server_state *vs)
   }
   if(vs->sendmsg == SENT_BLANK) {
     init_send_screen(vs);
+    check_updates(vs);
   } else if(vs->sendmsg == SEND_BLANK) {
     /* Do nothing until sendmsg == SENT_BLANK. */
-  } else if(vs->sendmsg == SEND_SCREEN) {
-    /* When the screen has been fully drawn, ->x2 and ->y2 are both
-       set to 0 to indicate this.*/
-    if(vs->x2 == 0 && vs->y2 == 0) {
-      vs->sendmsg = SEND_NONE;
-      
-      /* If there was an updaterequest for the entire screen, we can
-	 clear that flag now. */
-      if(vs->updates_current != NULL) {	
-	vnc_server_update_free(vs, vs->updates_current);
-	vs->updates_current = NULL;
-      }
-      check_updates(vs);
-    } else {
-      vs->x1 = vs->x2;
-      vs->y1 = vs->y2;
-    }
-	      
   } else if(vs->sendmsg == SEND_UPDATE) {
-    if(vs->x2 == 0 && vs->y2 == 0) {
-      /* So, we have updated the area that we needed. We now check if
-	 there have been any recent full screen update requests. If
-	 so, we need to go to the SEND_SCREEN state. Else, we see if
-	 there were more areas that needed to be updated and if so,
-	 we'll continue with those. */
-
+    /* Drop the updates that the segment completed and continue where
+       it ended. */
+    vs->updates_first = (vs->updates_first + vs->done) %
+      VNC_SERVER_MAX_UPDATES;
+    vs->updates_num -= vs->done;
+    vs->done = 0;
+    vs->x1 = vs->x2;
+    vs->y1 = vs->y2;
+
+    /* Cells that have become dirty in the meantime are sent right
+       away, without waiting for the client to ask for them, so that
+       every acknowledgement is followed by a full segment. */
+    fill_updates(vs);
+    if(vs->updates_num == 0) {
       vs->sendmsg = SEND_NONE;
-
-      if(vs->updates_current != NULL) {
-	vnc_server_update_free(vs, vs->updates_current);
-	vs->updates_current = NULL;
-
-      }
-      check_updates(vs);
-#if 0
-      if(vs->updaterequest == VNC_SERVER_UPDATE_FULL) {
-	check_updates(vs);
-      } else {
-	vs->updatesptr2 = (vs->updatesptr2 + 1) %
-	  VNC_SERVER_MAX_UPDATES;
-
-	/* If there are no more updates to do, we'll go back to the
-	   SEND_NONE state. */	
-	if(vs->updatesptr2 == vs->updatesptr) {
-	  vs->updatetype = VNC_SERVER_UPDATE_NONE;
-	} else {	 
-	  /* Otherwise, we continue to update the next area. */
-	  vs->updaterequest = VNC_SERVER_UPDATE_PARTS;
-	  check_updates(vs);
-	}
-      }
-#endif /* 0 */
-    } else {	     
-      vs->x1 = vs->x2;
-      vs->y1 = vs->y2;
-    }    
+    }
   } else {
     vs->sendmsg = SEND_NONE;
   }
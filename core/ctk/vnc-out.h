@@ -56,6 +56,8 @@ char vnc_out_keyavail(void);
 
 void vnc_out_update_area(struct vnc_server_state *vs,
 			 uint8_t x, uint8_t y, uint8_t w, uint8_t h);
+void vnc_out_update_changed(struct vnc_server_state *vs);
+void vnc_out_clear_changed(void);
 
 #include "ctk/ctk.h"
 
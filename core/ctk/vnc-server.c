@@ -247,7 +247,7 @@ static uint8_t
 vnc_read_data(CC_REGISTER_ARG struct vnc_server_state *vs)
 {
   uint8_t *appdata;
-  uint16_t len;
+  uint16_t len, i;
   struct rfb_fb_update_request *req;
   /*  uint8_t niter;*/
   
@@ -315,8 +315,16 @@ vnc_read_data(CC_REGISTER_ARG struct vnc_server_state *vs)
 	PRINTF(("Set encodings\n"));
 	vs->readlen = sizeof(struct rfb_set_encoding);
 	vs->readlen += uip_htons(((struct rfb_set_encoding *)appdata)->encodings) * 4;
-	/* Make sure that client supports the encodings we use. */
-	/* XXX: not implemented yet. */
+	/* Raw and RRE are always used. Look for hextile among the
+	   encodings that are in this segment. */
+	vs->encodings = 0;
+	for(i = sizeof(struct rfb_set_encoding);
+	    i + 4 <= vs->readlen && i + 4 <= len; i += 4) {
+	  if(appdata[i] == 0 && appdata[i + 1] == 0 &&
+	     appdata[i + 2] == 0 && appdata[i + 3] == RFB_ENC_HEXTILE) {
+	    vs->encodings |= VNC_SERVER_ENC_HEXTILE;
+	  }
+	}
 	break;
 	
       case RFB_FB_UPDATE_REQ:
@@ -397,6 +405,7 @@ vnc_new(CC_REGISTER_ARG struct vnc_server_state *vs)
   vs->readlen = 0;
   vs->sendmsg = SEND_NONE;
   vs->update_requested = 1;
+  vs->encodings = 0;
   switch(vs->type) {
   case 0:	
     vnc_out_new(vs);
@@ -35,25 +35,21 @@
 #define __VNC_SERVER_H__
 
 
-/*struct vnc_server_updatearea {
-  uint8_t active;
-  uint8_t x, y;
-  uint8_t w, h;
-  };*/
+#include "lib/libconio.h"
 
+/* A rectangle of character cells that is being sent to the client. */
 struct vnc_server_update {
-  struct vnc_server_update *next;
-
-#define VNC_SERVER_UPDATE_NONE  0
-#define VNC_SERVER_UPDATE_PARTS 1
-#define VNC_SERVER_UPDATE_FULL  2
-
-  uint8_t type;
-
   uint8_t x, y;
   uint8_t w, h;  
 };
 
+/* One bit for every character cell on the screen. */
+#define VNC_SERVER_DIRTY_SIZE ((LIBCONIO_SCREEN_WIDTH *		\
+				LIBCONIO_SCREEN_HEIGHT + 7) / 8)
+
+/* Encodings announced by the client with SetEncodings. */
+#define VNC_SERVER_ENC_HEXTILE 0x01
+
 struct vnc_server_state {
   uint16_t counter;
   uint8_t type;
@@ -61,9 +57,13 @@ struct vnc_server_state {
   uint16_t height, width;
 
   uint8_t update_requested;
+  uint8_t encodings;
   
-  /* Variables used when sending screen updates. */
-  uint8_t x, y, x1, y1, x2, y2;
+  /* Variables used when sending screen updates. The segment in
+     flight starts at x1, y1 in the first queued update, and ends
+     after "done" updates at x2, y2 in the update that follows. */
+  uint8_t x1, y1, x2, y2;
+  uint8_t done;
   uint8_t w, h;
 
   
@@ -72,31 +72,15 @@ struct vnc_server_state {
   uint8_t sendmsg;
   uint8_t button;
 
-  
-  struct vnc_server_update *updates_current;
-  struct vnc_server_update *updates_pending;
-  struct vnc_server_update *updates_free;
-
+  /* Queue of updates, taken from the dirty cells, oldest first. */
 #define VNC_SERVER_MAX_UPDATES 8  
-  struct vnc_server_update updates_pool[VNC_SERVER_MAX_UPDATES];
+  struct vnc_server_update updates[VNC_SERVER_MAX_UPDATES];
+  uint8_t updates_first, updates_num;
 
+  /* Cells that have changed since they were last sent. */
+  uint8_t dirty[VNC_SERVER_DIRTY_SIZE];
 };
 
-struct vnc_server_update *
-     vnc_server_update_alloc(struct vnc_server_state *vs);
-void vnc_server_update_free(struct vnc_server_state *vs,
-			    struct vnc_server_update *a);
-void vnc_server_update_remove(struct vnc_server_state *vs,
-			      struct vnc_server_update *a);
-
-void vnc_server_update_add(struct vnc_server_state *vs,
-			   struct vnc_server_update *a);
-struct vnc_server_update *
-     vnc_server_update_dequeue(struct vnc_server_state *vs);
-
-
-
-
 void vnc_server_init(void);
 void vnc_server_appcall(struct vnc_server_state *state);
 
@@ -191,6 +175,13 @@ struct rfb_pixel_format {
 #define RFB_ENC_CORRE    3
 #define RFB_ENC_HEXTILE  4
 
+/* Hextile tile subencoding bits. */
+#define RFB_HEXTILE_RAW              1
+#define RFB_HEXTILE_BG_SPECIFIED     2
+#define RFB_HEXTILE_FG_SPECIFIED     4
+#define RFB_HEXTILE_ANY_SUBRECTS     8
+#define RFB_HEXTILE_SUBRECTS_COLORED 16
+
 /* Message definitions. */
 
 /* Server to client messages. */
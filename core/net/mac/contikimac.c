@@ -48,6 +48,7 @@
 #include "net/netstack.h"
 #include "net/rime.h"
 #include "sys/compower.h"
+#include "sys/profile.h"
 #include "sys/pt.h"
 #include "sys/rtimer.h"
 
@@ -355,6 +356,7 @@ powercycle_turn_radio_on(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+PROFILE_PROBE(powercycle);
 static char
 powercycle(struct rtimer *t, void *ptr)
 {
@@ -394,6 +396,7 @@ powercycle(struct rtimer *t, void *ptr)
 #endif
 
     packet_seen = 0;
+    PROFILE_PROBE_BEGIN(powercycle);
 
     for(count = 0; count < CCA_COUNT_MAX; ++count) {
       t0 = RTIMER_NOW();
@@ -473,6 +476,7 @@ powercycle(struct rtimer *t, void *ptr)
         }
       }
     }
+    PROFILE_PROBE_END(powercycle);
 
     if(RTIMER_CLOCK_LT(RTIMER_NOW() - cycle_start, CYCLE_TIME - CHECK_TIME * 4)) {
 	     /* Schedule the next powercycle interrupt, or sleep the mcu until then.
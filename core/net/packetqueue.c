@@ -108,6 +108,12 @@ packetqueue_first(struct packetqueue *q)
   return list_head(*q->list);
 }
 /*---------------------------------------------------------------------------*/
+struct packetqueue_item *
+packetqueue_last(struct packetqueue *q)
+{
+  return list_tail(*q->list);
+}
+/*---------------------------------------------------------------------------*/
 void
 packetqueue_dequeue(struct packetqueue *q)
 {
@@ -165,6 +165,18 @@ int packetqueue_enqueue_packetbuf(struct packetqueue *q, clock_time_t lifetime,
  */
 struct packetqueue_item *packetqueue_first(struct packetqueue *q);
 
+/**
+ * \brief      Access the last item on the packet buffer.
+ * \param q    A pointer to a struct packetqueue.
+ * \return     A pointer to the last item on the packet queue.
+ *
+ *             This function returns the item that was most recently
+ *             enqueued. The packet queue is unchanged by this
+ *             function.
+ *
+ */
+struct packetqueue_item *packetqueue_last(struct packetqueue *q);
+
 /**
  * \brief      Remove the first item on the packet buffer.
  * \param q    A pointer to a struct packetqueue.
@@ -405,6 +405,25 @@ queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
 }
 /*---------------------------------------------------------------------------*/
 void
+queuebuf_update_data(struct queuebuf *buf, const void *data, uint16_t len)
+{
+  struct queuebuf_data *buframptr;
+
+  if(!memb_inmemb(&bufmem, buf)) {
+    /* Reference queuebufs point to data that is not ours to change. */
+    return;
+  }
+  buframptr = queuebuf_load_to_ram(buf);
+  buframptr->len = len > PACKETBUF_SIZE? PACKETBUF_SIZE: len;
+  memcpy(buframptr->data, data, buframptr->len);
+#if WITH_SWAP
+  if(buf->location == IN_CFS) {
+    queuebuf_flush_tmpdata();
+  }
+#endif
+}
+/*---------------------------------------------------------------------------*/
+void
 queuebuf_free(struct queuebuf *buf)
 {
   if(memb_inmemb(&bufmem, buf)) {
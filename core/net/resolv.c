@@ -78,6 +78,7 @@
 */
 
 process_event_t resolv_event_found;
+struct resolv_stats resolv_stats;
 
 PROCESS(resolv_process, "DNS resolver");
 
@@ -141,8 +142,16 @@ struct namemap {
   uint8_t retries;
   uint8_t seqno;
   uint8_t err;
+  uint8_t hash;
+  /* Set when the server has answered, until the name is looked up.
+     That lookup belongs to the miss that sent the query, and is not
+     counted as a hit. */
+  uint8_t answered;
   char name[32];
   uip_ipaddr_t ipaddr;
+  /* In clock_seconds(). A STATE_ERROR entry that has not expired is
+     a negative answer (NXDOMAIN or no address). */
+  unsigned long expiration;
 };
 
 #ifndef UIP_CONF_RESOLV_ENTRIES
@@ -151,9 +160,33 @@ struct namemap {
 #define RESOLV_ENTRIES UIP_CONF_RESOLV_ENTRIES
 #endif /* UIP_CONF_RESOLV_ENTRIES */
 
+/* The TTL of answers is clamped to this range, in seconds. The
+   minimum keeps an answer around long enough for the applications
+   that call resolv_lookup() when resolv_event_found arrives. */
+#ifndef UIP_CONF_RESOLV_MIN_TTL
+#define RESOLV_MIN_TTL 10
+#else /* UIP_CONF_RESOLV_MIN_TTL */
+#define RESOLV_MIN_TTL UIP_CONF_RESOLV_MIN_TTL
+#endif /* UIP_CONF_RESOLV_MIN_TTL */
+
+#ifndef UIP_CONF_RESOLV_MAX_TTL
+#define RESOLV_MAX_TTL 86400UL
+#else /* UIP_CONF_RESOLV_MAX_TTL */
+#define RESOLV_MAX_TTL UIP_CONF_RESOLV_MAX_TTL
+#endif /* UIP_CONF_RESOLV_MAX_TTL */
+
+/* How long names that do not exist are remembered, in seconds. */
+#ifndef UIP_CONF_RESOLV_NEGATIVE_TTL
+#define RESOLV_NEGATIVE_TTL 60
+#else /* UIP_CONF_RESOLV_NEGATIVE_TTL */
+#define RESOLV_NEGATIVE_TTL UIP_CONF_RESOLV_NEGATIVE_TTL
+#endif /* UIP_CONF_RESOLV_NEGATIVE_TTL */
+
 
 static struct namemap names[RESOLV_ENTRIES];
 
+struct resolv_stats resolv_stats;
+
 static uint8_t seqno;
 
 static struct uip_udp_conn *resolv_conn = NULL;
@@ -197,8 +230,93 @@ parse_name(unsigned char *query)
 }
 /*-----------------------------------------------------------------------------------*/
 /** \internal
- * Runs through the list of names to see if there are any that have
- * not yet been queried and, if so, sends out a query.
+ * A short hash of a name, compared before the name itself.
+ */
+/*-----------------------------------------------------------------------------------*/
+static uint8_t
+name_hash(const char *name)
+{
+  uint8_t hash = 0;
+
+  while(*name != 0) {
+    hash = (hash << 3) + (hash >> 5) + *name++;
+  }
+  return hash;
+}
+/*-----------------------------------------------------------------------------------*/
+/** \internal
+ * Find the entry of a name, whatever its state.
+ */
+/*-----------------------------------------------------------------------------------*/
+static struct namemap *
+find_name(const char *name)
+{
+  uint8_t i, hash;
+  register struct namemap *namemapptr;
+
+  hash = name_hash(name);
+  for(i = 0; i < RESOLV_ENTRIES; ++i) {
+    namemapptr = &names[i];
+    if(namemapptr->state != STATE_UNUSED &&
+       namemapptr->hash == hash &&
+       strcmp(name, namemapptr->name) == 0) {
+      return namemapptr;
+    }
+  }
+  return NULL;
+}
+/*-----------------------------------------------------------------------------------*/
+/** \internal
+ * Whether an answered entry is still valid. Expired entries are
+ * freed.
+ */
+/*-----------------------------------------------------------------------------------*/
+static int
+is_fresh(struct namemap *namemapptr)
+{
+  if((long)(namemapptr->expiration - clock_seconds()) > 0) {
+    return 1;
+  }
+  namemapptr->state = STATE_UNUSED;
+  ++resolv_stats.expired;
+  return 0;
+}
+/*-----------------------------------------------------------------------------------*/
+/** \internal
+ * Counts down the retransmission timers of the outstanding queries,
+ * once per second. Returns non-zero if any query is outstanding.
+ */
+/*-----------------------------------------------------------------------------------*/
+static int
+tick_entries(void)
+{
+  uint8_t i;
+  int asking = 0;
+  register struct namemap *namemapptr;
+
+  for(i = 0; i < RESOLV_ENTRIES; ++i) {
+    namemapptr = &names[i];
+    if(namemapptr->state == STATE_ASKING) {
+      if(namemapptr->tmr > 0 && --namemapptr->tmr == 0 &&
+	 ++namemapptr->retries == MAX_RETRIES) {
+	/* No answer: report it, but do not remember it. */
+	namemapptr->state = STATE_UNUSED;
+	resolv_found(namemapptr->name, NULL);
+	continue;
+      }
+      asking = 1;
+    } else if(namemapptr->state == STATE_NEW) {
+      asking = 1;
+    }
+  }
+  return asking;
+}
+/*-----------------------------------------------------------------------------------*/
+/** \internal
+ * Sends a query for the first name that is new or whose
+ * retransmission timer has run out. Only one packet can be sent per
+ * poll, so another poll is requested when more queries are due. This
+ * way several queries can be outstanding at the same time.
  */
 /*-----------------------------------------------------------------------------------*/
 static void
@@ -213,30 +331,23 @@ check_entries(void)
   for(i = 0; i < RESOLV_ENTRIES; ++i) {
     namemapptr = &names[i];
     if(namemapptr->state == STATE_NEW ||
-       namemapptr->state == STATE_ASKING) {
-      etimer_set(&retry, CLOCK_SECOND);
+       (namemapptr->state == STATE_ASKING && namemapptr->tmr == 0)) {
+      if(etimer_expired(&retry)) {
+	etimer_set(&retry, CLOCK_SECOND);
+      }
       if(namemapptr->state == STATE_ASKING) {
-	if(--namemapptr->tmr == 0) {
-	  if(++namemapptr->retries == MAX_RETRIES) {
-	    namemapptr->state = STATE_ERROR;
-	    resolv_found(namemapptr->name, NULL);
-	    continue;
-	  }
-	  namemapptr->tmr = namemapptr->retries;
-	} else {
-	  /*	  printf("Timer %d\n", namemapptr->tmr);*/
-	  /* Its timer has not run out, so we move on to next
-	     entry. */
-	  continue;
-	}
+	namemapptr->tmr = namemapptr->retries;
       } else {
 	namemapptr->state = STATE_ASKING;
 	namemapptr->tmr = 1;
 	namemapptr->retries = 0;
       }
+      ++resolv_stats.queries;
       hdr = (struct dns_hdr *)uip_appdata;
       memset(hdr, 0, sizeof(struct dns_hdr));
-      hdr->id = uip_htons(i);
+      /* The entry and its sequence number, so that a late answer to
+	 an earlier query in the same entry is not taken. */
+      hdr->id = uip_htons(((uint16_t)namemapptr->seqno << 8) | i);
       hdr->flags1 = DNS_FLAG1_RD;
       hdr->numquestions = UIP_HTONS(1);
       query = (char *)uip_appdata + 12;
@@ -260,6 +371,15 @@ check_entries(void)
 	memcpy(query, endquery, 5);
       }
       uip_udp_send((unsigned char)(query + 5 - (char *)uip_appdata));
+
+      /* Poll again if another query is due. */
+      for(++i; i < RESOLV_ENTRIES; ++i) {
+	if(names[i].state == STATE_NEW ||
+	   (names[i].state == STATE_ASKING && names[i].tmr == 0)) {
+	  tcpip_poll_udp(resolv_conn);
+	  break;
+	}
+      }
       break;
     }
   }
@@ -277,6 +397,7 @@ newdata(void)
   struct dns_hdr *hdr;
   static uint8_t nquestions, nanswers;
   static uint8_t i;
+  uint32_t ttl;
   register struct namemap *namemapptr;
   
   hdr = (struct dns_hdr *)uip_appdata;
@@ -291,19 +412,27 @@ newdata(void)
   */
 
   /* The ID in the DNS header should be our entry into the name
-     table. */
+     table, and the sequence number of its query. */
   i = (uint8_t)uip_htons(hdr->id);
   namemapptr = &names[i];
   if(i < RESOLV_ENTRIES &&
-     namemapptr->state == STATE_ASKING) {
+     namemapptr->state == STATE_ASKING &&
+     namemapptr->seqno == (uint8_t)(uip_htons(hdr->id) >> 8)) {
 
-    /* This entry is now finished. */
-    namemapptr->state = STATE_DONE;
+    /* This entry is now finished. Unless an address is found below,
+       it is an error. */
+    namemapptr->state = STATE_ERROR;
     namemapptr->err = hdr->flags2 & DNS_FLAG2_ERR_MASK;
+    namemapptr->expiration = clock_seconds();
 
-    /* Check for error. If so, call callback to inform. */
+    /* Check for error. If so, call callback to inform. A name that
+       does not exist is remembered for a while. */
     if(namemapptr->err != 0) {
-      namemapptr->state = STATE_ERROR;
+      if(namemapptr->err == DNS_FLAG2_ERR_NAME) {
+	namemapptr->expiration += RESOLV_NEGATIVE_TTL;
+      } else {
+	namemapptr->state = STATE_UNUSED;
+      }
       resolv_found(namemapptr->name, NULL);
       return;
     }
@@ -350,6 +479,15 @@ newdata(void)
         for(i = 0; i < 4; i++) {
           namemapptr->ipaddr.u8[i] = ans->ipaddr[i];
         }
+	ttl = ((uint32_t)uip_htons(ans->ttl[0]) << 16) | uip_htons(ans->ttl[1]);
+	if(ttl < RESOLV_MIN_TTL) {
+	  ttl = RESOLV_MIN_TTL;
+	} else if(ttl > RESOLV_MAX_TTL) {
+	  ttl = RESOLV_MAX_TTL;
+	}
+	namemapptr->expiration += ttl;
+	namemapptr->state = STATE_DONE;
+	namemapptr->answered = 1;
 	
 	resolv_found(namemapptr->name, &namemapptr->ipaddr);
 	return;
@@ -358,6 +496,10 @@ newdata(void)
       }
       --nanswers;
     }
+
+    /* The name exists, but has no address. */
+    namemapptr->expiration += RESOLV_NEGATIVE_TTL;
+    resolv_found(namemapptr->name, NULL);
   }
 }
 /*-----------------------------------------------------------------------------------*/
@@ -382,8 +524,11 @@ PROCESS_THREAD(resolv_process, ev, data)
     PROCESS_WAIT_EVENT();
     
     if(ev == PROCESS_EVENT_TIMER) {
-      if(resolv_conn != NULL) {
-        tcpip_poll_udp(resolv_conn);
+      if(tick_entries()) {
+	etimer_set(&retry, CLOCK_SECOND);
+	if(resolv_conn != NULL) {
+	  tcpip_poll_udp(resolv_conn);
+	}
       }
 
     } else if(ev == EVENT_NEW_SERVER) {
@@ -410,6 +555,10 @@ PROCESS_THREAD(resolv_process, ev, data)
 /**
  * Queues a name so that a question for the name will be sent out.
  *
+ * If the name is in the cache and has not expired, no question is
+ * sent and resolv_event_found is posted right away. This is also the
+ * case for a name that recently turned out not to exist.
+ *
  * \param name The hostname that is to be queried.
  */
 /*-----------------------------------------------------------------------------------*/
@@ -418,29 +567,60 @@ resolv_query(const char *name)
 {
   static uint8_t i;
   static uint8_t lseq, lseqi;
+  uint8_t busy, pending;
   register struct namemap *nameptr;
-      
+
+  nameptr = find_name(name);
+  if(nameptr != NULL) {
+    if(nameptr->state == STATE_NEW || nameptr->state == STATE_ASKING) {
+      /* Already being asked for. */
+      return;
+    }
+    if(is_fresh(nameptr)) {
+      /* Answer from the cache without asking the server. The hit is
+	 counted when the address is looked up. */
+      if(nameptr->state == STATE_DONE) {
+	resolv_found(nameptr->name, &nameptr->ipaddr);
+      } else {
+	++resolv_stats.negative_hits;
+	resolv_found(nameptr->name, NULL);
+      }
+      return;
+    }
+  }
+
+  /* Take an unused entry, or else the oldest entry that is not
+     waiting for an answer, or else the oldest entry. */
   lseq = lseqi = 0;
-  nameptr = 0;                //compiler warning if not initialized
-  
+  pending = 1;
   for(i = 0; i < RESOLV_ENTRIES; ++i) {
     nameptr = &names[i];
-    if(nameptr->state == STATE_UNUSED) {
+    if(nameptr->state == STATE_UNUSED ||
+       ((nameptr->state == STATE_DONE || nameptr->state == STATE_ERROR) &&
+	!is_fresh(nameptr))) {
       break;
     }
-    if(seqno - nameptr->seqno > lseq) {
+    busy = nameptr->state == STATE_NEW || nameptr->state == STATE_ASKING;
+    if((pending && !busy) ||
+       (busy == pending && (uint8_t)(seqno - nameptr->seqno) > lseq)) {
       lseq = seqno - nameptr->seqno;
       lseqi = i;
+      pending = busy;
     }
   }
 
   if(i == RESOLV_ENTRIES) {
     i = lseqi;
     nameptr = &names[i];
+    ++resolv_stats.evictions;
   }
 
-  strncpy(nameptr->name, name, sizeof(nameptr->name));
+  strncpy(nameptr->name, name, sizeof(nameptr->name) - 1);
+  nameptr->name[sizeof(nameptr->name) - 1] = 0;
+  nameptr->hash = name_hash(nameptr->name);
+  nameptr->answered = 0;
   nameptr->state = STATE_NEW;
+  ++resolv_stats.misses;
   nameptr->seqno = seqno;
   ++seqno;
 
@@ -465,17 +645,20 @@ resolv_query(const char *name)
 uip_ipaddr_t *
 resolv_lookup(const char *name)
 {
-  static uint8_t i;
   struct namemap *nameptr;
   
-  /* Walk through the list to see if the name is in there. If it is
-     not, we return NULL. */
-  for(i = 0; i < RESOLV_ENTRIES; ++i) {
-    nameptr = &names[i];
-    if(nameptr->state == STATE_DONE &&
-       strcmp(name, nameptr->name) == 0) {
-      return &nameptr->ipaddr;
+  /* Look for the name in the cache. If it is not there, or its TTL
+     has run out, we return NULL. The miss is counted by
+     resolv_query(). */
+  nameptr = find_name(name);
+  if(nameptr != NULL && nameptr->state == STATE_DONE &&
+     is_fresh(nameptr)) {
+    if(nameptr->answered) {
+      nameptr->answered = 0;
+    } else {
+      ++resolv_stats.hits;
     }
+    return &nameptr->ipaddr;
   }
   return NULL;
 }
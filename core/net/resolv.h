@@ -46,6 +46,23 @@
  */
 CCIF extern process_event_t resolv_event_found;
 
+/**
+ * Counters of the DNS cache. Each name that is resolved counts once,
+ * as a hit, a negative hit or a miss, whether the application calls
+ * resolv_lookup() before resolv_query() or the other way around.
+ */
+struct resolv_stats {
+  uint16_t hits;          /* resolv_lookup() calls answered by the cache. */
+  uint16_t misses;        /* resolv_query() calls that ask the server. */
+  uint16_t expired;       /* Entries dropped because their TTL ran out. */
+  uint16_t negative_hits; /* resolv_query() calls answered by a
+			     remembered failure. */
+  uint16_t queries;       /* Queries sent to the server. */
+  uint16_t evictions;     /* Valid entries replaced by a new name. */
+};
+
+CCIF extern struct resolv_stats resolv_stats;
+
 /* Functions. */
 CCIF void resolv_conf(const uip_ipaddr_t *dnsserver);
 CCIF uip_ipaddr_t *resolv_getserver(void);
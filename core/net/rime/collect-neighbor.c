@@ -44,6 +44,7 @@
 
 #include <limits.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "contiki.h"
 #include "lib/memb.h"
@@ -69,6 +70,9 @@ MEMB(collect_neighbors_mem, struct collect_neighbor, MAX_COLLECT_NEIGHBORS);
 #define EXPECTED_CONGESTION_DURATION CLOCK_SECOND * 240
 #define CONGESTION_PENALTY           8 * COLLECT_LINK_ESTIMATE_UNIT
 
+/* Number of periodic ticks since the tick stamp t. */
+#define AGE(neighbor_list, t) ((uint16_t)((neighbor_list)->ticks - (t)))
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -77,31 +81,122 @@ MEMB(collect_neighbors_mem, struct collect_neighbor, MAX_COLLECT_NEIGHBORS);
 #define PRINTF(...)
 #endif
 
+/*---------------------------------------------------------------------------*/
+static struct collect_neighbor **
+bucket(struct collect_neighbor_list *neighbor_list, const rimeaddr_t *addr)
+{
+  uint8_t h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < RIMEADDR_SIZE; i++) {
+    h = h * 31 + addr->u8[i];
+  }
+  return &neighbor_list->hash[h % COLLECT_NEIGHBOR_HASH_SIZE];
+}
 /*---------------------------------------------------------------------------*/
 static void
-periodic(void *ptr)
+unhash(struct collect_neighbor_list *neighbor_list, struct collect_neighbor *n)
+{
+  struct collect_neighbor **np;
+
+  for(np = bucket(neighbor_list, &n->addr); *np != NULL; np = &(*np)->hnext) {
+    if(*np == n) {
+      *np = n->hnext;
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_best(struct collect_neighbor *n)
 {
   struct collect_neighbor_list *neighbor_list;
-  struct collect_neighbor *n;
+  uint16_t metric;
 
-  neighbor_list = ptr;
+  neighbor_list = n->neighbor_list;
+  if(neighbor_list->best_dirty) {
+    /* The best neighbor will be recomputed anyway. */
+    return;
+  }
 
-  /* Go through all collect_neighbors and increase their age. */
-  for(n = list_head(neighbor_list->list); n != NULL; n = list_item_next(n)) {
-    n->age++;
-    n->le_age++;
+  metric = collect_neighbor_rtmetric_link_estimate(n);
+  if(n == neighbor_list->best) {
+    if(metric <= neighbor_list->best_metric) {
+      neighbor_list->best_metric = metric;
+    } else {
+      /* Another neighbor may now be better. */
+      neighbor_list->best_dirty = 1;
+    }
+  } else if(metric < neighbor_list->best_metric) {
+    neighbor_list->best = n;
+    neighbor_list->best_metric = metric;
   }
-  for(n = list_head(neighbor_list->list); n != NULL; n = list_item_next(n)) {
-    if(n->le_age == MAX_LE_AGE) {
-      collect_link_estimate_new(&n->le);
-      n->le_age = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+schedule_sweep(struct collect_neighbor_list *neighbor_list, uint16_t tick)
+{
+  if((int16_t)(tick - neighbor_list->next_sweep) < 0) {
+    neighbor_list->next_sweep = tick;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_neighbor(struct collect_neighbor_list *neighbor_list,
+                struct collect_neighbor *n)
+{
+  unhash(neighbor_list, n);
+  list_remove(neighbor_list->list, n);
+  memb_free(&collect_neighbors_mem, n);
+  if(n == neighbor_list->best) {
+    neighbor_list->best = NULL;
+    neighbor_list->best_dirty = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+sweep(struct collect_neighbor_list *neighbor_list)
+{
+  struct collect_neighbor *n, *next;
+
+  /* The sweep is due when the oldest neighbor times out or when a link
+     estimate gets too old. Those are the only events that change the
+     list between updates, so the neighbors do not have to be aged one
+     by one on every tick. */
+  neighbor_list->next_sweep = neighbor_list->ticks + MAX_AGE;
+  for(n = list_head(neighbor_list->list); n != NULL; n = next) {
+    next = list_item_next(n);
+    if(AGE(neighbor_list, n->age) >= MAX_AGE) {
+      PRINTF("collect_neighbor: %d.%d timed out\n",
+             n->addr.u8[0], n->addr.u8[1]);
+      remove_neighbor(neighbor_list, n);
+      continue;
     }
-    if(n->age == MAX_AGE) {
-      memb_free(&collect_neighbors_mem, n);
-      list_remove(neighbor_list->list, n);
-      n = list_head(neighbor_list->list);
+    schedule_sweep(neighbor_list, n->age + MAX_AGE);
+    if(collect_link_estimate_num_estimates(&n->le) > 0) {
+      if(AGE(neighbor_list, n->le_age) >= MAX_LE_AGE) {
+        collect_link_estimate_new(&n->le);
+        n->le_age = neighbor_list->ticks;
+        update_best(n);
+      } else {
+        schedule_sweep(neighbor_list, n->le_age + MAX_LE_AGE);
+      }
     }
   }
+}
+/*---------------------------------------------------------------------------*/
+static void
+periodic(void *ptr)
+{
+  struct collect_neighbor_list *neighbor_list;
+
+  neighbor_list = ptr;
+
+  neighbor_list->ticks++;
+  if((int16_t)(neighbor_list->ticks - neighbor_list->next_sweep) >= 0) {
+    sweep(neighbor_list);
+  }
   ctimer_set(&neighbor_list->periodic, PERIODIC_INTERVAL,
              periodic, neighbor_list);
 }
@@ -121,6 +216,12 @@ collect_neighbor_list_new(struct collect_neighbor_list *neighbors_list)
 {
   LIST_STRUCT_INIT(neighbors_list, list);
   list_init(neighbors_list->list);
+  memset(neighbors_list->hash, 0, sizeof(neighbors_list->hash));
+  neighbors_list->best = NULL;
+  neighbors_list->best_metric = RTMETRIC_MAX;
+  neighbors_list->best_dirty = 0;
+  neighbors_list->ticks = 0;
+  neighbors_list->next_sweep = MAX_AGE;
   ctimer_set(&neighbors_list->periodic, CLOCK_SECOND, periodic, neighbors_list);
 }
 /*---------------------------------------------------------------------------*/
@@ -132,7 +233,7 @@ collect_neighbor_list_find(struct collect_neighbor_list *neighbors_list,
   if(neighbors_list == NULL) {
     return NULL;
   }
-  for(n = list_head(neighbors_list->list); n != NULL; n = list_item_next(n)) {
+  for(n = *bucket(neighbors_list, addr); n != NULL; n = n->hnext) {
     if(rimeaddr_cmp(&n->addr, addr)) {
       return n;
     }
@@ -158,12 +259,10 @@ collect_neighbor_list_add(struct collect_neighbor_list *neighbors_list,
   PRINTF("collect_neighbor_add: adding %d.%d\n", addr->u8[0], addr->u8[1]);
 
   /* Check if the collect_neighbor is already on the list. */
-  for(n = list_head(neighbors_list->list); n != NULL; n = list_item_next(n)) {
-    if(rimeaddr_cmp(&n->addr, addr)) {
-      PRINTF("collect_neighbor_add: already on list %d.%d\n",
-             addr->u8[0], addr->u8[1]);
-      break;
-    }
+  n = collect_neighbor_list_find(neighbors_list, addr);
+  if(n != NULL) {
+    PRINTF("collect_neighbor_add: already on list %d.%d\n",
+           addr->u8[0], addr->u8[1]);
   }
 
   /* If the collect_neighbor was not on the list, we try to allocate memory
@@ -174,50 +273,60 @@ collect_neighbor_list_add(struct collect_neighbor_list *neighbors_list,
     n = memb_alloc(&collect_neighbors_mem);
     if(n != NULL) {
       list_add(neighbors_list->list, n);
+      n->neighbor_list = neighbors_list;
+      rimeaddr_copy(&n->addr, addr);
+      n->hnext = *bucket(neighbors_list, addr);
+      *bucket(neighbors_list, addr) = n;
     }
   }
 
-  /* If we could not allocate memory, we try to recycle an old
-     neighbor. XXX Should also look for the one with the worst
-     rtmetric (not link esimate). XXX Also make sure that we don't
-     replace a neighbor with a neighbor that has a worse metric. */
+  /* If we could not allocate memory, we try to recycle the neighbor
+     that is ranked worst, i.e., the one with the highest rtmetric +
+     link estimate. This is the neighbor that we are least likely to
+     be using in the future. */
   if(n == NULL) {
-    uint16_t worst_rtmetric;
+    uint16_t worst_metric;
     struct collect_neighbor *worst_neighbor;
+    struct collect_link_estimate le;
 
-    /* Find the neighbor that has the highest rtmetric. This is the
-       neighbor that we are least likely to be using in the
-       future. But we also need to make sure that the neighbor we are
-       currently adding is not worst than the one we would be
-       replacing. If so, we don't put the new neighbor on the list. */
-    worst_rtmetric = 0;
+    worst_metric = 0;
     worst_neighbor = NULL;
 
     for(n = list_head(neighbors_list->list);
         n != NULL; n = list_item_next(n)) {
-      if(n->rtmetric > worst_rtmetric) {
+      if(collect_neighbor_rtmetric_link_estimate(n) >= worst_metric) {
         worst_neighbor = n;
-        worst_rtmetric = n->rtmetric;
+        worst_metric = collect_neighbor_rtmetric_link_estimate(n);
       }
     }
 
-    /* Only add this new neighbor if its rtmetric is lower than the
-       one it would replace. */
-    if(nrtmetric < worst_rtmetric) {
+    /* Only add this new neighbor if it ranks better than the one it
+       would replace. The new neighbor starts out with the initial
+       link estimate. */
+    collect_link_estimate_new(&le);
+    n = NULL;
+    if(worst_neighbor != NULL &&
+       (uint32_t)nrtmetric + collect_link_estimate(&le) < worst_metric) {
       n = worst_neighbor;
-    }
-    if(n != NULL) {
       PRINTF("collect_neighbor_add: not on list, not allocated, recycling %d.%d\n",
              n->addr.u8[0], n->addr.u8[1]);
+      unhash(neighbors_list, n);
+      if(n == neighbors_list->best) {
+        neighbors_list->best = NULL;
+        neighbors_list->best_dirty = 1;
+      }
+      rimeaddr_copy(&n->addr, addr);
+      n->hnext = *bucket(neighbors_list, addr);
+      *bucket(neighbors_list, addr) = n;
     }
   }
 
   if(n != NULL) {
-    n->age = 0;
-    rimeaddr_copy(&n->addr, addr);
+    n->age = neighbors_list->ticks;
     n->rtmetric = nrtmetric;
     collect_link_estimate_new(&n->le);
-    n->le_age = 0;
+    n->le_age = neighbors_list->ticks;
+    update_best(n);
     return 1;
   }
   return 0;
@@ -246,26 +355,27 @@ collect_neighbor_list_remove(struct collect_neighbor_list *neighbors_list,
   n = collect_neighbor_list_find(neighbors_list, addr);
 
   if(n != NULL) {
-    list_remove(neighbors_list->list, n);
-    memb_free(&collect_neighbors_mem, n);
+    remove_neighbor(neighbors_list, n);
   }
 }
 /*---------------------------------------------------------------------------*/
 struct collect_neighbor *
 collect_neighbor_list_best(struct collect_neighbor_list *neighbors_list)
 {
-  int found;
   struct collect_neighbor *n, *best;
   uint16_t rtmetric;
 
-  rtmetric = RTMETRIC_MAX;
-  best = NULL;
-  found = 0;
-
   if(neighbors_list == NULL) {
     return NULL;
   }
 
+  if(!neighbors_list->best_dirty) {
+    return neighbors_list->best;
+  }
+
+  rtmetric = RTMETRIC_MAX;
+  best = NULL;
+
   /*  PRINTF("%d: ", node_id);*/
   PRINTF("collect_neighbor_best: ");
 
@@ -282,6 +392,9 @@ collect_neighbor_list_best(struct collect_neighbor_list *neighbors_list)
   }
   PRINTF("\n");
 
+  neighbors_list->best = best;
+  neighbors_list->best_metric = rtmetric;
+  neighbors_list->best_dirty = 0;
   return best;
 }
 /*---------------------------------------------------------------------------*/
@@ -330,6 +443,10 @@ collect_neighbor_list_purge(struct collect_neighbor_list *neighbors_list)
   while(list_head(neighbors_list->list) != NULL) {
     memb_free(&collect_neighbors_mem, list_pop(neighbors_list->list));
   }
+  memset(neighbors_list->hash, 0, sizeof(neighbors_list->hash));
+  neighbors_list->best = NULL;
+  neighbors_list->best_metric = RTMETRIC_MAX;
+  neighbors_list->best_dirty = 0;
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -340,10 +457,20 @@ collect_neighbor_update_rtmetric(struct collect_neighbor *n, uint16_t rtmetric)
            rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
            n->addr.u8[0], n->addr.u8[1], rtmetric);
     n->rtmetric = rtmetric;
-    n->age = 0;
+    n->age = n->neighbor_list->ticks;
+    update_best(n);
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+refresh_link_estimate(struct collect_neighbor *n)
+{
+  n->le_age = n->neighbor_list->ticks;
+  n->age = n->neighbor_list->ticks;
+  schedule_sweep(n->neighbor_list, n->le_age + MAX_LE_AGE);
+  update_best(n);
+}
+/*---------------------------------------------------------------------------*/
 void
 collect_neighbor_tx_fail(struct collect_neighbor *n, uint16_t num_tx)
 {
@@ -351,8 +478,7 @@ collect_neighbor_tx_fail(struct collect_neighbor *n, uint16_t num_tx)
     return;
   }
   collect_link_estimate_update_tx_fail(&n->le, num_tx);
-  n->le_age = 0;
-  n->age = 0;
+  refresh_link_estimate(n);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -362,8 +488,7 @@ collect_neighbor_tx(struct collect_neighbor *n, uint16_t num_tx)
     return;
   }
   collect_link_estimate_update_tx(&n->le, num_tx);
-  n->le_age = 0;
-  n->age = 0;
+  refresh_link_estimate(n);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -373,7 +498,8 @@ collect_neighbor_rx(struct collect_neighbor *n)
     return;
   }
   collect_link_estimate_update_rx(&n->le);
-  n->age = 0;
+  n->age = n->neighbor_list->ticks;
+  update_best(n);
 }
 /*---------------------------------------------------------------------------*/
 uint16_t
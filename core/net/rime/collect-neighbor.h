@@ -55,15 +55,39 @@
 #include "net/rime/collect-link-estimate.h"
 #include "lib/list.h"
 
+#ifdef COLLECT_NEIGHBOR_CONF_HASH_SIZE
+#define COLLECT_NEIGHBOR_HASH_SIZE COLLECT_NEIGHBOR_CONF_HASH_SIZE
+#else /* COLLECT_NEIGHBOR_CONF_HASH_SIZE */
+#define COLLECT_NEIGHBOR_HASH_SIZE 8
+#endif /* COLLECT_NEIGHBOR_CONF_HASH_SIZE */
+
+struct collect_neighbor;
+
 struct collect_neighbor_list {
   LIST_STRUCT(list);
   struct ctimer periodic;
+  /* Neighbors hashed on their address. */
+  struct collect_neighbor *hash[COLLECT_NEIGHBOR_HASH_SIZE];
+  /* The neighbor with the lowest rtmetric + link estimate, kept up to
+     date as neighbors are updated. Recomputed by
+     collect_neighbor_list_best() when best_dirty is set. */
+  struct collect_neighbor *best;
+  uint16_t best_metric;
+  uint8_t best_dirty;
+  /* Periodic ticks since the list was created, and the tick at which
+     the next neighbor times out or has its link estimate reset. */
+  uint16_t ticks;
+  uint16_t next_sweep;
 };
 
 struct collect_neighbor {
   struct collect_neighbor *next;
+  struct collect_neighbor *hnext;
+  struct collect_neighbor_list *neighbor_list;
   rimeaddr_t addr;
   uint16_t rtmetric;
+  /* The tick at which the neighbor was last heard from, and at which
+     its link estimate was last updated. */
   uint16_t age;
   uint16_t le_age;
   struct collect_link_estimate le;
@@ -91,6 +91,20 @@ struct data_msg_hdr {
   uint16_t rtmetric;
 };
 
+/* If the DATA_FLAGS_AGGREGATE flag is set, the data packet is an
+   aggregate of several packets. The header is then followed by one
+   record per packet. A record holds the attributes that the packet
+   would otherwise have carried in its own frame, followed by the
+   packet data. */
+#define DATA_FLAGS_AGGREGATE            0x01
+
+struct aggregate_hdr {
+  uint8_t len;
+  uint8_t eseqno;
+  uint8_t hops, ttl, max_rexmit;
+  rimeaddr_t esender;
+};
+
 
 /* This is the header of ACK packets. It contains a flags field that
    indicates if the node is congested (ACK_FLAGS_CONGESTED), if the
@@ -160,6 +174,33 @@ MEMB(send_queue_memb, struct packetqueue_item, MAX_SENDING_QUEUE);
 #define PROACTIVE_PROBING_INTERVAL (random_rand() % CLOCK_SECOND * 60)
 #define PROACTIVE_PROBING_REXMITS  15
 
+#if COLLECT_AGGREGATE
+/* COLLECT_AGGREGATE_DELAY is the maximum time a lone data packet is
+   held in the send queue, waiting for other packets to be merged into
+   it. COLLECT_AGGREGATE_MAX_LEN is the maximum size of an aggregated
+   packet. It leaves room for the Rime and link-layer headers in the
+   radio frame. */
+#ifdef COLLECT_CONF_AGGREGATE_DELAY
+#define COLLECT_AGGREGATE_DELAY COLLECT_CONF_AGGREGATE_DELAY
+#else /* COLLECT_CONF_AGGREGATE_DELAY */
+#define COLLECT_AGGREGATE_DELAY (CLOCK_SECOND / 2)
+#endif /* COLLECT_CONF_AGGREGATE_DELAY */
+
+#ifdef COLLECT_CONF_AGGREGATE_MAX_LEN
+#define COLLECT_AGGREGATE_MAX_LEN COLLECT_CONF_AGGREGATE_MAX_LEN
+#else /* COLLECT_CONF_AGGREGATE_MAX_LEN */
+#define COLLECT_AGGREGATE_MAX_LEN (PACKETBUF_SIZE - PACKETBUF_HDR_SIZE)
+#endif /* COLLECT_CONF_AGGREGATE_MAX_LEN */
+
+enum {
+  AGGREGATE_IDLE,
+  AGGREGATE_WAIT,
+  AGGREGATE_SEND,
+};
+
+static uint8_t aggregate_buf[COLLECT_AGGREGATE_MAX_LEN];
+#endif /* COLLECT_AGGREGATE */
+
 /* The ANNOUNCEMENT_SCAN_TIME defines for how long the Collect
    implementation should listen for announcements from other nodes
    when it requires a route. */
@@ -189,6 +230,8 @@ struct {
   uint32_t ttldrop;
   uint32_t ackdrop;
   uint32_t timedout;
+
+  uint32_t aggregated;
 } stats;
 
 /* Debug definition: draw routing tree in Cooja. */
@@ -462,6 +505,7 @@ enqueue_dummy_packet(struct collect_conn *c, int rexmits)
 
   /* Allocate space for the header. */
   packetbuf_hdralloc(sizeof(struct data_msg_hdr));
+  memset(packetbuf_hdrptr(), 0, sizeof(struct data_msg_hdr));
 
   n = collect_neighbor_list_find(&c->neighbor_list, &c->parent);
   if(n != NULL) {
@@ -472,6 +516,145 @@ enqueue_dummy_packet(struct collect_conn *c, int rexmits)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+#if COLLECT_AGGREGATE
+/**
+ * This function returns the number of data bytes that a packet merged
+ * into the queued packet q could have. An aggregate holds at most
+ * NUM_RECENT_PACKETS packets, so that a receiver still remembers all
+ * the packets of an aggregate that it has queued when the aggregate
+ * is sent again.
+ *
+ */
+static int
+aggregate_room(struct queuebuf *q)
+{
+  struct data_msg_hdr hdr;
+  struct aggregate_hdr rec;
+  int len, off, n;
+
+  len = queuebuf_datalen(q);
+  if(len <= sizeof(struct data_msg_hdr)) {
+    /* Keepalives and probes are never aggregated. */
+    return 0;
+  }
+  memcpy(&hdr, queuebuf_dataptr(q), sizeof(struct data_msg_hdr));
+  if((hdr.flags & DATA_FLAGS_AGGREGATE) == 0) {
+    len += sizeof(struct aggregate_hdr);
+  } else {
+    n = 0;
+    for(off = sizeof(struct data_msg_hdr);
+        off + sizeof(rec) <= len;
+        off += sizeof(rec) + rec.len) {
+      memcpy(&rec, (uint8_t *)queuebuf_dataptr(q) + off, sizeof(rec));
+      n++;
+    }
+    if(n >= NUM_RECENT_PACKETS) {
+      return 0;
+    }
+  }
+  len += sizeof(struct aggregate_hdr);
+  return len < COLLECT_AGGREGATE_MAX_LEN ? COLLECT_AGGREGATE_MAX_LEN - len : 0;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * This function merges the packet in the packetbuf into the last
+ * packet on the send queue, if that packet is not currently being
+ * sent and has room for it. The packetbuf is left unchanged. The
+ * merged packet keeps the lifetime of the queued packet.
+ *
+ */
+static int
+aggregate_packetbuf(struct collect_conn *c)
+{
+  struct packetqueue_item *i;
+  struct queuebuf *q;
+  struct data_msg_hdr hdr;
+  struct aggregate_hdr rec;
+  int len, datalen;
+
+  i = packetqueue_last(&c->send_queue);
+  if(i == NULL ||
+     (c->sending && i == packetqueue_first(&c->send_queue))) {
+    return 0;
+  }
+  q = packetqueue_queuebuf(i);
+  datalen = packetbuf_totlen() - sizeof(struct data_msg_hdr);
+  if(q == NULL || datalen <= 0 || datalen > aggregate_room(q)) {
+    return 0;
+  }
+
+  len = queuebuf_datalen(q);
+  memcpy(aggregate_buf, queuebuf_dataptr(q), len);
+  memcpy(&hdr, aggregate_buf, sizeof(struct data_msg_hdr));
+  if((hdr.flags & DATA_FLAGS_AGGREGATE) == 0) {
+    /* The queued packet becomes the first record of the aggregate. */
+    memmove(&aggregate_buf[sizeof(struct data_msg_hdr) + sizeof(rec)],
+            &aggregate_buf[sizeof(struct data_msg_hdr)],
+            len - sizeof(struct data_msg_hdr));
+    rec.len = len - sizeof(struct data_msg_hdr);
+    rec.eseqno = queuebuf_attr(q, PACKETBUF_ATTR_EPACKET_ID);
+    rec.hops = queuebuf_attr(q, PACKETBUF_ATTR_HOPS);
+    rec.ttl = queuebuf_attr(q, PACKETBUF_ATTR_TTL);
+    rec.max_rexmit = queuebuf_attr(q, PACKETBUF_ATTR_MAX_REXMIT);
+    rimeaddr_copy(&rec.esender, queuebuf_addr(q, PACKETBUF_ADDR_ESENDER));
+    memcpy(&aggregate_buf[sizeof(struct data_msg_hdr)], &rec, sizeof(rec));
+    hdr.flags |= DATA_FLAGS_AGGREGATE;
+    memcpy(aggregate_buf, &hdr, sizeof(struct data_msg_hdr));
+    len += sizeof(rec);
+  }
+
+  /* Append the new packet. Its data_msg_hdr is copied into the space
+     of the record header, which is then written over it. */
+  packetbuf_copyto(&aggregate_buf[len + sizeof(rec) -
+                                  sizeof(struct data_msg_hdr)]);
+  rec.len = datalen;
+  rec.eseqno = packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID);
+  rec.hops = packetbuf_attr(PACKETBUF_ATTR_HOPS);
+  rec.ttl = packetbuf_attr(PACKETBUF_ATTR_TTL);
+  rec.max_rexmit = packetbuf_attr(PACKETBUF_ATTR_MAX_REXMIT);
+  rimeaddr_copy(&rec.esender, packetbuf_addr(PACKETBUF_ADDR_ESENDER));
+  memcpy(&aggregate_buf[len], &rec, sizeof(rec));
+  len += sizeof(rec) + datalen;
+
+  queuebuf_update_data(q, aggregate_buf, len);
+  stats.aggregated++;
+
+  PRINTF("%d.%d: aggregated packet %d from %d.%d, length %d\n",
+         rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+         rec.eseqno, rec.esender.u8[0], rec.esender.u8[1], len);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+aggregate_deadline(void *ptr)
+{
+  struct collect_conn *c = ptr;
+
+  c->aggregate_state = AGGREGATE_SEND;
+  send_queued_packet(c);
+}
+#endif /* COLLECT_AGGREGATE */
+/*---------------------------------------------------------------------------*/
+/**
+ * This function puts the data packet in the packetbuf on the send
+ * queue, merging it into the last queued packet if aggregation is
+ * enabled.
+ *
+ */
+static int
+enqueue_packetbuf(struct collect_conn *c)
+{
+#if COLLECT_AGGREGATE
+  if(aggregate_packetbuf(c)) {
+    return 1;
+  }
+#endif /* COLLECT_AGGREGATE */
+  return packetqueue_enqueue_packetbuf(&c->send_queue,
+                                       FORWARD_PACKET_LIFETIME_BASE *
+                                       packetbuf_attr(PACKETBUF_ATTR_MAX_REXMIT),
+                                       c);
+}
+/*---------------------------------------------------------------------------*/
 static void
 send_packet(struct collect_conn *c, struct collect_neighbor *n)
 {
@@ -571,12 +754,33 @@ send_queued_packet(struct collect_conn *c)
   if(i == NULL) {
     PRINTF("%d.%d: nothing on queue\n",
            rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1]);
-
+#if COLLECT_AGGREGATE
+    c->aggregate_state = AGGREGATE_IDLE;
+#endif /* COLLECT_AGGREGATE */
     return;
   }
 
   /* We should send the first packet from the queue. */
   q = packetqueue_queuebuf(i);
+
+#if COLLECT_AGGREGATE
+  /* If the packet is alone on the queue and has room for more data,
+     we hold it until the aggregation deadline, so that packets that
+     are queued in the meantime can be merged into it. Packets that
+     have waited behind another packet are sent right away. */
+  if(q != NULL && c->aggregate_state != AGGREGATE_SEND &&
+     packetqueue_len(&c->send_queue) == 1 && aggregate_room(q) > 0) {
+    if(c->aggregate_state == AGGREGATE_IDLE) {
+      c->aggregate_state = AGGREGATE_WAIT;
+      ctimer_set(&c->aggregate_timer, COLLECT_AGGREGATE_DELAY,
+                 aggregate_deadline, c);
+    }
+    return;
+  }
+  ctimer_stop(&c->aggregate_timer);
+  c->aggregate_state = AGGREGATE_IDLE;
+#endif /* COLLECT_AGGREGATE */
+
   if(q != NULL) {
     /* Place the queued packet into the packetbuf. */
     queuebuf_to_packetbuf(q);
@@ -627,6 +831,8 @@ send_queued_packet(struct collect_conn *c)
       /* Copy our rtmetric into the packet header of the outgoing
          packet. */
       memset(&hdr, 0, sizeof(hdr));
+      hdr.flags = ((struct data_msg_hdr *)packetbuf_dataptr())->flags &
+        DATA_FLAGS_AGGREGATE;
       hdr.rtmetric = c->rtmetric;
       memcpy(packetbuf_dataptr(), &hdr, sizeof(struct data_msg_hdr));
 
@@ -726,6 +932,8 @@ retransmit_current_packet(struct collect_conn *c)
       /* Copy our rtmetric into the packet header of the outgoing
          packet. */
       memset(&hdr, 0, sizeof(hdr));
+      hdr.flags = ((struct data_msg_hdr *)packetbuf_dataptr())->flags &
+        DATA_FLAGS_AGGREGATE;
       hdr.rtmetric = c->rtmetric;
       memcpy(packetbuf_dataptr(), &hdr, sizeof(struct data_msg_hdr));
 
@@ -748,6 +956,11 @@ send_next_packet(struct collect_conn *tc)
   tc->sending = 0;
   tc->transmissions = 0;
 
+#if COLLECT_AGGREGATE
+  /* The next packet has already waited for this one to be sent. */
+  tc->aggregate_state = AGGREGATE_SEND;
+#endif /* COLLECT_AGGREGATE */
+
   PRINTF("sending next packet, seqno %d, queue len %d\n",
          tc->seqno, packetqueue_len(&tc->send_queue));
 
@@ -901,12 +1114,132 @@ add_packet_to_recent_packets(struct collect_conn *tc)
   }
 }
 /*---------------------------------------------------------------------------*/
+static int
+is_recent_packet(struct collect_conn *tc)
+{
+  int i;
+
+  for(i = 0; i < NUM_RECENT_PACKETS; i++) {
+    if(recent_packets[i].conn == tc &&
+       recent_packets[i].eseqno == packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID) &&
+       rimeaddr_cmp(&recent_packets[i].originator,
+                    packetbuf_addr(PACKETBUF_ADDR_ESENDER))) {
+      PRINTF("%d.%d: found duplicate packet from %d.%d with seqno %d, via %d.%d\n",
+             rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+             recent_packets[i].originator.u8[0], recent_packets[i].originator.u8[1],
+             packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID),
+             packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[0],
+             packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[1]);
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+#if COLLECT_AGGREGATE
+/**
+ * This function is called when an aggregated data packet has been
+ * received. The packets in it are delivered one by one if we are the
+ * sink, or put on our own send queue if we are a forwarder. The
+ * aggregate is acknowledged as a whole. If any of its packets could
+ * not be queued, the ACK tells the sender to send the aggregate
+ * again, and the packets that were queued are then dropped as
+ * duplicates.
+ *
+ */
+static void
+aggregate_received(struct collect_conn *tc, const struct data_msg_hdr *hdr,
+                   const rimeaddr_t *ack_to, uint8_t packet_seqno,
+                   uint8_t ackflags)
+{
+  struct queuebuf *q;
+  struct aggregate_hdr rec;
+  uint8_t *ptr;
+  uint16_t off, len;
+
+  if(tc->rtmetric == RTMETRIC_SINK) {
+    ackflags = 0;
+  } else if(tc->rtmetric == RTMETRIC_MAX) {
+    return;
+  } else if(hdr->rtmetric <= tc->rtmetric) {
+    ackflags |= ACK_FLAGS_RTMETRIC_NEEDS_UPDATE;
+  }
+
+  /* Keep the aggregate in a queuebuf, since the packetbuf is used for
+     each of the packets. */
+  q = queuebuf_new_from_packetbuf();
+  if(q == NULL) {
+    packetbuf_set_attr(PACKETBUF_ATTR_PACKET_ID, packet_seqno);
+    send_ack(tc, ack_to, ackflags | ACK_FLAGS_DROPPED | ACK_FLAGS_CONGESTED);
+    stats.qdrop++;
+    return;
+  }
+
+  len = queuebuf_datalen(q);
+  for(off = sizeof(struct data_msg_hdr);
+      off + sizeof(rec) <= len;
+      off += sizeof(rec) + rec.len) {
+    ptr = (uint8_t *)queuebuf_dataptr(q) + off;
+    memcpy(&rec, ptr, sizeof(rec));
+    if(off + sizeof(rec) + rec.len > len) {
+      break;
+    }
+
+    /* Rebuild the packet as it would have been received on its own,
+       with an empty data_msg_hdr in front of the data. */
+    packetbuf_copyfrom(ptr + sizeof(rec) - sizeof(struct data_msg_hdr),
+                       rec.len + sizeof(struct data_msg_hdr));
+    memset(packetbuf_dataptr(), 0, sizeof(struct data_msg_hdr));
+    packetbuf_set_addr(PACKETBUF_ADDR_ESENDER, &rec.esender);
+    packetbuf_set_attr(PACKETBUF_ATTR_EPACKET_ID, rec.eseqno);
+    packetbuf_set_attr(PACKETBUF_ATTR_HOPS, rec.hops);
+    packetbuf_set_attr(PACKETBUF_ATTR_TTL, rec.ttl);
+    packetbuf_set_attr(PACKETBUF_ATTR_MAX_REXMIT, rec.max_rexmit);
+    packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
+                       PACKETBUF_ATTR_PACKET_TYPE_DATA);
+
+    if(is_recent_packet(tc)) {
+      stats.duprecv++;
+      continue;
+    }
+
+    if(tc->rtmetric == RTMETRIC_SINK) {
+      add_packet_to_recent_packets(tc);
+      packetbuf_hdrreduce(sizeof(struct data_msg_hdr));
+      if(packetbuf_datalen() > 0 && tc->cb->recv != NULL) {
+        tc->cb->recv(packetbuf_addr(PACKETBUF_ADDR_ESENDER),
+                     packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID),
+                     packetbuf_attr(PACKETBUF_ATTR_HOPS));
+      }
+    } else if(rec.ttl <= 1) {
+      stats.ttldrop++;
+    } else {
+      packetbuf_set_attr(PACKETBUF_ATTR_HOPS, rec.hops + 1);
+      packetbuf_set_attr(PACKETBUF_ATTR_TTL, rec.ttl - 1);
+      if(packetqueue_len(&tc->send_queue) <= MAX_SENDING_QUEUE - MIN_AVAILABLE_QUEUE_ENTRIES &&
+         enqueue_packetbuf(tc)) {
+        add_packet_to_recent_packets(tc);
+      } else {
+        ackflags |= ACK_FLAGS_DROPPED | ACK_FLAGS_CONGESTED;
+        stats.qdrop++;
+      }
+    }
+  }
+  queuebuf_free(q);
+
+  packetbuf_set_attr(PACKETBUF_ATTR_PACKET_ID, packet_seqno);
+  send_ack(tc, ack_to, ackflags);
+  if(tc->rtmetric != RTMETRIC_SINK) {
+    send_queued_packet(tc);
+  }
+}
+#endif /* COLLECT_AGGREGATE */
+/*---------------------------------------------------------------------------*/
 static void
 node_packet_received(struct unicast_conn *c, const rimeaddr_t *from)
 {
   struct collect_conn *tc = (struct collect_conn *)
     ((char *)c - offsetof(struct collect_conn, unicast_conn));
-  int i;
   struct data_msg_hdr hdr;
   uint8_t ackflags = 0;
   struct collect_neighbor *n;
@@ -949,23 +1282,19 @@ node_packet_received(struct unicast_conn *c, const rimeaddr_t *from)
       ackflags |= ACK_FLAGS_CONGESTED;
     }
 
-    for(i = 0; i < NUM_RECENT_PACKETS; i++) {
-      if(recent_packets[i].conn == tc &&
-         recent_packets[i].eseqno == packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID) &&
-         rimeaddr_cmp(&recent_packets[i].originator,
-                      packetbuf_addr(PACKETBUF_ADDR_ESENDER))) {
-        /* This is a duplicate of a packet we recently received, so we
-           just send an ACK. */
-        PRINTF("%d.%d: found duplicate packet from %d.%d with seqno %d, via %d.%d\n",
-               rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
-               recent_packets[i].originator.u8[0], recent_packets[i].originator.u8[1],
-               packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID),
-               packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[0],
-               packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[1]);
-        send_ack(tc, &ack_to, ackflags);
-        stats.duprecv++;
-        return;
-      }
+#if COLLECT_AGGREGATE
+    if(hdr.flags & DATA_FLAGS_AGGREGATE) {
+      aggregate_received(tc, &hdr, &ack_to, packet_seqno, ackflags);
+      return;
+    }
+#endif /* COLLECT_AGGREGATE */
+
+    if(is_recent_packet(tc)) {
+      /* This is a duplicate of a packet we recently received, so we
+         just send an ACK. */
+      send_ack(tc, &ack_to, ackflags);
+      stats.duprecv++;
+      return;
     }
 
     /* If we are the sink, the packet has reached its final
@@ -1041,10 +1370,7 @@ node_packet_received(struct unicast_conn *c, const rimeaddr_t *from)
          to ensure that we always have entries for packets that
          are originated by this node. */
       if(packetqueue_len(&tc->send_queue) <= MAX_SENDING_QUEUE - MIN_AVAILABLE_QUEUE_ENTRIES &&
-         packetqueue_enqueue_packetbuf(&tc->send_queue,
-                                       FORWARD_PACKET_LIFETIME_BASE *
-                                       packetbuf_attr(PACKETBUF_ATTR_MAX_REXMIT),
-                                       tc)) {
+         enqueue_packetbuf(tc)) {
         add_packet_to_recent_packets(tc);
         send_ack(tc, &ack_to, ackflags);
         send_queued_packet(tc);
@@ -1282,6 +1608,9 @@ collect_open(struct collect_conn *tc, uint16_t channels,
   tc->seqno = 10;
   tc->eseqno = 0;
   LIST_STRUCT_INIT(tc, send_queue_list);
+#if COLLECT_AGGREGATE
+  tc->aggregate_state = AGGREGATE_IDLE;
+#endif /* COLLECT_AGGREGATE */
   collect_neighbor_list_new(&tc->neighbor_list);
   tc->send_queue.list = &(tc->send_queue_list);
   tc->send_queue.memb = &send_queue_memb;
@@ -1359,6 +1688,9 @@ collect_close(struct collect_conn *tc)
   while(packetqueue_first(&tc->send_queue) != NULL) {
     packetqueue_dequeue(&tc->send_queue);
   }
+#if COLLECT_AGGREGATE
+  ctimer_stop(&tc->aggregate_timer);
+#endif /* COLLECT_AGGREGATE */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -1377,6 +1709,10 @@ collect_set_sink(struct collect_conn *tc, int should_be_sink)
 
     /* Stop the retransmission timer. */
     ctimer_stop(&tc->retransmission_timer);
+#if COLLECT_AGGREGATE
+    ctimer_stop(&tc->aggregate_timer);
+    tc->aggregate_state = AGGREGATE_IDLE;
+#endif /* COLLECT_AGGREGATE */
   } else {
     tc->rtmetric = RTMETRIC_MAX;
   }
@@ -1439,11 +1775,9 @@ collect_send(struct collect_conn *tc, int rexmits)
 
     /* Allocate space for the header. */
     packetbuf_hdralloc(sizeof(struct data_msg_hdr));
+    memset(packetbuf_hdrptr(), 0, sizeof(struct data_msg_hdr));
 
-    if(packetqueue_enqueue_packetbuf(&tc->send_queue,
-                                     FORWARD_PACKET_LIFETIME_BASE *
-                                     packetbuf_attr(PACKETBUF_ATTR_MAX_REXMIT),
-                                     tc)) {
+    if(enqueue_packetbuf(tc)) {
       send_queued_packet(tc);
       ret = 1;
     } else {
@@ -1518,12 +1852,12 @@ collect_purge(struct collect_conn *tc)
 void
 collect_print_stats(void)
 {
-  PRINTF("collect stats foundroute %lu newparent %lu routelost %lu acksent %lu datasent %lu datarecv %lu ackrecv %lu badack %lu duprecv %lu qdrop %lu rtdrop %lu ttldrop %lu ackdrop %lu timedout %lu\n",
+  PRINTF("collect stats foundroute %lu newparent %lu routelost %lu acksent %lu datasent %lu datarecv %lu ackrecv %lu badack %lu duprecv %lu qdrop %lu rtdrop %lu ttldrop %lu ackdrop %lu timedout %lu aggregated %lu\n",
          stats.foundroute, stats.newparent, stats.routelost,
          stats.acksent, stats.datasent, stats.datarecv,
          stats.ackrecv, stats.badack, stats.duprecv,
          stats.qdrop, stats.rtdrop, stats.ttldrop, stats.ackdrop,
-         stats.timedout);
+         stats.timedout, stats.aggregated);
 }
 /*---------------------------------------------------------------------------*/
 /** @} */
@@ -92,6 +92,17 @@ struct collect_callbacks {
 #define COLLECT_ANNOUNCEMENTS COLLECT_CONF_ANNOUNCEMENTS
 #endif /* COLLECT_CONF_ANNOUNCEMENTS */
 
+/* COLLECT_CONF_AGGREGATE defines if data packets that are queued for
+   the parent should be merged into a single frame. A lone packet is
+   then held for a short while, so that packets that arrive after it
+   can be sent along with it. All nodes in the network must use the
+   same setting. */
+#ifdef COLLECT_CONF_AGGREGATE
+#define COLLECT_AGGREGATE COLLECT_CONF_AGGREGATE
+#else /* COLLECT_CONF_AGGREGATE */
+#define COLLECT_AGGREGATE 0
+#endif /* COLLECT_CONF_AGGREGATE */
+
 struct collect_conn {
   struct unicast_conn unicast_conn;
 #if ! COLLECT_ANNOUNCEMENTS
@@ -111,6 +122,11 @@ struct collect_conn {
 
   struct ctimer proactive_probing_timer;
 
+#if COLLECT_AGGREGATE
+  struct ctimer aggregate_timer;
+  uint8_t aggregate_state;
+#endif /* COLLECT_AGGREGATE */
+
   rimeaddr_t parent, current_parent;
   uint16_t rtmetric;
   uint8_t seqno;
@@ -53,6 +53,10 @@ struct rimestats {
     sendingdrop; /* Packet dropped when we were sending a packet */
 
   unsigned long lltx, llrx;
+
+  /* Route table lookups and evictions, and route discoveries */
+  unsigned long routehit, routemiss, routeevict,
+    routediscovery, routefound, routetimedout;
 };
 
 extern struct rimestats rimestats;
@@ -184,6 +184,7 @@ rrep_packet_received(struct unicast_conn *uc, const rimeaddr_t *from)
 
   if(rimeaddr_cmp(&msg->dest, &rimeaddr_node_addr)) {
     PRINTF("rrep for us!\n");
+    RIMESTATS_ADD(routefound);
     rrep_pending = 0;
     ctimer_stop(&c->t);
     if(c->cb->new_route) {
@@ -294,6 +295,7 @@ timeout_handler(void *ptr)
 {
   struct route_discovery_conn *c = ptr;
   PRINTF("route_discovery: timeout, timed out\n");
+  RIMESTATS_ADD(routetimedout);
   rrep_pending = 0;
   if(c->cb->timedout) {
     c->cb->timedout(c);
@@ -310,6 +312,7 @@ route_discovery_discover(struct route_discovery_conn *c, const rimeaddr_t *addr,
   }
 
   PRINTF("route_discovery_send: sending route request\n");
+  RIMESTATS_ADD(routediscovery);
   ctimer_set(&c->t, timeout, timeout_handler, c);
   rrep_pending = 1;
   send_rreq(c, addr);
@@ -43,11 +43,13 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "lib/list.h"
 #include "lib/memb.h"
-#include "sys/ctimer.h"
+#include "sys/clock.h"
 #include "net/rime/route.h"
+#include "net/rime/rimestats.h"
 #include "contiki-conf.h"
 
 #ifdef ROUTE_CONF_ENTRIES
@@ -56,6 +58,13 @@
 #define NUM_RT_ENTRIES 8
 #endif /* ROUTE_CONF_ENTRIES */
 
+/* Number of hash buckets, must be a power of two. */
+#ifdef ROUTE_CONF_HASH_SIZE
+#define HASH_SIZE ROUTE_CONF_HASH_SIZE
+#else /* ROUTE_CONF_HASH_SIZE */
+#define HASH_SIZE 16
+#endif /* ROUTE_CONF_HASH_SIZE */
+
 #ifdef ROUTE_CONF_DECAY_THRESHOLD
 #define DECAY_THRESHOLD ROUTE_CONF_DECAY_THRESHOLD
 #else /* ROUTE_CONF_DECAY_THRESHOLD */
@@ -69,12 +78,13 @@
 #endif /* ROUTE_CONF_DEFAULT_LIFETIME */
 
 /*
- * List of route entries.
+ * List of route entries, newest first. The entries are also hashed
+ * on their destination for lookups.
  */
 LIST(route_table);
 MEMB(route_mem, struct route_entry, NUM_RT_ENTRIES);
 
-static struct ctimer t;
+static struct route_entry *buckets[HASH_SIZE];
 
 static int max_time = DEFAULT_LIFETIME;
 
@@ -88,24 +98,66 @@ static int max_time = DEFAULT_LIFETIME;
 
 
 /*---------------------------------------------------------------------------*/
-static void
-periodic(void *ptr)
+static struct route_entry **
+bucket(const rimeaddr_t *dest)
 {
-  struct route_entry *e;
+  unsigned int h;
+  int i;
 
-  for(e = list_head(route_table); e != NULL; e = list_item_next(e)) {
-    e->time++;
-    if(e->time >= max_time) {
-      PRINTF("route periodic: removing entry to %d.%d with nexthop %d.%d and cost %d\n",
-	     e->dest.u8[0], e->dest.u8[1],
-	     e->nexthop.u8[0], e->nexthop.u8[1],
-	     e->cost);
-      list_remove(route_table, e);
-      memb_free(&route_mem, e);
+  h = 0;
+  for(i = 0; i < sizeof(rimeaddr_t); i++) {
+    h = h * 31 + dest->u8[i];
+  }
+  return &buckets[h & (HASH_SIZE - 1)];
+}
+/*---------------------------------------------------------------------------*/
+static int
+expired(struct route_entry *e)
+{
+  return clock_seconds() - e->time >= (unsigned long)max_time;
+}
+/*---------------------------------------------------------------------------*/
+/* Find the route with the lowest cost, removing expired routes on
+   the way. */
+static struct route_entry *
+find(const rimeaddr_t *dest)
+{
+  struct route_entry *e, *next;
+  uint8_t lowest_cost;
+  struct route_entry *best_entry;
+
+  lowest_cost = -1;
+  best_entry = NULL;
+
+  for(e = *bucket(dest); e != NULL; e = next) {
+    next = e->hnext;
+    if(rimeaddr_cmp(dest, &e->dest)) {
+      if(expired(e)) {
+        PRINTF("route find: removing entry to %d.%d with nexthop %d.%d and cost %d\n",
+               e->dest.u8[0], e->dest.u8[1],
+               e->nexthop.u8[0], e->nexthop.u8[1],
+               e->cost);
+        route_remove(e);
+      } else if(e->cost < lowest_cost) {
+        best_entry = e;
+        lowest_cost = e->cost;
+      }
     }
   }
+  return best_entry;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_expired(void)
+{
+  struct route_entry *e, *next;
 
-  ctimer_set(&t, CLOCK_SECOND, periodic, NULL);
+  for(e = list_head(route_table); e != NULL; e = next) {
+    next = list_item_next(e);
+    if(expired(e)) {
+      route_remove(e);
+    }
+  }
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -113,42 +165,55 @@ route_init(void)
 {
   list_init(route_table);
   memb_init(&route_mem);
-
-  ctimer_set(&t, CLOCK_SECOND, periodic, NULL);
+  memset(buckets, 0, sizeof(buckets));
 }
 /*---------------------------------------------------------------------------*/
 int
 route_add(const rimeaddr_t *dest, const rimeaddr_t *nexthop,
 	  uint8_t cost, uint8_t seqno)
 {
-  struct route_entry *e;
+  struct route_entry *e, *oldest;
 
   /* Avoid inserting duplicate entries. */
-  e = route_lookup(dest);
+  e = find(dest);
   if(e != NULL && rimeaddr_cmp(&e->nexthop, nexthop)) {
-    list_remove(route_table, e);
-  } else {
-    /* Allocate a new entry or reuse the oldest entry with highest cost. */
+    route_remove(e);
+  }
+
+  e = memb_alloc(&route_mem);
+  if(e == NULL) {
+    remove_expired();
     e = memb_alloc(&route_mem);
-    if(e == NULL) {
-      /* Remove oldest entry.  XXX */
-      e = list_chop(route_table);
-      PRINTF("route_add: removing entry to %d.%d with nexthop %d.%d and cost %d\n",
-	     e->dest.u8[0], e->dest.u8[1],
-	     e->nexthop.u8[0], e->nexthop.u8[1],
-	     e->cost);
+  }
+  if(e == NULL) {
+    /* Remove the entry that was refreshed longest ago, the one added
+       first if there are several. */
+    oldest = list_head(route_table);
+    for(e = oldest; e != NULL; e = list_item_next(e)) {
+      if(clock_seconds() - e->time >= clock_seconds() - oldest->time) {
+        oldest = e;
+      }
     }
+    PRINTF("route_add: removing entry to %d.%d with nexthop %d.%d and cost %d\n",
+           oldest->dest.u8[0], oldest->dest.u8[1],
+           oldest->nexthop.u8[0], oldest->nexthop.u8[1],
+           oldest->cost);
+    RIMESTATS_ADD(routeevict);
+    route_remove(oldest);
+    e = memb_alloc(&route_mem);
   }
 
   rimeaddr_copy(&e->dest, dest);
   rimeaddr_copy(&e->nexthop, nexthop);
   e->cost = cost;
   e->seqno = seqno;
-  e->time = 0;
+  e->time = clock_seconds();
   e->decay = 0;
 
   /* New entry goes first. */
   list_push(route_table, e);
+  e->hnext = *bucket(dest);
+  *bucket(dest) = e;
 
   PRINTF("route_add: new entry to %d.%d with nexthop %d.%d and cost %d\n",
 	 e->dest.u8[0], e->dest.u8[1],
@@ -162,25 +227,14 @@ struct route_entry *
 route_lookup(const rimeaddr_t *dest)
 {
   struct route_entry *e;
-  uint8_t lowest_cost;
-  struct route_entry *best_entry;
-
-  lowest_cost = -1;
-  best_entry = NULL;
-  
-  /* Find the route with the lowest cost. */
-  for(e = list_head(route_table); e != NULL; e = list_item_next(e)) {
-    /*    printf("route_lookup: comparing %d.%d.%d.%d with %d.%d.%d.%d\n",
-	   uip_ipaddr_to_quad(dest), uip_ipaddr_to_quad(&e->dest));*/
 
-    if(rimeaddr_cmp(dest, &e->dest)) {
-      if(e->cost < lowest_cost) {
-	best_entry = e;
-	lowest_cost = e->cost;
-      }
-    }
+  e = find(dest);
+  if(e != NULL) {
+    RIMESTATS_ADD(routehit);
+  } else {
+    RIMESTATS_ADD(routemiss);
   }
-  return best_entry;
+  return e;
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -189,10 +243,10 @@ route_refresh(struct route_entry *e)
   if(e != NULL) {
     /* Refresh age of route so that used routes do not get thrown
        out. */
-    e->time = 0;
+    e->time = clock_seconds();
     e->decay = 0;
     
-    PRINTF("route_refresh: time %d last %d decay %d for entry to %d.%d with nexthop %d.%d and cost %d\n",
+    PRINTF("route_refresh: time %lu last %d decay %d for entry to %d.%d with nexthop %d.%d and cost %d\n",
            e->time, e->time_last_decay, e->decay,
            e->dest.u8[0], e->dest.u8[1],
            e->nexthop.u8[0], e->nexthop.u8[1],
@@ -207,15 +261,15 @@ route_decay(struct route_entry *e)
   /* If routes are not refreshed, they decay over time. This function
      is called to decay a route. The route can only be decayed once
      per second. */
-  PRINTF("route_decay: time %d last %d decay %d for entry to %d.%d with nexthop %d.%d and cost %d\n",
+  PRINTF("route_decay: time %lu last %d decay %d for entry to %d.%d with nexthop %d.%d and cost %d\n",
 	 e->time, e->time_last_decay, e->decay,
 	 e->dest.u8[0], e->dest.u8[1],
 	 e->nexthop.u8[0], e->nexthop.u8[1],
 	 e->cost);
   
-  if(e->time != e->time_last_decay) {
+  if((uint8_t)clock_seconds() != e->time_last_decay) {
     /* Do not decay a route too often - not more than once per second. */
-    e->time_last_decay = e->time;
+    e->time_last_decay = clock_seconds();
     e->decay++;
 
     if(e->decay >= DECAY_THRESHOLD) {
@@ -231,6 +285,14 @@ route_decay(struct route_entry *e)
 void
 route_remove(struct route_entry *e)
 {
+  struct route_entry **p;
+
+  for(p = bucket(&e->dest); *p != NULL; p = &(*p)->hnext) {
+    if(*p == e) {
+      *p = e->hnext;
+      break;
+    }
+  }
   list_remove(route_table, e);
   memb_free(&route_mem, e);
 }
@@ -248,6 +310,7 @@ route_flush_all(void)
       break;
     }
   }
+  memset(buckets, 0, sizeof(buckets));
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -262,6 +325,8 @@ route_num(void)
   struct route_entry *e;
   int i = 0;
 
+  remove_expired();
+
   for(e = list_head(route_table); e != NULL; e = list_item_next(e)) {
     i++;
   }
@@ -55,11 +55,15 @@
 
 struct route_entry {
   struct route_entry *next;
+  /* Next entry in the same hash bucket. */
+  struct route_entry *hnext;
   rimeaddr_t dest;
   rimeaddr_t nexthop;
   uint8_t seqno;
   uint8_t cost;
-  uint8_t time;
+  /* clock_seconds() when the route was added or last refreshed. The
+     route expires when it is looked up after its lifetime. */
+  unsigned long time;
 
   uint8_t decay;
   uint8_t time_last_decay;
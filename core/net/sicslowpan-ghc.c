@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Generic Header Compression (RFC 7400) of ICMPv6 messages.
+ *
+ *         The message is coded as literals, runs of zeroes and back
+ *         references into the bytes that were already output. The
+ *         output starts out with a dictionary of the source and
+ *         destination addresses and 16 static bytes, so that the
+ *         addresses and prefixes repeated in RPL and ND messages
+ *         become back references.
+ */
+
+#include "contiki.h"
+#include "net/uip.h"
+#include "net/sicslowpan-ghc.h"
+
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+/* Source and destination address, then the static dictionary */
+#define DICT_LEN        48
+#define ADDRS_LEN       32
+
+#define MAX_LITERAL     95
+#define MAX_ZEROES      17
+
+static const uint8_t static_dict[DICT_LEN - ADDRS_LEN] = {
+  0x16, 0xfe, 0xfd, 0x17, 0xfe, 0xfd, 0x00, 0x01,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00
+};
+
+static struct sicslowpan_ghc_stats stats[SICSLOWPAN_GHC_STATS];
+/*---------------------------------------------------------------------------*/
+/* Byte i of the dictionary followed by the data */
+static uint8_t
+byte_at(const uint8_t *addrs, const uint8_t *data, int i)
+{
+  if(i < ADDRS_LEN) {
+    return addrs[i];
+  } else if(i < DICT_LEN) {
+    return static_dict[i - ADDRS_LEN];
+  }
+  return data[i - DICT_LEN];
+}
+/*---------------------------------------------------------------------------*/
+static void
+count(uint8_t type, uint8_t code, uint16_t uncompressed, uint16_t compressed)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_GHC_STATS; i++) {
+    if(stats[i].messages == 0) {
+      stats[i].type = type;
+      stats[i].code = code;
+    }
+    if(stats[i].type == type && stats[i].code == code) {
+      stats[i].messages++;
+      stats[i].uncompressed += uncompressed;
+      stats[i].compressed += compressed;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Number of extension bytecodes needed for a back reference */
+static int
+extensions(int n, int d)
+{
+  int sa, na;
+
+  sa = (d - n) >> 3;
+  na = (n - 2) >> 3;
+  sa = (sa + 14) / 15;
+  return sa > na ? sa : na;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_compressable(uint8_t next_header)
+{
+  return next_header == UIP_PROTO_ICMP6;
+}
+/*---------------------------------------------------------------------------*/
+/* Output the lit bytes before data as literals */
+static uint8_t *
+literal(uint8_t *out, const uint8_t *end, const uint8_t *data, int lit)
+{
+  if(lit > 0) {
+    if(out + 1 + lit > end) {
+      return NULL;
+    }
+    *out++ = lit;
+    memcpy(out, data - lit, lit);
+    out += lit;
+  }
+  return out;
+}
+/*---------------------------------------------------------------------------*/
+static int
+compress(uint8_t *compressed, int max, uint8_t *uncompressed_len)
+{
+  const uint8_t *addrs, *data;
+  uint8_t *out, *end;
+  int len, i, lit, z, n, start, best_n, best_d, sa, na;
+
+  if(*uncompressed_len != UIP_IPH_LEN || uip_len > 255) {
+    return 0;
+  }
+  addrs = UIP_IP_BUF->srcipaddr.u8;
+  data = (uint8_t *)UIP_IP_BUF + UIP_IPH_LEN;
+  len = uip_len - UIP_IPH_LEN;
+  if(len < 4 || max < 2) {
+    return 0;
+  }
+
+  out = compressed;
+  end = compressed + max;
+  *out++ = SICSLOWPAN_NHC_GHC_ICMP6;
+
+  lit = 0;
+  i = 0;
+  while(i < len && out != NULL) {
+    for(z = 0; i + z < len && z < MAX_ZEROES && data[i + z] == 0; z++);
+
+    /* Longest back reference that does not overlap the current
+       position, the closest one if there are several */
+    best_n = best_d = 0;
+    for(start = DICT_LEN + i - 2; start >= 0; start--) {
+      for(n = 0; i + n < len && start + n < DICT_LEN + i &&
+            byte_at(addrs, data, start + n) == data[i + n]; n++);
+      if(n > best_n) {
+        best_n = n;
+        best_d = DICT_LEN + i - start;
+      }
+    }
+
+    if(z < 2 && (best_n < 2 || 1 + extensions(best_n, best_d) >= best_n)) {
+      lit++;
+      i++;
+      if(lit == MAX_LITERAL) {
+        out = literal(out, end, &data[i], lit);
+        lit = 0;
+      }
+      continue;
+    }
+
+    out = literal(out, end, &data[i], lit);
+    lit = 0;
+    if(out == NULL) {
+      break;
+    }
+    if(z >= 2 && z >= best_n) {
+      if(out + 1 > end) {
+        out = NULL;
+        break;
+      }
+      *out++ = 0x80 | (z - 2);
+      i += z;
+    } else {
+      if(out + 1 + extensions(best_n, best_d) > end) {
+        out = NULL;
+        break;
+      }
+      sa = (best_d - best_n) >> 3;
+      na = (best_n - 2) >> 3;
+      while(sa > 0 || na > 0) {
+        n = sa > 15 ? 15 : sa;
+        *out++ = 0xa0 | (na > 0 ? 0x10 : 0) | n;
+        sa -= n;
+        if(na > 0) {
+          na--;
+        }
+      }
+      *out++ = 0xc0 | (((best_n - 2) & 7) << 3) | ((best_d - best_n) & 7);
+      i += best_n;
+    }
+  }
+  if(out != NULL) {
+    out = literal(out, end, &data[i], lit);
+  }
+
+  /* The NHC byte takes the place of the inline next header */
+  n = out != NULL ? out - compressed : len + 1;
+  count(data[0], data[1], len, n > len ? len : n - 1);
+  if(n > len) {
+    PRINTF("GHC: %d bytes would not get smaller\n", len);
+    return 0;
+  }
+  PRINTF("GHC: compressed %d bytes to %d\n", len, n - 1);
+  *uncompressed_len += len;
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static int
+uncompress(uint8_t *compressed, int len, uint8_t *lowpanbuf,
+           uint8_t *uncompressed_len)
+{
+  struct uip_ip_hdr *ip;
+  uint8_t *in, *end, *out;
+  int max, o, k, n, s, sa, na;
+
+  if(len < 1 || *compressed != SICSLOWPAN_NHC_GHC_ICMP6) {
+    PRINTF("GHC: unknown next header 0x%02x\n", *compressed);
+    return -1;
+  }
+
+  ip = (struct uip_ip_hdr *)&lowpanbuf[UIP_LLH_LEN];
+  ip->proto = UIP_PROTO_ICMP6;
+  out = &lowpanbuf[UIP_LLH_LEN + *uncompressed_len];
+  max = UIP_BUFSIZE - UIP_LLH_LEN - *uncompressed_len;
+  if(max > 255 - *uncompressed_len) {
+    max = 255 - *uncompressed_len;
+  }
+
+  in = compressed + 1;
+  end = compressed + len;
+  o = sa = na = 0;
+  while(in < end) {
+    k = *in++;
+    if(k < 0x60) {
+      /* literal */
+      if(in + k > end || o + k > max) {
+        return -1;
+      }
+      memcpy(&out[o], in, k);
+      in += k;
+      o += k;
+    } else if((k & 0xf0) == 0x80) {
+      /* zeroes */
+      n = (k & 0x0f) + 2;
+      if(o + n > max) {
+        return -1;
+      }
+      memset(&out[o], 0, n);
+      o += n;
+    } else if(k == SICSLOWPAN_GHC_STOP) {
+      break;
+    } else if((k & 0xe0) == 0xa0) {
+      /* extension of the next back reference */
+      sa += (k & 0x0f) << 3;
+      na += (k & 0x10) >> 1;
+    } else if((k & 0xc0) == 0xc0) {
+      /* back reference */
+      n = na + ((k >> 3) & 7) + 2;
+      s = (k & 7) + sa + n;
+      sa = na = 0;
+      if(s > DICT_LEN + o || o + n > max) {
+        return -1;
+      }
+      for(; n > 0; n--, o++) {
+        out[o] = byte_at(ip->srcipaddr.u8, out, DICT_LEN + o - s);
+      }
+    } else {
+      PRINTF("GHC: reserved bytecode 0x%02x\n", k);
+      return -1;
+    }
+  }
+
+  *uncompressed_len += o;
+  return in - compressed;
+}
+/*---------------------------------------------------------------------------*/
+const struct sicslowpan_ghc_stats *
+sicslowpan_ghc_stats(int i)
+{
+  if(i < 0 || i >= SICSLOWPAN_GHC_STATS || stats[i].messages == 0) {
+    return NULL;
+  }
+  return &stats[i];
+}
+/*---------------------------------------------------------------------------*/
+void
+sicslowpan_ghc_stats_reset(void)
+{
+  memset(stats, 0, sizeof(stats));
+}
+/*---------------------------------------------------------------------------*/
+struct sicslowpan_nh_compressor sicslowpan_ghc = {
+  is_compressable,
+  compress,
+  uncompress
+};
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Generic Header Compression (RFC 7400) of ICMPv6 messages,
+ *         as a sicslowpan next header compressor. Enable it with
+ *         #define SICSLOWPAN_NH_COMPRESSOR sicslowpan_ghc
+ */
+
+#ifndef __SICSLOWPAN_GHC_H__
+#define __SICSLOWPAN_GHC_H__
+
+#include "net/sicslowpan.h"
+
+/** NHC dispatch of a GHC compressed ICMPv6 message */
+#define SICSLOWPAN_NHC_GHC_ICMP6       0xDF
+
+/** Bytecodes */
+#define SICSLOWPAN_GHC_STOP            0x90
+
+/** Number of message types that are counted */
+#ifdef SICSLOWPAN_GHC_CONF_STATS
+#define SICSLOWPAN_GHC_STATS SICSLOWPAN_GHC_CONF_STATS
+#else
+#define SICSLOWPAN_GHC_STATS 8
+#endif
+
+/** Bytes sent per ICMPv6 message type and code */
+struct sicslowpan_ghc_stats {
+  uint8_t type;
+  uint8_t code;
+  uint16_t messages;
+  uint32_t uncompressed;
+  uint32_t compressed;
+};
+
+extern struct sicslowpan_nh_compressor sicslowpan_ghc;
+
+/**
+ * \brief Get the counters of a message type
+ * \param i Index, from 0
+ * \return The counters, or NULL after the last type seen
+ *
+ * Messages that were not compressed because they would not get
+ * smaller are counted with the same size before and after.
+ */
+const struct sicslowpan_ghc_stats *sicslowpan_ghc_stats(int i);
+
+void sicslowpan_ghc_stats_reset(void);
+
+#endif /* __SICSLOWPAN_GHC_H__ */
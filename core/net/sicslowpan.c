@@ -67,6 +67,7 @@
 #include "net/sicslowpan.h"
 #include "net/neighbor-info.h"
 #include "net/netstack.h"
+#include "sys/profile.h"
 
 #define DEBUG 0
 #if DEBUG
@@ -368,16 +369,43 @@ dummy()
 /** \name HC06 related functions
  * @{                                                                 */
 /*--------------------------------------------------------------------*/
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > SICSLOWPAN_CONTEXT_MAX
+#error SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS can be at most 16
+#endif
+/*--------------------------------------------------------------------*/
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
+/* Check the lifetime of a context. A context that expires is kept for
+   decompression only for a while, and is then removed. Returns
+   non-zero if the context is still in use. */
+static uint8_t
+context_alive(struct sicslowpan_addr_context *c)
+{
+  if(c->isinfinite || !stimer_expired(&c->lifetime)) {
+    return 1;
+  }
+  if(c->compress) {
+    PRINTF("IPHC: context %u expired, decompression only\n", c->number);
+    c->compress = 0;
+    stimer_set(&c->lifetime, SICSLOWPAN_CONTEXT_DECOMPRESS_TIME);
+    return 1;
+  }
+  PRINTF("IPHC: context %u removed\n", c->number);
+  c->used = 0;
+  return 0;
+}
+#endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 */
+/*--------------------------------------------------------------------*/
 /** \brief find the context corresponding to prefix ipaddr */
 static struct sicslowpan_addr_context*
-addr_context_lookup_by_prefix(uip_ipaddr_t *ipaddr)
+addr_context_lookup_by_prefix(const uint8_t *prefix)
 {
 /* Remove code to avoid warnings and save flash if no context is used */
 #if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
   int i;
   for(i = 0; i < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS; i++) {
-    if((addr_contexts[i].used == 1) &&
-       uip_ipaddr_prefixcmp(&addr_contexts[i].prefix, ipaddr, 64)) {
+    if(addr_contexts[i].used == 1 && addr_contexts[i].compress &&
+       memcmp(addr_contexts[i].prefix, prefix, 8) == 0 &&
+       context_alive(&addr_contexts[i]) && addr_contexts[i].compress) {
       return &addr_contexts[i];
     }
   }
@@ -395,13 +423,104 @@ addr_context_lookup_by_number(uint8_t number)
   for(i = 0; i < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS; i++) {
     if((addr_contexts[i].used == 1) &&
        addr_contexts[i].number == number) {
-      return &addr_contexts[i];
+      return context_alive(&addr_contexts[i]) ? &addr_contexts[i] : NULL;
     }
   }
 #endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 */
   return NULL;
 }
 /*--------------------------------------------------------------------*/
+struct sicslowpan_addr_context *
+sicslowpan_context_lookup(uint8_t number)
+{
+  return addr_context_lookup_by_number(number);
+}
+/*--------------------------------------------------------------------*/
+int
+sicslowpan_context_set(uint8_t number, const uint8_t *prefix,
+                       uint8_t compress, unsigned long lifetime)
+{
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
+  struct sicslowpan_addr_context *c, *free;
+  int i;
+
+  if(number >= SICSLOWPAN_CONTEXT_MAX) {
+    return 0;
+  }
+
+  c = free = NULL;
+  for(i = 0; i < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS; i++) {
+    if(addr_contexts[i].used == 1 && addr_contexts[i].number == number) {
+      c = &addr_contexts[i];
+      break;
+    } else if(free == NULL && (addr_contexts[i].used == 0 ||
+                               !context_alive(&addr_contexts[i]))) {
+      free = &addr_contexts[i];
+    }
+  }
+
+  if(lifetime == 0) {
+    if(c != NULL) {
+      PRINTF("IPHC: removing context %u\n", number);
+      c->used = 0;
+    }
+    return 1;
+  }
+
+  if(c == NULL) {
+    if(free == NULL) {
+      PRINTF("IPHC: no room for context %u\n", number);
+      return 0;
+    }
+    c = free;
+    c->used = 1;
+    c->number = number;
+    c->nh_compress = 0;
+  }
+  memcpy(c->prefix, prefix, 8);
+  c->compress = compress;
+  if(lifetime == SICSLOWPAN_CONTEXT_INFINITE_LIFETIME) {
+    c->isinfinite = 1;
+  } else {
+    c->isinfinite = 0;
+    stimer_set(&c->lifetime, lifetime);
+  }
+  PRINTF("IPHC: context %u set, compress %u lifetime %lu\n",
+         number, compress, lifetime);
+  return 1;
+#else /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 */
+  return 0;
+#endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 */
+}
+/*--------------------------------------------------------------------*/
+void
+sicslowpan_context_set_nh_compress(uint8_t number, uint8_t on)
+{
+  struct sicslowpan_addr_context *c;
+
+  c = addr_context_lookup_by_number(number);
+  if(c != NULL) {
+    c->nh_compress = on;
+  }
+}
+/*--------------------------------------------------------------------*/
+#ifdef SICSLOWPAN_NH_COMPRESSOR
+/* Whether the destination of the packet in uip_buf can decode the
+   next header compressor. dstctx is the context of the destination. */
+static uint8_t
+nh_compress_allowed(struct sicslowpan_addr_context *dstctx)
+{
+  if(dstctx != NULL) {
+    return dstctx->nh_compress;
+  }
+  /* link-local unicast and link-local scope multicast */
+  return SICSLOWPAN_NH_COMPRESS_DEFAULT &&
+    (uip_is_addr_link_local(&UIP_IP_BUF->destipaddr) ||
+     (uip_is_addr_mcast(&UIP_IP_BUF->destipaddr) &&
+      (UIP_IP_BUF->destipaddr.u8[1] & 0x0f) == 2));
+}
+#endif /* SICSLOWPAN_NH_COMPRESSOR */
+/*--------------------------------------------------------------------*/
 static uint8_t
 compress_addr_64(uint8_t bitpos, uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr)
 {
@@ -501,6 +620,11 @@ static void
 compress_hdr_hc06(rimeaddr_t *rime_destaddr)
 {
   uint8_t tmp, iphc0, iphc1;
+  struct sicslowpan_addr_context *srcctx, *dstctx;
+#ifdef SICSLOWPAN_NH_COMPRESSOR
+  uint8_t *nh_ptr = NULL;
+  int nh_len;
+#endif
 #if DEBUG
   { uint16_t ndx;
     PRINTF("before compression (%d): ", UIP_IP_BUF->len[1]);
@@ -531,14 +655,28 @@ compress_hdr_hc06(rimeaddr_t *rime_destaddr)
    */
 
 
-  /* check if dest context exists (for allocating third byte) */
-  /* TODO: fix this so that it remembers the looked up values for
-     avoiding two lookups - or set the lookup values immediately */
-  if(addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr) != NULL ||
-     addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr) != NULL) {
+  /* look up the contexts once, they decide on the third byte */
+  srcctx = NULL;
+  if(!uip_is_addr_unspecified(&UIP_IP_BUF->srcipaddr)) {
+    srcctx = addr_context_lookup_by_prefix(UIP_IP_BUF->srcipaddr.u8);
+  }
+  dstctx = NULL;
+  if(!uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
+    dstctx = addr_context_lookup_by_prefix(UIP_IP_BUF->destipaddr.u8);
+  } else if(sicslowpan_is_mcast_addr_prefix_based(&UIP_IP_BUF->destipaddr)) {
+    /* unicast-prefix-based multicast, the prefix is at byte 4. None of
+       the stateless forms apply to these. */
+    dstctx = addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr.u8[4]);
+  }
+
+  /* context 0 is implied when CID is not set */
+  if((srcctx != NULL && srcctx->number != 0) ||
+     (dstctx != NULL && dstctx->number != 0)) {
     /* set context flag and increase hc06_ptr */
     PRINTF("IPHC: compressing dest or src ipaddr - setting CID\n");
     iphc1 |= SICSLOWPAN_IPHC_CID;
+    RIME_IPHC_BUF[2] = ((srcctx != NULL ? srcctx->number : 0) << 4) |
+      (dstctx != NULL ? dstctx->number : 0);
     hc06_ptr++;
   }
 
@@ -593,12 +731,10 @@ compress_hdr_hc06(rimeaddr_t *rime_destaddr)
     iphc0 |= SICSLOWPAN_IPHC_NH_C;
   }
 #endif /*UIP_CONF_UDP*/
-#ifdef SICSLOWPAN_NH_COMPRESSOR 
-  if(SICSLOWPAN_NH_COMPRESSOR.is_compressable(UIP_IP_BUF->proto)) {
-    iphc0 |= SICSLOWPAN_IPHC_NH_C;
-  }
-#endif
   if ((iphc0 & SICSLOWPAN_IPHC_NH_C) == 0) {
+#ifdef SICSLOWPAN_NH_COMPRESSOR
+    nh_ptr = hc06_ptr;
+#endif
     *hc06_ptr = UIP_IP_BUF->proto;
     hc06_ptr += 1;
   }
@@ -631,13 +767,11 @@ compress_hdr_hc06(rimeaddr_t *rime_destaddr)
     PRINTF("IPHC: compressing unspecified - setting SAC\n");
     iphc1 |= SICSLOWPAN_IPHC_SAC;
     iphc1 |= SICSLOWPAN_IPHC_SAM_00;
-  } else if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr))
-     != NULL) {
+  } else if(srcctx != NULL) {
     /* elide the prefix - indicate by CID and set context + SAC */
-    PRINTF("IPHC: compressing src with context - setting CID & SAC ctx: %d\n",
-	   context->number);
-    iphc1 |= SICSLOWPAN_IPHC_CID | SICSLOWPAN_IPHC_SAC;
-    RIME_IPHC_BUF[2] |= context->number << 4;
+    PRINTF("IPHC: compressing src with context - setting SAC ctx: %d\n",
+	   srcctx->number);
+    iphc1 |= SICSLOWPAN_IPHC_SAC;
     /* compession compare with this nodes address (source) */
 
     iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
@@ -677,6 +811,13 @@ compress_hdr_hc06(rimeaddr_t *rime_destaddr)
       *hc06_ptr = UIP_IP_BUF->destipaddr.u8[1];
       memcpy(hc06_ptr + 1, &UIP_IP_BUF->destipaddr.u8[11], 5);
       hc06_ptr += 6;
+    } else if(dstctx != NULL) {
+      /* flags, scope, reserved and group id - prefix from context */
+      iphc1 |= SICSLOWPAN_IPHC_DAC | SICSLOWPAN_IPHC_DAM_00;
+      hc06_ptr[0] = UIP_IP_BUF->destipaddr.u8[1];
+      hc06_ptr[1] = UIP_IP_BUF->destipaddr.u8[2];
+      memcpy(hc06_ptr + 2, &UIP_IP_BUF->destipaddr.u8[12], 4);
+      hc06_ptr += 6;
     } else {
       iphc1 |= SICSLOWPAN_IPHC_DAM_00;
       /* full address */
@@ -685,10 +826,9 @@ compress_hdr_hc06(rimeaddr_t *rime_destaddr)
     }
   } else {
     /* Address is unicast, try to compress */
-    if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr)) != NULL) {
+    if(dstctx != NULL) {
       /* elide the prefix */
       iphc1 |= SICSLOWPAN_IPHC_DAC;
-      RIME_IPHC_BUF[2] |= context->number;
       /* compession compare with link adress (destination) */
 
       iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
@@ -762,8 +902,19 @@ compress_hdr_hc06(rimeaddr_t *rime_destaddr)
 #endif /*UIP_CONF_UDP*/
 
 #ifdef SICSLOWPAN_NH_COMPRESSOR
-  /* if nothing to compress just return zero  */
-  hc06_ptr += SICSLOWPAN_NH_COMPRESSOR.compress(hc06_ptr, &uncomp_hdr_len);
+  /* The next header stays inline unless the compressor can fit the
+     rest of the packet in this frame. If it can, the inline next
+     header byte is removed. */
+  if(nh_ptr != NULL && nh_compress_allowed(dstctx) &&
+     SICSLOWPAN_NH_COMPRESSOR.is_compressable(UIP_IP_BUF->proto)) {
+    nh_len = SICSLOWPAN_NH_COMPRESSOR.compress(hc06_ptr,
+                 MAC_MAX_PAYLOAD - (hc06_ptr - rime_ptr) + 1, &uncomp_hdr_len);
+    if(nh_len > 0) {
+      memmove(nh_ptr, nh_ptr + 1, hc06_ptr + nh_len - nh_ptr - 1);
+      hc06_ptr += nh_len - 1;
+      iphc0 |= SICSLOWPAN_IPHC_NH_C;
+    }
+  }
 #endif
 
   /* before the rime_hdr_len operation */
@@ -896,7 +1047,22 @@ uncompress_hdr_hc06(uint16_t ip_len)
   if(iphc1 & SICSLOWPAN_IPHC_M) {
     /* context based multicast compression */
     if(iphc1 & SICSLOWPAN_IPHC_DAC) {
-      /* TODO: implement this */
+      /* DAM_00: 48 bits FFXX:XX64:<prefix>:XXXX:XXXX, other modes are
+         reserved */
+      uint8_t dci = (iphc1 & SICSLOWPAN_IPHC_CID) ?
+	RIME_IPHC_BUF[2] & 0x0f : 0;
+      context = addr_context_lookup_by_number(dci);
+      if(tmp != 0 || context == NULL) {
+	PRINTF("sicslowpan uncompress_hdr: error context not found\n");
+	return;
+      }
+      SICSLOWPAN_IP_BUF->destipaddr.u8[0] = 0xff;
+      SICSLOWPAN_IP_BUF->destipaddr.u8[1] = hc06_ptr[0];
+      SICSLOWPAN_IP_BUF->destipaddr.u8[2] = hc06_ptr[1];
+      SICSLOWPAN_IP_BUF->destipaddr.u8[3] = 64;
+      memcpy(&SICSLOWPAN_IP_BUF->destipaddr.u8[4], context->prefix, 8);
+      memcpy(&SICSLOWPAN_IP_BUF->destipaddr.u8[12], hc06_ptr + 2, 4);
+      hc06_ptr += 6;
     } else {
       /* non-context based multicast compression - */
       /* DAM_00: 128 bits  */
@@ -1002,7 +1168,15 @@ uncompress_hdr_hc06(uint16_t ip_len)
     }
 #ifdef SICSLOWPAN_NH_COMPRESSOR
     else {
-      hc06_ptr += SICSLOWPAN_NH_COMPRESSOR.uncompress(hc06_ptr, sicslowpan_buf, &uncomp_hdr_len);
+      int nh_len;
+      nh_len = SICSLOWPAN_NH_COMPRESSOR.uncompress(hc06_ptr,
+                   packetbuf_datalen() - (hc06_ptr - rime_ptr),
+                   sicslowpan_buf, &uncomp_hdr_len);
+      if(nh_len < 0) {
+        PRINTF("sicslowpan uncompress_hdr: error in next header\n");
+        return;
+      }
+      hc06_ptr += nh_len;
     }
 #endif
   }
@@ -1028,6 +1202,26 @@ uncompress_hdr_hc06(uint16_t ip_len)
   return;
 }
 /** @} */
+#else /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
+/*--------------------------------------------------------------------*/
+/* Only HC06 uses contexts */
+struct sicslowpan_addr_context *
+sicslowpan_context_lookup(uint8_t number)
+{
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+int
+sicslowpan_context_set(uint8_t number, const uint8_t *prefix,
+                       uint8_t compress, unsigned long lifetime)
+{
+  return 0;
+}
+/*--------------------------------------------------------------------*/
+void
+sicslowpan_context_set_nh_compress(uint8_t number, uint8_t on)
+{
+}
 #endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
 
 
@@ -1558,6 +1752,7 @@ output(uip_lladdr_t *localdest)
 }
 
 /*--------------------------------------------------------------------*/
+PROFILE_PROBE(sicslowpan_input);
 /** \brief Process a received 6lowpan packet.
  *  \param r The MAC layer
  *
@@ -1587,6 +1782,8 @@ input(void)
   last_fragment = 0;
 #endif /*SICSLOWPAN_CONF_FRAG*/
 
+  PROFILE_PROBE_BEGIN(sicslowpan_input);
+
   /* init */
   uncomp_hdr_len = 0;
   rime_hdr_len = 0;
@@ -1657,6 +1854,7 @@ input(void)
        * being reassembled or the packet is not a fragment.
        */
       PRINTFI("sicslowpan input: Dropping 6lowpan packet that is not a fragment of the packet currently being reassembled\n");
+      PROFILE_PROBE_END(sicslowpan_input);
       return;
     }
   } else {
@@ -1711,6 +1909,7 @@ input(void)
       /* unknown header */
       PRINTFI("sicslowpan input: unknown dispatch: %u\n",
              RIME_HC1_PTR[RIME_HC1_DISPATCH]);
+      PROFILE_PROBE_END(sicslowpan_input);
       return;
   }
    
@@ -1727,6 +1926,7 @@ input(void)
    */
   if(packetbuf_datalen() < rime_hdr_len) {
     PRINTF("SICSLOWPAN: packet dropped due to header > total packet\n");
+    PROFILE_PROBE_END(sicslowpan_input);
     return;
   }
   rime_payload_len = packetbuf_datalen() - rime_hdr_len;
@@ -1796,6 +1996,7 @@ input(void)
 #if SICSLOWPAN_CONF_FRAG
   }
 #endif /* SICSLOWPAN_CONF_FRAG */
+  PROFILE_PROBE_END(sicslowpan_input);
 }
 /** @} */
 
@@ -1854,6 +2055,19 @@ sicslowpan_init(void)
   }
 #endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 1 */
 
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
+  /* Configured contexts never expire, learned ones are added with
+     sicslowpan_context_set() */
+  {
+    int i;
+    for(i = 0; i < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS; i++) {
+      addr_contexts[i].compress = 1;
+      addr_contexts[i].isinfinite = 1;
+      addr_contexts[i].nh_compress = SICSLOWPAN_NH_COMPRESS_DEFAULT;
+    }
+  }
+#endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 */
+
 #endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
 }
 /*--------------------------------------------------------------------*/
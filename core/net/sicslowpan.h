@@ -49,6 +49,7 @@
 #define __SICSLOWPAN_H__
 #include "net/uip.h"
 #include "net/mac/mac.h"
+#include "sys/stimer.h"
 
 /**
  * \name General sicslowpan defines
@@ -216,13 +217,67 @@
 /**
  * \brief An address context for IPHC address compression
  * each context can have upto 8 bytes
+ *
+ * Contexts are either configured statically (see
+ * SICSLOWPAN_CONF_ADDR_CONTEXT_0) or learned from 6CO options in
+ * Router Advertisements. A learned context is used for compression
+ * until its lifetime expires, and for decompression only during
+ * SICSLOWPAN_CONTEXT_DECOMPRESS_TIME seconds after that.
  */
 struct sicslowpan_addr_context {
   uint8_t used; /* possibly use as prefix-length */
   uint8_t number;
   uint8_t prefix[8];
+  uint8_t compress;
+  uint8_t isinfinite;
+  uint8_t nh_compress; /* peers can decode SICSLOWPAN_NH_COMPRESSOR */
+  struct stimer lifetime;
 };
 
+/** Context numbers are four bits wide. */
+#define SICSLOWPAN_CONTEXT_MAX 16
+
+#ifdef SICSLOWPAN_CONF_CONTEXT_DECOMPRESS_TIME
+#define SICSLOWPAN_CONTEXT_DECOMPRESS_TIME SICSLOWPAN_CONF_CONTEXT_DECOMPRESS_TIME
+#else
+#define SICSLOWPAN_CONTEXT_DECOMPRESS_TIME 300
+#endif
+
+#define SICSLOWPAN_CONTEXT_INFINITE_LIFETIME 0xffffffff
+
+/**
+ * \brief Add or update an address context
+ * \param number The context number, 0 to 15
+ * \param prefix The 64 bit prefix of the context
+ * \param compress Non-zero if the context may be used for compression
+ * \param lifetime Lifetime in seconds, or
+ *        SICSLOWPAN_CONTEXT_INFINITE_LIFETIME. A lifetime of 0 removes
+ *        the context.
+ * \return Non-zero if the context was stored
+ */
+int sicslowpan_context_set(uint8_t number, const uint8_t *prefix,
+                           uint8_t compress, unsigned long lifetime);
+
+/** \brief Get the context with the given number, or NULL */
+struct sicslowpan_addr_context *sicslowpan_context_lookup(uint8_t number);
+
+/**
+ * Whether the next header compressor is used for destinations that
+ * are link-local or covered by a configured context. For learned
+ * contexts, this is set with sicslowpan_context_set_nh_compress().
+ */
+#ifdef SICSLOWPAN_CONF_NH_COMPRESS_DEFAULT
+#define SICSLOWPAN_NH_COMPRESS_DEFAULT SICSLOWPAN_CONF_NH_COMPRESS_DEFAULT
+#else
+#define SICSLOWPAN_NH_COMPRESS_DEFAULT 1
+#endif
+
+/**
+ * \brief Set whether nodes using a context can decode payloads
+ * compressed by SICSLOWPAN_NH_COMPRESSOR
+ */
+void sicslowpan_context_set_nh_compress(uint8_t number, uint8_t on);
+
 /**
  * \name Address compressibility test functions
  * @{
@@ -286,6 +341,12 @@ struct sicslowpan_addr_context {
    (((a)->u16[5]) == 0) &&                       \
    (((a)->u8[12]) == 0))
 
+/* FFXX:XX40:PPPP:PPPP:PPPP:PPPP:XXXX:XXXX, unicast-prefix based
+   (RFC 3306) with a 64 bit prefix */
+#define sicslowpan_is_mcast_addr_prefix_based(a) \
+  (((((a)->u8[1]) & 0x30) == 0x30) &&             \
+   (((a)->u8[3]) == 64))
+
 /* FF02::00XX */
 #define sicslowpan_is_mcast_addr_compressable8(a) \
   ((((a)->u8[1]) == 2) &&                        \
@@ -300,20 +361,28 @@ struct sicslowpan_addr_context {
 /** @} */
 
 /**
- * The structure of a next header compressor.
+ * The structure of a next header compressor. It is plugged in by
+ * defining SICSLOWPAN_NH_COMPRESSOR to the name of the structure, and
+ * is tried on next headers that IPHC does not compress itself. The
+ * compressed next header and everything after it must fit in the
+ * frame, so it is only used on packets that need no fragmentation.
  *
  * TODO: needs more parameters when compressing extension headers, etc.
  */
 struct sicslowpan_nh_compressor {
   int (* is_compressable)(uint8_t next_header);
 
-  /** compress next header (TCP/UDP, etc) - ptr points to next header to
-      compress */
-  int (* compress)(uint8_t *compressed, uint8_t *uncompressed_len);
+  /** compress next header (TCP/UDP, etc) of the packet in uip_buf into
+      compressed, using at most max bytes. Adds the number of bytes it
+      consumed to uncompressed_len, and returns the number of bytes
+      written, or 0 if the packet was left uncompressed */
+  int (* compress)(uint8_t *compressed, int max, uint8_t *uncompressed_len);
 
   /** uncompress next header (TCP/UDP, etc) - ptr points to next header to
-      uncompress */
-  int (* uncompress)(uint8_t *compressed, uint8_t *lowpanbuf, uint8_t *uncompressed_len);
+      uncompress, len is the number of bytes left in the frame. Returns
+      the number of bytes used, or -1 on error */
+  int (* uncompress)(uint8_t *compressed, int len, uint8_t *lowpanbuf,
+                     uint8_t *uncompressed_len);
 
 };
 
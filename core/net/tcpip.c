@@ -247,7 +247,7 @@ tcp_connect(uip_ipaddr_t *ripaddr, uint16_t port, void *appstate)
 void
 tcp_unlisten(uint16_t port)
 {
-  static unsigned char i;
+  static uip_conn_index_t i;
   struct listenport *l;
 
   l = s.listenports;
@@ -265,7 +265,7 @@ tcp_unlisten(uint16_t port)
 void
 tcp_listen(uint16_t port)
 {
-  static unsigned char i;
+  static uip_conn_index_t i;
   struct listenport *l;
 
   l = s.listenports;
@@ -369,7 +369,7 @@ static void
 eventhandler(process_event_t ev, process_data_t data)
 {
 #if UIP_TCP
-  static unsigned char i;
+  static uip_conn_index_t i;
   register struct listenport *l;
 #endif /*UIP_TCP*/
   static struct process *p;
@@ -614,10 +614,8 @@ tcpip_ipv6_output(void)
       } else {
 #if UIP_CONF_IPV6_QUEUE_PKT
         /* Copy outgoing pkt in the queuing buffer for later transmit. */
-        if(uip_packetqueue_alloc(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME) != NULL) {
-          memcpy(uip_packetqueue_buf(&nbr->packethandle), UIP_IP_BUF, uip_len);
-          uip_packetqueue_set_buflen(&nbr->packethandle, uip_len);
-        }
+        uip_packetqueue_push(&nbr->packethandle, (uint8_t *)UIP_IP_BUF,
+                             uip_len, UIP_DS6_NBR_PACKET_LIFETIME);
 #endif
       /* RFC4861, 7.2.2:
        * "If the source address of the packet prompting the solicitation is the
@@ -638,12 +636,10 @@ tcpip_ipv6_output(void)
       if(nbr->state == NBR_INCOMPLETE) {
         PRINTF("tcpip_ipv6_output: nbr cache entry incomplete\n");
 #if UIP_CONF_IPV6_QUEUE_PKT
-        /* Copy outgoing pkt in the queuing buffer for later transmit and set
-           the destination nbr to nbr. */
-        if(uip_packetqueue_alloc(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME) != NULL) {
-          memcpy(uip_packetqueue_buf(&nbr->packethandle), UIP_IP_BUF, uip_len);
-          uip_packetqueue_set_buflen(&nbr->packethandle, uip_len);
-        }
+        /* Append outgoing pkt to the packets queued for nbr, they are
+           sent in order once the address resolution is complete. */
+        uip_packetqueue_push(&nbr->packethandle, (uint8_t *)UIP_IP_BUF,
+                             uip_len, UIP_DS6_NBR_PACKET_LIFETIME);
 #endif /*UIP_CONF_IPV6_QUEUE_PKT*/
         uip_len = 0;
         return;
@@ -657,23 +653,30 @@ tcpip_ipv6_output(void)
         PRINTF("tcpip_ipv6_output: nbr cache entry stale moving to delay\n");
       }
 
-      tcpip_output(&nbr->lladdr);
-
 #if UIP_CONF_IPV6_QUEUE_PKT
       /*
-       * Send the queued packets from here, may not be 100% perfect though.
-       * This happens in a few cases, for example when instead of receiving a
-       * NA after sendiong a NS, you receive a NS with SLLAO: the entry moves
-       * to STALE, and you must both send a NA and the queued packet.
+       * Send the queued packets from here, before this one. This happens
+       * in a few cases, for example when instead of receiving a NA after
+       * sending a NS, you receive a NS with SLLAO: the entry moves to
+       * STALE, and you must both send a NA and the queued packets.
+       *
+       * The queued packets are popped into uip_buf, so this one is kept
+       * behind them in the queue meanwhile, exempt from the limits that
+       * would drop it. Only if the queued packets of the neighbor itself
+       * leave no room for it, it is sent ahead of them instead.
        */
-      if(uip_packetqueue_buflen(&nbr->packethandle) != 0) {
-        uip_len = uip_packetqueue_buflen(&nbr->packethandle);
-        memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-        uip_packetqueue_free(&nbr->packethandle);
-        tcpip_output(&nbr->lladdr);
+      if(!uip_packetqueue_isempty(&nbr->packethandle)) {
+        if(!uip_packetqueue_append(&nbr->packethandle, (uint8_t *)UIP_IP_BUF,
+                                   uip_len, UIP_DS6_NBR_PACKET_LIFETIME)) {
+          tcpip_output(&nbr->lladdr);
+        }
+        tcpip_ipv6_flush_queue(nbr);
+        return;
       }
 #endif /*UIP_CONF_IPV6_QUEUE_PKT*/
 
+      tcpip_output(&nbr->lladdr);
+
       uip_len = 0;
       return;
     }
@@ -684,6 +687,20 @@ tcpip_ipv6_output(void)
   uip_len = 0;
   uip_ext_len = 0;
 }
+/*---------------------------------------------------------------------------*/
+#if UIP_CONF_IPV6_QUEUE_PKT
+void
+tcpip_ipv6_flush_queue(uip_ds6_nbr_t *nbr)
+{
+  while((uip_len = uip_packetqueue_pop(&nbr->packethandle,
+                                       (uint8_t *)UIP_IP_BUF)) != 0) {
+    PRINTF("tcpip_ipv6_flush_queue: sending queued packet, len %u\n", uip_len);
+    tcpip_output(&nbr->lladdr);
+  }
+  uip_len = 0;
+  uip_ext_len = 0;
+}
+#endif /* UIP_CONF_IPV6_QUEUE_PKT */
 #endif /* UIP_CONF_IPV6 */
 /*---------------------------------------------------------------------------*/
 #if UIP_UDP
@@ -719,7 +736,7 @@ tcpip_uipcall(void)
 
 #if UIP_TCP
  {
-   static unsigned char i;
+   static uip_conn_index_t i;
    register struct listenport *l;
    
    /* If this is a connection request for a listening port, we must
@@ -758,7 +775,7 @@ PROCESS_THREAD(tcpip_process, ev, data)
   
 #if UIP_TCP
  {
-   static unsigned char i;
+   static uip_conn_index_t i;
    
    for(i = 0; i < UIP_LISTENPORTS; ++i) {
      s.listenports[i].port = 0;
@@ -72,7 +72,11 @@
 #include "net/uip-icmp6.h"
 #include "net/uip-nd6.h"
 #include "net/uip-ds6.h"
+#include "net/tcpip.h"
 #include "lib/random.h"
+#if UIP_ND6_6CO
+#include "net/sicslowpan.h"
+#endif /* UIP_ND6_6CO */
 
 /*------------------------------------------------------------------*/
 #define DEBUG 0
@@ -121,6 +125,9 @@ static uint8_t *nd6_opt_llao;   /**  Pointer to llao option in uip_buf */
 static uip_nd6_opt_prefix_info *nd6_opt_prefix_info; /**  Pointer to prefix information option in uip_buf */
 static uip_ipaddr_t ipaddr;
 static uip_ds6_prefix_t *prefix; /**  Pointer to a prefix list entry */
+#if UIP_ND6_6CO
+static uip_nd6_opt_6co *nd6_opt_6co; /**  Pointer to 6LoWPAN context option in uip_buf */
+#endif /* UIP_ND6_6CO */
 #endif
 static uip_ds6_nbr_t *nbr; /**  Pointer to a nbr cache entry*/
 static uip_ds6_defrt_t *defrt; /**  Pointer to a router list entry */
@@ -519,20 +526,8 @@ uip_nd6_na_input(void)
     }
   }
 #if UIP_CONF_IPV6_QUEUE_PKT
-  /* The nbr is now reachable, check if we had buffered a pkt for it */
-  /*if(nbr->queue_buf_len != 0) {
-    uip_len = nbr->queue_buf_len;
-    memcpy(UIP_IP_BUF, nbr->queue_buf, uip_len);
-    nbr->queue_buf_len = 0;
-    return;
-    }*/
-  if(uip_packetqueue_buflen(&nbr->packethandle) != 0) {
-    uip_len = uip_packetqueue_buflen(&nbr->packethandle);
-    memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-    uip_packetqueue_free(&nbr->packethandle);
-    return;
-  }
-  
+  /* The nbr is now reachable, send the pkts we had buffered for it */
+  tcpip_ipv6_flush_queue(nbr);
 #endif /*UIP_CONF_IPV6_QUEUE_PKT */
 
 discard:
@@ -757,6 +752,13 @@ uip_nd6_rs_output(void)
 void
 uip_nd6_ra_input(void)
 {
+#if UIP_ND6_6CO
+  /* Contexts of this RA, and whether the router can decode GHC */
+  uint16_t contexts = 0;
+  uint8_t ghc = 0;
+  uint8_t cid;
+#endif /* UIP_ND6_6CO */
+
   PRINTF("Received RA from");
   PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
   PRINTF("to");
@@ -909,6 +911,25 @@ uip_nd6_ra_input(void)
         /* End of autonomous flag related processing */
       }
       break;
+#if UIP_ND6_6CO
+    case UIP_ND6_OPT_6CO:
+      PRINTF("Processing 6CO option in RA\n");
+      nd6_opt_6co = (uip_nd6_opt_6co *) UIP_ND6_OPT_HDR_BUF;
+      /* Only 64 bit contexts are supported, like prefixes */
+      if(nd6_opt_6co->len >= 2 && nd6_opt_6co->ctxlen == 64) {
+        cid = nd6_opt_6co->flagscid & UIP_ND6_6CO_CID_MASK;
+        if(sicslowpan_context_set(cid, nd6_opt_6co->prefix,
+                                  nd6_opt_6co->flagscid & UIP_ND6_6CO_FLAG_COMPRESS,
+                                  60UL * uip_ntohs(nd6_opt_6co->lifetime))) {
+          contexts |= 1 << cid;
+        }
+      }
+      break;
+    case UIP_ND6_OPT_6CIO:
+      PRINTF("Processing 6CIO option in RA\n");
+      ghc = ((uint8_t *)UIP_ND6_OPT_HDR_BUF)[3] & UIP_ND6_6CIO_FLAG_GHC;
+      break;
+#endif /* UIP_ND6_6CO */
     default:
       PRINTF("ND option not supported in RA");
       break;
@@ -916,6 +937,16 @@ uip_nd6_ra_input(void)
     nd6_opt_offset += (UIP_ND6_OPT_HDR_BUF->len << 3);
   }
 
+#if UIP_ND6_6CO
+  /* Next header compression is used on a context only when the
+     router that announces it says it can decode it */
+  for(cid = 0; contexts != 0; cid++, contexts >>= 1) {
+    if(contexts & 1) {
+      sicslowpan_context_set_nh_compress(cid, ghc);
+    }
+  }
+#endif /* UIP_ND6_6CO */
+
   defrt = uip_ds6_defrt_lookup(&UIP_IP_BUF->srcipaddr);
   if(UIP_ND6_RA_BUF->router_lifetime != 0) {
     if(nbr != NULL) {
@@ -937,20 +968,10 @@ uip_nd6_ra_input(void)
 
 #if UIP_CONF_IPV6_QUEUE_PKT
   /* If the nbr just became reachable (e.g. it was in NBR_INCOMPLETE state
-   * and we got a SLLAO), check if we had buffered a pkt for it */
-  /*  if((nbr != NULL) && (nbr->queue_buf_len != 0)) {
-    uip_len = nbr->queue_buf_len;
-    memcpy(UIP_IP_BUF, nbr->queue_buf, uip_len);
-    nbr->queue_buf_len = 0;
-    return;
-    }*/
-  if(nbr != NULL && uip_packetqueue_buflen(&nbr->packethandle) != 0) {
-    uip_len = uip_packetqueue_buflen(&nbr->packethandle);
-    memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-    uip_packetqueue_free(&nbr->packethandle);
-    return;
+   * and we got a SLLAO), send the pkts we had buffered for it */
+  if(nbr != NULL && nbr->state != NBR_INCOMPLETE) {
+    tcpip_ipv6_flush_queue(nbr);
   }
-
 #endif /*UIP_CONF_IPV6_QUEUE_PKT */
 
 discard:
@@ -68,6 +68,15 @@
 #define UIP_ND6_DEF_MAXDADNS UIP_CONF_ND6_DEF_MAXDADNS
 #endif /* UIP_CONF_ND6_DEF_MAXDADNS */
 
+/** \brief Learn 6LoWPAN header compression contexts from RAs (RFC 6775) */
+#ifdef UIP_CONF_ND6_6CO
+#define UIP_ND6_6CO UIP_CONF_ND6_6CO
+#elif UIP_CONF_LL_802154
+#define UIP_ND6_6CO 1
+#else
+#define UIP_ND6_6CO 0
+#endif
+
 /** \name RFC 4861 Host constant */
 /** @{ */
 #define UIP_ND6_MAX_RTR_SOLICITATION_DELAY 1
@@ -130,6 +139,8 @@
 #define UIP_ND6_OPT_PREFIX_INFO         3
 #define UIP_ND6_OPT_REDIRECTED_HDR      4
 #define UIP_ND6_OPT_MTU                 5
+#define UIP_ND6_OPT_6CO                 34
+#define UIP_ND6_OPT_6CIO                36
 /** @} */
 
 /** \name ND6 option types */
@@ -274,6 +285,23 @@ typedef struct uip_nd6_opt_mtu {
   uint32_t mtu;
 } uip_nd6_opt_mtu;
 
+/** \brief ND option 6LoWPAN context (RFC 6775) */
+typedef struct uip_nd6_opt_6co {
+  uint8_t type;
+  uint8_t len;
+  uint8_t ctxlen;
+  uint8_t flagscid;
+  uint16_t reserved;
+  uint16_t lifetime; /* in minutes */
+  uint8_t prefix[8];
+} uip_nd6_opt_6co;
+
+#define UIP_ND6_6CO_FLAG_COMPRESS       0x10
+#define UIP_ND6_6CO_CID_MASK            0x0f
+
+/** \brief G flag of the 6LoWPAN capability indication option (RFC 7400) */
+#define UIP_ND6_6CIO_FLAG_GHC           0x01
+
 /** \struct Redirected header option */
 typedef struct uip_nd6_opt_redirected_hdr {
   uint8_t type;
@@ -1,13 +1,22 @@
 #include <stdio.h>
+#include <string.h>
 
 #include "net/uip.h"
 
+#include "lib/list.h"
 #include "lib/memb.h"
 
 #include "net/uip-packetqueue.h"
 
-#define MAX_NUM_QUEUED_PACKETS 2
-MEMB(packets_memb, struct uip_packetqueue_packet, MAX_NUM_QUEUED_PACKETS);
+MEMB(packets_memb, struct uip_packetqueue_packet, UIP_PACKETQUEUE_MAX_PACKETS);
+
+/* Packet data is allocated at pool_head and reclaimed from the start
+   of the oldest packet, so the pool is used as a ring buffer. Packets
+   that are removed out of order keep their space until all older
+   packets are gone too. */
+LIST(packets);
+static uint8_t pool[UIP_PACKETQUEUE_BUDGET];
+static uint16_t pool_head;
 
 #define DEBUG 0
 #if DEBUG
@@ -19,13 +28,110 @@ MEMB(packets_memb, struct uip_packetqueue_packet, MAX_NUM_QUEUED_PACKETS);
 
 /*---------------------------------------------------------------------------*/
 static void
-packet_timedout(void *ptr)
+reclaim(void)
+{
+  struct uip_packetqueue_packet *p;
+
+  for(p = list_head(packets); p != NULL && p->handle == NULL;
+      p = list_head(packets)) {
+    list_pop(packets);
+    memb_free(&packets_memb, p);
+  }
+  if(list_head(packets) == NULL) {
+    pool_head = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+unlink_packet(struct uip_packetqueue_packet *p)
+{
+  struct uip_packetqueue_packet **pp;
+
+  for(pp = &p->handle->packet; *pp != NULL; pp = &(*pp)->qnext) {
+    if(*pp == p) {
+      *pp = p->qnext;
+      p->handle->count--;
+      break;
+    }
+  }
+  p->handle = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_expired(void)
+{
+  struct uip_packetqueue_packet *p;
+
+  for(p = list_head(packets); p != NULL; p = list_item_next(p)) {
+    if(p->handle != NULL && timer_expired(&p->lifetimer)) {
+      PRINTF("uip_packetqueue: packet %p timed out\n", p);
+      unlink_packet(p);
+    }
+  }
+  reclaim();
+}
+/*---------------------------------------------------------------------------*/
+static int
+pool_alloc(uint16_t len)
+{
+  struct uip_packetqueue_packet *oldest;
+  uint16_t tail;
+
+  oldest = list_head(packets);
+  if(oldest == NULL) {
+    return len <= UIP_PACKETQUEUE_BUDGET ? 0 : -1;
+  }
+  /* The ends are kept strictly apart, so that pool_head == tail only
+     when the pool is empty. */
+  tail = oldest->offset;
+  if(pool_head >= tail) {
+    if(pool_head + len <= UIP_PACKETQUEUE_BUDGET) {
+      return pool_head;
+    }
+    if(len < tail) {
+      return 0;
+    }
+  } else if(pool_head + len < tail) {
+    return pool_head;
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+drop_oldest(struct uip_packetqueue_handle *keep)
+{
+  struct uip_packetqueue_packet *p;
+
+  for(p = list_head(packets); p != NULL; p = list_item_next(p)) {
+    if(p->handle != NULL && p->handle != keep) {
+      PRINTF("uip_packetqueue: dropping oldest packet %p\n", p);
+      unlink_packet(p);
+      reclaim();
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_packet(struct uip_packetqueue_handle *handle, int offset,
+           const uint8_t *data, uint16_t len, clock_time_t lifetime)
 {
-  struct uip_packetqueue_handle *h = ptr;
+  struct uip_packetqueue_packet *p, **pp;
 
-  PRINTF("uip_packetqueue_free timed out %p\n", h);
-  memb_free(&packets_memb, h->packet);
-  h->packet = NULL;
+  p = memb_alloc(&packets_memb);
+  p->offset = offset;
+  p->len = len;
+  p->handle = handle;
+  p->qnext = NULL;
+  timer_set(&p->lifetimer, lifetime);
+  memcpy(&pool[offset], data, len);
+  pool_head = offset + len;
+  list_add(packets, p);
+
+  for(pp = &handle->packet; *pp != NULL; pp = &(*pp)->qnext);
+  *pp = p;
+  handle->count++;
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -33,54 +139,115 @@ uip_packetqueue_new(struct uip_packetqueue_handle *handle)
 {
   PRINTF("uip_packetqueue_new %p\n", handle);
   handle->packet = NULL;
+  handle->count = 0;
 }
 /*---------------------------------------------------------------------------*/
-struct uip_packetqueue_packet *
-uip_packetqueue_alloc(struct uip_packetqueue_handle *handle, clock_time_t lifetime)
+int
+uip_packetqueue_push(struct uip_packetqueue_handle *handle,
+                     const uint8_t *data, uint16_t len, clock_time_t lifetime)
 {
-  PRINTF("uip_packetqueue_alloc %p\n", handle);
-  if(handle->packet != NULL) {
-    PRINTF("alloced\n");
-    return NULL;
+  int offset;
+
+  PRINTF("uip_packetqueue_push %p len %u\n", handle, len);
+  if(len == 0 || len > UIP_PACKETQUEUE_BUDGET) {
+    return 0;
+  }
+
+  remove_expired();
+
+  if(handle->count >= UIP_PACKETQUEUE_MAX_PER_HANDLE) {
+#if UIP_PACKETQUEUE_DROP_POLICY == UIP_PACKETQUEUE_DROP_OLDEST
+    unlink_packet(handle->packet);
+    reclaim();
+#else
+    PRINTF("uip_packetqueue: handle full, dropping new packet\n");
+    return 0;
+#endif
   }
-  handle->packet = memb_alloc(&packets_memb);
-  if(handle->packet != NULL) {
-    ctimer_set(&handle->packet->lifetimer, lifetime,
-               packet_timedout, handle);
-  } else {
-    PRINTF("uip_packetqueue_alloc failed\n");
+
+  while((offset = pool_alloc(len)) < 0 ||
+        list_length(packets) >= UIP_PACKETQUEUE_MAX_PACKETS) {
+#if UIP_PACKETQUEUE_DROP_POLICY == UIP_PACKETQUEUE_DROP_OLDEST
+    if(!drop_oldest(NULL)) {
+      return 0;
+    }
+#else
+    PRINTF("uip_packetqueue: queue full, dropping new packet\n");
+    return 0;
+#endif
   }
-  return handle->packet;
+
+  add_packet(handle, offset, data, len, lifetime);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_packetqueue_append(struct uip_packetqueue_handle *handle,
+                       const uint8_t *data, uint16_t len,
+                       clock_time_t lifetime)
+{
+  int offset;
+
+  PRINTF("uip_packetqueue_append %p len %u\n", handle, len);
+  if(len == 0 || len > UIP_PACKETQUEUE_BUDGET) {
+    return 0;
+  }
+
+  remove_expired();
+
+  while((offset = pool_alloc(len)) < 0 ||
+        list_length(packets) >= UIP_PACKETQUEUE_MAX_PACKETS) {
+    if(!drop_oldest(handle)) {
+      return 0;
+    }
+  }
+
+  add_packet(handle, offset, data, len, lifetime);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_packetqueue_pop(struct uip_packetqueue_handle *handle, uint8_t *buf)
+{
+  struct uip_packetqueue_packet *p;
+  uint16_t len;
+
+  while((p = handle->packet) != NULL) {
+    len = p->len;
+    if(!timer_expired(&p->lifetimer)) {
+      memcpy(buf, &pool[p->offset], len);
+    } else {
+      len = 0;
+    }
+    unlink_packet(p);
+    reclaim();
+    if(len > 0) {
+      PRINTF("uip_packetqueue_pop %p len %u\n", handle, len);
+      return len;
+    }
+  }
+  return 0;
 }
 /*---------------------------------------------------------------------------*/
 void
 uip_packetqueue_free(struct uip_packetqueue_handle *handle)
 {
   PRINTF("uip_packetqueue_free %p\n", handle);
-  if(handle->packet != NULL) {
-    ctimer_stop(&handle->packet->lifetimer);
-    memb_free(&packets_memb, handle->packet);
-    handle->packet = NULL;
+  while(handle->packet != NULL) {
+    unlink_packet(handle->packet);
   }
+  reclaim();
 }
 /*---------------------------------------------------------------------------*/
 uint8_t *
 uip_packetqueue_buf(struct uip_packetqueue_handle *h)
 {
-  return h->packet != NULL? h->packet->queue_buf: NULL;
+  return h->packet != NULL? &pool[h->packet->offset]: NULL;
 }
 /*---------------------------------------------------------------------------*/
 uint16_t
 uip_packetqueue_buflen(struct uip_packetqueue_handle *h)
 {
-  return h->packet != NULL? h->packet->queue_buf_len: 0;
-}
-/*---------------------------------------------------------------------------*/
-void
-uip_packetqueue_set_buflen(struct uip_packetqueue_handle *h, uint16_t len)
-{
-  if(h->packet != NULL) {
-    h->packet->queue_buf_len = len;
-  }
+  return h->packet != NULL? h->packet->len: 0;
 }
 /*---------------------------------------------------------------------------*/
@@ -1,35 +1,104 @@
 #ifndef UIP_PACKETQUEUE_H
 #define UIP_PACKETQUEUE_H
 
-#include "sys/ctimer.h"
+#include "sys/timer.h"
+
+/*
+ * Packets are queued per handle (one handle per neighbor cache entry)
+ * in FIFO order. Packet data lives in a shared byte pool, so the
+ * total amount of queued data is bounded by UIP_PACKETQUEUE_BUDGET
+ * rather than by a number of full-sized buffers.
+ */
+
+/** Total number of bytes of packet data that can be queued. */
+#ifdef UIP_PACKETQUEUE_CONF_BUDGET
+#define UIP_PACKETQUEUE_BUDGET UIP_PACKETQUEUE_CONF_BUDGET
+#else
+#define UIP_PACKETQUEUE_BUDGET (2 * (UIP_BUFSIZE - UIP_LLH_LEN))
+#endif
+
+/** Total number of packets that can be queued. */
+#ifdef UIP_PACKETQUEUE_CONF_MAX_PACKETS
+#define UIP_PACKETQUEUE_MAX_PACKETS UIP_PACKETQUEUE_CONF_MAX_PACKETS
+#else
+#define UIP_PACKETQUEUE_MAX_PACKETS 8
+#endif
+
+/** Number of packets that can be queued on a single handle. */
+#ifdef UIP_PACKETQUEUE_CONF_MAX_PER_HANDLE
+#define UIP_PACKETQUEUE_MAX_PER_HANDLE UIP_PACKETQUEUE_CONF_MAX_PER_HANDLE
+#else
+#define UIP_PACKETQUEUE_MAX_PER_HANDLE 4
+#endif
+
+/*
+ * What to do with a packet that does not fit. With DROP_OLDEST, the
+ * oldest packet of the handle is dropped when the handle is full, and
+ * the oldest packet in the whole queue is dropped when the budget is
+ * exhausted. With DROP_NEWEST, the new packet is dropped.
+ */
+#define UIP_PACKETQUEUE_DROP_OLDEST 0
+#define UIP_PACKETQUEUE_DROP_NEWEST 1
+
+#ifdef UIP_PACKETQUEUE_CONF_DROP_POLICY
+#define UIP_PACKETQUEUE_DROP_POLICY UIP_PACKETQUEUE_CONF_DROP_POLICY
+#else
+#define UIP_PACKETQUEUE_DROP_POLICY UIP_PACKETQUEUE_DROP_OLDEST
+#endif
 
 struct uip_packetqueue_handle;
 
 struct uip_packetqueue_packet {
-  struct uip_ds6_queued_packet *next;
-  uint8_t queue_buf[UIP_BUFSIZE - UIP_LLH_LEN];
-  uint16_t queue_buf_len;
-  struct ctimer lifetimer;
+  /* All packets, in the order their data was allocated. */
+  struct uip_packetqueue_packet *next;
+  /* Packets of the same handle, oldest first. */
+  struct uip_packetqueue_packet *qnext;
+  /* NULL once the packet has been removed from its handle. */
   struct uip_packetqueue_handle *handle;
+  struct timer lifetimer;
+  uint16_t offset;
+  uint16_t len;
 };
 
 struct uip_packetqueue_handle {
   struct uip_packetqueue_packet *packet;
+  uint8_t count;
 };
 
 void uip_packetqueue_new(struct uip_packetqueue_handle *handle);
 
+/**
+ * Append a copy of a packet to the queue. Returns non-zero if the
+ * packet was queued.
+ */
+int uip_packetqueue_push(struct uip_packetqueue_handle *handle,
+                         const uint8_t *data, uint16_t len,
+                         clock_time_t lifetime);
 
-struct uip_packetqueue_packet *
-uip_packetqueue_alloc(struct uip_packetqueue_handle *handle, clock_time_t lifetime);
+/**
+ * Append a copy of a packet that is to be sent right after the packets
+ * already in the queue, without being lost to the limits. Neither the
+ * per-handle limit nor the drop policy applies, and only packets of
+ * other handles are dropped to make room. Returns zero if the queued
+ * packets of the handle itself leave no room.
+ */
+int uip_packetqueue_append(struct uip_packetqueue_handle *handle,
+                           const uint8_t *data, uint16_t len,
+                           clock_time_t lifetime);
 
+/**
+ * Remove the oldest packet from the queue and copy it to buf. Returns
+ * the length of the packet, or 0 if the queue is empty.
+ */
+uint16_t uip_packetqueue_pop(struct uip_packetqueue_handle *handle,
+                             uint8_t *buf);
 
-void
-uip_packetqueue_free(struct uip_packetqueue_handle *handle);
+/** Drop all packets of the handle. */
+void uip_packetqueue_free(struct uip_packetqueue_handle *handle);
 
 uint8_t *uip_packetqueue_buf(struct uip_packetqueue_handle *h);
 uint16_t uip_packetqueue_buflen(struct uip_packetqueue_handle *h);
-void uip_packetqueue_set_buflen(struct uip_packetqueue_handle *h, uint16_t len);
 
+#define uip_packetqueue_isempty(h) ((h)->packet == NULL)
 
 #endif /* UIP_PACKETQUEUE_H */
@@ -74,6 +74,7 @@
 #include "net/uipopt.h"
 #include "net/uip_arp.h"
 #include "net/uip_arch.h"
+#include "sys/profile.h"
 
 #if !UIP_CONF_IPV6 /* If UIP_CONF_IPV6 is defined, we compile the
 		      uip6.c file instead of this one. Therefore
@@ -87,6 +88,8 @@
 
 #include <string.h>
 
+PROFILE_PROBE(uip_process);
+
 /*---------------------------------------------------------------------------*/
 /* Variable definitions. */
 
@@ -674,6 +677,8 @@ uip_process(uint8_t flag)
 {
   register struct uip_conn *uip_connr = uip_conn;
 
+  PROFILE_PROBE_BEGIN(uip_process);
+
 #if UIP_UDP
   if(flag == UIP_UDP_SEND_CONN) {
     goto udp_send;
@@ -1929,11 +1934,13 @@ uip_process(uint8_t flag)
   UIP_STAT(++uip_stat.ip.sent);
   /* Return and let the caller do the actual transmission. */
   uip_flags = 0;
+  PROFILE_PROBE_END(uip_process);
   return;
 
  drop:
   uip_len = 0;
   uip_flags = 0;
+  PROFILE_PROBE_END(uip_process);
   return;
 }
 /*---------------------------------------------------------------------------*/
@@ -846,7 +846,12 @@ struct uip_udp_conn *uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport);
  *
  * \hideinitializer
  */
+#if UIP_CONF_IPV6 && UIP_CONF_CONN_HASH
+#define uip_udp_bind(conn, port) uip_udp_rebind(conn, port)
+void uip_udp_rebind(struct uip_udp_conn *conn, uint16_t port);
+#else
 #define uip_udp_bind(conn, port) (conn)->lport = port
+#endif
 
 /**
  * Send a UDP datagram of length len on the current connection.
@@ -1333,6 +1338,17 @@ struct uip_conn {
  */
 
 CCIF extern struct uip_conn *uip_conn;
+
+/**
+ * An integer type large enough to index the uip_conns,
+ * uip_udp_conns and listen port tables.
+ */
+#if UIP_CONNS >= 255 || UIP_UDP_CONNS >= 255 || UIP_LISTENPORTS >= 255
+typedef uint16_t uip_conn_index_t;
+#else
+typedef uint8_t uip_conn_index_t;
+#endif
+
 #if UIP_TCP
 /* The array containing all uIP connections. */
 CCIF extern struct uip_conn uip_conns[UIP_CONNS];
@@ -75,6 +75,7 @@
 #include "net/uip-icmp6.h"
 #include "net/uip-nd6.h"
 #include "net/uip-ds6.h"
+#include "sys/profile.h"
 
 #include <string.h>
 
@@ -100,7 +101,8 @@ void uip_log(char *msg);
 #if UIP_STATISTICS == 1
 struct uip_stats uip_stat;
 #endif /* UIP_STATISTICS == 1 */
- 
+
+PROFILE_PROBE(uip_process);
 
 /*---------------------------------------------------------------------------*/
 /** @{ \name Layer 2 variables */
@@ -195,7 +197,7 @@ struct uip_conn *uip_conn;
 
 /* Temporary variables. */
 #if (UIP_TCP || UIP_UDP)
-static uint8_t c;
+static uip_conn_index_t c;
 #endif
 
 #if UIP_ACTIVE_OPEN || UIP_UDP
@@ -254,6 +256,188 @@ struct uip_udp_conn uip_udp_conns[UIP_UDP_CONNS];
 #endif /* UIP_UDP */
 /** @} */
 
+/*---------------------------------------------------------------------------*/
+/** @{ \name Connection hash tables                                         */
+/*---------------------------------------------------------------------------*/
+#if UIP_CONF_CONN_HASH && (UIP_TCP || UIP_UDP)
+/*
+ * Incoming segments and datagrams are demultiplexed through chained
+ * hash tables instead of a scan of the connection tables. UDP
+ * connections are hashed on their local port, TCP connections on the
+ * local port, remote port and remote address. The chains hold table
+ * indices in increasing order, so that a lookup finds the same
+ * connection as a scan of the table would.
+ *
+ * Connections are removed by clearing lport (UDP) or by moving to
+ * UIP_CLOSED (TCP) from many places, so entries are checked on lookup
+ * and stale ones are unlinked when they are found, or when their slot
+ * is reused.
+ */
+#define CONN_HASH_SIZE UIP_CONF_CONN_HASH_SIZE
+#if CONN_HASH_SIZE < 1 || CONN_HASH_SIZE > 65535
+#error "UIP_CONF_CONN_HASH_SIZE must be between 1 and 65535"
+#endif
+#define CONN_HASH_NONE ((uip_conn_index_t)~0)
+
+struct conn_hash {
+  uip_conn_index_t *head;
+  uip_conn_index_t *next;
+  /* The bucket each connection is linked into, or CONN_HASH_SIZE. */
+  uint16_t *bucket;
+};
+/*---------------------------------------------------------------------------*/
+static void
+conn_hash_init(struct conn_hash *h, uip_conn_index_t nconns)
+{
+  /* As wide as the bucket numbers, since CONN_HASH_SIZE may not fit in
+     an index. */
+  uint16_t i;
+
+  for(i = 0; i < CONN_HASH_SIZE; ++i) {
+    h->head[i] = CONN_HASH_NONE;
+  }
+  for(i = 0; i < nconns; ++i) {
+    h->bucket[i] = CONN_HASH_SIZE;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+conn_hash_unlink(struct conn_hash *h, uip_conn_index_t i)
+{
+  uip_conn_index_t *p;
+
+  if(h->bucket[i] == CONN_HASH_SIZE) {
+    return;
+  }
+  for(p = &h->head[h->bucket[i]]; *p != CONN_HASH_NONE; p = &h->next[*p]) {
+    if(*p == i) {
+      *p = h->next[i];
+      break;
+    }
+  }
+  h->bucket[i] = CONN_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+conn_hash_link(struct conn_hash *h, uint16_t bucket, uip_conn_index_t i)
+{
+  uip_conn_index_t *p;
+
+  conn_hash_unlink(h, i);
+  for(p = &h->head[bucket];
+      *p != CONN_HASH_NONE && *p < i;
+      p = &h->next[*p]);
+  h->next[i] = *p;
+  *p = i;
+  h->bucket[i] = bucket;
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_UDP
+static uip_conn_index_t udp_hash_head[CONN_HASH_SIZE];
+static uip_conn_index_t udp_hash_next[UIP_UDP_CONNS];
+static uint16_t udp_hash_bucket[UIP_UDP_CONNS];
+static struct conn_hash udp_hash =
+  { udp_hash_head, udp_hash_next, udp_hash_bucket };
+
+#define UDP_HASH(lport) ((uint16_t)((lport) ^ ((lport) >> 7)) % CONN_HASH_SIZE)
+/*---------------------------------------------------------------------------*/
+static struct uip_udp_conn *
+udp_hash_lookup(uint16_t lport, uint8_t any_remote)
+{
+  uip_conn_index_t *p;
+  struct uip_udp_conn *conn;
+  uint16_t bucket;
+
+  bucket = UDP_HASH(lport);
+  p = &udp_hash_head[bucket];
+  while(*p != CONN_HASH_NONE) {
+    conn = &uip_udp_conns[*p];
+    if(conn->lport == 0 || UDP_HASH(conn->lport) != bucket) {
+      /* Removed or rebound behind our back. */
+      udp_hash_bucket[*p] = CONN_HASH_SIZE;
+      *p = udp_hash_next[*p];
+      continue;
+    }
+    if(lport == conn->lport &&
+       (any_remote ||
+        ((conn->rport == 0 ||
+          UIP_UDP_BUF->srcport == conn->rport) &&
+         (uip_is_addr_unspecified(&conn->ripaddr) ||
+          uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &conn->ripaddr))))) {
+      return conn;
+    }
+    p = &udp_hash_next[*p];
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_udp_rebind(struct uip_udp_conn *conn, uint16_t port)
+{
+  conn->lport = port;
+  if(port == 0) {
+    conn_hash_unlink(&udp_hash, conn - uip_udp_conns);
+  } else {
+    conn_hash_link(&udp_hash, UDP_HASH(port), conn - uip_udp_conns);
+  }
+}
+#endif /* UIP_UDP */
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP
+static uip_conn_index_t tcp_hash_head[CONN_HASH_SIZE];
+static uip_conn_index_t tcp_hash_next[UIP_CONNS];
+static uint16_t tcp_hash_bucket[UIP_CONNS];
+static struct conn_hash tcp_hash =
+  { tcp_hash_head, tcp_hash_next, tcp_hash_bucket };
+/*---------------------------------------------------------------------------*/
+static uint16_t
+tcp_hash_bucket_of(uint16_t lport, uint16_t rport, const uip_ipaddr_t *ripaddr)
+{
+  uint16_t h;
+
+  h = lport ^ (rport << 5) ^ (rport >> 11) ^
+    ripaddr->u16[7] ^ (ripaddr->u16[6] << 3);
+  h ^= h >> 7;
+  return h % CONN_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcp_hash_add(struct uip_conn *conn)
+{
+  conn_hash_link(&tcp_hash,
+                 tcp_hash_bucket_of(conn->lport, conn->rport, &conn->ripaddr),
+                 conn - uip_conns);
+}
+/*---------------------------------------------------------------------------*/
+static struct uip_conn *
+tcp_hash_lookup(void)
+{
+  uip_conn_index_t *p;
+  struct uip_conn *conn;
+
+  p = &tcp_hash_head[tcp_hash_bucket_of(UIP_TCP_BUF->destport,
+                                        UIP_TCP_BUF->srcport,
+                                        &UIP_IP_BUF->srcipaddr)];
+  while(*p != CONN_HASH_NONE) {
+    conn = &uip_conns[*p];
+    if(conn->tcpstateflags == UIP_CLOSED) {
+      tcp_hash_bucket[*p] = CONN_HASH_SIZE;
+      *p = tcp_hash_next[*p];
+      continue;
+    }
+    if(UIP_TCP_BUF->destport == conn->lport &&
+       UIP_TCP_BUF->srcport == conn->rport &&
+       uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &conn->ripaddr)) {
+      return conn;
+    }
+    p = &tcp_hash_next[*p];
+  }
+  return NULL;
+}
+#endif /* UIP_TCP */
+#endif /* UIP_CONF_CONN_HASH && (UIP_TCP || UIP_UDP) */
+/** @} */
+
 /*---------------------------------------------------------------------------*/
 /** @{ \name ICMPv6 variables                                                */
 /*---------------------------------------------------------------------------*/
@@ -417,6 +601,9 @@ uip_init(void)
   for(c = 0; c < UIP_CONNS; ++c) {
     uip_conns[c].tcpstateflags = UIP_CLOSED;
   }
+#if UIP_CONF_CONN_HASH
+  conn_hash_init(&tcp_hash, UIP_CONNS);
+#endif /* UIP_CONF_CONN_HASH */
 #endif /* UIP_TCP */
 
 #if UIP_ACTIVE_OPEN || UIP_UDP
@@ -427,6 +614,9 @@ uip_init(void)
   for(c = 0; c < UIP_UDP_CONNS; ++c) {
     uip_udp_conns[c].lport = 0;
   }
+#if UIP_CONF_CONN_HASH
+  conn_hash_init(&udp_hash, UIP_UDP_CONNS);
+#endif /* UIP_CONF_CONN_HASH */
 #endif /* UIP_UDP */
 }
 /*---------------------------------------------------------------------------*/
@@ -496,6 +686,9 @@ uip_connect(uip_ipaddr_t *ripaddr, uint16_t rport)
   conn->lport = uip_htons(lastport);
   conn->rport = rport;
   uip_ipaddr_copy(&conn->ripaddr, ripaddr);
+#if UIP_CONF_CONN_HASH
+  tcp_hash_add(conn);
+#endif /* UIP_CONF_CONN_HASH */
   
   return conn;
 }
@@ -540,11 +733,17 @@ uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport)
     lastport = 4096;
   }
   
+#if UIP_CONF_CONN_HASH
+  if(udp_hash_lookup(uip_htons(lastport), 1) != NULL) {
+    goto again;
+  }
+#else /* UIP_CONF_CONN_HASH */
   for(c = 0; c < UIP_UDP_CONNS; ++c) {
     if(uip_udp_conns[c].lport == uip_htons(lastport)) {
       goto again;
     }
   }
+#endif /* UIP_CONF_CONN_HASH */
 
   conn = 0;
   for(c = 0; c < UIP_UDP_CONNS; ++c) {
@@ -566,6 +765,9 @@ uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport)
     uip_ipaddr_copy(&conn->ripaddr, ripaddr);
   }
   conn->ttl = uip_ds6_if.cur_hop_limit;
+#if UIP_CONF_CONN_HASH
+  conn_hash_link(&udp_hash, UDP_HASH(conn->lport), conn - uip_udp_conns);
+#endif /* UIP_CONF_CONN_HASH */
   
   return conn;
 }
@@ -906,6 +1108,8 @@ uip_process(uint8_t flag)
 #if UIP_TCP
   register struct uip_conn *uip_connr = uip_conn;
 #endif /* UIP_TCP */
+
+  PROFILE_PROBE_BEGIN(uip_process);
 #if UIP_UDP
   if(flag == UIP_UDP_SEND_CONN) {
     goto udp_send;
@@ -1473,6 +1677,12 @@ uip_process(uint8_t flag)
   }
 
   /* Demultiplex this UDP packet between the UDP "connections". */
+#if UIP_CONF_CONN_HASH
+  uip_udp_conn = udp_hash_lookup(UIP_UDP_BUF->destport, 0);
+  if(uip_udp_conn != NULL) {
+    goto udp_found;
+  }
+#else /* UIP_CONF_CONN_HASH */
   for(uip_udp_conn = &uip_udp_conns[0];
       uip_udp_conn < &uip_udp_conns[UIP_UDP_CONNS];
       ++uip_udp_conn) {
@@ -1492,6 +1702,7 @@ uip_process(uint8_t flag)
       goto udp_found;
     }
   }
+#endif /* UIP_CONF_CONN_HASH */
   PRINTF("udp: no matching connection found\n");
 
 #if UIP_UDP_SEND_UNREACH_NOPORT
@@ -1576,6 +1787,12 @@ uip_process(uint8_t flag)
 
   /* Demultiplex this segment. */
   /* First check any active connections. */
+#if UIP_CONF_CONN_HASH
+  uip_connr = tcp_hash_lookup();
+  if(uip_connr != NULL) {
+    goto found;
+  }
+#else /* UIP_CONF_CONN_HASH */
   for(uip_connr = &uip_conns[0]; uip_connr <= &uip_conns[UIP_CONNS - 1];
       ++uip_connr) {
     if(uip_connr->tcpstateflags != UIP_CLOSED &&
@@ -1585,6 +1802,7 @@ uip_process(uint8_t flag)
       goto found;
     }
   }
+#endif /* UIP_CONF_CONN_HASH */
 
   /* If we didn't find and active connection that expected the packet,
      either this packet is an old duplicate, or this is a SYN packet
@@ -1701,6 +1919,9 @@ uip_process(uint8_t flag)
   uip_connr->rport = UIP_TCP_BUF->srcport;
   uip_ipaddr_copy(&uip_connr->ripaddr, &UIP_IP_BUF->srcipaddr);
   uip_connr->tcpstateflags = UIP_SYN_RCVD;
+#if UIP_CONF_CONN_HASH
+  tcp_hash_add(uip_connr);
+#endif /* UIP_CONF_CONN_HASH */
 
   uip_connr->snd_nxt[0] = iss[0];
   uip_connr->snd_nxt[1] = iss[1];
@@ -2265,6 +2486,7 @@ uip_process(uint8_t flag)
   UIP_STAT(++uip_stat.ip.sent);
   /* Return and let the caller do the actual transmission. */
   uip_flags = 0;
+  PROFILE_PROBE_END(uip_process);
   return;
 
  drop:
@@ -2272,6 +2494,7 @@ uip_process(uint8_t flag)
   uip_ext_len = 0;
   uip_ext_bitmap = 0;
   uip_flags = 0;
+  PROFILE_PROBE_END(uip_process);
   return;
 }
 /*---------------------------------------------------------------------------*/
@@ -222,6 +222,17 @@
 /** Minimum number of default routers */
 #define UIP_CONF_DS6_DEFRT_NBU       2
 #endif
+
+#ifndef UIP_CONF_CONN_HASH
+/** Do we demultiplex incoming TCP and UDP packets through hash tables
+    instead of scanning the connection tables (default: no) */
+#define UIP_CONF_CONN_HASH            0
+#endif
+
+#ifndef UIP_CONF_CONN_HASH_SIZE
+/** Number of buckets in each of the connection hash tables */
+#define UIP_CONF_CONN_HASH_SIZE       16
+#endif
 /** @} */
 
 /*------------------------------------------------------------------------------*/
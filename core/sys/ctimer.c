@@ -42,10 +42,16 @@
  *         Adam Dunkels <adam@sics.se>
  */
 
+#include <stddef.h>
+
 #include "sys/ctimer.h"
 #include "contiki.h"
 #include "lib/list.h"
 
+/* Callback timers that are set before ctimer_process has started.
+   They are moved to the event timer list when the process starts, and
+   from then on the etimer of a callback timer is all that is needed
+   to find it. */
 LIST(ctimer_list);
 
 static char initialized;
@@ -60,6 +66,20 @@ static char initialized;
 
 /*---------------------------------------------------------------------------*/
 PROCESS(ctimer_process, "Ctimer process");
+/*---------------------------------------------------------------------------*/
+/* A callback timer that has expired, but whose callback has not been
+   called, has an event waiting in the event queue. The event is
+   removed when the timer is stopped or set again, so that
+   ctimer_process never gets an event for a callback timer that has
+   been stopped, set again or freed. */
+static void
+cancel_event(struct ctimer *c)
+{
+  if(initialized && c->armed && etimer_expired(&c->etimer)) {
+    process_post_cancel(&ctimer_process, PROCESS_EVENT_TIMER, &c->etimer);
+  }
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(ctimer_process, ev, data)
 {
   struct ctimer *c;
@@ -68,21 +88,20 @@ PROCESS_THREAD(ctimer_process, ev, data)
   for(c = list_head(ctimer_list); c != NULL; c = c->next) {
     etimer_set(&c->etimer, c->etimer.timer.interval);
   }
+  list_init(ctimer_list);
   initialized = 1;
 
   while(1) {
     PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_TIMER);
-    for(c = list_head(ctimer_list); c != NULL; c = c->next) {
-      if(&c->etimer == data) {
-	list_remove(ctimer_list, c);
-	PROCESS_CONTEXT_BEGIN(c->p);
-	if(c->f != NULL) {
-	  c->f(c->ptr);
-	}
-	PROCESS_CONTEXT_END(c->p);
-	break;
-      }
+    /* The ctimer is found from its etimer without a list walk. The
+       event cannot be stale, see cancel_event(). */
+    c = (struct ctimer *)((char *)data - offsetof(struct ctimer, etimer));
+    c->armed = 0;
+    PROCESS_CONTEXT_BEGIN(c->p);
+    if(c->f != NULL) {
+      c->f(c->ptr);
     }
+    PROCESS_CONTEXT_END(c->p);
   }
   PROCESS_END();
 }
@@ -100,57 +119,64 @@ ctimer_set(struct ctimer *c, clock_time_t t,
 	   void (*f)(void *), void *ptr)
 {
   PRINTF("ctimer_set %p %u\n", c, (unsigned)t);
+  cancel_event(c);
   c->p = PROCESS_CURRENT();
   c->f = f;
   c->ptr = ptr;
+  c->armed = 1;
   if(initialized) {
     PROCESS_CONTEXT_BEGIN(&ctimer_process);
     etimer_set(&c->etimer, t);
     PROCESS_CONTEXT_END(&ctimer_process);
   } else {
     c->etimer.timer.interval = t;
+    list_remove(ctimer_list, c);
+    list_add(ctimer_list, c);
   }
-
-  list_remove(ctimer_list, c);
-  list_add(ctimer_list, c);
 }
 /*---------------------------------------------------------------------------*/
 void
 ctimer_reset(struct ctimer *c)
 {
+  cancel_event(c);
+  c->armed = 1;
   if(initialized) {
     PROCESS_CONTEXT_BEGIN(&ctimer_process);
     etimer_reset(&c->etimer);
     PROCESS_CONTEXT_END(&ctimer_process);
+  } else {
+    list_remove(ctimer_list, c);
+    list_add(ctimer_list, c);
   }
-
-  list_remove(ctimer_list, c);
-  list_add(ctimer_list, c);
 }
 /*---------------------------------------------------------------------------*/
 void
 ctimer_restart(struct ctimer *c)
 {
+  cancel_event(c);
+  c->armed = 1;
   if(initialized) {
     PROCESS_CONTEXT_BEGIN(&ctimer_process);
     etimer_restart(&c->etimer);
     PROCESS_CONTEXT_END(&ctimer_process);
+  } else {
+    list_remove(ctimer_list, c);
+    list_add(ctimer_list, c);
   }
-
-  list_remove(ctimer_list, c);
-  list_add(ctimer_list, c);
 }
 /*---------------------------------------------------------------------------*/
 void
 ctimer_stop(struct ctimer *c)
 {
+  cancel_event(c);
+  c->armed = 0;
   if(initialized) {
     etimer_stop(&c->etimer);
   } else {
     c->etimer.next = NULL;
     c->etimer.p = PROCESS_NONE;
+    list_remove(ctimer_list, c);
   }
-  list_remove(ctimer_list, c);
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -62,6 +62,8 @@ struct ctimer {
   struct process *p;
   void (*f)(void *);
   void *ptr;
+  /* Set while the timer is set and its callback has not been called. */
+  char armed;
 };
 
 /**
@@ -40,6 +40,8 @@
 #include "sys/energest.h"
 #include "contiki-conf.h"
 
+#include <string.h>
+
 #if ENERGEST_CONF_ON
 
 int energest_total_count;
@@ -50,6 +52,13 @@ energest_t energest_leveldevice_current_leveltime[ENERGEST_CONF_LEVELDEVICE_LEVE
 #endif
 unsigned char energest_current_mode[ENERGEST_TYPE_MAX];
 
+#if ENERGEST_PROCESSES
+static struct energest_process processes[ENERGEST_PROCESSES];
+static struct energest_process *current_process = &processes[0];
+static rtimer_clock_t process_since;
+static unsigned long process_transmit, process_listen;
+#endif /* ENERGEST_PROCESSES */
+
 /*---------------------------------------------------------------------------*/
 void
 energest_init(void)
@@ -64,6 +73,12 @@ energest_init(void)
     energest_leveldevice_current_leveltime[i].current = 0;
   }
 #endif
+#if ENERGEST_PROCESSES
+  memset(processes, 0, sizeof(processes));
+  current_process = &processes[0];
+  process_since = RTIMER_NOW();
+  process_transmit = process_listen = 0;
+#endif /* ENERGEST_PROCESSES */
 }
 /*---------------------------------------------------------------------------*/
 unsigned long
@@ -113,6 +128,77 @@ energest_flush(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if ENERGEST_PROCESSES
+static struct process *
+account(struct process *p)
+{
+  struct energest_process *e;
+  struct process *previous;
+  rtimer_clock_t now;
+  unsigned long transmit, listen;
+  int i;
+
+  now = RTIMER_NOW();
+  transmit = energest_type_time(ENERGEST_TYPE_TRANSMIT);
+  listen = energest_type_time(ENERGEST_TYPE_LISTEN);
+
+  e = current_process;
+  e->cpu += (rtimer_clock_t)(now - process_since);
+  e->transmit += transmit - process_transmit;
+  e->listen += listen - process_listen;
+  previous = e->p;
+
+  process_since = now;
+  process_transmit = transmit;
+  process_listen = listen;
+
+  /* Find the entry of the new process, or take a free one. */
+  e = &processes[0];
+  if(p != NULL) {
+    for(i = 1; i < ENERGEST_PROCESSES; i++) {
+      if(processes[i].p == p) {
+        e = &processes[i];
+        break;
+      }
+      if(processes[i].p == NULL) {
+        processes[i].p = p;
+        e = &processes[i];
+        break;
+      }
+    }
+  }
+  current_process = e;
+  return previous;
+}
+/*---------------------------------------------------------------------------*/
+struct process *
+energest_process_enter(struct process *p)
+{
+  struct process *previous;
+
+  previous = account(p);
+  current_process->calls++;
+  return previous;
+}
+/*---------------------------------------------------------------------------*/
+void
+energest_process_leave(struct process *previous)
+{
+  account(previous);
+}
+/*---------------------------------------------------------------------------*/
+struct energest_process *
+energest_process_entry(int i)
+{
+  if(i < 0 || i >= ENERGEST_PROCESSES) {
+    return NULL;
+  }
+  /* Bring the running entry up to date. */
+  account(current_process->p);
+  return &processes[i];
+}
+#endif /* ENERGEST_PROCESSES */
+/*---------------------------------------------------------------------------*/
 #else /* ENERGEST_CONF_ON */
 void energest_type_set(int type, unsigned long val) {}
 void energest_init(void) {}
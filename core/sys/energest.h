@@ -75,6 +75,38 @@ unsigned long energest_leveldevice_leveltime(int powerlevel);
 void energest_type_set(int type, unsigned long value);
 void energest_flush(void);
 
+/*
+ * Per-process accounting. When ENERGEST_CONF_PROCESSES is set, the
+ * CPU time and the radio time spent while a process is running are
+ * charged to that process. Entry 0 collects the time spent outside
+ * of any process, and the time of processes that did not get an
+ * entry of their own. Interrupts are charged to the process they
+ * interrupted.
+ */
+#ifdef ENERGEST_CONF_PROCESSES
+#define ENERGEST_PROCESSES ENERGEST_CONF_PROCESSES
+#else
+#define ENERGEST_PROCESSES 0
+#endif
+
+struct process;
+
+struct energest_process {
+  struct process *p;
+  unsigned long cpu, transmit, listen;
+  unsigned long calls;
+};
+
+/** Charge the time since the last switch to the running process
+    and start charging p. Returns the process that was running. */
+struct process *energest_process_enter(struct process *p);
+/** Charge the time since the last switch to the running process
+    and go back to charging the process that was running before. */
+void energest_process_leave(struct process *previous);
+/** Get entry i, 0 <= i < ENERGEST_PROCESSES, with the running
+    process brought up to date. Unused entries have p == NULL. */
+struct energest_process *energest_process_entry(int i);
+
 #if ENERGEST_CONF_ON
 /*extern int energest_total_count;*/
 extern energest_t energest_total_time[ENERGEST_TYPE_MAX];
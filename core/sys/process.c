@@ -47,6 +47,7 @@
 
 #include "sys/process.h"
 #include "sys/arg.h"
+#include "sys/energest.h"
 
 /*
  * Pointer to the currently running process structure.
@@ -175,6 +176,9 @@ static void
 call_process(struct process *p, process_event_t ev, process_data_t data)
 {
   int ret;
+#if ENERGEST_CONF_ON && ENERGEST_PROCESSES
+  struct process *caller;
+#endif /* ENERGEST_CONF_ON && ENERGEST_PROCESSES */
 
 #if DEBUG
   if(p->state == PROCESS_STATE_CALLED) {
@@ -187,7 +191,13 @@ call_process(struct process *p, process_event_t ev, process_data_t data)
     PRINTF("process: calling process '%s' with event %d\n", PROCESS_NAME_STRING(p), ev);
     process_current = p;
     p->state = PROCESS_STATE_CALLED;
+#if ENERGEST_CONF_ON && ENERGEST_PROCESSES
+    caller = energest_process_enter(p);
     ret = p->thread(&p->pt, ev, data);
+    energest_process_leave(caller);
+#else /* ENERGEST_CONF_ON && ENERGEST_PROCESSES */
+    ret = p->thread(&p->pt, ev, data);
+#endif /* ENERGEST_CONF_ON && ENERGEST_PROCESSES */
     if(ret == PT_EXITED ||
        ret == PT_ENDED ||
        ev == PROCESS_EVENT_EXIT) {
@@ -368,6 +378,24 @@ process_post_synch(struct process *p, process_event_t ev, process_data_t data)
 }
 /*---------------------------------------------------------------------------*/
 void
+process_post_cancel(struct process *p, process_event_t ev, process_data_t data)
+{
+  process_num_events_t i, n, from;
+
+  n = 0;
+  for(i = 0; i < nevents; ++i) {
+    from = (process_num_events_t)(fevent + i) % PROCESS_CONF_NUMEVENTS;
+    if(events[from].p != p || events[from].ev != ev ||
+       events[from].data != data) {
+      events[(process_num_events_t)(fevent + n) % PROCESS_CONF_NUMEVENTS] =
+	events[from];
+      ++n;
+    }
+  }
+  nevents = n;
+}
+/*---------------------------------------------------------------------------*/
+void
 process_poll(struct process *p)
 {
   if(p != NULL) {
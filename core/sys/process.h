@@ -377,6 +377,22 @@ CCIF int process_post(struct process *p, process_event_t ev, void* data);
 CCIF void process_post_synch(struct process *p,
 			     process_event_t ev, void* data);
 
+/**
+ * Remove asynchronous events that have not been delivered yet.
+ *
+ * This function removes the events with the given receiver, event
+ * number and data from the event queue. The other events are left
+ * in order.
+ *
+ * \param p The process to which the events were posted.
+ *
+ * \param ev The event number.
+ *
+ * \param data The auxiliary data that was posted with the events.
+ */
+CCIF void process_post_cancel(struct process *p,
+			      process_event_t ev, void* data);
+
 /**
  * \brief      Cause a process to exit
  * \param p    The process that is to be exited
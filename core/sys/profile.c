@@ -31,7 +31,6 @@
  */
 
 /**
- * \file
  *         Implementation of the Contiki profiling system
  * \author
  *         Adam Dunkels <adam@sics.se>
@@ -41,156 +40,184 @@
 #include "sys/clock.h"
 
 #include <stdio.h>
+#include <string.h>
 
-/* XXX: the profiling code is under development and may not work at
-   present. */
+/* Open-addressed hash table, keyed on the probe name. Entries are
+   never removed, so the probes can keep a pointer to their entry. */
+static struct profile_stats table[PROFILE_PROBE_SIZE];
+static uint16_t dropped;
 
+#if PROFILE_CONF_ON
+static rtimer_clock_t episode_start_time;
+#endif /* PROFILE_CONF_ON */
 
-TIMETABLE_NONSTATIC(profile_timetable);
-
-TIMETABLE_NONSTATIC(profile_begin_timetable);
-TIMETABLE_NONSTATIC(profile_end_timetable);
-TIMETABLE_AGGREGATE(profile_aggregate, PROFILE_AGGREGATE_SIZE);
+/*---------------------------------------------------------------------------*/
+static unsigned
+hash(const char *name)
+{
+  unsigned h;
 
-static rtimer_clock_t episode_start_time;
-static unsigned int invalid_episode_overflow, invalid_episode_toolong,
-  max_queuelen;
+  h = 0;
+  while(*name != '\0') {
+    h = h * 31 + (unsigned char)*name++;
+  }
+  return h;
+}
+/*---------------------------------------------------------------------------*/
+static struct profile_stats *
+lookup(const char *name)
+{
+  unsigned i, n;
+  struct profile_stats *s;
 
-/* The number of fine grained ticks per coarse grained ticks. We
-   currently (MSP430) have 2457600 ticks per second for the fine
-   grained timer, and 32678 / 8 ticks per second for the coarse. */
-#define XXX_HACK_FINE_TICKS_PER_COARSE_TICK (2457600/(32678/8))
+  i = hash(name);
+  for(n = 0; n < PROFILE_PROBE_SIZE; n++) {
+    s = &table[(i + n) & (PROFILE_PROBE_SIZE - 1)];
+    if(s->name == NULL) {
+      s->name = name;
+      s->min = (rtimer_clock_t)~0;
+      return s;
+    }
+    if(s->name == name || strcmp(s->name, name) == 0) {
+      return s;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update(struct profile_stats *s, rtimer_clock_t ticks)
+{
+  int bin;
+  rtimer_clock_t t;
 
+  s->count++;
+  s->total += ticks;
+  if(ticks < s->min) {
+    s->min = ticks;
+  }
+  if(ticks > s->max) {
+    s->max = ticks;
+  }
+  for(bin = 0, t = ticks; t != 0 && bin < PROFILE_HISTOGRAM_SIZE - 1;
+      t >>= 1) {
+    bin++;
+  }
+  if(s->histogram[bin] != 0xffff) {
+    s->histogram[bin]++;
+  }
+}
 /*---------------------------------------------------------------------------*/
 void
 profile_init(void)
 {
-  timetable_init();
-  timetable_clear(&profile_begin_timetable);
-  timetable_clear(&profile_end_timetable);
+  memset(table, 0, sizeof(table));
+  dropped = 0;
 }
 /*---------------------------------------------------------------------------*/
 void
 profile_episode_start(void)
 {
-  struct timetable_timestamp *e;
-  timetable_clear(&profile_begin_timetable);
-  timetable_clear(&profile_end_timetable);
-  episode_start_time = clock_time();
-  
-  e = timetable_entry(&profile_begin_timetable,
-		      PROFILE_TIMETABLE_SIZE - 1);
-  if(e != NULL) {
-    e->id = NULL;
-  }
-  e = timetable_entry(&profile_end_timetable,
-		      PROFILE_TIMETABLE_SIZE - 1);
-  if(e != NULL) {
-    e->id = NULL;
-  }
+#if PROFILE_CONF_ON
+  episode_start_time = RTIMER_NOW();
+#endif /* PROFILE_CONF_ON */
 }
 /*---------------------------------------------------------------------------*/
 void
 profile_episode_end(void)
 {
-  struct timetable_timestamp *e;
-  rtimer_clock_t episode_end_time = clock_time();
+#if PROFILE_CONF_ON
+  profile_record("episode", RTIMER_NOW() - episode_start_time);
+#endif /* PROFILE_CONF_ON */
+}
+/*---------------------------------------------------------------------------*/
+void
+profile_probe_end(struct profile_probe *p)
+{
+  rtimer_clock_t ticks;
 
-/*   printf("timetable_episode_end start %u, end %u, max time %u\n", episode_start_time, episode_end_time, 65536/FINE_TICKS_PER_COARSE_TICK); */
-  e = timetable_entry(&profile_begin_timetable,
-		      PROFILE_TIMETABLE_SIZE - 1);
-  if(e != NULL && e->id != NULL) {
-    /* Invalid episode because of list overflow. */
-    invalid_episode_overflow++;
-    max_queuelen = PROFILE_TIMETABLE_SIZE;
-  } else if(episode_end_time - episode_start_time >
-	    65536/XXX_HACK_FINE_TICKS_PER_COARSE_TICK) {
-    /* Invalid episode because of timer overflow. */
-    invalid_episode_toolong++;
-  } else {
-    /* Compute aggregates. */
-    if(timetable_ptr(&profile_begin_timetable) > max_queuelen) {
-      max_queuelen = timetable_ptr(&profile_begin_timetable);
+  if(p->depth == 0 || --p->depth > 0) {
+    return;
+  }
+  ticks = RTIMER_NOW() - p->start;
+  if(p->stats == NULL) {
+    p->stats = lookup(p->name);
+    if(p->stats == NULL) {
+      dropped++;
+      return;
     }
-    /*    timetable_aggregates_compute();*/
   }
+  update(p->stats, ticks);
 }
 /*---------------------------------------------------------------------------*/
-/*
- *
- * Find a specific aggregate ID in the list of aggregates.
- *
- */
-static struct timetable_aggregate_entry *
-find_aggregate(struct timetable_aggregate *a,
-	       const char *id)
+void
+profile_record(const char *name, rtimer_clock_t ticks)
 {
-  int i;
-  for(i = 0; i < a->ptr; ++i) {
-    if(a->entries[i].id == id) {
-      return &a->entries[i];
-    }
+  struct profile_stats *s;
+
+  s = lookup(name);
+  if(s == NULL) {
+    dropped++;
+    return;
   }
-  if(i == a->size) {
-    return NULL;
+  update(s, ticks);
+}
+/*---------------------------------------------------------------------------*/
+struct profile_stats *
+profile_stats_next(struct profile_stats *s)
+{
+  for(s = s == NULL ? table : s + 1; s < &table[PROFILE_PROBE_SIZE]; s++) {
+    if(s->name != NULL && s->count > 0) {
+      return s;
+    }
   }
-  a->entries[a->ptr].id = NULL;
-  return &a->entries[a->ptr++];
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+struct profile_stats *
+profile_stats_head(void)
+{
+  return profile_stats_next(NULL);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+profile_dropped(void)
+{
+  return dropped;
 }
 /*---------------------------------------------------------------------------*/
 void
-profile_aggregate_print_detailed(void)
+profile_reset(void)
 {
   int i;
-  struct timetable_aggregate *a = &profile_aggregate;
-  
-  /*  printf("timetable_aggregate_print_detailed: a ptr %d\n", a->ptr);*/
-  for(i = 0; i < a->ptr; ++i) {
-    printf("-- %s: %lu / %u = %lu\n", a->entries[i].id,
-	   a->entries[i].time,
-	   a->entries[i].episodes,
-	   a->entries[i].time / a->entries[i].episodes);
+  const char *name;
+
+  /* Keep the names, the probes still point to their entries. */
+  for(i = 0; i < PROFILE_PROBE_SIZE; i++) {
+    name = table[i].name;
+    memset(&table[i], 0, sizeof(table[i]));
+    table[i].name = name;
+    table[i].min = (rtimer_clock_t)~0;
   }
-  
-  printf("Memory for entries: %d * %d = %d\n",
-	 (int)sizeof(struct timetable_aggregate), a->ptr,
-	 (int)sizeof(struct timetable_aggregate) * a->ptr);
+  dropped = 0;
 }
 /*---------------------------------------------------------------------------*/
 void
-profile_aggregate_compute_detailed(void)
+profile_print(void)
 {
+  struct profile_stats *s;
   int i;
-  int last;
-  rtimer_clock_t t;
-  struct timetable_aggregate *a = &profile_aggregate;
-  struct timetable *timetable = &profile_timetable;
-  struct timetable_aggregate_entry *entry;
 
-  last = timetable_ptr(&profile_begin_timetable);
-  t = profile_begin_timetable.timestamps[0].time;
-  for(i = 0; i < last; ++i) {
-
-    entry = find_aggregate(a, profile_begin_timetable.timestamps[i].id);
-    if(entry == NULL) {
-      /* The list is full, skip this entry */
-      /*      printf("detailed_timetable_aggregate_compute: list full\n");*/
-    } else if(entry->id == NULL) {
-      /* The id was found in the list, so we add it. */
-      entry->id = timetable->timestamps[i - 1].id;
-      entry->time = (unsigned long)(timetable->timestamps[i].time - t -
-				    timetable_timestamp_time);
-      entry->episodes = 1;
-      /*      printf("New entry %s %lu\n", entry->id, entry->time);*/
-    } else {
-      entry->time += (unsigned long)(timetable->timestamps[i].time - t -
-				     timetable_timestamp_time);
-				     entry->episodes++;
+  for(s = profile_stats_head(); s != NULL; s = profile_stats_next(s)) {
+    printf("P %s %lu %lu %u %u %lu", s->name,
+           (unsigned long)s->count, (unsigned long)s->total,
+           (unsigned)s->min, (unsigned)s->max,
+           (unsigned long)(s->total / s->count));
+    for(i = 0; i < PROFILE_HISTOGRAM_SIZE; i++) {
+      printf(" %u", s->histogram[i]);
     }
-    t = timetable->timestamps[i].time;
-    /*    printf("a ptr %d\n", a->ptr);*/
-
+    printf("\n");
   }
-
+  printf("P dropped %u\n", dropped);
 }
 /*---------------------------------------------------------------------------*/
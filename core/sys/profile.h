@@ -40,48 +40,103 @@
 #ifndef __PROFILE_H__
 #define __PROFILE_H__
 
-/* XXX: the profiling code is under development and may not work at
-   present. */
+#include "contiki-conf.h"
+#include "sys/cc.h"
+#include "sys/rtimer.h"
 
-#define TIMETABLE_WITH_TYPE 1
-#include "sys/timetable.h"
+/*
+ * A probe is a named code section whose execution time is measured
+ * in rtimer ticks. A probe is declared once per file and then
+ * bracketed around the code to be measured:
+ *
+ *   PROFILE_PROBE(uip_process);
+ *   ...
+ *   PROFILE_PROBE_BEGIN(uip_process);
+ *   ...
+ *   PROFILE_PROBE_END(uip_process);
+ *
+ * The start time is kept in the probe itself. A probe that is entered
+ * again before it has ended, as uip_process() does when it sends a
+ * reply, counts as one execution from the outermost begin to the
+ * outermost end. Probes with the same name in
+ * different files share statistics. The probe macros compile to
+ * nothing unless PROFILE_CONF_ON is set.
+ */
 
-#ifdef PROFILE_CONF_TIMETABLE_SIZE
-#define PROFILE_TIMETABLE_SIZE PROFILE_CONF_TIMETABLE_SIZE
+/** Number of distinct probe names that can be tracked. Must be a
+    power of two. */
+#ifdef PROFILE_CONF_PROBE_SIZE
+#define PROFILE_PROBE_SIZE PROFILE_CONF_PROBE_SIZE
 #else
-#define PROFILE_TIMETABLE_SIZE 128
+#define PROFILE_PROBE_SIZE 16
 #endif
 
-#ifdef PROFILE_CONF_AGGREGATE_SIZE
-#define PROFILE_AGGREGATE_SIZE PROFILE_CONF_AGGREGATE_SIZE
+/** Number of histogram bins. Bin 0 counts durations of 0 ticks, bin
+    n counts durations of 2^(n-1) to 2^n - 1 ticks, and the last bin
+    counts everything longer. */
+#ifdef PROFILE_CONF_HISTOGRAM_SIZE
+#define PROFILE_HISTOGRAM_SIZE PROFILE_CONF_HISTOGRAM_SIZE
 #else
-#define PROFILE_AGGREGATE_SIZE 128
+#define PROFILE_HISTOGRAM_SIZE 12
 #endif
 
-#define PROFILE_BEGIN(id) TIMETABLE_TIMESTAMP_TYPE(profile_timetable, id, 1)
-#define PROFILE_END(id) TIMETABLE_TIMESTAMP_TYPE(profile_timetable, id, 2)
-
-/*#define PROFILE_COND_BEGIN(cond, id) TIMETABLE_COND_TIMESTAMP(profile_begin_timetable, \
-								  cond, id)
-#define PROFILE_COND_END(cond, id) TIMETABLE_COND_TIMESTAMP(profile_end_timetable, \
-								  cond, id)
-*/
+struct profile_stats {
+  const char *name;
+  uint32_t count;
+  uint32_t total;
+  rtimer_clock_t min, max;
+  uint16_t histogram[PROFILE_HISTOGRAM_SIZE];
+};
 
-#define profile_begin_timetable_size PROFILE_TIMETABLE_SIZE
-TIMETABLE_DECLARE(profile_begin_timetable);
-#define profile_end_timetable_size PROFILE_TIMETABLE_SIZE
-TIMETABLE_DECLARE(profile_end_timetable);
+struct profile_probe {
+  const char *name;
+  struct profile_stats *stats;
+  rtimer_clock_t start;
+  uint8_t depth;
+};
 
-#define profile_timetable_size PROFILE_TIMETABLE_SIZE
-TIMETABLE_DECLARE(profile_timetable);
+#if PROFILE_CONF_ON
+#define PROFILE_PROBE(name)                                     \
+  static struct profile_probe CC_CONCAT(profile_probe_, name) = \
+    { #name, NULL, 0, 0 }
+#define PROFILE_PROBE_BEGIN(name)                               \
+  do {                                                          \
+    if(CC_CONCAT(profile_probe_, name).depth++ == 0) {          \
+      CC_CONCAT(profile_probe_, name).start = RTIMER_NOW();     \
+    }                                                           \
+  } while(0)
+#define PROFILE_PROBE_END(name)                                 \
+  profile_probe_end(&CC_CONCAT(profile_probe_, name))
+#else /* PROFILE_CONF_ON */
+#define PROFILE_PROBE(name) struct profile_probe
+#define PROFILE_PROBE_BEGIN(name)
+#define PROFILE_PROBE_END(name)
+#endif /* PROFILE_CONF_ON */
 
 void profile_init(void);
 
+/** Start and end an iteration of the scheduler loop. The time between
+    the two calls is recorded in the "episode" probe. */
 void profile_episode_start(void);
 void profile_episode_end(void);
 
-void profile_aggregate_print_detailed(void);
-void profile_aggregate_compute_detailed(void);
+void profile_probe_end(struct profile_probe *p);
+
+/** Record a duration for a named probe. The name is looked up by
+    content, so it need not be the same pointer every time. */
+void profile_record(const char *name, rtimer_clock_t ticks);
+
+/** Iterate over the probes that have recorded at least once. */
+struct profile_stats *profile_stats_head(void);
+struct profile_stats *profile_stats_next(struct profile_stats *s);
+
+/** Number of durations dropped because the probe table was full. */
+uint16_t profile_dropped(void);
+
+void profile_reset(void);
 
+/** Print all probes, one line each, in the format
+    "P <name> <count> <total> <min> <max> <mean> <histogram...>". */
+void profile_print(void);
 
 #endif /* __PROFILE_H__ */
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2010, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ *	Tests of multi-row INSERT queries and of what a failing
+ *	batch leaves in the relation. Runs on the native platform,
+ *	whose file system can be made to fail with a file size limit.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include "contiki.h"
+#include "antelope.h"
+#include "relation.h"
+#include "unit-test.h"
+
+UNIT_TEST_REGISTER(multi_row, "Multi-row INSERT");
+UNIT_TEST_REGISTER(row_limit, "Too many rows");
+UNIT_TEST_REGISTER(domain_error, "Domain error in a batch");
+UNIT_TEST_REGISTER(storage_error, "Storage error in a batch");
+
+/* The number of rows matched by a query, or -1 on error. The values
+   of a must be equal to b / 10. */
+static long
+count_rows(const char *query)
+{
+  db_handle_t handle;
+  attribute_value_t a, b;
+  db_result_t result;
+  long rows;
+
+  if(DB_ERROR(db_query(&handle, query))) {
+    return -1;
+  }
+  rows = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      if(DB_ERROR(db_get_value(&a, &handle, 0)) ||
+         DB_ERROR(db_get_value(&b, &handle, 1)) ||
+         db_value_to_long(&a) * 10 != db_value_to_long(&b)) {
+        rows = -1;
+        break;
+      }
+      rows++;
+    } else if(result == DB_FINISHED) {
+      break;
+    } else if(DB_ERROR(result)) {
+      rows = -1;
+      break;
+    }
+  }
+  db_free(&handle);
+  return rows;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(multi_row)
+{
+  UNIT_TEST_BEGIN();
+
+  db_query(NULL, "REMOVE RELATION r;");
+  UNIT_TEST_ASSERT(!DB_ERROR(db_query(NULL, "CREATE RELATION r;")));
+  UNIT_TEST_ASSERT(!DB_ERROR(db_query(NULL,
+                                      "CREATE ATTRIBUTE a DOMAIN INT IN r;")));
+  UNIT_TEST_ASSERT(!DB_ERROR(db_query(NULL,
+                                      "CREATE ATTRIBUTE b DOMAIN INT IN r;")));
+
+  UNIT_TEST_ASSERT(!DB_ERROR(db_query(NULL,
+          "INSERT (1, 10), (2, 20), (3, 30), (4, 40), (5, 50) INTO r;")));
+  UNIT_TEST_ASSERT(count_rows("SELECT a, b FROM r;") == 5);
+  UNIT_TEST_ASSERT(count_rows("SELECT a, b FROM r WHERE a = 4;") == 1);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(row_limit)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(DB_ERROR(db_query(NULL,
+          "INSERT (6, 60), (7, 70), (8, 80), (9, 90), (10, 100), "
+          "(11, 110), (12, 120), (13, 130), (14, 140) INTO r;")));
+  UNIT_TEST_ASSERT(count_rows("SELECT a, b FROM r;") == 5);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(domain_error)
+{
+  UNIT_TEST_BEGIN();
+
+  /* All rows are checked before any is stored. */
+  UNIT_TEST_ASSERT(DB_ERROR(db_query(NULL,
+          "INSERT (6, 60), (7, 70), (8, 80), (9, 'x') INTO r;")));
+  UNIT_TEST_ASSERT(count_rows("SELECT a, b FROM r;") == 5);
+  UNIT_TEST_ASSERT(count_rows("SELECT a, b FROM r WHERE a = 6;") == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(storage_error)
+{
+  relation_t *rel;
+  struct stat st;
+  struct rlimit limit;
+  struct rlimit saved;
+  unsigned rows_per_buffer;
+  db_result_t result;
+
+  UNIT_TEST_BEGIN();
+
+  rel = relation_load("r");
+  UNIT_TEST_ASSERT(rel != NULL);
+  UNIT_TEST_ASSERT(stat(rel->tuple_filename, &st) == 0);
+  rows_per_buffer = DB_INSERT_BUFFER_SIZE / rel->row_length;
+  UNIT_TEST_ASSERT(rows_per_buffer > 0 && rows_per_buffer < 8);
+
+  /* Room for the first buffer of the batch only. */
+  signal(SIGXFSZ, SIG_IGN);
+  getrlimit(RLIMIT_FSIZE, &saved);
+  limit = saved;
+  limit.rlim_cur = st.st_size + rows_per_buffer * rel->row_length;
+  setrlimit(RLIMIT_FSIZE, &limit);
+  result = db_query(NULL, "INSERT (20, 200), (21, 210), (22, 220), (23, 230), "
+                    "(24, 240), (25, 250), (26, 260), (27, 270) INTO r;");
+  setrlimit(RLIMIT_FSIZE, &saved);
+  relation_release(rel);
+
+  UNIT_TEST_ASSERT(result == DB_STORAGE_ERROR);
+
+  /* The rows of the first buffer are stored, the others are not. */
+  UNIT_TEST_ASSERT(count_rows("SELECT a, b FROM r;") == 5 + rows_per_buffer);
+  UNIT_TEST_ASSERT(count_rows("SELECT a, b FROM r WHERE a = 20;") == 1);
+  UNIT_TEST_ASSERT(count_rows("SELECT a, b FROM r WHERE a = 27;") == 0);
+
+  /* The relation takes new rows after the failure. */
+  UNIT_TEST_ASSERT(!DB_ERROR(db_query(NULL, "INSERT (30, 300), (31, 310) INTO r;")));
+  UNIT_TEST_ASSERT(count_rows("SELECT a, b FROM r;") == 7 + rows_per_buffer);
+  UNIT_TEST_ASSERT(count_rows("SELECT a, b FROM r WHERE a = 31;") == 1);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(insert_test_process, "Multi-row INSERT test");
+AUTOSTART_PROCESSES(&insert_test_process);
+
+PROCESS_THREAD(insert_test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  db_init();
+
+  UNIT_TEST_RUN(multi_row);
+  UNIT_TEST_RUN(row_limit);
+  UNIT_TEST_RUN(domain_error);
+  UNIT_TEST_RUN(storage_error);
+
+  db_query(NULL, "REMOVE RELATION r;");
+
+  PROCESS_END();
+}
@@ -0,0 +1,14 @@
+#undef DB_FEATURE_JOIN
+#define DB_FEATURE_JOIN                      0
+
+/* Multi-row INSERT, stored three rows of two INT values at a time, so
+   that a batch spans several buffers. */
+#undef AQL_INSERT_ROW_LIMIT
+#define AQL_INSERT_ROW_LIMIT                 8
+
+#undef DB_INSERT_BUFFER_SIZE
+#define DB_INSERT_BUFFER_SIZE                12
+
+/* The native platform has no Coffee file system. */
+#undef DB_FEATURE_COFFEE
+#define DB_FEATURE_COFFEE                    0
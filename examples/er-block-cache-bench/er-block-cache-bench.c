@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Benchmark of the Block2 cache of the CoAP engine. A client
+ *         fetches a .well-known/core of about 2 KB in 64-byte blocks.
+ *         Without the cache, the resource directory is rendered up to
+ *         the requested offset for every block. With the cache, it is
+ *         rendered once and the blocks are served from the pool. Both
+ *         ways are timed and their results compared.
+ */
+
+#include "contiki.h"
+#include "er-coap-07-engine.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define FETCHES         2000
+#define BLOCK_SIZE      REST_MAX_CHUNK_SIZE
+#define DOCUMENT_SIZE   2048
+
+/* 24 resources with long link attributes make up a 2 KB resource directory. */
+#define SENSOR(n) \
+  RESOURCE(sensor_##n, METHOD_GET, "sensors/reading-" #n, \
+           "title=\"Temperature reading " #n "\";rt=\"ucum:Cel\";if=\"core.s\";ct=0"); \
+  void \
+  sensor_##n##_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset) \
+  { \
+  }
+
+SENSOR(00) SENSOR(01) SENSOR(02) SENSOR(03) SENSOR(04) SENSOR(05)
+SENSOR(06) SENSOR(07) SENSOR(08) SENSOR(09) SENSOR(10) SENSOR(11)
+SENSOR(12) SENSOR(13) SENSOR(14) SENSOR(15) SENSOR(16) SENSOR(17)
+SENSOR(18) SENSOR(19) SENSOR(20) SENSOR(21) SENSOR(22) SENSOR(23)
+
+static resource_t *sensors[] = {
+  &resource_sensor_00, &resource_sensor_01, &resource_sensor_02, &resource_sensor_03,
+  &resource_sensor_04, &resource_sensor_05, &resource_sensor_06, &resource_sensor_07,
+  &resource_sensor_08, &resource_sensor_09, &resource_sensor_10, &resource_sensor_11,
+  &resource_sensor_12, &resource_sensor_13, &resource_sensor_14, &resource_sensor_15,
+  &resource_sensor_16, &resource_sensor_17, &resource_sensor_18, &resource_sensor_19,
+  &resource_sensor_20, &resource_sensor_21, &resource_sensor_22, &resource_sensor_23
+};
+
+static coap_packet_t request[1];
+static coap_packet_t response[1];
+static uint8_t buffer[BLOCK_SIZE + 1];
+static char document[2][DOCUMENT_SIZE + 1];
+static uint16_t document_len[2];
+static uip_ipaddr_t client_addr;
+static unsigned long calls;
+
+PROCESS(er_block_cache_bench_process, "Block2 cache benchmark");
+AUTOSTART_PROCESSES(&er_block_cache_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+append(int i)
+{
+  if(document_len[i] + response->payload_len <= DOCUMENT_SIZE) {
+    memcpy(&document[i][document_len[i]], response->payload, response->payload_len);
+    document_len[i] += response->payload_len;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+service(void *request, void *response, uint8_t *buffer, uint16_t buffer_size, int32_t *offset)
+{
+  calls++;
+  return rest_invoke_restful_service(request, response, buffer, buffer_size, offset);
+}
+/*---------------------------------------------------------------------------*/
+/* What the engine does without the cache: invoke the resource for every block. */
+static unsigned
+fetch_rendered(void)
+{
+  uint32_t block_num;
+  int32_t offset;
+
+  document_len[0] = 0;
+  block_num = 0;
+  do {
+    coap_set_header_block2(request, block_num, 0, BLOCK_SIZE);
+    coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, request->mid);
+    offset = block_num * BLOCK_SIZE;
+    service(request, response, buffer, BLOCK_SIZE, &offset);
+    append(0);
+    block_num++;
+  } while(offset != -1);
+
+  return block_num;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+fetch_cached(void)
+{
+  coap_cached_blocks_t *c;
+  uint32_t block_num;
+
+  document_len[1] = 0;
+  block_num = 0;
+  do {
+    coap_set_header_block2(request, block_num, 0, BLOCK_SIZE);
+    coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, request->mid);
+    c = coap_get_cached_blocks(request, &client_addr, UIP_HTONS(COAP_DEFAULT_PORT),
+                               BLOCK_SIZE, service);
+    if(c == NULL) {
+      printf("block %lu not cached\n", (unsigned long)block_num);
+      return 0;
+    }
+    coap_set_cached_block(c, response, block_num, BLOCK_SIZE);
+    append(1);
+    block_num++;
+  } while(response->block2_more);
+
+  return block_num;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(er_block_cache_bench_process, ev, data)
+{
+  static const uint8_t token[] = { 0xbe, 0xef };
+  clock_time_t start, rendered_time, cached_time;
+  unsigned long rendered_calls, cached_calls;
+  unsigned i, blocks;
+
+  PROCESS_BEGIN();
+
+  rest_init_engine();
+  for(i = 0; i < sizeof(sensors) / sizeof(sensors[0]); i++) {
+    rest_activate_resource(sensors[i]);
+  }
+  /* Let the CoAP receiver activate .well-known/core. */
+  PROCESS_PAUSE();
+
+  uip_ip6addr(&client_addr, 0xfe80, 0, 0, 0, 0, 0, 0, 1);
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, 1);
+  coap_set_header_uri_path(request, ".well-known/core");
+  coap_set_header_token(request, token, sizeof(token));
+
+  calls = 0;
+  start = clock_time();
+  for(i = 0; i < FETCHES; i++) {
+    blocks = fetch_rendered();
+  }
+  rendered_time = clock_time() - start;
+  rendered_calls = calls;
+
+  calls = 0;
+  start = clock_time();
+  for(i = 0; i < FETCHES; i++) {
+    fetch_cached();
+  }
+  cached_time = clock_time() - start;
+  cached_calls = calls;
+
+  printf("%u fetches of %u bytes in %u blocks of %u bytes\n",
+         FETCHES, document_len[0], blocks, BLOCK_SIZE);
+  printf("rendered per block: %lu ms, %lu resource calls\n",
+         (unsigned long)(rendered_time * 1000 / CLOCK_SECOND), rendered_calls);
+  printf("cached:             %lu ms, %lu resource calls\n",
+         (unsigned long)(cached_time * 1000 / CLOCK_SECOND), cached_calls);
+  printf("representations %s\n",
+         document_len[0] == document_len[1] &&
+         memcmp(document[0], document[1], document_len[0]) == 0 ?
+         "identical" : "DIFFER");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         End-to-end test of Block1 uploads. A client pushes 64 KB in
+ *         64-byte blocks through the CoAP receiver to a resource that
+ *         streams the blocks into a CFS file. The requests are fed to
+ *         the receiver process the way uIP delivers them, and the
+ *         responses are taken from the output function of uIP. The
+ *         file is read back and compared. A block retransmitted with
+ *         the same or a new MID, a missing block, an upload announced
+ *         too large, and a resource that does not handle Block1 are
+ *         checked as well.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "cfs/cfs.h"
+#include "er-coap-07-engine.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define UPLOAD_SIZE     65536UL
+#define MAX_UPLOAD_SIZE 131072UL
+#define BLOCK_SIZE      REST_MAX_CHUNK_SIZE
+#define FILENAME        "upload"
+
+/*---------------------------------------------------------------------------*/
+/* Server side */
+RESOURCE(upload, METHOD_PUT, "upload", "title=\"Streaming upload\"");
+RESOURCE(plain, METHOD_PUT, "plain", "title=\"Single packet upload\"");
+
+static int fd = -1;
+static int block_calls;
+
+static coap_status_t
+upload_block_handler(void *request, void *response, uint32_t offset, const uint8_t *data, uint16_t len, uint32_t size, uint8_t more)
+{
+  block_calls++;
+  if(offset == 0) {
+    if(size > MAX_UPLOAD_SIZE) {
+      coap_set_header_size(response, MAX_UPLOAD_SIZE);
+      return REQUEST_ENTITY_TOO_LARGE_4_13;
+    }
+    if(fd >= 0) {
+      cfs_close(fd);
+    }
+    if((fd = cfs_open(FILENAME, CFS_WRITE)) < 0) {
+      return INTERNAL_SERVER_ERROR_5_00;
+    }
+  }
+  if(fd < 0 || cfs_write(fd, data, len) != len) {
+    return INTERNAL_SERVER_ERROR_5_00;
+  }
+  if(!more) {
+    cfs_close(fd);
+    fd = -1;
+  }
+  return NO_ERROR;
+}
+
+void
+upload_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  if(coap_block1_stream(&UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport, request, response, upload_block_handler)) {
+    REST.set_response_status(response, REST.status.CHANGED);
+  }
+}
+
+void
+plain_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  REST.set_response_status(response, REST.status.CHANGED);
+}
+/*---------------------------------------------------------------------------*/
+/* Client side */
+static coap_packet_t request[1];
+static coap_packet_t reply[1];
+static uint8_t request_buf[COAP_MAX_PACKET_SIZE + 1];
+static uint16_t request_len;
+static uint8_t reply_buf[COAP_MAX_PACKET_SIZE + 1];
+static uint16_t reply_len;
+static uint8_t payload[BLOCK_SIZE];
+static uint16_t mid;
+static int failures;
+
+static uip_ipaddr_t client_addr;
+static uip_lladdr_t client_lladdr;
+
+PROCESS(er_block1_upload_process, "Block1 upload test");
+AUTOSTART_PROCESSES(&er_block1_upload_process);
+/*---------------------------------------------------------------------------*/
+static uint8_t
+data_at(uint32_t offset)
+{
+  return (uint8_t)((offset * 31) ^ (offset >> 8));
+}
+/*---------------------------------------------------------------------------*/
+/* Takes the place of the radio. */
+static uint8_t
+output(uip_lladdr_t *lladdr)
+{
+  reply_len = uip_len - UIP_IPUDPH_LEN;
+  memcpy(reply_buf, &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN], reply_len);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Delivers the request to the CoAP receiver and parses the reply. */
+static void
+send_request(void)
+{
+  uip_ext_len = 0;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, &client_addr);
+  UIP_UDP_BUF->srcport = UIP_HTONS(COAP_DEFAULT_PORT);
+  UIP_UDP_BUF->destport = UIP_HTONS(COAP_DEFAULT_PORT);
+  uip_appdata = &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
+  memcpy(uip_appdata, request_buf, request_len);
+  uip_len = request_len;
+  uip_flags = UIP_NEWDATA;
+
+  reply_len = 0;
+  process_post_synch(&coap_receiver, tcpip_event, NULL);
+  uip_flags = 0;
+  uip_len = 0;
+
+  memset(reply, 0, sizeof(reply));
+  if(reply_len > 0) {
+    coap_parse_message(reply, reply_buf, reply_len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Sends one block to the given resource. */
+static void
+put_block_to(const char *path, uint32_t num, uint8_t more, uint32_t size)
+{
+  static const uint8_t token[] = { 0x0b, 0x1c };
+  uint16_t i;
+
+  coap_init_message(request, COAP_TYPE_CON, COAP_PUT, ++mid);
+  coap_set_header_uri_path(request, path);
+  coap_set_header_token(request, token, sizeof(token));
+  coap_set_header_block1(request, num, more, BLOCK_SIZE);
+  if(num == 0 && size > 0) {
+    coap_set_header_size(request, size);
+  }
+  for(i = 0; i < BLOCK_SIZE; i++) {
+    payload[i] = data_at(num * BLOCK_SIZE + i);
+  }
+  coap_set_payload(request, payload, BLOCK_SIZE);
+  request_len = coap_serialize_message(request, request_buf);
+
+  send_request();
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_block(uint32_t num, uint8_t more, uint32_t size)
+{
+  put_block_to("upload", num, more, size);
+}
+/*---------------------------------------------------------------------------*/
+static void
+expect(const char *what, uint8_t code, uint32_t num, uint8_t more)
+{
+  if(reply->code != code ||
+     (code < BAD_REQUEST_4_00 &&
+      (!IS_OPTION(reply, COAP_OPTION_BLOCK1) || reply->block1_num != num || reply->block1_more != more))) {
+    printf("%s: code %u block %lu%s, expected %u block %lu%s\n", what,
+           reply->code, (unsigned long)reply->block1_num, reply->block1_more ? "+" : "",
+           code, (unsigned long)num, more ? "+" : "");
+    failures++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_file(void)
+{
+  static uint8_t buf[256];
+  uint32_t offset;
+  int i, n, cfd;
+
+  if((cfd = cfs_open(FILENAME, CFS_READ)) < 0) {
+    return 0;
+  }
+  offset = 0;
+  while((n = cfs_read(cfd, buf, sizeof(buf))) > 0) {
+    for(i = 0; i < n; i++, offset++) {
+      if(buf[i] != data_at(offset)) {
+        printf("byte %lu differs\n", (unsigned long)offset);
+        cfs_close(cfd);
+        return 0;
+      }
+    }
+  }
+  cfs_close(cfd);
+  printf("read back %lu bytes\n", (unsigned long)offset);
+  return offset == UPLOAD_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(er_block1_upload_process, ev, data)
+{
+  static uint32_t num, last;
+  static int calls;
+  clock_time_t start;
+
+  PROCESS_BEGIN();
+
+  rest_init_engine();
+  rest_activate_resource(&resource_upload);
+  rest_activate_resource(&resource_plain);
+
+  /* The client is a neighbor, so that replies need no neighbor discovery. */
+  uip_ip6addr(&client_addr, 0xfe80, 0, 0, 0, 0, 0, 0, 1);
+  memset(&client_lladdr, 0x11, sizeof(client_lladdr));
+  uip_ds6_nbr_add(&client_addr, &client_lladdr, 0, NBR_REACHABLE);
+  tcpip_set_outputfunc(output);
+
+  /* Refused by the engine for a resource that does not handle Block1. */
+  put_block_to("plain", 0, 1, 0);
+  expect("no Block1 support", NOT_IMPLEMENTED_5_01, 0, 0);
+
+  /* Rejected early with the announced size. */
+  put_block(0, 1, 1024UL * 1024);
+  expect("too large", REQUEST_ENTITY_TOO_LARGE_4_13, 0, 0);
+
+  /* A gap is detected. */
+  put_block(0, 1, UPLOAD_SIZE);
+  expect("block 0", CHANGED_2_04, 0, 1);
+  put_block(2, 1, 0);
+  expect("gap", REQUEST_ENTITY_INCOMPLETE_4_08, 0, 0);
+
+  /* The upload. */
+  last = UPLOAD_SIZE / BLOCK_SIZE - 1;
+  start = clock_time();
+  for(num = 0; num <= last; num++) {
+    put_block(num, num < last, UPLOAD_SIZE);
+    expect("upload", CHANGED_2_04, num, num < last);
+    if(num == 100) {
+      /* Retransmitted with the same MID: answered by the engine. */
+      calls = block_calls;
+      send_request();
+      expect("duplicate", CHANGED_2_04, num, 1);
+      if(block_calls != calls) {
+        printf("duplicate: passed to the resource again\n");
+        failures++;
+      }
+      /* Retransmitted with a new MID: answered by coap_block1_stream(). */
+      put_block(num, 1, 0);
+      expect("retransmission", CHANGED_2_04, num, 1);
+      if(block_calls != calls) {
+        printf("retransmission: block passed to the handler again\n");
+        failures++;
+      }
+    }
+  }
+  printf("uploaded %lu bytes in %lu blocks in %lu ms\n", UPLOAD_SIZE,
+         (unsigned long)last + 1,
+         (unsigned long)((clock_time() - start) * 1000 / CLOCK_SECOND));
+
+  if(!check_file()) {
+    failures++;
+  }
+  cfs_remove(FILENAME);
+
+  printf("%s\n", failures ? "TEST FAILED" : "TEST OK");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Benchmark of the URL dispatch of Erbium. 32 resources in the
+ *         style of an IPSO object tree and one resource with
+ *         sub-resources are requested through rest_invoke_restful_service(),
+ *         which looks them up in the dispatch index, and through the
+ *         linear search over the resource list that was used before.
+ *         Both are timed and their results compared. Then
+ *         .well-known/core is fetched blockwise from the precomputed
+ *         link-format string and checked.
+ */
+
+#include "contiki.h"
+#include "er-coap-07-engine.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define ROUNDS          20000
+#define BLOCK_SIZE      REST_MAX_CHUNK_SIZE
+#define DOCUMENT_SIZE   COAP_LINK_FORMAT_SIZE
+
+static resource_t *handled;
+
+#define IPSO(object, instance, res) \
+  RESOURCE(ipso_##object##_##instance##_##res, METHOD_GET, #object "/" #instance "/" #res, \
+           "rt=\"ipso." #object "\";if=\"core.s\""); \
+  void \
+  ipso_##object##_##instance##_##res##_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset) \
+  { \
+    handled = &resource_ipso_##object##_##instance##_##res; \
+  }
+
+IPSO(3303, 0, 5700) IPSO(3303, 0, 5701) IPSO(3303, 0, 5601) IPSO(3303, 0, 5602)
+IPSO(3303, 1, 5700) IPSO(3303, 1, 5701) IPSO(3303, 1, 5601) IPSO(3303, 1, 5602)
+IPSO(3304, 0, 5700) IPSO(3304, 0, 5701) IPSO(3304, 0, 5601) IPSO(3304, 0, 5602)
+IPSO(3304, 1, 5700) IPSO(3304, 1, 5701) IPSO(3304, 1, 5601) IPSO(3304, 1, 5602)
+IPSO(3311, 0, 5700) IPSO(3311, 0, 5701) IPSO(3311, 0, 5601) IPSO(3311, 0, 5602)
+IPSO(3311, 1, 5700) IPSO(3311, 1, 5701) IPSO(3311, 1, 5601) IPSO(3311, 1, 5602)
+IPSO(3315, 0, 5700) IPSO(3315, 0, 5701) IPSO(3315, 0, 5601) IPSO(3315, 0, 5602)
+IPSO(3315, 1, 5700) IPSO(3315, 1, 5701) IPSO(3315, 1, 5601) IPSO(3315, 1, 5602)
+
+RESOURCE(firmware, METHOD_GET | METHOD_PUT | HAS_SUB_RESOURCES, "fw", "title=\"Firmware images\"");
+void
+firmware_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  handled = &resource_firmware;
+}
+
+static resource_t *resources[] = {
+  &resource_ipso_3303_0_5700, &resource_ipso_3303_0_5701, &resource_ipso_3303_0_5601,
+  &resource_ipso_3303_0_5602, &resource_ipso_3303_1_5700, &resource_ipso_3303_1_5701,
+  &resource_ipso_3303_1_5601, &resource_ipso_3303_1_5602, &resource_ipso_3304_0_5700,
+  &resource_ipso_3304_0_5701, &resource_ipso_3304_0_5601, &resource_ipso_3304_0_5602,
+  &resource_ipso_3304_1_5700, &resource_ipso_3304_1_5701, &resource_ipso_3304_1_5601,
+  &resource_ipso_3304_1_5602, &resource_ipso_3311_0_5700, &resource_ipso_3311_0_5701,
+  &resource_ipso_3311_0_5601, &resource_ipso_3311_0_5602, &resource_ipso_3311_1_5700,
+  &resource_ipso_3311_1_5701, &resource_ipso_3311_1_5601, &resource_ipso_3311_1_5602,
+  &resource_ipso_3315_0_5700, &resource_ipso_3315_0_5701, &resource_ipso_3315_0_5601,
+  &resource_ipso_3315_0_5602, &resource_ipso_3315_1_5700, &resource_ipso_3315_1_5701,
+  &resource_ipso_3315_1_5601, &resource_ipso_3315_1_5602
+};
+
+/* Requests for every resource, below the sub-resource one, and a miss. */
+static const char *urls[] = {
+  "3303/0/5700", "3303/1/5602", "3304/0/5701", "3304/1/5601",
+  "3311/0/5700", "3311/1/5602", "3315/0/5601", "3315/1/5701",
+  "fw", "fw/image/3", "3315/2/5700"
+};
+#define URLS (sizeof(urls) / sizeof(urls[0]))
+
+static coap_packet_t request[1];
+static coap_packet_t response[1];
+static uint8_t buffer[BLOCK_SIZE + 1];
+static char expected[DOCUMENT_SIZE + 1];
+static char document[DOCUMENT_SIZE + 1];
+static uint16_t document_len;
+
+PROCESS(er_dispatch_bench_process, "URL dispatch benchmark");
+AUTOSTART_PROCESSES(&er_dispatch_bench_process);
+/*---------------------------------------------------------------------------*/
+/* The dispatch loop as it was before the index: a linear search over all resources. */
+static int
+invoke_linear(void *request, void *response, uint8_t *buffer, uint16_t buffer_size, int32_t *offset)
+{
+  resource_t *resource;
+  const char *url = NULL;
+
+  for(resource = (resource_t *)list_head(rest_get_resources()); resource; resource = resource->next) {
+    if((REST.get_url(request, &url) == strlen(resource->url) ||
+        (REST.get_url(request, &url) > strlen(resource->url) && (resource->flags & HAS_SUB_RESOURCES))) &&
+       strncmp(resource->url, url, strlen(resource->url)) == 0) {
+      if(resource->flags & REST.get_method_type(request)) {
+        resource->handler(request, response, buffer, buffer_size, offset);
+        return 1;
+      }
+      REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
+      return 0;
+    }
+  }
+  REST.set_response_status(response, REST.status.NOT_FOUND);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+run(int (*invoke)(void *, void *, uint8_t *, uint16_t, int32_t *), resource_t **results)
+{
+  clock_time_t start;
+  int32_t offset;
+  unsigned i, u;
+
+  start = clock_time();
+  for(i = 0; i < ROUNDS; i++) {
+    for(u = 0; u < URLS; u++) {
+      coap_set_header_uri_path(request, urls[u]);
+      coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, request->mid);
+      handled = NULL;
+      offset = 0;
+      invoke(request, response, buffer, BLOCK_SIZE, &offset);
+      results[u] = response->code == NOT_FOUND_4_04 ? NULL : handled;
+    }
+  }
+  return clock_time() - start;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+fetch_well_known(void)
+{
+  uint32_t block_num;
+  int32_t offset;
+
+  coap_set_header_uri_path(request, ".well-known/core");
+  document_len = 0;
+  block_num = 0;
+  do {
+    coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, request->mid);
+    offset = block_num * BLOCK_SIZE;
+    rest_invoke_restful_service(request, response, buffer, BLOCK_SIZE, &offset);
+    if(document_len + response->payload_len <= DOCUMENT_SIZE) {
+      memcpy(&document[document_len], response->payload, response->payload_len);
+      document_len += response->payload_len;
+    }
+    block_num++;
+  } while(offset != -1);
+
+  return block_num;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(er_dispatch_bench_process, ev, data)
+{
+  static resource_t *linear_results[URLS], *indexed_results[URLS];
+  clock_time_t linear_time, indexed_time, start;
+  resource_t *resource;
+  unsigned i, blocks;
+  int len;
+
+  PROCESS_BEGIN();
+
+  rest_init_engine();
+  for(i = 0; i < sizeof(resources) / sizeof(resources[0]); i++) {
+    rest_activate_resource(resources[i]);
+  }
+  rest_activate_resource(&resource_firmware);
+  /* Let the CoAP receiver activate .well-known/core. */
+  PROCESS_PAUSE();
+
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, 1);
+
+  linear_time = run(invoke_linear, linear_results);
+  indexed_time = run(rest_invoke_restful_service, indexed_results);
+
+  printf("%u rounds of %u requests over %u resources\n",
+         ROUNDS, (unsigned)URLS, list_length(rest_get_resources()));
+  printf("linear search: %lu ms\n",
+         (unsigned long)(linear_time * 1000 / CLOCK_SECOND));
+  printf("dispatch index: %lu ms\n",
+         (unsigned long)(indexed_time * 1000 / CLOCK_SECOND));
+  printf("resources %s\n",
+         memcmp(linear_results, indexed_results, sizeof(linear_results)) == 0 ?
+         "identical" : "DIFFER");
+
+  /* The link format as the handler renders it. */
+  len = 0;
+  for(resource = (resource_t *)list_head(rest_get_resources()); resource; resource = resource->next) {
+    len += snprintf(expected + len, sizeof(expected) - len, "</%s>%s%s%s", resource->url,
+                    resource->attributes[0] ? ";" : "", resource->attributes,
+                    resource->next ? "," : "");
+  }
+
+  start = clock_time();
+  for(i = 0; i < ROUNDS / 10; i++) {
+    blocks = fetch_well_known();
+  }
+  printf(".well-known/core: %u fetches of %u bytes in %u blocks in %lu ms\n",
+         ROUNDS / 10, document_len, blocks,
+         (unsigned long)((clock_time() - start) * 1000 / CLOCK_SECOND));
+  printf("link format %s\n",
+         document_len == len && memcmp(document, expected, len) == 0 ?
+         "identical" : "DIFFER");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
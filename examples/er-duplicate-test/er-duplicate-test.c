@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Tests of the duplicate detection of the CoAP-07 engine. The
+ *         requests are fed to the CoAP receiver process the way uIP
+ *         delivers them, and the responses are taken from the output
+ *         function of uIP.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "er-coap-07-engine.h"
+#include "unit-test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define UIP_IP_BUF   ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF  ((struct uip_udp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+
+UNIT_TEST_REGISTER(retransmission, "Retransmitted CON answered from the cache");
+UNIT_TEST_REGISTER(other_endpoint, "Same MID from another port is new");
+UNIT_TEST_REGISTER(non_request, "Retransmitted NON not served again");
+
+/*---------------------------------------------------------------------------*/
+/* Counts how often it has been invoked. */
+RESOURCE(counter, METHOD_GET, "counter", "title=\"Counter\"");
+
+static int invocations;
+
+void
+counter_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  int len;
+
+  len = snprintf((char *)buffer, preferred_size, "%d", ++invocations);
+  REST.set_response_payload(response, buffer, len);
+}
+/*---------------------------------------------------------------------------*/
+static uip_ipaddr_t client_addr;
+static uip_lladdr_t client_lladdr;
+
+static uint8_t request_buf[COAP_MAX_PACKET_SIZE];
+static uint8_t reply_buf[COAP_MAX_PACKET_SIZE];
+static uint16_t reply_len;
+static int replies;
+static coap_packet_t reply[1];
+/*---------------------------------------------------------------------------*/
+/* Takes the place of the radio. */
+static uint8_t
+output(uip_lladdr_t *lladdr)
+{
+  replies++;
+  reply_len = uip_len - UIP_IPUDPH_LEN;
+  memcpy(reply_buf, &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN], reply_len);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Delivers a GET of /counter to the CoAP receiver, and returns the
+   number of datagrams it sent back. */
+static int
+get(uint8_t type, uint16_t mid, uint16_t port)
+{
+  static coap_packet_t request[1];
+  uint16_t len;
+  int before;
+
+  coap_init_message(request, type, COAP_GET, mid);
+  coap_set_header_uri_path(request, "counter");
+  len = coap_serialize_message(request, request_buf);
+
+  uip_ext_len = 0;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, &client_addr);
+  UIP_UDP_BUF->srcport = UIP_HTONS(port);
+  UIP_UDP_BUF->destport = UIP_HTONS(COAP_DEFAULT_PORT);
+  uip_appdata = &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
+  memcpy(uip_appdata, request_buf, len);
+  uip_len = len;
+  uip_flags = UIP_NEWDATA;
+
+  before = replies;
+  process_post_synch(&coap_receiver, tcpip_event, NULL);
+  uip_flags = 0;
+  uip_len = 0;
+
+  if(replies > before) {
+    coap_parse_message(reply, reply_buf, reply_len);
+  }
+  return replies - before;
+}
+/*---------------------------------------------------------------------------*/
+static int
+reply_is(const char *payload)
+{
+  return reply->payload_len == strlen(payload) &&
+    memcmp(reply->payload, payload, reply->payload_len) == 0;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(retransmission)
+{
+  static uint8_t first[COAP_MAX_PACKET_SIZE];
+  static uint16_t first_len;
+  uint32_t hits;
+
+  UNIT_TEST_BEGIN();
+
+  hits = coap_duplicate_stats.hits;
+
+  UNIT_TEST_ASSERT(get(COAP_TYPE_CON, 100, 5000) == 1);
+  UNIT_TEST_ASSERT(reply->type == COAP_TYPE_ACK && reply->mid == 100);
+  UNIT_TEST_ASSERT(reply_is("1"));
+  memcpy(first, reply_buf, reply_len);
+  first_len = reply_len;
+
+  /* The same response, without invoking the resource again. */
+  UNIT_TEST_ASSERT(get(COAP_TYPE_CON, 100, 5000) == 1);
+  UNIT_TEST_ASSERT(reply_len == first_len && memcmp(reply_buf, first, first_len) == 0);
+  UNIT_TEST_ASSERT(invocations == 1);
+  UNIT_TEST_ASSERT(coap_duplicate_stats.hits == hits + 1);
+
+  /* A new MID is a new request. */
+  UNIT_TEST_ASSERT(get(COAP_TYPE_CON, 101, 5000) == 1);
+  UNIT_TEST_ASSERT(reply->mid == 101 && reply_is("2"));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(other_endpoint)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(get(COAP_TYPE_CON, 101, 5001) == 1);
+  UNIT_TEST_ASSERT(reply->mid == 101 && reply_is("3"));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(non_request)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(get(COAP_TYPE_NON, 200, 5000) == 1);
+  UNIT_TEST_ASSERT(reply->type == COAP_TYPE_NON && reply_is("4"));
+
+  /* Answered again with the same response, not handled again. */
+  UNIT_TEST_ASSERT(get(COAP_TYPE_NON, 200, 5000) == 1);
+  UNIT_TEST_ASSERT(reply_is("4"));
+  UNIT_TEST_ASSERT(invocations == 4);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(er_duplicate_test_process, "Duplicate detection test");
+AUTOSTART_PROCESSES(&er_duplicate_test_process);
+
+PROCESS_THREAD(er_duplicate_test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  rest_init_engine();
+  rest_activate_resource(&resource_counter);
+
+  /* The client is a neighbor, so that replies need no neighbor discovery. */
+  uip_ip6addr(&client_addr, 0xfe80, 0, 0, 0, 0, 0, 0, 1);
+  memset(&client_lladdr, 0x11, sizeof(client_lladdr));
+  uip_ds6_nbr_add(&client_addr, &client_lladdr, 0, NBR_REACHABLE);
+  tcpip_set_outputfunc(output);
+
+  UNIT_TEST_RUN(retransmission);
+  UNIT_TEST_RUN(other_endpoint);
+  UNIT_TEST_RUN(non_request);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Fetches /log from the RPL root, alternating between the
+ *         stop-and-wait COAP_BLOCKING_REQUEST() and
+ *         COAP_PIPELINED_REQUEST() with COAP_NSTART blocks in flight,
+ *         and prints the transfer times.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "net/rpl/rpl.h"
+#include "er-coap-07-engine.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "er-pipeline-bench.h"
+
+#define ROUNDS          5
+#define SETTLE_TIME     (20 * CLOCK_SECOND)
+#define REMOTE_PORT     UIP_HTONS(COAP_DEFAULT_PORT)
+
+static uip_ipaddr_t server_ipaddr;
+static uint32_t received;
+static uint8_t corrupt;
+
+PROCESS(er_pipeline_client_process, "Pipelined blockwise client");
+AUTOSTART_PROCESSES(&er_pipeline_client_process);
+/*---------------------------------------------------------------------------*/
+static void
+log_chunk_handler(void *response)
+{
+  uint8_t *chunk;
+  int i, len;
+
+  len = coap_get_payload(response, &chunk);
+  for(i = 0; i < len; i++) {
+    if(chunk[i] != LOG_BYTE(received + i)) {
+      corrupt = 1;
+    }
+  }
+  received += len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *mode, clock_time_t start)
+{
+  printf("%s: %lu bytes in %lu ms%s\n", mode, (unsigned long)received,
+         (unsigned long)((clock_time() - start) * 1000 / CLOCK_SECOND),
+         received != LOG_SIZE || corrupt ? " FAILED" : "");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(er_pipeline_client_process, ev, data)
+{
+  static coap_packet_t request[1];
+  static struct etimer et;
+  static clock_time_t start;
+  static int round;
+  rpl_dag_t *dag;
+
+  PROCESS_BEGIN();
+
+  coap_receiver_init();
+
+  /* Wait until the node has joined the DAG, whose ID is the server address. */
+  etimer_set(&et, CLOCK_SECOND);
+  while((dag = rpl_get_any_dag()) == NULL || !dag->joined) {
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    etimer_reset(&et);
+  }
+  uip_ipaddr_copy(&server_ipaddr, &dag->dag_id);
+
+  /* Give the DAOs time to set up the downward routes. */
+  etimer_set(&et, SETTLE_TIME);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  for(round = 0; round < ROUNDS; round++) {
+    coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
+    coap_set_header_uri_path(request, "log");
+    received = 0;
+    corrupt = 0;
+    start = clock_time();
+    COAP_BLOCKING_REQUEST(&server_ipaddr, REMOTE_PORT, request, log_chunk_handler);
+    report("stop-and-wait", start);
+
+    coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
+    coap_set_header_uri_path(request, "log");
+    received = 0;
+    corrupt = 0;
+    start = clock_time();
+    COAP_PIPELINED_REQUEST(&server_ipaddr, REMOTE_PORT, request, log_chunk_handler);
+    report("pipelined", start);
+  }
+  printf("done\n");
+
+  /* Let make bench continue with the next hop count. */
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
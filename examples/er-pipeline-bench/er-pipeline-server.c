@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         RPL root that serves /log, a representation of LOG_SIZE
+ *         bytes, blockwise to er-pipeline-client.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "net/rpl/rpl.h"
+#include "er-coap-07-engine.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "er-pipeline-bench.h"
+
+RESOURCE(log, METHOD_GET, "log", "title=\"Benchmark log\";sz=" LOG_SIZE_STRING);
+
+void
+log_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  uint16_t len;
+
+  if(*offset >= LOG_SIZE) {
+    REST.set_response_status(response, REST.status.BAD_OPTION);
+    REST.set_response_payload(response, "BlockOutOfScope", 15);
+    return;
+  }
+
+  for(len = 0; len < preferred_size && *offset + len < LOG_SIZE; len++) {
+    buffer[len] = LOG_BYTE(*offset + len);
+  }
+  REST.set_header_content_type(response, REST.type.APPLICATION_OCTET_STREAM);
+  REST.set_response_payload(response, buffer, len);
+
+  *offset += len;
+  if(*offset >= LOG_SIZE) {
+    *offset = -1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(er_pipeline_server_process, "Pipelined blockwise server");
+AUTOSTART_PROCESSES(&er_pipeline_server_process);
+
+PROCESS_THREAD(er_pipeline_server_process, ev, data)
+{
+  uip_ipaddr_t ipaddr;
+  rpl_dag_t *dag;
+
+  PROCESS_BEGIN();
+
+  uip_ip6addr(&ipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(&ipaddr, &uip_lladdr);
+  uip_ds6_addr_add(&ipaddr, 0, ADDR_MANUAL);
+  dag = rpl_set_root(RPL_DEFAULT_INSTANCE, &ipaddr);
+  uip_ip6addr(&ipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
+  rpl_set_prefix(dag, &ipaddr, 64);
+
+  rest_init_engine();
+  rest_activate_resource(&resource_log);
+
+  printf("serving %u bytes\n", LOG_SIZE);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
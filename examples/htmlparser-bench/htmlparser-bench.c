@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Throughput benchmark of the web browser's HTML parser. A
+ *         corpus of saved pages is fed to the parser in TCP-sized
+ *         segments, and the words, links and form widgets it reports
+ *         are summed up, so that changes to the parser can be checked
+ *         for both speed and output.
+ */
+
+#include "contiki.h"
+#include "htmlparser.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define ROUNDS       2000
+#define PAGE_SIZE    32768
+#define SEGMENT_SIZE 536
+
+static const char *pages[] = {
+  "pages/uip.html",
+  "pages/index.html",
+  "../../tools/6502/contiki.html",
+  "../../apps/webserver/httpd-fs/index.html",
+};
+#define NUM_PAGES (sizeof(pages) / sizeof(pages[0]))
+
+static char page[PAGE_SIZE];
+static char segment[SEGMENT_SIZE];
+
+/* The output is only summed up in the first round, so that the timed
+   rounds measure the parser rather than the checksum. */
+static int checking;
+static unsigned long sum;
+static unsigned long words, links, widgets;
+
+PROCESS(htmlparser_bench_process, "HTML parser benchmark");
+AUTOSTART_PROCESSES(&htmlparser_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+add_string(const char *str)
+{
+  if(!checking) {
+    return;
+  }
+  while(*str != '\0') {
+    sum = sum * 31 + (unsigned char)*str++;
+  }
+  sum = sum * 31;
+}
+/*---------------------------------------------------------------------------*/
+void
+htmlparser_word(char *word, unsigned char wordlen)
+{
+  sum = sum * 31 + wordlen;
+  add_string(word);
+  words++;
+}
+/*---------------------------------------------------------------------------*/
+void
+htmlparser_link(char *text, unsigned char textlen, char *url)
+{
+  sum = sum * 31 + textlen;
+  add_string(text);
+  add_string(url);
+  links++;
+}
+/*---------------------------------------------------------------------------*/
+void
+htmlparser_newline(void)
+{
+  sum = sum * 31 + '\n';
+}
+/*---------------------------------------------------------------------------*/
+void
+htmlparser_submitbutton(char *value, char *name,
+                        char *formname, char *formaction)
+{
+  add_string(value);
+  add_string(name);
+  add_string(formname);
+  add_string(formaction);
+  widgets++;
+}
+/*---------------------------------------------------------------------------*/
+void
+htmlparser_inputfield(unsigned char size, char *value, char *name,
+                      char *formname, char *formaction)
+{
+  sum = sum * 31 + size;
+  add_string(value);
+  add_string(name);
+  add_string(formname);
+  add_string(formaction);
+  widgets++;
+}
+/*---------------------------------------------------------------------------*/
+void
+htmlparser_renderstate(unsigned char state)
+{
+  sum = sum * 31 + state;
+}
+/*---------------------------------------------------------------------------*/
+/* Parse a page in segments, copied out like www.c gets them from the
+   web client. */
+static void
+parse_page(int len)
+{
+  int pos, n;
+
+  htmlparser_init();
+  for(pos = 0; pos < len; pos += n) {
+    n = len - pos < SEGMENT_SIZE ? len - pos : SEGMENT_SIZE;
+    memcpy(segment, &page[pos], n);
+    htmlparser_parse(segment, n);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(htmlparser_bench_process, ev, data)
+{
+  FILE *f;
+  clock_time_t start, time;
+  unsigned long bytes, total_bytes, total_time;
+  int i, len;
+  unsigned p;
+
+  PROCESS_BEGIN();
+
+  total_bytes = total_time = 0;
+  for(p = 0; p < NUM_PAGES; p++) {
+    f = fopen(pages[p], "r");
+    if(f == NULL) {
+      printf("%s: cannot open\n", pages[p]);
+      continue;
+    }
+    len = fread(page, 1, sizeof(page), f);
+    fclose(f);
+
+    sum = words = links = widgets = 0;
+    checking = 1;
+    parse_page(len);
+    checking = 0;
+    printf("%s: %d bytes, %lu words, %lu links, %lu widgets, sum %08lx\n",
+           pages[p], len, words, links, widgets, sum & 0xffffffffUL);
+
+    start = clock_time();
+    for(i = 0; i < ROUNDS; i++) {
+      parse_page(len);
+    }
+    time = clock_time() - start;
+    bytes = (unsigned long)len * ROUNDS;
+    printf("  %lu ms, %lu kB/s\n",
+           (unsigned long)(time * 1000 / CLOCK_SECOND),
+           time == 0 ? 0 : bytes * CLOCK_SECOND / time / 1024);
+    total_bytes += bytes;
+    total_time += time;
+  }
+  printf("total: %lu kB in %lu ms, %lu kB/s\n",
+         total_bytes / 1024,
+         (unsigned long)(total_time * 1000 / CLOCK_SECOND),
+         total_time == 0 ? 0 :
+         total_bytes * CLOCK_SECOND / total_time / 1024);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
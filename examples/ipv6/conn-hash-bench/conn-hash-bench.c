@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of TCP/IP input demultiplexing with many UDP
+ *         connections. Build with CONN_HASH=0 or CONN_HASH=1 to
+ *         compare the linear scan against the connection hash.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_SOCKETS   1000
+#define ROUNDS        200
+#define BASE_PORT     20000
+#define PAYLOAD_LEN   4
+
+#define UIP_IP_BUF    ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF   ((struct uip_udp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+
+static unsigned long received;
+
+PROCESS(conn_hash_bench_process, "Connection hash benchmark");
+PROCESS(sink_process, "Benchmark sink");
+AUTOSTART_PROCESSES(&conn_hash_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sink_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == tcpip_event);
+    if(uip_newdata()) {
+      received++;
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+input_packet(const uip_ipaddr_t *dest, uint16_t port)
+{
+  memset(uip_buf, 0, UIP_LLH_LEN + UIP_IPUDPH_LEN + PAYLOAD_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[0] = 0;
+  UIP_IP_BUF->len[1] = UIP_UDPH_LEN + PAYLOAD_LEN;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0x99);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, dest);
+  UIP_UDP_BUF->srcport = UIP_HTONS(5683);
+  UIP_UDP_BUF->destport = uip_htons(port);
+  UIP_UDP_BUF->udplen = UIP_HTONS(UIP_UDPH_LEN + PAYLOAD_LEN);
+  uip_len = UIP_IPUDPH_LEN + PAYLOAD_LEN;
+  uip_ext_len = 0;
+  UIP_UDP_BUF->udpchksum = ~(uip_udpchksum());
+  if(UIP_UDP_BUF->udpchksum == 0) {
+    UIP_UDP_BUF->udpchksum = 0xffff;
+  }
+  uip_input();
+  uip_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(conn_hash_bench_process, ev, data)
+{
+  static struct etimer et;
+  static uip_ipaddr_t dest;
+  uip_ds6_addr_t *lladdr;
+  struct uip_udp_conn *conn;
+  clock_time_t start, ticks;
+  unsigned long rounds;
+  int i;
+
+  PROCESS_BEGIN();
+
+  /* Let tcpip_process initialize the stack first. */
+  etimer_set(&et, CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  lladdr = uip_ds6_get_link_local(-1);
+  if(lladdr == NULL) {
+    printf("No link-local address\n");
+    PROCESS_EXIT();
+  }
+  uip_ipaddr_copy(&dest, &lladdr->ipaddr);
+
+  process_start(&sink_process, NULL);
+  PROCESS_CONTEXT_BEGIN(&sink_process);
+  for(i = 0; i < NUM_SOCKETS; i++) {
+    conn = udp_new(NULL, 0, NULL);
+    if(conn == NULL) {
+      printf("Could only allocate %d sockets\n", i);
+      break;
+    }
+    udp_bind(conn, UIP_HTONS(BASE_PORT + i));
+  }
+  PROCESS_CONTEXT_END(&sink_process);
+
+  printf("Demultiplexing over %d UDP sockets, connection hash %s\n",
+         i, UIP_CONF_CONN_HASH ? "on" : "off");
+
+  received = 0;
+  rounds = 0;
+  start = clock_time();
+  while(rounds < ROUNDS) {
+    for(i = 0; i < NUM_SOCKETS; i++) {
+      /* Spread the packets over the whole port range. */
+      input_packet(&dest, BASE_PORT + (i * 7919UL) % NUM_SOCKETS);
+    }
+    rounds++;
+  }
+  ticks = clock_time() - start;
+
+  printf("%lu packets, %lu delivered, %lu ms, %lu packets/s\n",
+         rounds * NUM_SOCKETS, received,
+         (unsigned long)(ticks * 1000 / CLOCK_SECOND),
+         ticks > 0 ? rounds * NUM_SOCKETS * CLOCK_SECOND / ticks : 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of 6LoWPAN IPHC header compression over a trace
+ *         of captured IPv6 packets. Each packet is compressed, the
+ *         resulting frames are counted and the first frame is
+ *         decompressed again to check that the packet is unchanged.
+ *
+ *         The trace (trace.txt, or the file given on the command
+ *         line) has one packet per line as hex, starting with the
+ *         IPv6 header. A line "c <cid> <prefix>" makes a 64 bit
+ *         prefix known as context <cid>, as if it had been learned
+ *         from a 6CO option. Lines starting with '#' are ignored.
+ *
+ *         The trace is run twice, first with the static contexts
+ *         only and then with the contexts of the trace as well.
+ *
+ *         Build with GHC=1 to compress ICMPv6 messages with Generic
+ *         Header Compression, as if the contexts had been announced
+ *         with the G flag. The bytes saved by GHC are then counted
+ *         per message type.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "net/sicslowpan.h"
+#include "net/mac/mac.h"
+#include "net/rime.h"
+#ifdef SICSLOWPAN_NH_COMPRESSOR
+#include "net/sicslowpan-ghc.h"
+#endif /* SICSLOWPAN_NH_COMPRESSOR */
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#define UIP_IP_BUF    ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+#define LINE_LEN      (2 * UIP_BUFSIZE + 2)
+
+extern int contiki_argc;
+extern char **contiki_argv;
+
+static uint8_t packet[UIP_BUFSIZE];
+static uint16_t packet_len;
+
+/* The frames of the packet being compressed */
+static uint8_t frame[PACKETBUF_SIZE];
+static uint16_t frame_len;
+static uint16_t frame_bytes;
+static uint8_t frames;
+static uint8_t verifying;
+static uint8_t verified;
+
+struct result {
+  unsigned long packets;
+  unsigned long ip_bytes;
+  unsigned long frame_bytes;
+  unsigned long fragmented;
+  unsigned long errors;
+};
+
+PROCESS(iphc_bench_process, "IPHC benchmark");
+AUTOSTART_PROCESSES(&iphc_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+send(mac_callback_t sent, void *ptr)
+{
+  if(!verifying) {
+    if(frames == 0) {
+      frame_len = packetbuf_datalen();
+      memcpy(frame, packetbuf_dataptr(), frame_len);
+    }
+    frame_bytes += packetbuf_datalen();
+    frames++;
+  }
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver iphc_bench_mac_driver = {
+  "iphc-bench",
+  init,
+  send,
+  input,
+  on,
+  off,
+  channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
+/* Called by sicslowpan with the decompressed packet in uip_buf */
+static void
+sniffer_input(void)
+{
+  if(verifying) {
+    verified = uip_len == packet_len &&
+      memcmp(UIP_IP_BUF, packet, packet_len) == 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+sniffer_output(int mac_status)
+{
+}
+/*---------------------------------------------------------------------------*/
+RIME_SNIFFER(sniffer, sniffer_input, sniffer_output);
+/*---------------------------------------------------------------------------*/
+static int
+hex(const char *s, uint8_t *buf, int max)
+{
+  int len, c;
+  unsigned int b;
+
+  for(len = 0; *s != '\0' && !isspace((unsigned char)*s); len++) {
+    if(len >= max || sscanf(s, "%2x%n", &b, &c) != 1 || c != 2) {
+      return -1;
+    }
+    buf[len] = b;
+    s += 2;
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+/* The link-layer address that an IID was derived from */
+static void
+iid_to_lladdr(const uip_ipaddr_t *addr, uip_lladdr_t *lladdr)
+{
+  memcpy(lladdr, &addr->u8[8], sizeof(uip_lladdr_t));
+  lladdr->addr[0] ^= 0x02;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_packet(struct result *r)
+{
+  uip_lladdr_t dest;
+  uip_lladdr_t own;
+
+  r->packets++;
+  r->ip_bytes += packet_len;
+
+  /* Compress as the sender of the packet would have */
+  memcpy(&own, &uip_lladdr, sizeof(own));
+  iid_to_lladdr(&UIP_IP_BUF->srcipaddr, &uip_lladdr);
+  iid_to_lladdr(&UIP_IP_BUF->destipaddr, &dest);
+
+  frames = 0;
+  frame_bytes = 0;
+  uip_len = packet_len;
+  uip_ext_len = 0;
+  if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
+    tcpip_output(NULL);
+  } else {
+    tcpip_output(&dest);
+  }
+  uip_len = 0;
+  r->frame_bytes += frame_bytes;
+
+  if(frames > 1) {
+    r->fragmented++;
+  } else if(frames == 1) {
+    /* Decompress again, as the receiver would */
+    packetbuf_clear();
+    packetbuf_copyfrom(frame, frame_len);
+    packetbuf_set_addr(PACKETBUF_ADDR_SENDER, (rimeaddr_t *)&uip_lladdr);
+    if(uip_is_addr_mcast(&((struct uip_ip_hdr *)packet)->destipaddr)) {
+      packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &rimeaddr_null);
+    } else {
+      packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, (rimeaddr_t *)&dest);
+    }
+    verifying = 1;
+    verified = 0;
+    NETSTACK_NETWORK.input();
+    verifying = 0;
+    if(!verified) {
+      printf("Packet %lu changed by compression\n", r->packets);
+      r->errors++;
+    }
+  } else {
+    printf("Packet %lu was not sent\n", r->packets);
+    r->errors++;
+  }
+
+  memcpy(&uip_lladdr, &own, sizeof(own));
+}
+/*---------------------------------------------------------------------------*/
+static int
+run_trace(const char *name, uint8_t use_contexts, struct result *r)
+{
+  static char line[LINE_LEN];
+  uint8_t prefix[8];
+  unsigned int cid;
+  char prefixhex[17];
+  FILE *f;
+  int len;
+
+  f = fopen(name, "r");
+  if(f == NULL) {
+    printf("Cannot open %s\n", name);
+    return 0;
+  }
+
+  memset(r, 0, sizeof(*r));
+  while(fgets(line, sizeof(line), f) != NULL) {
+    if(line[0] == '#' || isspace((unsigned char)line[0])) {
+      continue;
+    }
+    if(line[0] == 'c') {
+      if(sscanf(line, "c %u %16s", &cid, prefixhex) != 2 ||
+         hex(prefixhex, prefix, sizeof(prefix)) != sizeof(prefix)) {
+        printf("Bad context line: %s", line);
+        continue;
+      }
+      sicslowpan_context_set(cid, prefix, 1,
+                             use_contexts ? SICSLOWPAN_CONTEXT_INFINITE_LIFETIME : 0);
+      sicslowpan_context_set_nh_compress(cid, 1);
+      continue;
+    }
+    len = hex(line, packet, sizeof(packet));
+    if(len < UIP_IPH_LEN ||
+       len != UIP_IPH_LEN + ((packet[4] << 8) | packet[5])) {
+      printf("Bad packet line: %s", line);
+      continue;
+    }
+    packet_len = len;
+    memcpy(UIP_IP_BUF, packet, packet_len);
+    run_packet(r);
+  }
+  fclose(f);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_result(const char *title, const struct result *r)
+{
+  printf("%s: %lu packets, %lu IPv6 bytes, %lu 6LoWPAN bytes",
+         title, r->packets, r->ip_bytes, r->frame_bytes);
+  if(r->ip_bytes > 0) {
+    printf(" (%lu%%)", r->frame_bytes * 100 / r->ip_bytes);
+  }
+  if(r->packets > 0) {
+    printf(", %lu bytes saved per packet",
+           (r->ip_bytes - r->frame_bytes) / r->packets);
+  }
+  printf(", %lu fragmented, %lu errors\n", r->fragmented, r->errors);
+}
+/*---------------------------------------------------------------------------*/
+#ifdef SICSLOWPAN_NH_COMPRESSOR
+static void
+print_ghc_stats(void)
+{
+  const struct sicslowpan_ghc_stats *s;
+  int i;
+
+  for(i = 0; (s = sicslowpan_ghc_stats(i)) != NULL; i++) {
+    printf("GHC ICMPv6 type %u code %u: %u messages, %lu bytes to %lu",
+           s->type, s->code, s->messages,
+           (unsigned long)s->uncompressed, (unsigned long)s->compressed);
+    printf(", %lu bytes saved per message\n",
+           (unsigned long)(s->uncompressed - s->compressed) / s->messages);
+  }
+}
+#endif /* SICSLOWPAN_NH_COMPRESSOR */
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(iphc_bench_process, ev, data)
+{
+  static struct etimer et;
+  static struct result without, with;
+  const char *name;
+
+  PROCESS_BEGIN();
+
+  /* Let tcpip_process initialize the stack first. */
+  etimer_set(&et, CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  name = contiki_argc > 1 ? contiki_argv[1] : "trace.txt";
+  rime_sniffer_add(&sniffer);
+
+  if(run_trace(name, 0, &without)) {
+#ifdef SICSLOWPAN_NH_COMPRESSOR
+    /* Only count the run with all contexts */
+    sicslowpan_ghc_stats_reset();
+#endif /* SICSLOWPAN_NH_COMPRESSOR */
+    if(run_trace(name, 1, &with)) {
+      print_result("Static contexts", &without);
+      print_result("Learned contexts", &with);
+#ifdef SICSLOWPAN_NH_COMPRESSOR
+      print_ghc_stats();
+#endif /* SICSLOWPAN_NH_COMPRESSOR */
+    }
+  }
+
+  rime_sniffer_remove(&sniffer);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
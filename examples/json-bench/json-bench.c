@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Benchmark of the JSON library. A tree of 16 sensors is
+ *         printed through a putchar function, through a buffer that
+ *         is flushed in spans, and in 64-byte chunks like a REST
+ *         resource would produce its blocks. The document is then
+ *         parsed as a whole and as a stream of small fragments. All
+ *         ways are timed and their results compared.
+ */
+
+#include "contiki.h"
+#include "jsontree.h"
+#include "jsonparse.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define ROUNDS          20000
+#define CHUNK_SIZE      64
+#define WINDOW_SIZE     48
+#define DOCUMENT_SIZE   2048
+
+static struct jsontree_string unit = JSONTREE_STRING("Cel");
+
+#define SENSOR(n) \
+  static struct jsontree_string name_##n = JSONTREE_STRING("temperature-" #n); \
+  static struct jsontree_int value_##n = { JSON_TYPE_INT, 2000 + 37 * 1##n }; \
+  static struct jsontree_int min_##n = { JSON_TYPE_INT, 1500 + 11 * 1##n }; \
+  static struct jsontree_int max_##n = { JSON_TYPE_INT, 2500 + 13 * 1##n }; \
+  JSONTREE_OBJECT(sensor_##n, \
+                  JSONTREE_PAIR("name", &name_##n), \
+                  JSONTREE_PAIR("unit", &unit), \
+                  JSONTREE_PAIR("value", &value_##n), \
+                  JSONTREE_PAIR("min", &min_##n), \
+                  JSONTREE_PAIR("max", &max_##n));
+
+SENSOR(00) SENSOR(01) SENSOR(02) SENSOR(03)
+SENSOR(04) SENSOR(05) SENSOR(06) SENSOR(07)
+SENSOR(08) SENSOR(09) SENSOR(10) SENSOR(11)
+SENSOR(12) SENSOR(13) SENSOR(14) SENSOR(15)
+
+static struct jsontree_value *sensor_list[] = {
+  (struct jsontree_value *)&sensor_00, (struct jsontree_value *)&sensor_01,
+  (struct jsontree_value *)&sensor_02, (struct jsontree_value *)&sensor_03,
+  (struct jsontree_value *)&sensor_04, (struct jsontree_value *)&sensor_05,
+  (struct jsontree_value *)&sensor_06, (struct jsontree_value *)&sensor_07,
+  (struct jsontree_value *)&sensor_08, (struct jsontree_value *)&sensor_09,
+  (struct jsontree_value *)&sensor_10, (struct jsontree_value *)&sensor_11,
+  (struct jsontree_value *)&sensor_12, (struct jsontree_value *)&sensor_13,
+  (struct jsontree_value *)&sensor_14, (struct jsontree_value *)&sensor_15
+};
+static struct jsontree_array sensors = {
+  JSON_TYPE_ARRAY, sizeof(sensor_list) / sizeof(sensor_list[0]), sensor_list
+};
+static struct jsontree_string node = JSONTREE_STRING("node \"7\"");
+
+JSONTREE_OBJECT(root,
+                JSONTREE_PAIR("node", &node),
+                JSONTREE_PAIR("sensors", &sensors));
+
+static char document[3][DOCUMENT_SIZE];
+static int document_len[3];
+static char chunk[CHUNK_SIZE];
+
+PROCESS(json_bench_process, "JSON benchmark");
+AUTOSTART_PROCESSES(&json_bench_process);
+/*---------------------------------------------------------------------------*/
+static int
+document_putchar(int c)
+{
+  if(document_len[0] < DOCUMENT_SIZE) {
+    document[0][document_len[0]++] = c;
+  }
+  return c;
+}
+/*---------------------------------------------------------------------------*/
+static int
+document_flush(struct jsontree_buffer *out)
+{
+  if(document_len[1] + out->pos > DOCUMENT_SIZE) {
+    return 0;
+  }
+  memcpy(&document[1][document_len[1]], out->buf, out->pos);
+  document_len[1] += out->pos;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* A checksum over the elements and values the parser returns. */
+static unsigned long
+parse_step(struct jsonparse_state *js, unsigned long sum, int type)
+{
+  char value[32];
+  int i;
+
+  sum = sum * 31 + type;
+  if((type == JSON_TYPE_PAIR_NAME || type == JSON_TYPE_STRING ||
+      type == JSON_TYPE_NUMBER) &&
+     jsonparse_copy_value(js, value, sizeof(value))) {
+    for(i = 0; value[i] != '\0'; i++) {
+      sum = sum * 31 + (unsigned char)value[i];
+    }
+  }
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+parse_whole(int *elements)
+{
+  struct jsonparse_state js;
+  unsigned long sum = 0;
+  int type;
+
+  *elements = 0;
+  jsonparse_setup(&js, document[0], document_len[0]);
+  while((type = jsonparse_next(&js)) != 0) {
+    sum = parse_step(&js, sum, type);
+    (*elements)++;
+  }
+  return js.error ? 0 : sum;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+parse_stream(int *elements)
+{
+  static char window[WINDOW_SIZE];
+  struct jsonparse_state js;
+  unsigned long sum = 0;
+  int type, pos, len;
+
+  *elements = 0;
+  jsonparse_setup_stream(&js, window, sizeof(window));
+  pos = 0;
+  len = 1;
+  while(1) {
+    while((type = jsonparse_next(&js)) != 0) {
+      sum = parse_step(&js, sum, type);
+      (*elements)++;
+    }
+    if(js.error != JSON_ERROR_INCOMPLETE) {
+      break;
+    }
+    /* Fragments of 1 to 23 bytes, as they may arrive from the network. */
+    if(pos < document_len[0]) {
+      len = len % 23 + 1;
+      if(len > document_len[0] - pos) {
+        len = document_len[0] - pos;
+      }
+      pos += jsonparse_feed(&js, &document[0][pos], len);
+    } else {
+      jsonparse_feed(&js, NULL, 0);
+    }
+  }
+  return js.error ? 0 : sum;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(json_bench_process, ev, data)
+{
+  static struct jsontree_context js_ctx;
+  static struct jsontree_buffer out;
+  clock_time_t start;
+  int32_t offset;
+  unsigned long whole_sum, stream_sum;
+  int whole_elements, stream_elements;
+  int i, len;
+
+  PROCESS_BEGIN();
+
+  start = clock_time();
+  for(i = 0; i < ROUNDS; i++) {
+    document_len[0] = 0;
+    jsontree_setup(&js_ctx, (struct jsontree_value *)&root, document_putchar);
+    while(jsontree_print_next(&js_ctx));
+  }
+  printf("%d prints of %d bytes\n", ROUNDS, document_len[0]);
+  printf("putchar:  %lu ms\n",
+         (unsigned long)((clock_time() - start) * 1000 / CLOCK_SECOND));
+
+  start = clock_time();
+  for(i = 0; i < ROUNDS; i++) {
+    document_len[1] = 0;
+    out.buf = chunk;
+    out.size = sizeof(chunk);
+    out.flush = document_flush;
+    jsontree_setup_buffer(&js_ctx, (struct jsontree_value *)&root, &out);
+    while(jsontree_print_next(&js_ctx));
+    jsontree_flush(&js_ctx);
+  }
+  printf("buffered: %lu ms, output %s\n",
+         (unsigned long)((clock_time() - start) * 1000 / CLOCK_SECOND),
+         document_len[0] == document_len[1] &&
+         memcmp(document[0], document[1], document_len[0]) == 0 ?
+         "identical" : "DIFFERS");
+
+  start = clock_time();
+  for(i = 0; i < ROUNDS; i++) {
+    document_len[2] = 0;
+    offset = 0;
+    jsontree_setup(&js_ctx, (struct jsontree_value *)&root, NULL);
+    do {
+      jsontree_reset(&js_ctx);
+      len = jsontree_print_chunk(&js_ctx, chunk, sizeof(chunk), &offset);
+      memcpy(&document[2][document_len[2]], chunk, len);
+      document_len[2] += len;
+    } while(offset != -1 && document_len[2] + sizeof(chunk) <= DOCUMENT_SIZE);
+  }
+  printf("chunked:  %lu ms in %d-byte chunks, output %s\n",
+         (unsigned long)((clock_time() - start) * 1000 / CLOCK_SECOND),
+         CHUNK_SIZE,
+         document_len[0] == document_len[2] &&
+         memcmp(document[0], document[2], document_len[0]) == 0 ?
+         "identical" : "DIFFERS");
+
+  start = clock_time();
+  for(i = 0; i < ROUNDS; i++) {
+    whole_sum = parse_whole(&whole_elements);
+  }
+  printf("parse whole document: %lu ms, %d elements\n",
+         (unsigned long)((clock_time() - start) * 1000 / CLOCK_SECOND),
+         whole_elements);
+
+  start = clock_time();
+  for(i = 0; i < ROUNDS; i++) {
+    stream_sum = parse_stream(&stream_elements);
+  }
+  printf("parse stream:         %lu ms, %d elements in a %d-byte window, %s\n",
+         (unsigned long)((clock_time() - start) * 1000 / CLOCK_SECOND),
+         stream_elements, WINDOW_SIZE,
+         whole_sum != 0 && whole_sum == stream_sum &&
+         whole_elements == stream_elements ? "identical" : "DIFFERS");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Tests of the DNS cache of the resolver. resolv_process is
+ *         driven the way uIP would drive it: it is polled to send its
+ *         queries, and answers are handed to it as new data.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "contiki-net.h"
+#include "unit-test.h"
+
+UNIT_TEST_REGISTER(ttl_expiry, "Answers are kept for their TTL");
+UNIT_TEST_REGISTER(negative, "NXDOMAIN is remembered");
+UNIT_TEST_REGISTER(parallel, "Parallel queries");
+
+/* Not declared by uip.h, but needed to stand in for uIP's UDP
+   processing. */
+extern uint16_t uip_slen;
+extern void *uip_sappdata;
+
+#define DNS_NXDOMAIN 3
+
+static struct uip_udp_conn *conn;
+static uip_ipaddr_t addr_a, addr_b, addr_c;
+/*---------------------------------------------------------------------------*/
+/* Let the resolver send a query, if it has one due. Returns the DNS
+   id and copies the name asked for, or returns -1 if nothing was
+   sent. */
+static long
+poll_query(char *name)
+{
+  uint8_t *p;
+  uint8_t n;
+
+  uip_udp_conn = conn;
+  uip_flags = UIP_POLL;
+  uip_sappdata = uip_appdata = &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
+  uip_slen = 0;
+  process_post_synch(&resolv_process, tcpip_event, NULL);
+  if(uip_slen == 0) {
+    return -1;
+  }
+
+  p = (uint8_t *)uip_appdata + 12;
+  while((n = *p++) != 0) {
+    memcpy(name, p, n);
+    name += n;
+    p += n;
+    *name++ = *p != 0 ? '.' : 0;
+  }
+  p = uip_appdata;
+  return (p[0] << 8) | p[1];
+}
+/*---------------------------------------------------------------------------*/
+/* Hand the resolver an answer to the query with the given id: the
+   address with its TTL, or an error code if addr is NULL. */
+static void
+answer(long id, const char *name, uip_ipaddr_t *addr, uint32_t ttl,
+       uint8_t err)
+{
+  uint8_t *p, *label;
+  const char *c;
+
+  p = uip_appdata = &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
+  memset(p, 0, 12);
+  p[0] = id >> 8;
+  p[1] = id;
+  p[2] = 0x81;
+  p[3] = 0x80 | err;
+  p[5] = 1;
+  p[7] = addr != NULL;
+  p += 12;
+
+  label = p++;
+  for(c = name; *c != 0; ++c) {
+    if(*c == '.') {
+      *label = p - label - 1;
+      label = p++;
+    } else {
+      *p++ = *c;
+    }
+  }
+  *label = p - label - 1;
+  *p++ = 0;
+  *p++ = 0; *p++ = 1;                     /* Type A */
+  *p++ = 0; *p++ = 1;                     /* Class IN */
+
+  if(addr != NULL) {
+    *p++ = 0xc0; *p++ = 12;               /* The name of the question */
+    *p++ = 0; *p++ = 1;
+    *p++ = 0; *p++ = 1;
+    *p++ = ttl >> 24; *p++ = ttl >> 16; *p++ = ttl >> 8; *p++ = ttl;
+    *p++ = 0; *p++ = 4;
+    memcpy(p, addr, 4);
+    p += 4;
+  }
+
+  uip_udp_conn = conn;
+  uip_flags = UIP_NEWDATA;
+  uip_len = p - (uint8_t *)uip_appdata;
+  process_post_synch(&resolv_process, tcpip_event, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_addr(uip_ipaddr_t *found, uip_ipaddr_t *addr)
+{
+  return found != NULL && uip_ipaddr_cmp(found, addr);
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(ttl_expiry)
+{
+  struct resolv_stats before;
+  char name[32];
+  long id;
+
+  UNIT_TEST_BEGIN();
+
+  /* The way most applications resolve a name: look it up, and ask
+     the server if it is not in the cache. */
+  before = resolv_stats;
+  UNIT_TEST_ASSERT(resolv_lookup("a.example") == NULL);
+  resolv_query("a.example");
+  id = poll_query(name);
+  UNIT_TEST_ASSERT(id >= 0 && strcmp(name, "a.example") == 0);
+  answer(id, "a.example", &addr_a, 2, 0);
+  UNIT_TEST_ASSERT(is_addr(resolv_lookup("a.example"), &addr_a));
+
+  /* That was one miss, and nothing else. */
+  UNIT_TEST_ASSERT(resolv_stats.misses == before.misses + 1);
+  UNIT_TEST_ASSERT(resolv_stats.hits == before.hits);
+  UNIT_TEST_ASSERT(resolv_stats.queries == before.queries + 1);
+
+  /* Until the TTL runs out, the name is answered from the cache. */
+  UNIT_TEST_ASSERT(is_addr(resolv_lookup("a.example"), &addr_a));
+  UNIT_TEST_ASSERT(resolv_stats.hits == before.hits + 1);
+  resolv_query("a.example");
+  UNIT_TEST_ASSERT(poll_query(name) < 0);
+  UNIT_TEST_ASSERT(resolv_stats.misses == before.misses + 1);
+
+  sleep(3);
+  UNIT_TEST_ASSERT(resolv_lookup("a.example") == NULL);
+  UNIT_TEST_ASSERT(resolv_stats.expired == before.expired + 1);
+  resolv_query("a.example");
+  id = poll_query(name);
+  UNIT_TEST_ASSERT(id >= 0 && strcmp(name, "a.example") == 0);
+  UNIT_TEST_ASSERT(resolv_stats.misses == before.misses + 2);
+  answer(id, "a.example", &addr_a, 2, 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(negative)
+{
+  struct resolv_stats before;
+  char name[32];
+  long id;
+
+  UNIT_TEST_BEGIN();
+
+  resolv_query("nx.example");
+  id = poll_query(name);
+  UNIT_TEST_ASSERT(id >= 0 && strcmp(name, "nx.example") == 0);
+  answer(id, "nx.example", NULL, 0, DNS_NXDOMAIN);
+  UNIT_TEST_ASSERT(resolv_lookup("nx.example") == NULL);
+
+  /* The server is not asked again while the failure is remembered. */
+  before = resolv_stats;
+  resolv_query("nx.example");
+  UNIT_TEST_ASSERT(poll_query(name) < 0);
+  UNIT_TEST_ASSERT(resolv_stats.negative_hits == before.negative_hits + 1);
+  UNIT_TEST_ASSERT(resolv_stats.misses == before.misses);
+
+  sleep(3);
+  resolv_query("nx.example");
+  id = poll_query(name);
+  UNIT_TEST_ASSERT(id >= 0 && strcmp(name, "nx.example") == 0);
+  UNIT_TEST_ASSERT(resolv_stats.misses == before.misses + 1);
+  answer(id, "nx.example", NULL, 0, DNS_NXDOMAIN);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(parallel)
+{
+  char name1[32], name2[32];
+  long id1, id2;
+
+  UNIT_TEST_BEGIN();
+
+  /* Both queries are sent before any answer has come. */
+  resolv_query("b.example");
+  resolv_query("c.example");
+  id1 = poll_query(name1);
+  id2 = poll_query(name2);
+  UNIT_TEST_ASSERT(id1 >= 0 && id2 >= 0 && id1 != id2);
+  UNIT_TEST_ASSERT(strcmp(name1, "b.example") == 0 ||
+                   strcmp(name1, "c.example") == 0);
+  UNIT_TEST_ASSERT(strcmp(name2, "b.example") == 0 ||
+                   strcmp(name2, "c.example") == 0);
+  UNIT_TEST_ASSERT(strcmp(name1, name2) != 0);
+  UNIT_TEST_ASSERT(poll_query(name1) < 0);
+
+  /* The answers come in the reverse order. */
+  answer(id2, name2, strcmp(name2, "b.example") == 0 ? &addr_b : &addr_c,
+         60, 0);
+  answer(id1, name1, strcmp(name1, "b.example") == 0 ? &addr_b : &addr_c,
+         60, 0);
+  UNIT_TEST_ASSERT(is_addr(resolv_lookup("b.example"), &addr_b));
+  UNIT_TEST_ASSERT(is_addr(resolv_lookup("c.example"), &addr_c));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(resolv_test_process, "Resolver test");
+AUTOSTART_PROCESSES(&resolv_test_process);
+
+PROCESS_THREAD(resolv_test_process, ev, data)
+{
+  static uip_ipaddr_t server;
+  int i;
+
+  PROCESS_BEGIN();
+
+  uip_ipaddr(&addr_a, 10, 0, 0, 1);
+  uip_ipaddr(&addr_b, 10, 0, 0, 2);
+  uip_ipaddr(&addr_c, 10, 0, 0, 3);
+
+  process_start(&resolv_process, NULL);
+  uip_ipaddr(&server, 10, 0, 0, 53);
+  resolv_conf(&server);
+  /* Let the resolver open its connection. */
+  PROCESS_PAUSE();
+  for(i = 0; i < UIP_UDP_CONNS; ++i) {
+    if(uip_udp_conns[i].lport != 0 &&
+       uip_udp_conns[i].rport == UIP_HTONS(53)) {
+      conn = &uip_udp_conns[i];
+    }
+  }
+
+  UNIT_TEST_RUN(ttl_expiry);
+  UNIT_TEST_RUN(negative);
+  UNIT_TEST_RUN(parallel);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Benchmark of packet aggregation in collect. Every node
+ *         sends a small reading at a fixed rate, and each reading
+ *         carries the radio energy the node has used so far. The
+ *         sink reports how many readings it has received per joule
+ *         spent by the radios of the whole network. Build with
+ *         AGGREGATE=0 or AGGREGATE=1 and run
+ *         collect-aggregate-bench.csc to compare the two, or run
+ *         "make bench" to run both over the native radio medium.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/rime.h"
+#include "net/rime/collect.h"
+#include "sys/energest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SINK_ID          1
+#define MAX_NODES        32
+#define READING_INTERVAL (CLOCK_SECOND * 4)
+#ifndef REPORT_INTERVAL
+#define REPORT_INTERVAL  (CLOCK_SECOND * 60)
+#endif
+#ifndef SETTLE_TIME
+#define SETTLE_TIME      (CLOCK_SECOND * 120)
+#endif
+
+/* Radio current draw (mA) and supply voltage (V) of the Tmote Sky. */
+#define RX_CURRENT       20
+#define TX_CURRENT       18
+#define VOLTAGE          3
+
+struct reading {
+  uint16_t seqno;
+  uint32_t energy;
+  uint32_t tx_energy;
+};
+
+static struct collect_conn tc;
+
+static uint32_t node_energy[MAX_NODES];
+static uint32_t node_tx_energy[MAX_NODES];
+static unsigned long delivered, lost, duplicates;
+
+/* The highest sequence number heard from each node, and a bitmap of
+   which of the 32 sequence numbers up to it have been heard, so that
+   late readings are not counted as duplicates. */
+static struct {
+  uint16_t seqno;
+  uint32_t heard;
+} node_seqno[MAX_NODES];
+
+PROCESS(collect_aggregate_bench_process, "Collect aggregation benchmark");
+AUTOSTART_PROCESSES(&collect_aggregate_bench_process);
+/*---------------------------------------------------------------------------*/
+/* The energy (mJ) used by the radio of this node to transmit. */
+static uint32_t
+tx_energy(void)
+{
+  energest_flush();
+  return (energest_type_time(ENERGEST_TYPE_TRANSMIT) / 64) * TX_CURRENT *
+    VOLTAGE / (RTIMER_SECOND / 64);
+}
+/*---------------------------------------------------------------------------*/
+/* The energy (mJ) used by the radio of this node. */
+static uint32_t
+radio_energy(void)
+{
+  energest_flush();
+  return (energest_type_time(ENERGEST_TYPE_LISTEN) / 64) * RX_CURRENT *
+    VOLTAGE / (RTIMER_SECOND / 64) + tx_energy();
+}
+/*---------------------------------------------------------------------------*/
+/* Count a reading from node id as lost, duplicate or delivered. */
+static void
+count_reading(int id, uint16_t seqno)
+{
+  uint16_t diff;
+
+  if(node_seqno[id].heard == 0) {
+    lost += seqno;
+    node_seqno[id].seqno = seqno;
+    node_seqno[id].heard = 1;
+    delivered++;
+    return;
+  }
+  diff = node_seqno[id].seqno - seqno;
+  if(diff < 32) {
+    /* Not newer than the newest one heard. */
+    if(node_seqno[id].heard & ((uint32_t)1 << diff)) {
+      duplicates++;
+      return;
+    }
+    node_seqno[id].heard |= (uint32_t)1 << diff;
+    lost--;
+  } else if(diff < 0x8000) {
+    /* Too old for the bitmap: count it as late rather than as a
+       duplicate. */
+    lost--;
+  } else {
+    diff = seqno - node_seqno[id].seqno;
+    lost += diff - 1;
+    node_seqno[id].heard = diff < 32 ? node_seqno[id].heard << diff : 0;
+    node_seqno[id].heard |= 1;
+    node_seqno[id].seqno = seqno;
+  }
+  delivered++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv(const rimeaddr_t *originator, uint8_t seqno, uint8_t hops)
+{
+  struct reading r;
+
+  if(packetbuf_datalen() != sizeof(r)) {
+    return;
+  }
+  memcpy(&r, packetbuf_dataptr(), sizeof(r));
+  if(originator->u8[0] < MAX_NODES) {
+    node_energy[originator->u8[0]] = r.energy;
+    node_tx_energy[originator->u8[0]] = r.tx_energy;
+    count_reading(originator->u8[0], r.seqno);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(void)
+{
+  uint32_t energy, tx;
+  int i;
+
+  node_energy[SINK_ID] = radio_energy();
+  node_tx_energy[SINK_ID] = tx_energy();
+  energy = tx = 0;
+  for(i = 0; i < MAX_NODES; i++) {
+    energy += node_energy[i];
+    tx += node_tx_energy[i];
+  }
+  printf("Delivered %lu readings, radio energy %lu mJ, %lu readings/J, aggregation %s\n",
+         delivered, (unsigned long)energy,
+         energy > 0 ? delivered * 1000 / energy : 0,
+         COLLECT_AGGREGATE ? "on" : "off");
+  printf("Lost %lu readings, %lu duplicates, transmit energy %lu mJ, %lu readings/J\n",
+         lost, duplicates, (unsigned long)tx,
+         tx > 0 ? delivered * 1000 / tx : 0);
+}
+/*---------------------------------------------------------------------------*/
+static const struct collect_callbacks callbacks = { recv };
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(collect_aggregate_bench_process, ev, data)
+{
+  static struct etimer periodic;
+  static struct etimer et;
+  static uint16_t seqno;
+  struct reading r;
+
+  PROCESS_BEGIN();
+
+  collect_open(&tc, 130, COLLECT_ROUTER, &callbacks);
+
+  if(rimeaddr_node_addr.u8[0] == SINK_ID &&
+     rimeaddr_node_addr.u8[1] == 0) {
+    printf("I am sink\n");
+    collect_set_sink(&tc, 1);
+
+    etimer_set(&periodic, SETTLE_TIME + REPORT_INTERVAL);
+    while(1) {
+      PROCESS_WAIT_UNTIL(etimer_expired(&periodic));
+      etimer_reset(&periodic);
+      report();
+    }
+  }
+
+  /* Allow some time for the network to settle. */
+  etimer_set(&et, SETTLE_TIME);
+  PROCESS_WAIT_UNTIL(etimer_expired(&et));
+
+  etimer_set(&periodic, READING_INTERVAL);
+  while(1) {
+    /* Send a reading at a random time in every interval. */
+    etimer_set(&et, random_rand() % READING_INTERVAL);
+    PROCESS_WAIT_UNTIL(etimer_expired(&et));
+
+    r.seqno = seqno++;
+    r.energy = radio_energy();
+    r.tx_energy = tx_energy();
+    packetbuf_clear();
+    memcpy(packetbuf_dataptr(), &r, sizeof(r));
+    packetbuf_set_datalen(sizeof(r));
+    collect_send(&tc, 15);
+
+    PROCESS_WAIT_UNTIL(etimer_expired(&periodic));
+    etimer_reset(&periodic);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
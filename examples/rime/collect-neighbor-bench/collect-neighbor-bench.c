@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Benchmark of parent selection in the collect neighbor
+ *         table. A set of candidate neighbors, larger than the table,
+ *         announce changing rtmetrics and get packets sent to them,
+ *         and the best neighbor is looked up after every event as
+ *         collect does. The result is checked against a linear scan
+ *         of the table.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/rime/collect.h"
+#include "net/rime/collect-neighbor.h"
+
+#include <stdio.h>
+
+#define NUM_CANDIDATES 80
+#define EVENTS         200000UL
+
+#define RTMETRIC_MAX   COLLECT_MAX_DEPTH
+
+enum {
+  RUN_CHECK,
+  RUN_INDEXED,
+  RUN_LINEAR,
+  RUNS
+};
+static const char *run_names[] = { "check", "indexed", "linear scan" };
+
+static struct collect_neighbor_list neighbors;
+static uint16_t rtmetrics[NUM_CANDIDATES];
+
+PROCESS(collect_neighbor_bench_process, "Collect neighbor benchmark");
+AUTOSTART_PROCESSES(&collect_neighbor_bench_process);
+/*---------------------------------------------------------------------------*/
+static struct collect_neighbor *
+linear_best(uint16_t *metric)
+{
+  struct collect_neighbor *n, *best;
+
+  best = NULL;
+  *metric = RTMETRIC_MAX;
+  for(n = list_head(collect_neighbor_list(&neighbors));
+      n != NULL; n = list_item_next(n)) {
+    if(collect_neighbor_rtmetric_link_estimate(n) < *metric) {
+      *metric = collect_neighbor_rtmetric_link_estimate(n);
+      best = n;
+    }
+  }
+  return best;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+linear_worst(void)
+{
+  struct collect_neighbor *n;
+  uint16_t worst;
+
+  worst = 0;
+  for(n = list_head(collect_neighbor_list(&neighbors));
+      n != NULL; n = list_item_next(n)) {
+    if(collect_neighbor_rtmetric_link_estimate(n) > worst) {
+      worst = collect_neighbor_rtmetric_link_estimate(n);
+    }
+  }
+  return worst;
+}
+/*---------------------------------------------------------------------------*/
+static void
+event(int check, unsigned long *rejected, unsigned long *errors)
+{
+  struct collect_neighbor *n;
+  struct collect_link_estimate le;
+  rimeaddr_t addr;
+  unsigned short r;
+  int i;
+
+  r = random_rand();
+  i = r % NUM_CANDIDATES;
+  addr.u8[0] = i + 1;
+  addr.u8[1] = 0;
+
+  n = collect_neighbor_list_find(&neighbors, &addr);
+  switch((r >> 8) & 7) {
+  case 0:
+  case 1:
+  case 2:
+    /* An announcement with a slightly changed rtmetric. */
+    rtmetrics[i] += (random_rand() & 15);
+    rtmetrics[i] -= 7;
+    if(rtmetrics[i] < COLLECT_LINK_ESTIMATE_UNIT ||
+       rtmetrics[i] > RTMETRIC_MAX / 2) {
+      rtmetrics[i] = COLLECT_LINK_ESTIMATE_UNIT * (1 + (i % 16));
+    }
+    if(n == NULL) {
+      if(!collect_neighbor_list_add(&neighbors, &addr, rtmetrics[i])) {
+        (*rejected)++;
+        if(check) {
+          /* The rejected neighbor must not rank better than any
+             neighbor in the table. */
+          collect_link_estimate_new(&le);
+          if(rtmetrics[i] + collect_link_estimate(&le) < linear_worst()) {
+            (*errors)++;
+          }
+        }
+      }
+    } else {
+      collect_neighbor_update_rtmetric(n, rtmetrics[i]);
+    }
+    break;
+  case 3:
+    collect_neighbor_rx(n);
+    break;
+  case 7:
+    collect_neighbor_tx_fail(n, 4);
+    break;
+  default:
+    /* Links to low-numbered candidates are better. */
+    collect_neighbor_tx(n, 1 + (random_rand() % (1 + i / 20)));
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(collect_neighbor_bench_process, ev, data)
+{
+  static struct collect_neighbor *parent;
+  struct collect_neighbor *best;
+  clock_time_t start, ticks;
+  unsigned long i, changes, rejected, errors;
+  uint16_t metric;
+  int run;
+
+  PROCESS_BEGIN();
+
+  collect_neighbor_init();
+
+  for(run = 0; run < RUNS; run++) {
+    collect_neighbor_list_new(&neighbors);
+    random_init(1);
+    for(i = 0; i < NUM_CANDIDATES; i++) {
+      rtmetrics[i] = COLLECT_LINK_ESTIMATE_UNIT * (1 + (i % 16));
+    }
+
+    parent = NULL;
+    changes = rejected = errors = 0;
+    start = clock_time();
+    for(i = 0; i < EVENTS; i++) {
+      event(run == RUN_CHECK, &rejected, &errors);
+      if(run == RUN_CHECK) {
+        best = collect_neighbor_list_best(&neighbors);
+        linear_best(&metric);
+        if(metric != (best == NULL ? RTMETRIC_MAX :
+                      collect_neighbor_rtmetric_link_estimate(best))) {
+          errors++;
+        }
+      } else if(run == RUN_INDEXED) {
+        best = collect_neighbor_list_best(&neighbors);
+      } else {
+        best = linear_best(&metric);
+      }
+      if(best != parent) {
+        parent = best;
+        changes++;
+      }
+    }
+    ticks = clock_time() - start;
+
+    printf("%s: %lu events, %d neighbors, %lu parent changes, "
+           "%lu rejected, %lu errors, %lu ms\n",
+           run_names[run],
+           EVENTS, collect_neighbor_list_num(&neighbors), changes,
+           rejected, errors, (unsigned long)(ticks * 1000 / CLOCK_SECOND));
+
+    collect_neighbor_list_purge(&neighbors);
+    ctimer_stop(&neighbors.periodic);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
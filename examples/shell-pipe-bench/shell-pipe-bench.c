@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Benchmark of shell pipelines. A file is read through a few
+ *         pipelines of the file, crc and base64 commands into another
+ *         file, as if the commands had been typed into the shell. Each
+ *         pipeline is timed and its output is compared with what it
+ *         should be.
+ */
+
+#include "contiki.h"
+#include "shell.h"
+#include "cfs/cfs.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define FILE_SIZE       24000
+#define LINE_LEN        76
+
+struct pipeline {
+  const char *commandline;
+  const char *expected;
+};
+
+static const struct pipeline pipelines[] = {
+  { "read bench-in | write bench-out", "bench-in" },
+  { "read bench-in | crc | crc-v | write bench-out", "bench-in" },
+  { "read bench-in | bin2hex | hex2bin | write bench-out", "bench-in" },
+  { "read bench-b64 | dec64 | write bench-out", "bench-in" },
+  { "read bench-in | crc | bin2hex | hex2bin | crc-v | write bench-out",
+    "bench-in" },
+  /* hd does not wait for room in the pipe of the next command. */
+  { "read bench-in | hd | write bench-hd", NULL },
+  { "read bench-in | hd | crc | crc-v | write bench-out", "bench-hd" },
+  { "read bench-in | hd | bin2hex | write bench-hex", NULL },
+  { "read bench-hex | hex2bin | write bench-out", "bench-hd" },
+};
+
+static uint8_t prompted;
+
+PROCESS(shell_pipe_bench_process, "Shell pipe benchmark");
+AUTOSTART_PROCESSES(&shell_pipe_bench_process);
+/*---------------------------------------------------------------------------*/
+void
+shell_default_output(const char *data1, int size1,
+		     const char *data2, int size2)
+{
+  /* Every pipeline ends with write, which also passes its data on to
+     here. Only the shell's own messages are shown. */
+  if(size1 >= 7 && strncmp(data1, "shell: ", 7) == 0) {
+    printf("%.*s%.*s\n", size1, data1, size2, data2);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_prompt(char *prompt)
+{
+  prompted = 1;
+  process_poll(&shell_pipe_bench_process);
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_exit(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+data_byte(unsigned long i)
+{
+  return (uint8_t)((i * 131) ^ (i >> 7));
+}
+/*---------------------------------------------------------------------------*/
+static void
+create_files(void)
+{
+  static const char b64chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  char line[LINE_LEN];
+  uint8_t in[3];
+  unsigned long i;
+  int fd, b64fd, n, j;
+
+  fd = cfs_open("bench-in", CFS_WRITE);
+  b64fd = cfs_open("bench-b64", CFS_WRITE);
+  n = 0;
+  for(i = 0; i < FILE_SIZE; i += 3) {
+    for(j = 0; j < 3; ++j) {
+      in[j] = data_byte(i + j);
+    }
+    cfs_write(fd, in, 3);
+    line[n++] = b64chars[in[0] >> 2];
+    line[n++] = b64chars[((in[0] & 3) << 4) | (in[1] >> 4)];
+    line[n++] = b64chars[((in[1] & 15) << 2) | (in[2] >> 6)];
+    line[n++] = b64chars[in[2] & 63];
+    if(n == LINE_LEN) {
+      cfs_write(b64fd, line, n);
+      n = 0;
+    }
+  }
+  cfs_write(b64fd, line, n);
+  cfs_close(fd);
+  cfs_close(b64fd);
+}
+/*---------------------------------------------------------------------------*/
+static int
+compare_files(const char *name1, const char *name2)
+{
+  char buf1[64], buf2[64];
+  int fd1, fd2, len1, len2, same;
+
+  fd1 = cfs_open(name1, CFS_READ);
+  fd2 = cfs_open(name2, CFS_READ);
+  same = fd1 >= 0 && fd2 >= 0;
+  while(same) {
+    len1 = cfs_read(fd1, buf1, sizeof(buf1));
+    len2 = cfs_read(fd2, buf2, sizeof(buf2));
+    if(len1 != len2 || memcmp(buf1, buf2, len1) != 0) {
+      same = 0;
+    } else if(len1 <= 0) {
+      break;
+    }
+  }
+  cfs_close(fd1);
+  cfs_close(fd2);
+  return same;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_pipe_bench_process, ev, data)
+{
+  static char commandline[80];
+  static clock_time_t start;
+  static int i;
+
+  PROCESS_BEGIN();
+
+  create_files();
+
+  shell_init();
+  shell_file_init();
+  shell_base64_init();
+  shell_crc_init();
+  shell_text_init();
+
+  PROCESS_WAIT_EVENT_UNTIL(prompted);
+
+  printf("%d-byte file, %d-byte pipe buffers\n", FILE_SIZE, SHELL_PIPE_SIZE);
+  for(i = 0; i < sizeof(pipelines) / sizeof(pipelines[0]); ++i) {
+    cfs_remove("bench-out");
+    strcpy(commandline, pipelines[i].commandline);
+    prompted = 0;
+    start = clock_time();
+    shell_input(commandline, strlen(commandline));
+    /* The prompt may be shown while the last command is still being
+       exited, so we wait until we are polled. */
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL && prompted);
+    printf("%-68s %5lu ms %s\n", pipelines[i].commandline,
+	   (unsigned long)((clock_time() - start) * 1000 / CLOCK_SECOND),
+	   pipelines[i].expected == NULL ? "" :
+	   compare_files("bench-out", pipelines[i].expected) ? "ok" : "FAILED");
+  }
+  cfs_remove("bench-in");
+  cfs_remove("bench-b64");
+  cfs_remove("bench-hd");
+  cfs_remove("bench-hex");
+  cfs_remove("bench-out");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Benchmark of the time that Deluge needs to disseminate an
+ *         image to all nodes. The sink starts with version 1 of a
+ *         FILE_SIZE byte image and all other nodes with version 0.
+ *         Each node reports the time at which it has received the
+ *         full image. Build with, e.g., FILE_SIZE=8192 and
+ *         PIPELINE=1 or PIPELINE=2 and run deluge-bench.csc once per
+ *         image size.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "deluge.h"
+#include "dev/leds.h"
+#include "sys/node-id.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SINK_ID		1
+
+#ifndef FILE_SIZE
+#define FILE_SIZE	4096
+#endif
+
+#define FILE_NAME	"image"
+
+PROCESS(deluge_bench_process, "Deluge benchmark");
+AUTOSTART_PROCESSES(&deluge_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+fill(unsigned char *buf, cfs_offset_t offset, int len, unsigned version)
+{
+  int i;
+
+  for(i = 0; i < len; i++) {
+    buf[i] = version == 0 ? 0 : (unsigned char)(offset + i);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+write_image(unsigned version)
+{
+  unsigned char buf[32];
+  cfs_offset_t offset;
+  int fd, len;
+
+  cfs_remove(FILE_NAME);
+  if(cfs_coffee_reserve(FILE_NAME, FILE_SIZE) < 0) {
+    return -1;
+  }
+  fd = cfs_open(FILE_NAME, CFS_WRITE);
+  if(fd < 0) {
+    return -1;
+  }
+  for(offset = 0; offset < FILE_SIZE; offset += len) {
+    len = FILE_SIZE - offset < sizeof(buf) ? FILE_SIZE - offset : sizeof(buf);
+    fill(buf, offset, len, version);
+    if(cfs_write(fd, buf, len) != len) {
+      cfs_close(fd);
+      return -1;
+    }
+  }
+  cfs_close(fd);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_image(void)
+{
+  unsigned char buf[32], expected[32];
+  cfs_offset_t offset;
+  int fd, len;
+
+  fd = cfs_open(FILE_NAME, CFS_READ);
+  if(fd < 0) {
+    return 0;
+  }
+  for(offset = 0; offset < FILE_SIZE; offset += len) {
+    len = FILE_SIZE - offset < sizeof(buf) ? FILE_SIZE - offset : sizeof(buf);
+    fill(expected, offset, len, 1);
+    if(cfs_read(fd, buf, len) != len || memcmp(buf, expected, len) != 0) {
+      break;
+    }
+  }
+  cfs_close(fd);
+  return offset >= FILE_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(deluge_bench_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  if(write_image(node_id == SINK_ID) < 0) {
+    printf("failed to write the image\n");
+    PROCESS_EXIT();
+  }
+  if(deluge_disseminate(FILE_NAME, node_id == SINK_ID) < 0) {
+    printf("failed to start Deluge\n");
+    PROCESS_EXIT();
+  }
+
+  if(node_id == SINK_ID) {
+    printf("Disseminating %u bytes, pipeline %u\n",
+           FILE_SIZE, DELUGE_PIPELINE);
+    PROCESS_EXIT();
+  }
+
+  /* Deluge turns on the red LED when an update is complete. */
+  etimer_set(&et, CLOCK_SECOND);
+  do {
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    etimer_reset(&et);
+  } while(!(leds_get() & LEDS_RED));
+
+  printf("Image of %u bytes %s after %lu s\n", FILE_SIZE,
+         check_image() ? "received" : "corrupt", clock_seconds());
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
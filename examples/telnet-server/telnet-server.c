@@ -58,6 +58,7 @@ PROCESS_THREAD(shell_init_process, ev, data)
   shell_httpd_init();
   shell_irc_init();
   shell_ps_init();
+  shell_resolv_init();
   shell_run_init();
   shell_text_init();
   shell_time_init();
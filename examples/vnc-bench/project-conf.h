@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+#ifndef __PROJECT_VNC_BENCH_CONF_H__
+#define __PROJECT_VNC_BENCH_CONF_H__
+
+#define LIBCONIO_CONF_SCREEN_WIDTH     64
+#define LIBCONIO_CONF_SCREEN_HEIGHT    32
+
+#define CTK_VNCSERVER_CONF_NUMCONNS    2
+#define CTK_VNCSERVER_CONF_MAX_ICONS   8
+/* Costs two bytes of RAM per character, 4 kilobytes on this screen. */
+#define CTK_VNCSERVER_CONF_SHADOW_SCREEN 1
+
+#define CTK_CONF_ICONS                 1
+#define CTK_CONF_ICON_BITMAPS          1
+
+/* The low byte of the X keysyms that VNC viewers send. */
+#define CH_ESC                         0x1b
+#define CH_DEL                         0x08
+#define CH_CURS_LEFT                   0x51
+#define CH_CURS_UP                     0x52
+#define CH_CURS_RIGHT                  0x53
+#define CH_CURS_DOWN                   0x54
+
+#endif /* __PROJECT_VNC_BENCH_CONF_H__ */
@@ -0,0 +1,464 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Benchmark of the output side of the CTK VNC server. A
+ *         desktop with a menu bar and a window is drawn on the VNC
+ *         screen, and a few typical changes are sent to two
+ *         simulated clients: one that only knows raw and RRE, and
+ *         one that knows hextile as well. Each client decodes what
+ *         it receives into its own frame buffer. The number of bytes
+ *         and segments is printed, and the two frame buffers are
+ *         compared after each change.
+ */
+
+#include "contiki-net.h"
+#include "ctk/vnc-server.h"
+#include "ctk/vnc-out.h"
+#include "ctk/ctk-vncfont.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define FB_WIDTH  (LIBCONIO_SCREEN_WIDTH * CTK_VNCFONT_WIDTH + 20)
+#define FB_HEIGHT (LIBCONIO_SCREEN_HEIGHT * CTK_VNCFONT_HEIGHT + 16)
+
+/* Too small for a raw hextile tile and its headers. */
+#define SMALL_MSS 186
+
+#define WIN_X 6
+#define WIN_Y 4
+#define WIN_W 44
+#define WIN_H 18
+
+struct client {
+  const char *name;
+  struct vnc_server_state vs;
+  unsigned long bytes, segments;
+  int errors;
+  uint8_t fb[FB_WIDTH * FB_HEIGHT];
+};
+
+static struct client clients[2];
+#define NUM_CLIENTS (sizeof(clients) / sizeof(clients[0]))
+
+static struct uip_conn conn;
+
+/* Not declared by uip.h, but needed to stand in for uIP's TCP
+   processing. */
+extern uint16_t uip_slen;
+extern void *uip_sappdata;
+
+PROCESS(vnc_bench_process, "VNC benchmark");
+AUTOSTART_PROCESSES(&vnc_bench_process);
+/*---------------------------------------------------------------------------*/
+/* The same mapping as ctk-vncserver.c uses. */
+static unsigned char
+ascii2screen(unsigned char c)
+{
+  if(c == '|') {
+    return 0x68;
+  }
+  if(c < 0x20) {
+    return c + 0x60;
+  }
+  if(c >= 0x60 && c < 0x80) {
+    return c - 0x60;
+  }
+  return c;
+}
+/*---------------------------------------------------------------------------*/
+static void
+draw(uint8_t x, uint8_t y, const char *str, uint8_t len, uint8_t color)
+{
+  for(; len > 0; --len, ++x) {
+    vnc_out_update_screen(x, y, *str == 0? ' ': ascii2screen(*str), color);
+    if(*str != 0) {
+      ++str;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* What ctk-vncserver.c does when CTK has drawn an area, and when the
+   server runs next. */
+static uint8_t areas_updated;
+
+static void
+update_area(uint8_t x, uint8_t y, uint8_t w, uint8_t h)
+{
+  areas_updated = 1;
+}
+
+static void
+update_changed(void)
+{
+  unsigned i;
+
+  if(areas_updated) {
+    areas_updated = 0;
+    for(i = 0; i < NUM_CLIENTS; ++i) {
+      vnc_out_update_changed(&clients[i].vs);
+    }
+    vnc_out_clear_changed();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+draw_desktop(void)
+{
+  uint8_t y;
+
+  for(y = 1; y < LIBCONIO_SCREEN_HEIGHT; ++y) {
+    draw(0, y, "", LIBCONIO_SCREEN_WIDTH, VNC_OUT_BACKGROUNDCOLOR);
+  }
+  draw(0, 0, " Contiki  Programs  Network  Settings", LIBCONIO_SCREEN_WIDTH,
+       VNC_OUT_MENUCOLOR);
+  update_area(0, 0, LIBCONIO_SCREEN_WIDTH, LIBCONIO_SCREEN_HEIGHT);
+}
+/*---------------------------------------------------------------------------*/
+static void
+draw_window(uint8_t focus)
+{
+  static const char *lines[] = {
+    "Host:      www.sics.se",
+    "Port:      80",
+    "",
+    "Fetching /contiki/ ...",
+    "Received 1460 of 9318 bytes",
+    "",
+    "The Contiki operating system is a small,",
+    "portable multitasking OS for networked",
+    "embedded systems and sensor networks.",
+  };
+  uint8_t y, color;
+  char border[WIN_W];
+
+  color = VNC_OUT_WINDOWCOLOR + focus * 2;
+
+  /* Title bar and frame, with the border characters of the font. */
+  memset(border, 0x01 - 0x60, sizeof(border));
+  draw(WIN_X, WIN_Y, "\x60", 1, color);
+  draw(WIN_X + 1, WIN_Y, " Web browser", WIN_W, color);
+  draw(WIN_X + WIN_W + 1, WIN_Y, "\x62", 1, color);
+  for(y = 1; y <= WIN_H; ++y) {
+    draw(WIN_X, WIN_Y + y, "\x67", 1, color);
+    draw(WIN_X + 1, WIN_Y + y, "", WIN_W, color);
+    draw(WIN_X + WIN_W + 1, WIN_Y + y, "\x63", 1, color);
+  }
+  memset(border, 0x05 + 0x60, sizeof(border));
+  draw(WIN_X, WIN_Y + WIN_H + 1, "\x66", 1, color);
+  draw(WIN_X + 1, WIN_Y + WIN_H + 1, border, WIN_W, color);
+  draw(WIN_X + WIN_W + 1, WIN_Y + WIN_H + 1, "\x64", 1, color);
+
+  for(y = 0; y < sizeof(lines) / sizeof(lines[0]); ++y) {
+    draw(WIN_X + 2, WIN_Y + 2 + y, lines[y], strlen(lines[y]),
+         VNC_OUT_LABELCOLOR + focus * 2);
+  }
+  draw(WIN_X + 2, WIN_Y + WIN_H - 1, "[Back]", 6, VNC_OUT_BUTTONCOLOR + focus * 2);
+  draw(WIN_X + 10, WIN_Y + WIN_H - 1, "[Reload]", 8,
+       VNC_OUT_BUTTONCOLOR + focus * 2 + 1);
+  draw(WIN_X + 20, WIN_Y + WIN_H - 1, "[Stop]", 6, VNC_OUT_BUTTONCOLOR + focus * 2);
+  update_area(WIN_X, WIN_Y, WIN_W + 2, WIN_H + 2);
+}
+/*---------------------------------------------------------------------------*/
+static void
+draw_menu(void)
+{
+  static const char *items[] = {
+    "Web browser", "Email", "Telnet", "IRC", "FTP", "Calculator",
+  };
+  uint8_t i;
+
+  draw(10, 0, "Programs", 9, VNC_OUT_OPENMENUCOLOR);
+  for(i = 0; i < sizeof(items) / sizeof(items[0]); ++i) {
+    draw(10, 1 + i, items[i], 16,
+         i == 1? VNC_OUT_ACTIVEMENUCOLOR: VNC_OUT_OPENMENUCOLOR);
+  }
+  update_area(10, 0, 16, 1 + i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+type_char(uint8_t pos, char c)
+{
+  draw(WIN_X + 12 + pos, WIN_Y + 2, &c, 1, VNC_OUT_TEXTENTRYCOLOR + 1);
+  /* Text entries are redrawn as a whole. */
+  update_area(WIN_X + 11, WIN_Y + 2, 30, 1);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get16(const uint8_t *p)
+{
+  return (p[0] << 8) | p[1];
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill(struct client *c, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+     uint8_t pixel)
+{
+  uint16_t i;
+
+  if(x + w > FB_WIDTH || y + h > FB_HEIGHT) {
+    c->errors++;
+    return;
+  }
+  for(; h > 0; --h, ++y) {
+    for(i = 0; i < w; ++i) {
+      c->fb[(y * FB_WIDTH) + x + i] = pixel;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+copy(struct client *c, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+     const uint8_t *p)
+{
+  if(x + w > FB_WIDTH || y + h > FB_HEIGHT) {
+    c->errors++;
+    return;
+  }
+  for(; h > 0; --h, ++y, p += w) {
+    memcpy(&c->fb[(y * FB_WIDTH) + x], p, w);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Decode a FramebufferUpdate message the way a VNC viewer would. */
+static void
+decode(struct client *c, const uint8_t *p, uint16_t len)
+{
+  const uint8_t *end;
+  uint16_t n, x, y, w, h, tx, ty, tw, th;
+  unsigned long subrects;
+  uint8_t subenc, bg, fg, pixel, xy, wh;
+
+  end = p + len;
+  if(p[0] != RFB_FB_UPDATE) {
+    c->errors++;
+    return;
+  }
+  n = get16(p + 2);
+  p += 4;
+  bg = fg = 0;
+  for(; n > 0; --n) {
+    x = get16(p);
+    y = get16(p + 2);
+    w = get16(p + 4);
+    h = get16(p + 6);
+    p += 12;
+    switch(p[-1]) {
+    case RFB_ENC_RAW:
+      copy(c, x, y, w, h, p);
+      p += w * h;
+      break;
+    case RFB_ENC_RRE:
+      subrects = ((unsigned long)get16(p) << 16) | get16(p + 2);
+      fill(c, x, y, w, h, p[4]);
+      p += 5;
+      for(; subrects > 0; --subrects, p += 9) {
+        fill(c, x + get16(p + 1), y + get16(p + 3),
+             get16(p + 5), get16(p + 7), p[0]);
+      }
+      break;
+    case RFB_ENC_HEXTILE:
+      for(ty = 0; ty < h; ty += 16) {
+        th = h - ty > 16? 16: h - ty;
+        for(tx = 0; tx < w; tx += 16) {
+          tw = w - tx > 16? 16: w - tx;
+          subenc = *p++;
+          if(subenc & RFB_HEXTILE_RAW) {
+            copy(c, x + tx, y + ty, tw, th, p);
+            p += tw * th;
+            continue;
+          }
+          if(subenc & RFB_HEXTILE_BG_SPECIFIED) {
+            bg = *p++;
+          }
+          if(subenc & RFB_HEXTILE_FG_SPECIFIED) {
+            fg = *p++;
+          }
+          fill(c, x + tx, y + ty, tw, th, bg);
+          if(subenc & RFB_HEXTILE_ANY_SUBRECTS) {
+            for(subrects = *p++; subrects > 0; --subrects) {
+              pixel = (subenc & RFB_HEXTILE_SUBRECTS_COLORED)? *p++: fg;
+              xy = *p++;
+              wh = *p++;
+              fill(c, x + tx + (xy >> 4), y + ty + (xy & 0x0f),
+                   (wh >> 4) + 1, (wh & 0x0f) + 1, pixel);
+            }
+          }
+        }
+      }
+      break;
+    default:
+      c->errors++;
+      return;
+    }
+  }
+  if(p != end) {
+    c->errors++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Deliver segments to a client until the server has nothing more to
+   send. Each segment is first retransmitted, which must give the
+   same data, and then acknowledged. */
+static void
+run(struct client *c)
+{
+  static uint8_t segment[UIP_BUFSIZE];
+  uint16_t len;
+
+  c->vs.update_requested = 1;
+  uip_slen = 0;
+  vnc_out_poll(&c->vs);
+  while(uip_slen > 0) {
+    len = uip_slen;
+    memcpy(segment, uip_appdata, len);
+    uip_slen = 0;
+    vnc_server_send_data(&c->vs);
+    if(uip_slen != len || memcmp(segment, uip_appdata, len) != 0) {
+      c->errors++;
+    }
+
+    c->bytes += len;
+    c->segments++;
+    decode(c, segment, len);
+
+    /* Viewers ask for the next update as soon as they have got one. */
+    c->vs.update_requested = 1;
+    uip_slen = 0;
+    vnc_out_acked(&c->vs);
+    vnc_server_send_data(&c->vs);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_changes(void)
+{
+  unsigned i;
+
+  update_changed();
+  for(i = 0; i < NUM_CLIENTS; ++i) {
+    run(&clients[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *name)
+{
+  unsigned i;
+
+  printf("%-10s", name);
+  for(i = 0; i < NUM_CLIENTS; ++i) {
+    printf("  %s %6lu bytes %4lu segments", clients[i].name,
+           clients[i].bytes, clients[i].segments);
+    clients[i].bytes = clients[i].segments = 0;
+  }
+  printf("  %s\n",
+         memcmp(clients[0].fb, clients[1].fb, sizeof(clients[0].fb)) == 0 &&
+         clients[0].errors == 0 && clients[1].errors == 0?
+         "ok": "MISMATCH");
+}
+/*---------------------------------------------------------------------------*/
+static void
+measure(const char *name)
+{
+  send_changes();
+  report(name);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(vnc_bench_process, ev, data)
+{
+  unsigned i;
+  static const char url[] = "http://www.contiki-os.org/";
+
+  PROCESS_BEGIN();
+
+  conn.mss = UIP_TCP_MSS;
+  uip_conn = &conn;
+  uip_appdata = uip_sappdata = &uip_buf[UIP_LLH_LEN + UIP_TCPIP_HLEN];
+
+  vnc_out_init();
+  clients[0].name = "raw/rre";
+  clients[1].name = "hextile";
+  clients[1].vs.encodings = VNC_SERVER_ENC_HEXTILE;
+  for(i = 0; i < NUM_CLIENTS; ++i) {
+    vnc_out_new(&clients[i].vs);
+    clients[i].vs.state = VNC_RUNNING;
+    clients[i].vs.sendmsg = SEND_NONE;
+  }
+  printf("%d byte segments, %dx%d characters\n", UIP_TCP_MSS,
+         LIBCONIO_SCREEN_WIDTH, LIBCONIO_SCREEN_HEIGHT);
+
+  draw_desktop();
+  measure("desktop");
+
+  draw_window(0);
+  measure("window");
+
+  draw_window(1);
+  measure("focus");
+
+  draw_menu();
+  measure("menu");
+
+  draw_desktop();
+  draw_window(1);
+  measure("close menu");
+
+  /* Each key is sent on its own. */
+  for(i = 0; i < sizeof(url) - 1; ++i) {
+    type_char(i, url[i]);
+    send_changes();
+  }
+  report("typing");
+
+  /* A full refresh, as asked for by a viewer that has just connected. */
+  for(i = 0; i < NUM_CLIENTS; ++i) {
+    vnc_out_update_area(&clients[i].vs, 0, 0,
+                        LIBCONIO_SCREEN_WIDTH, LIBCONIO_SCREEN_HEIGHT);
+  }
+  measure("refresh");
+
+  /* With a small MSS not even a raw hextile tile fits into a
+     segment. */
+  conn.mss = SMALL_MSS;
+  draw_window(0);
+  measure("small mss");
+  for(i = 0; i < NUM_CLIENTS; ++i) {
+    vnc_out_update_area(&clients[i].vs, 0, 0,
+                        LIBCONIO_SCREEN_WIDTH, LIBCONIO_SCREEN_HEIGHT);
+  }
+  measure("refresh");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
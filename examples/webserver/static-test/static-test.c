@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Tests of the static header mode of the web server. The
+ *         server is driven through httpd_appcall() the way uIP would
+ *         drive it, with a file system image that makefsdata -H has
+ *         generated from the httpd-fs directory.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki-net.h"
+#include "httpd.h"
+#include "httpd-fs.h"
+#include "httpd-fsdata.h"
+#include "unit-test.h"
+
+#include "static-fsdata.c"
+
+UNIT_TEST_REGISTER(full_reply, "200 with the precomputed header");
+UNIT_TEST_REGISTER(not_modified, "304 on a matching If-None-Match");
+UNIT_TEST_REGISTER(other_etag, "200 on another If-None-Match");
+UNIT_TEST_REGISTER(bare_lf, "Headers ended by a bare LF");
+
+/* Not declared by uip.h, but needed to stand in for uIP's TCP
+   processing. */
+extern uint16_t uip_slen;
+extern void *uip_sappdata;
+
+static struct uip_conn conn;
+
+static char reply[UIP_BUFSIZE];
+static uint16_t reply_len;
+
+static char etag[HTTPD_FS_ETAG_LEN + 1];
+/*---------------------------------------------------------------------------*/
+/* httpd-fs.c serves the default image, so the test looks files up in
+   its own. */
+int
+httpd_fs_open(const char *name, struct httpd_fs_file *file)
+{
+  const struct httpd_fsdata_file *f;
+
+  for(f = HTTPD_FS_ROOT; f != NULL; f = f->next) {
+    if(strcmp(name, f->name) == 0) {
+      file->data = (char *)f->data;
+      file->len = f->len;
+      file->hdrlen = f->hdrlen;
+      file->etag = f->etag;
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+httpd_fs_count(char *name)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+httpd_fs_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+/* Call the server with the given uIP flags, and add what it sends to
+   the reply. */
+static void
+appcall(uint8_t flags)
+{
+  uip_conn = &conn;
+  uip_flags = flags;
+  uip_sappdata = uip_appdata = &uip_buf[UIP_LLH_LEN + UIP_TCPIP_HLEN];
+  uip_slen = 0;
+  httpd_appcall(conn.appstate.state);
+  if(uip_slen > 0 && reply_len + uip_slen < sizeof(reply)) {
+    memcpy(&reply[reply_len], uip_sappdata, uip_slen);
+    reply_len += uip_slen;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Open a connection, send the request in one segment, and acknowledge
+   what the server sends until it closes the connection. */
+static const char *
+request(const char *req)
+{
+  int i;
+
+  reply_len = 0;
+  conn.appstate.state = NULL;
+  conn.mss = UIP_TCP_MSS;
+  uip_len = 0;
+  appcall(UIP_CONNECTED);
+  uip_len = strlen(req);
+  memcpy(&uip_buf[UIP_LLH_LEN + UIP_TCPIP_HLEN], req, uip_len);
+  appcall(UIP_NEWDATA);
+  uip_len = 0;
+  for(i = 0; i < 10 && !uip_closed(); ++i) {
+    appcall(UIP_ACKDATA);
+  }
+  if(uip_closed()) {
+    /* The client's FIN. */
+    appcall(UIP_CLOSE);
+  }
+  reply[reply_len] = 0;
+  return reply;
+}
+/*---------------------------------------------------------------------------*/
+static int
+starts_with(const char *str, const char *prefix)
+{
+  return strncmp(str, prefix, strlen(prefix)) == 0;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(full_reply)
+{
+  struct httpd_fs_file file;
+  const char *r, *p;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(httpd_fs_open("/index.html", &file));
+  UNIT_TEST_ASSERT(file.hdrlen > 0);
+
+  r = request("GET /index.html HTTP/1.0\r\nHost: test\r\n\r\n");
+  UNIT_TEST_ASSERT(starts_with(r, "HTTP/1.0 200 OK\r\n"));
+  UNIT_TEST_ASSERT(reply_len == file.hdrlen + file.len);
+  UNIT_TEST_ASSERT(memcmp(r + file.hdrlen, file.data, file.len) == 0);
+
+  p = strstr(r, "\r\nETag: ");
+  UNIT_TEST_ASSERT(p != NULL);
+  memcpy(etag, p + 8, HTTPD_FS_ETAG_LEN);
+  UNIT_TEST_ASSERT(etag[0] == '"' && etag[HTTPD_FS_ETAG_LEN - 1] == '"');
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(not_modified)
+{
+  static char req[100];
+  const char *r;
+
+  UNIT_TEST_BEGIN();
+
+  sprintf(req, "GET /index.html HTTP/1.0\r\nIf-None-Match: %s\r\n\r\n", etag);
+  r = request(req);
+  UNIT_TEST_ASSERT(starts_with(r, "HTTP/1.0 304 Not Modified\r\n"));
+  UNIT_TEST_ASSERT(strstr(r, etag) != NULL);
+  /* No body after the empty line. */
+  UNIT_TEST_ASSERT(reply_len > 4 &&
+                   strcmp(r + reply_len - 4, "\r\n\r\n") == 0 &&
+                   strstr(r, "\r\n\r\n") == r + reply_len - 4);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(other_etag)
+{
+  const char *r;
+
+  UNIT_TEST_BEGIN();
+
+  r = request("GET /index.html HTTP/1.0\r\n"
+              "If-None-Match: \"00000000\"\r\n\r\n");
+  UNIT_TEST_ASSERT(starts_with(r, "HTTP/1.0 200 OK\r\n"));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(bare_lf)
+{
+  static char req[100];
+  const char *r;
+
+  UNIT_TEST_BEGIN();
+
+  /* A line of one character does not end the headers, only an empty
+     one does. */
+  sprintf(req, "GET /index.html HTTP/1.0\nX\nIf-None-Match: %s\n\n", etag);
+  r = request(req);
+  UNIT_TEST_ASSERT(starts_with(r, "HTTP/1.0 304 Not Modified\r\n"));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(static_test_process, "Static header test");
+AUTOSTART_PROCESSES(&static_test_process);
+
+PROCESS_THREAD(static_test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  httpd_init();
+
+  UNIT_TEST_RUN(full_reply);
+  UNIT_TEST_RUN(not_modified);
+  UNIT_TEST_RUN(other_etag);
+  UNIT_TEST_RUN(bare_lf);
+
+  PROCESS_END();
+}
@@ -153,6 +153,9 @@ typedef unsigned short uip_stats_t;
 #define UIP_CONF_RECEIVE_WINDOW  48
 #define UIP_CONF_TCP_MSS         48
 #define UIP_CONF_UDP_CONNS       12
+#ifndef UIP_CONF_CONN_HASH
+#define UIP_CONF_CONN_HASH       1
+#endif /* UIP_CONF_CONN_HASH */
 #define UIP_CONF_FWCACHE_SIZE    30
 #define UIP_CONF_BROADCAST       1
 #define UIP_ARCH_IPCHKSUM        1
@@ -32,6 +32,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/select.h>
@@ -44,12 +45,15 @@
 #include "net/netstack.h"
 
 #include "dev/serial-line.h"
+#include "lib/random.h"
+#include "sys/profile.h"
 
 #include "net/uip.h"
 
 #include "dev/button-sensor.h"
 #include "dev/pir-sensor.h"
 #include "dev/vib-sensor.h"
+#include "dev/native-medium.h"
 
 #if WITH_UIP6
 #include "net/uip-ds6.h"
@@ -184,6 +188,16 @@ main(int argc, char **argv)
 #endif
 #endif
 
+  /* Several native nodes may run on the same host, e.g., connected
+     through the native-medium server, so the node ID can be given in
+     the environment. */
+  if(getenv(NATIVE_MEDIUM_NODE_ID_ENV) != NULL) {
+    node_id = atoi(getenv(NATIVE_MEDIUM_NODE_ID_ENV));
+    serial_id[6] = node_id >> 8;
+    serial_id[7] = node_id & 0xff;
+    random_init(node_id);
+  }
+
   process_init();
   process_start(&etimer_process, NULL);
   ctimer_init();
@@ -221,6 +235,10 @@ main(int argc, char **argv)
 #endif
 
   serial_line_init();
+
+#if PROFILE_CONF_ON
+  profile_init();
+#endif /* PROFILE_CONF_ON */
   
   autostart_start(autostart_processes);
   
@@ -236,7 +254,13 @@ main(int argc, char **argv)
     int retval;
     struct timeval tv;
 
+#if PROFILE_CONF_ON
+    profile_episode_start();
+#endif /* PROFILE_CONF_ON */
     retval = process_run();
+#if PROFILE_CONF_ON
+    profile_episode_end();
+#endif /* PROFILE_CONF_ON */
 
     tv.tv_sec = 0;
     tv.tv_usec = retval ? 1 : 1000;
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Protocol between the native radio driver and the
+ *         native-medium server (tools/native-medium).
+ *
+ *         Nodes and the server exchange messages over a UNIX
+ *         SOCK_SEQPACKET socket. Each message starts with a
+ *         native_medium_hdr, which is followed by the frame for TX
+ *         and RX messages. All fields are in host byte order, since
+ *         the nodes and the server run on the same machine.
+ */
+
+#ifndef __NATIVE_MEDIUM_H__
+#define __NATIVE_MEDIUM_H__
+
+#include <stdint.h>
+
+#define NATIVE_MEDIUM_DEFAULT_SOCKET "/tmp/contiki-medium"
+
+/* The environment variables read by nodes. */
+#define NATIVE_MEDIUM_SOCKET_ENV     "CONTIKI_MEDIUM"
+#define NATIVE_MEDIUM_NODE_ID_ENV    "CONTIKI_NODE_ID"
+
+#define NATIVE_MEDIUM_MAX_FRAME      127
+
+/* Airtime of a frame of len bytes at 250 kbit/s, including the
+   preamble, SFD and length field, in microseconds. */
+#define NATIVE_MEDIUM_AIRTIME(len)   (((len) + 6) * 32)
+
+enum {
+  /* Node to server: the node ID is in node, followed by the link-layer
+     address of the node in the order in which it is sent in frames. */
+  NATIVE_MEDIUM_HELLO,
+  /* Node to server: a frame is sent. */
+  NATIVE_MEDIUM_TX,
+  /* Server to node: a neighbor has started to send a frame, which
+     keeps the channel busy for duration microseconds. */
+  NATIVE_MEDIUM_BUSY,
+  /* Server to node: a frame from node was received. timestamp is
+     the start of the frame. */
+  NATIVE_MEDIUM_RX,
+  /* Server to node: node received the frame with sequence number
+     seqno, which asked for an acknowledgement. */
+  NATIVE_MEDIUM_ACK,
+};
+
+/* How long a sender waits for an acknowledgement after the end of the
+   frame, in microseconds. Longer than on a real radio, to leave time
+   for the server to be scheduled. */
+#define NATIVE_MEDIUM_ACK_WAIT       2000
+
+struct native_medium_hdr {
+  uint8_t type;
+  int8_t rssi;
+  uint16_t node;
+  uint8_t seqno;
+  uint32_t duration;
+  /* Microseconds of CLOCK_MONOTONIC. */
+  uint64_t timestamp;
+};
+
+#endif /* __NATIVE_MEDIUM_H__ */
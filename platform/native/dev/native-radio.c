@@ -0,0 +1,461 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Radio driver that connects native nodes through the
+ *         native-medium server. The server decides which nodes hear
+ *         a frame, with which RSSI and after which delay.
+ *
+ *         The socket is given by the CONTIKI_MEDIUM environment
+ *         variable and the node ID, which is used by the server to
+ *         look up the topology, by CONTIKI_NODE_ID.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include "contiki.h"
+
+#include "net/packetbuf.h"
+#include "net/rime/rimestats.h"
+#include "net/netstack.h"
+
+#include "dev/radio.h"
+#include "dev/native-radio.h"
+#include "dev/native-medium.h"
+
+#define CCA_SS_THRESHOLD -95
+
+#define DEBUG 0
+#if DEBUG
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+static int sockfd = -1;
+static uint16_t node;
+static char radio_is_on = 1;
+static const void *pending_data;
+
+/* The channel is busy until this time, in microseconds. */
+static uint64_t busy_until;
+static int busy_rssi = -100;
+
+/* Received frames that have not been read yet. The server
+   acknowledges frames when they arrive, so there is room for more than
+   one, like in the RX FIFO of a real radio. */
+#ifdef NATIVE_RADIO_CONF_RX_FRAMES
+#define RX_FRAMES NATIVE_RADIO_CONF_RX_FRAMES
+#else
+#define RX_FRAMES 4
+#endif
+
+static struct {
+  uint8_t data[NATIVE_MEDIUM_MAX_FRAME];
+  int len;
+  int rssi;
+  rtimer_clock_t timestamp;
+} rx_frames[RX_FRAMES];
+static int rx_first, rx_count;
+static int rx_rssi = -100;
+
+/* The sequence number of the last acknowledgement, or -1. */
+static int ack_seqno = -1;
+
+PROCESS(native_radio_process, "native radio process");
+/*---------------------------------------------------------------------------*/
+static uint64_t
+now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+/*---------------------------------------------------------------------------*/
+static int
+send_msg(struct native_medium_hdr *hdr, const void *data, unsigned short len)
+{
+  struct iovec iov[2];
+  struct msghdr msg;
+
+  iov[0].iov_base = hdr;
+  iov[0].iov_len = sizeof(struct native_medium_hdr);
+  iov[1].iov_base = (void *)data;
+  iov[1].iov_len = len;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+
+  return sendmsg(sockfd, &msg, 0) == sizeof(struct native_medium_hdr) + len;
+}
+/*---------------------------------------------------------------------------*/
+int
+native_radio_signal_strength_last(void)
+{
+  return rx_rssi;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_on(void)
+{
+  radio_is_on = 1;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_off(void)
+{
+  radio_is_on = 0;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_read(void *buf, unsigned short bufsize)
+{
+  int len;
+
+  if(rx_count == 0) {
+    return 0;
+  }
+  len = rx_frames[rx_first].len;
+  rx_rssi = rx_frames[rx_first].rssi;
+  if(bufsize < len) {
+    RIMESTATS_ADD(toolong);
+    len = 0;
+  } else {
+    memcpy(buf, rx_frames[rx_first].data, len);
+    packetbuf_set_attr(PACKETBUF_ATTR_RSSI, rx_rssi);
+    packetbuf_set_attr(PACKETBUF_ATTR_TIMESTAMP, rx_frames[rx_first].timestamp);
+    RIMESTATS_ADD(llrx);
+  }
+  rx_first = (rx_first + 1) % RX_FRAMES;
+  rx_count--;
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static int
+receiving_packet(void)
+{
+  return radio_is_on && now_us() < busy_until;
+}
+/*---------------------------------------------------------------------------*/
+static int
+pending_packet(void)
+{
+  return rx_count > 0;
+}
+/*---------------------------------------------------------------------------*/
+/* A real radio senses the channel as it is now, while the BUSY
+   messages are otherwise only read from the main loop. Without this, a
+   node that answers a frame within the same loop iteration does not see
+   a neighbor that has started to send in the meantime. Messages are
+   taken up to the first frame that is still waiting to be received. */
+static void
+update_busy(void)
+{
+  struct native_medium_hdr hdr;
+  uint64_t now;
+
+  while(sockfd >= 0 &&
+        recv(sockfd, &hdr, sizeof(hdr), MSG_PEEK | MSG_DONTWAIT) ==
+        sizeof(hdr) && hdr.type == NATIVE_MEDIUM_BUSY) {
+    recv(sockfd, &hdr, sizeof(hdr), MSG_DONTWAIT);
+    now = now_us();
+    if(now + hdr.duration > busy_until) {
+      busy_until = now + hdr.duration;
+      busy_rssi = hdr.rssi;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+receive_msg(void)
+{
+  struct native_medium_hdr *hdr;
+  uint8_t buf[sizeof(struct native_medium_hdr) + NATIVE_MEDIUM_MAX_FRAME];
+  uint64_t now;
+  int len, i;
+
+  len = recv(sockfd, buf, sizeof(buf), 0);
+  if(len == 0) {
+    printf("native-radio: medium server closed the connection\n");
+    select_set_callback(sockfd, NULL);
+    sockfd = -1;
+    return;
+  }
+  if(len < (int)sizeof(struct native_medium_hdr)) {
+    return;
+  }
+
+  hdr = (struct native_medium_hdr *)buf;
+  now = now_us();
+  switch(hdr->type) {
+  case NATIVE_MEDIUM_BUSY:
+    if(now + hdr->duration > busy_until) {
+      busy_until = now + hdr->duration;
+      busy_rssi = hdr->rssi;
+    }
+    break;
+  case NATIVE_MEDIUM_RX:
+    if(!radio_is_on) {
+      break;
+    }
+    if(rx_count == RX_FRAMES) {
+      /* Only while waiting for an acknowledgement, since the main loop
+         leaves frames in the socket until there is room. */
+      RIMESTATS_ADD(contentiondrop);
+      break;
+    }
+    i = (rx_first + rx_count) % RX_FRAMES;
+    rx_frames[i].len = len - sizeof(struct native_medium_hdr);
+    memcpy(rx_frames[i].data, buf + sizeof(struct native_medium_hdr),
+           rx_frames[i].len);
+    rx_frames[i].rssi = hdr->rssi;
+    /* Convert the start of the frame to rtimer ticks. */
+    rx_frames[i].timestamp = RTIMER_NOW() -
+      (rtimer_clock_t)((now - hdr->timestamp) * RTIMER_SECOND / 1000000);
+    rx_count++;
+    PRINTF("native-radio: %d bytes from %u, rssi %d\n",
+           rx_frames[i].len, hdr->node, hdr->rssi);
+    process_poll(&native_radio_process);
+    break;
+  case NATIVE_MEDIUM_ACK:
+    ack_seqno = hdr->seqno;
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+wait_ack(uint8_t seqno)
+{
+  struct pollfd pfd;
+  uint64_t deadline, now;
+
+  ack_seqno = -1;
+  deadline = now_us() + NATIVE_MEDIUM_ACK_WAIT;
+  while(sockfd >= 0 && ack_seqno != seqno && (now = now_us()) < deadline) {
+    pfd.fd = sockfd;
+    pfd.events = POLLIN;
+    if(poll(&pfd, 1, (deadline - now + 999) / 1000) <= 0) {
+      continue;
+    }
+    receive_msg();
+  }
+  return ack_seqno == seqno;
+}
+/*---------------------------------------------------------------------------*/
+static int
+channel_clear(void)
+{
+  update_busy();
+  return !(now_us() < busy_until && busy_rssi > CCA_SS_THRESHOLD);
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_send(const void *payload, unsigned short payload_len)
+{
+  struct native_medium_hdr hdr;
+  struct timespec airtime;
+  uint32_t duration;
+
+  if(sockfd < 0 || payload_len == 0 ||
+     payload_len > NATIVE_MEDIUM_MAX_FRAME) {
+    return RADIO_TX_ERR;
+  }
+
+  /* Transmit on CCA */
+  if(!channel_clear()) {
+    return RADIO_TX_COLLISION;
+  }
+
+  duration = NATIVE_MEDIUM_AIRTIME(payload_len);
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.type = NATIVE_MEDIUM_TX;
+  hdr.node = node;
+  hdr.duration = duration;
+  hdr.timestamp = now_us();
+  if(!send_msg(&hdr, payload, payload_len)) {
+    perror("native-radio: send");
+    return RADIO_TX_ERR;
+  }
+  RIMESTATS_ADD(lltx);
+
+  /* Like a real radio, return when the frame has been sent. */
+  airtime.tv_sec = 0;
+  airtime.tv_nsec = duration * 1000L;
+  nanosleep(&airtime, NULL);
+
+  if(payload_len >= 3 && (((uint8_t *)payload)[0] & 0x20)) {
+    return wait_ack(((uint8_t *)payload)[2]) ? RADIO_TX_OK : RADIO_TX_NOACK;
+  }
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+prepare_packet(const void *data, unsigned short len)
+{
+  pending_data = data;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+transmit_packet(unsigned short len)
+{
+  int ret = RADIO_TX_ERR;
+  if(pending_data != NULL) {
+    ret = radio_send(pending_data, len);
+  }
+  return ret;
+}
+/*---------------------------------------------------------------------------*/
+static int
+set_fd(fd_set *rset, fd_set *wset)
+{
+  /* Frames are left in the socket until there is room for them. */
+  if(rx_count == RX_FRAMES) {
+    return 0;
+  }
+  FD_SET(sockfd, rset);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_fd(fd_set *rset, fd_set *wset)
+{
+  if(FD_ISSET(sockfd, rset)) {
+    receive_msg();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static const struct select_callback native_radio_callback = {
+  set_fd, handle_fd
+};
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(native_radio_process, ev, data)
+{
+  int len;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    while(rx_count > 0) {
+      packetbuf_clear();
+      len = radio_read(packetbuf_dataptr(), PACKETBUF_SIZE);
+      if(len > 0) {
+        packetbuf_set_datalen(len);
+        NETSTACK_RDC.input();
+      }
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static int
+init(void)
+{
+  struct sockaddr_un addr;
+  struct native_medium_hdr hdr;
+  uint8_t addr_le[sizeof(rimeaddr_t)];
+  const char *path;
+  const char *id;
+  int i;
+
+  path = getenv(NATIVE_MEDIUM_SOCKET_ENV);
+  if(path == NULL) {
+    path = NATIVE_MEDIUM_DEFAULT_SOCKET;
+  }
+  id = getenv(NATIVE_MEDIUM_NODE_ID_ENV);
+  node = id != NULL ? atoi(id) : 0;
+
+  sockfd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+  if(sockfd < 0) {
+    perror("native-radio: socket");
+    return 0;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  if(connect(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "native-radio: cannot connect to %s\n", path);
+    close(sockfd);
+    sockfd = -1;
+    return 0;
+  }
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.type = NATIVE_MEDIUM_HELLO;
+  hdr.node = node;
+  /* The server acknowledges frames to this address. Frames carry it
+     least significant byte first. */
+  for(i = 0; i < sizeof(rimeaddr_t); i++) {
+    addr_le[i] = rimeaddr_node_addr.u8[sizeof(rimeaddr_t) - 1 - i];
+  }
+  send_msg(&hdr, addr_le, sizeof(rimeaddr_t));
+
+  if(!select_set_callback(sockfd, &native_radio_callback)) {
+    fprintf(stderr, "native-radio: socket %d above SELECT_MAX\n", sockfd);
+  }
+
+  printf("native-radio: node %u connected to %s\n", node, path);
+
+  process_start(&native_radio_process, NULL);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+const struct radio_driver native_radio_driver =
+{
+    init,
+    prepare_packet,
+    transmit_packet,
+    radio_send,
+    radio_read,
+    channel_clear,
+    receiving_packet,
+    pending_packet,
+    radio_on,
+    radio_off,
+};
+/*---------------------------------------------------------------------------*/
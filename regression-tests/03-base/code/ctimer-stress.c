@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Stress test for callback timers. A large number of ctimers run
+ * concurrently with random intervals. Each timer is set again from
+ * its own callback a few times, and some callbacks stop another
+ * timer. The test checks that every callback that is due is called
+ * exactly once, not too early, with the right argument and in the
+ * context of the process that set the timer, and that stopped timers
+ * are never called, not even when their memory is reused. One more
+ * timer is set again with a zero interval from its own callback for
+ * as long as the test runs, which must not keep the other timers from
+ * running.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+
+#ifndef NUM_TIMERS
+#define NUM_TIMERS 2000
+#endif
+
+#define ROUNDS       3
+#define MAX_INTERVAL (4 * CLOCK_SECOND)
+#define TEST_TIMEOUT (ROUNDS * MAX_INTERVAL + 10 * CLOCK_SECOND)
+
+static struct ctimer timers[NUM_TIMERS];
+static clock_time_t deadline[NUM_TIMERS];
+static uint8_t rounds[NUM_TIMERS];
+static uint8_t pending[NUM_TIMERS];
+
+static unsigned long expected;
+static unsigned long fired;
+static unsigned long errors;
+static unsigned npending;
+
+static struct ctimer zero_timer;
+static unsigned long zero_fired;
+/*---------------------------------------------------------------------------*/
+PROCESS(ctimer_stress_process, "Ctimer stress test");
+AUTOSTART_PROCESSES(&ctimer_stress_process);
+/*---------------------------------------------------------------------------*/
+static void callback(void *ptr);
+
+static void
+stale_callback(void *ptr)
+{
+  printf("callback of a stopped timer called\n");
+  errors++;
+}
+
+static void
+start(int i)
+{
+  clock_time_t interval;
+
+  interval = 1 + random_rand() % MAX_INTERVAL;
+  deadline[i] = clock_time() + interval;
+  if(!pending[i]) {
+    pending[i] = 1;
+    npending++;
+  }
+  expected++;
+  ctimer_set(&timers[i], interval, callback, &timers[i]);
+}
+/*---------------------------------------------------------------------------*/
+static void
+stop(int i)
+{
+  if(pending[i]) {
+    pending[i] = 0;
+    npending--;
+    expected--;
+  }
+  ctimer_stop(&timers[i]);
+  if(!ctimer_expired(&timers[i])) {
+    printf("timer %d not expired after ctimer_stop\n", i);
+    errors++;
+  }
+  /* As if the memory of the timer had been freed and reused. */
+  timers[i].f = stale_callback;
+}
+/*---------------------------------------------------------------------------*/
+static void
+callback(void *ptr)
+{
+  int i;
+
+  i = (struct ctimer *)ptr - timers;
+  if(i < 0 || i >= NUM_TIMERS) {
+    printf("bad callback argument %p\n", ptr);
+    errors++;
+    return;
+  }
+
+  fired++;
+  if(!pending[i]) {
+    printf("timer %d called while not pending\n", i);
+    errors++;
+    return;
+  }
+  pending[i] = 0;
+  npending--;
+
+  if((long)(clock_time() - deadline[i]) < 0) {
+    printf("timer %d called %ld ticks early\n", i,
+           (long)(deadline[i] - clock_time()));
+    errors++;
+  }
+  if(PROCESS_CURRENT() != &ctimer_stress_process) {
+    printf("timer %d called in the wrong process context\n", i);
+    errors++;
+  }
+  if(!ctimer_expired(&timers[i])) {
+    printf("timer %d not expired in its callback\n", i);
+    errors++;
+  }
+
+  if(++rounds[i] < ROUNDS) {
+    start(i);
+  }
+
+  /* Every now and then, stop another timer that may be pending. */
+  if(i % 7 == 0) {
+    stop((i + NUM_TIMERS / 2) % NUM_TIMERS);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+zero_callback(void *ptr)
+{
+  zero_fired++;
+  if(npending > 0) {
+    ctimer_set(&zero_timer, 0, zero_callback, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ctimer_stress_process, ev, data)
+{
+  static struct etimer et;
+  static clock_time_t started;
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("Starting %d ctimers\n", NUM_TIMERS);
+
+  for(i = 0; i < NUM_TIMERS; i++) {
+    start(i);
+  }
+  ctimer_set(&zero_timer, 0, zero_callback, NULL);
+
+  started = clock_time();
+  while(npending > 0 && clock_time() - started < TEST_TIMEOUT) {
+    etimer_set(&et, CLOCK_SECOND);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  }
+
+  /* Give any stray callbacks a chance to show up. */
+  etimer_set(&et, MAX_INTERVAL);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  printf("%lu callbacks, %lu expected, %u pending, %lu errors, "
+         "%lu zero interval callbacks\n",
+         fired, expected, npending, errors, zero_fired);
+  if(npending == 0 && fired == expected && errors == 0 && zero_fired > 0) {
+    printf("TEST OK\n");
+  } else {
+    printf("TEST FAILED\n");
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,12 @@
+TIMEOUT(60000);
+
+while(true) {
+  log.log("> " + msg + "\n");
+  if (msg.equals('TEST OK')) {
+    log.testOK();
+  }
+  if (msg.equals('TEST FAILED')) {
+    log.testFailed();
+  }
+  YIELD();
+}
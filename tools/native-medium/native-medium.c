@@ -0,0 +1,623 @@
+/*
+ * Copyright (c) 2012, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Radio medium server for native Contiki nodes that use the
+ *         native radio driver (platform/native/dev/native-radio.c).
+ *
+ *         Nodes connect to a UNIX socket. A frame sent by one node is
+ *         delivered to the nodes that have a link from the sender,
+ *         subject to the packet reception ratio (PRR), delay and RSSI
+ *         of the link. Frames that overlap at a receiver, or that
+ *         arrive while the receiver itself is sending, are lost.
+ *         Frames that ask for an acknowledgement and are addressed to
+ *         the receiver are acknowledged over the reverse link, like a
+ *         radio with automatic acknowledgements does. Acknowledgements
+ *         take no airtime.
+ *
+ *         Usage: native-medium [-s socket] [-t topology] [-p prr]
+ *                              [-r rssi] [-d delay] [-S seed] [-v]
+ *
+ *         Without a topology file, every node hears every other node
+ *         with the PRR, RSSI and delay given by -p, -r and -d. A
+ *         topology file has one statement per line:
+ *
+ *           default <prr> <rssi> [<delay>]
+ *           link <from> <to> <prr> <rssi> [<delay>]
+ *           edge <node> <node> <prr> <rssi> [<delay>]
+ *
+ *         where link is one-way and edge goes both ways. Node pairs
+ *         that are not listed only have a link if there is a default
+ *         line. Delays are in microseconds. Lines starting with # are
+ *         ignored.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include "native-medium.h"
+
+#define MAX_NODES      1024
+#define MAX_RECEPTIONS 8192
+
+struct link {
+  struct link *next;
+  uint16_t to;
+  double prr;
+  int rssi;
+  uint32_t delay;
+};
+
+struct node {
+  int fd;
+  int has_id;
+  uint16_t id;
+  uint8_t addr[8];
+  int addr_len;
+  uint64_t tx_until;
+  unsigned long tx, rx, lost, collisions;
+};
+
+struct reception {
+  struct node *to;
+  uint16_t from;
+  int8_t rssi;
+  uint8_t collided;
+  uint64_t start, end;
+  uint8_t len;
+  uint8_t data[NATIVE_MEDIUM_MAX_FRAME];
+};
+
+static struct link *links[65536];
+static struct link default_link;
+static int has_default_link = 1;
+
+static struct node nodes[MAX_NODES];
+static int nnodes;
+
+static struct reception receptions[MAX_RECEPTIONS];
+static int nreceptions;
+
+static int verbose;
+static volatile sig_atomic_t done;
+
+/*---------------------------------------------------------------------------*/
+static uint64_t
+now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_link(uint16_t from, uint16_t to, double prr, int rssi, uint32_t delay)
+{
+  struct link *l;
+
+  for(l = links[from]; l != NULL && l->to != to; l = l->next);
+  if(l == NULL) {
+    l = malloc(sizeof(struct link));
+    if(l == NULL) {
+      perror("malloc");
+      exit(1);
+    }
+    l->to = to;
+    l->next = links[from];
+    links[from] = l;
+  }
+  l->prr = prr;
+  l->rssi = rssi;
+  l->delay = delay;
+}
+/*---------------------------------------------------------------------------*/
+static const struct link *
+get_link(uint16_t from, uint16_t to)
+{
+  struct link *l;
+
+  for(l = links[from]; l != NULL; l = l->next) {
+    if(l->to == to) {
+      return l;
+    }
+  }
+  return has_default_link ? &default_link : NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+read_topology(const char *filename)
+{
+  FILE *f;
+  char line[128];
+  char cmd[16];
+  unsigned a, b;
+  double prr;
+  int rssi;
+  unsigned long delay;
+  int n;
+  int lineno;
+
+  f = fopen(filename, "r");
+  if(f == NULL) {
+    perror(filename);
+    exit(1);
+  }
+
+  has_default_link = 0;
+  lineno = 0;
+  while(fgets(line, sizeof(line), f) != NULL) {
+    lineno++;
+    if(line[0] == '#' || sscanf(line, "%15s", cmd) != 1) {
+      continue;
+    }
+    delay = 0;
+    if(strcmp(cmd, "default") == 0) {
+      n = sscanf(line, "%*s %lf %d %lu", &prr, &rssi, &delay);
+      if(n >= 2) {
+        has_default_link = 1;
+        default_link.prr = prr;
+        default_link.rssi = rssi;
+        default_link.delay = delay;
+        continue;
+      }
+    } else if(strcmp(cmd, "link") == 0 || strcmp(cmd, "edge") == 0) {
+      n = sscanf(line, "%*s %u %u %lf %d %lu", &a, &b, &prr, &rssi, &delay);
+      if(n >= 4 && a < 65536 && b < 65536) {
+        add_link(a, b, prr, rssi, delay);
+        if(cmd[0] == 'e') {
+          add_link(b, a, prr, rssi, delay);
+        }
+        continue;
+      }
+    }
+    fprintf(stderr, "%s:%d: syntax error\n", filename, lineno);
+    exit(1);
+  }
+  fclose(f);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_msg(struct node *n, struct native_medium_hdr *hdr,
+         const void *data, int len)
+{
+  struct iovec iov[2];
+  struct msghdr msg;
+
+  iov[0].iov_base = hdr;
+  iov[0].iov_len = sizeof(struct native_medium_hdr);
+  iov[1].iov_base = (void *)data;
+  iov[1].iov_len = len;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+
+  /* A node that does not keep up loses the message, as it would lose
+     a frame on a real radio. */
+  if(sendmsg(n->fd, &msg, MSG_DONTWAIT) < 0 && errno != EAGAIN) {
+    perror("sendmsg");
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+transmit(struct node *sender, uint8_t *data, int len)
+{
+  struct native_medium_hdr hdr;
+  struct reception *r;
+  const struct link *l;
+  struct node *n;
+  uint64_t now, start, end;
+  uint32_t airtime;
+  int i, j;
+
+  now = now_us();
+  airtime = NATIVE_MEDIUM_AIRTIME(len);
+  sender->tx++;
+  sender->tx_until = now + airtime;
+
+  /* The sender cannot receive while sending. */
+  for(j = 0; j < nreceptions; j++) {
+    r = &receptions[j];
+    if(r->to == sender && r->end > now && !r->collided) {
+      r->collided = 1;
+      sender->collisions++;
+    }
+  }
+
+  for(i = 0; i < nnodes; i++) {
+    n = &nodes[i];
+    if(n == sender || !n->has_id) {
+      continue;
+    }
+    l = get_link(sender->id, n->id);
+    if(l == NULL || l->prr <= 0) {
+      continue;
+    }
+
+    start = now + l->delay;
+    end = start + airtime;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.type = NATIVE_MEDIUM_BUSY;
+    hdr.rssi = l->rssi;
+    hdr.node = sender->id;
+    hdr.duration = l->delay + airtime;
+    hdr.timestamp = start;
+    send_msg(n, &hdr, NULL, 0);
+
+    if(nreceptions == MAX_RECEPTIONS) {
+      n->lost++;
+      continue;
+    }
+    r = &receptions[nreceptions++];
+    r->to = n;
+    r->from = sender->id;
+    r->rssi = l->rssi;
+    r->start = start;
+    r->end = end;
+    r->len = len;
+    memcpy(r->data, data, len);
+    r->collided = (double)random() / RAND_MAX >= l->prr;
+    if(r->collided) {
+      n->lost++;
+      continue;
+    }
+    if(n->tx_until > start) {
+      r->collided = 1;
+      n->collisions++;
+      continue;
+    }
+
+    /* Overlapping frames destroy each other. */
+    for(j = 0; j < nreceptions - 1; j++) {
+      if(receptions[j].to == n &&
+         receptions[j].start < end && start < receptions[j].end) {
+        if(!receptions[j].collided) {
+          receptions[j].collided = 1;
+          n->collisions++;
+        }
+        if(!r->collided) {
+          r->collided = 1;
+          n->collisions++;
+        }
+      }
+    }
+  }
+
+  if(verbose) {
+    printf("%llu: %u sends %d bytes\n", (unsigned long long)now,
+           sender->id, len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Acknowledge a received 802.15.4 frame that asks for it and whose
+   destination address is that of the receiver. */
+static void
+acknowledge(const struct reception *r)
+{
+  struct native_medium_hdr hdr;
+  const struct link *l;
+  int fcf, addr_len, i;
+
+  if(r->len < 5) {
+    return;
+  }
+  fcf = r->data[0] | (r->data[1] << 8);
+  addr_len = ((fcf >> 10) & 3) == 3 ? 8 : 2;
+  /* The destination address follows the sequence number and PAN ID. */
+  if(!(fcf & 0x20) || ((fcf >> 10) & 3) < 2 || r->len < 5 + addr_len ||
+     addr_len != r->to->addr_len ||
+     memcmp(&r->data[5], r->to->addr, addr_len) != 0) {
+    return;
+  }
+  l = get_link(r->to->id, r->from);
+  if(l == NULL || (double)random() / RAND_MAX >= l->prr) {
+    return;
+  }
+  for(i = 0; i < nnodes; i++) {
+    if(nodes[i].has_id && nodes[i].id == r->from) {
+      memset(&hdr, 0, sizeof(hdr));
+      hdr.type = NATIVE_MEDIUM_ACK;
+      hdr.node = r->to->id;
+      hdr.seqno = r->data[2];
+      send_msg(&nodes[i], &hdr, NULL, 0);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+deliver(uint64_t now)
+{
+  struct native_medium_hdr hdr;
+  struct reception *r;
+  int i;
+
+  for(i = 0; i < nreceptions;) {
+    r = &receptions[i];
+    if(r->end > now) {
+      i++;
+      continue;
+    }
+    if(!r->collided) {
+      memset(&hdr, 0, sizeof(hdr));
+      hdr.type = NATIVE_MEDIUM_RX;
+      hdr.rssi = r->rssi;
+      hdr.node = r->from;
+      hdr.duration = r->end - r->start;
+      hdr.timestamp = r->start;
+      send_msg(r->to, &hdr, r->data, r->len);
+      r->to->rx++;
+      acknowledge(r);
+    }
+    *r = receptions[--nreceptions];
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint64_t
+next_delivery(void)
+{
+  uint64_t next;
+  int i;
+
+  next = UINT64_MAX;
+  for(i = 0; i < nreceptions; i++) {
+    if(receptions[i].end < next) {
+      next = receptions[i].end;
+    }
+  }
+  return next;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_node(int i)
+{
+  struct node *n;
+  int j;
+
+  n = &nodes[i];
+  if(n->has_id) {
+    printf("node %u left: tx %lu rx %lu lost %lu collisions %lu\n",
+           n->id, n->tx, n->rx, n->lost, n->collisions);
+  }
+  close(n->fd);
+
+  for(j = 0; j < nreceptions;) {
+    if(receptions[j].to == n) {
+      receptions[j] = receptions[--nreceptions];
+    } else {
+      j++;
+    }
+  }
+
+  /* Move the last node into the free slot. */
+  nnodes--;
+  if(i != nnodes) {
+    nodes[i] = nodes[nnodes];
+    for(j = 0; j < nreceptions; j++) {
+      if(receptions[j].to == &nodes[nnodes]) {
+        receptions[j].to = &nodes[i];
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_node(int i)
+{
+  uint8_t buf[sizeof(struct native_medium_hdr) + NATIVE_MEDIUM_MAX_FRAME];
+  struct native_medium_hdr *hdr;
+  struct node *n;
+  int len;
+
+  n = &nodes[i];
+  len = recv(n->fd, buf, sizeof(buf), 0);
+  if(len <= 0) {
+    remove_node(i);
+    return;
+  }
+  if(len < (int)sizeof(struct native_medium_hdr)) {
+    return;
+  }
+
+  hdr = (struct native_medium_hdr *)buf;
+  switch(hdr->type) {
+  case NATIVE_MEDIUM_HELLO:
+    n->id = hdr->node;
+    n->has_id = 1;
+    n->addr_len = len - sizeof(struct native_medium_hdr);
+    if(n->addr_len > (int)sizeof(n->addr)) {
+      n->addr_len = sizeof(n->addr);
+    }
+    memcpy(n->addr, buf + sizeof(struct native_medium_hdr), n->addr_len);
+    if(verbose) {
+      printf("node %u connected\n", n->id);
+    }
+    break;
+  case NATIVE_MEDIUM_TX:
+    if(n->has_id) {
+      transmit(n, buf + sizeof(struct native_medium_hdr),
+               len - sizeof(struct native_medium_hdr));
+    }
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+stop(int sig)
+{
+  done = 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+usage(const char *prog)
+{
+  fprintf(stderr, "usage: %s [-s socket] [-t topology] [-p prr] [-r rssi]"
+          " [-d delay] [-S seed] [-v]\n", prog);
+  exit(1);
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  static struct pollfd fds[MAX_NODES + 1];
+  struct sockaddr_un addr;
+  struct timespec timeout;
+  const char *path;
+  uint64_t now, next;
+  int listenfd;
+  int fd;
+  int c;
+  int i;
+
+  path = NATIVE_MEDIUM_DEFAULT_SOCKET;
+  default_link.prr = 1.0;
+  default_link.rssi = -60;
+  default_link.delay = 0;
+  srandom(time(NULL));
+
+  while((c = getopt(argc, argv, "s:t:p:r:d:S:v")) != -1) {
+    switch(c) {
+    case 's':
+      path = optarg;
+      break;
+    case 't':
+      read_topology(optarg);
+      break;
+    case 'p':
+      default_link.prr = atof(optarg);
+      break;
+    case 'r':
+      default_link.rssi = atoi(optarg);
+      break;
+    case 'd':
+      default_link.delay = atol(optarg);
+      break;
+    case 'S':
+      srandom(atol(optarg));
+      break;
+    case 'v':
+      verbose = 1;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  listenfd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+  if(listenfd < 0) {
+    perror("socket");
+    return 1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  unlink(path);
+  if(bind(listenfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+     listen(listenfd, 64) < 0) {
+    perror(path);
+    return 1;
+  }
+
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+  signal(SIGPIPE, SIG_IGN);
+
+  printf("native-medium listening on %s\n", path);
+
+  while(!done) {
+    fds[0].fd = listenfd;
+    fds[0].events = POLLIN;
+    for(i = 0; i < nnodes; i++) {
+      fds[i + 1].fd = nodes[i].fd;
+      fds[i + 1].events = POLLIN;
+      fds[i + 1].revents = 0;
+    }
+
+    now = now_us();
+    next = next_delivery();
+    if(next != UINT64_MAX) {
+      next = next > now ? next - now : 0;
+      timeout.tv_sec = next / 1000000;
+      timeout.tv_nsec = (next % 1000000) * 1000;
+    }
+
+    if(ppoll(fds, nnodes + 1, next == UINT64_MAX ? NULL : &timeout,
+             NULL) < 0) {
+      if(errno != EINTR) {
+        perror("ppoll");
+      }
+      continue;
+    }
+
+    /* Frames are handled in the order they reach the server. Nodes
+       are handled from the last one, since a node that leaves is
+       replaced by the last node. */
+    for(i = nnodes - 1; i >= 0; i--) {
+      if(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) {
+        handle_node(i);
+      }
+    }
+
+    if(fds[0].revents & POLLIN) {
+      fd = accept(listenfd, NULL, NULL);
+      if(fd >= 0) {
+        if(nnodes == MAX_NODES) {
+          close(fd);
+        } else {
+          memset(&nodes[nnodes], 0, sizeof(struct node));
+          nodes[nnodes].fd = fd;
+          nnodes++;
+        }
+      }
+    }
+
+    deliver(now_us());
+  }
+
+  for(i = nnodes - 1; i >= 0; i--) {
+    remove_node(i);
+  }
+  unlink(path);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/